@@ -0,0 +1,253 @@
+#include "alloc.h"
+
+// Sites by tag, for the profile and for the error of the checked calls
+static const char* tag_names[] = {
+    "program", "class", "function", "declaration", "assignment", "block", "if", "while", "return",
+    "print", "expression", "variable", "literal", "binary op", "unary op", "function call", "new",
+    "member access", "method call", "identifier list", "string literal", "super", "type cast",
+    "this", "lazy body", "token text", "symbols", "member lists", "ir", "analysis", "code", "modules",
+    "vm",
+};
+
+_Static_assert(sizeof(tag_names) / sizeof(tag_names[0]) == ALLOC_TAG_COUNT, "a name for every site");
+
+static int failure_status = EXIT_FAILURE;
+
+static void* checked(void* memory, int tag) {
+    if (!memory) {
+        fprintf(stderr, "Error: could not assign memory (%s).\n", tag_names[tag]);
+        exit(failure_status);
+    }
+    return memory;
+}
+
+void* checkedMalloc(size_t size, int tag) {
+    return checked(compilerMalloc(size ? size : 1, tag), tag);
+}
+
+void* checkedCalloc(size_t count, size_t size, int tag) {
+    return checked(compilerCalloc(count ? count : 1, size ? size : 1, tag), tag);
+}
+
+void* checkedRealloc(void* memory, size_t size, int tag) {
+    return checked(compilerRealloc(memory, size ? size : 1, tag), tag);
+}
+
+char* checkedStrdup(const char* text, int tag) {
+    return checked(compilerStrdup(text, tag), tag);
+}
+
+void setAllocFailureStatus(int status) {
+    failure_status = status;
+}
+
+#ifdef ALLOC_PROFILE
+
+#include <stdint.h>
+#include <pthread.h>
+
+typedef struct {
+    long calls;
+    long bytes;                    // Requested by the calls, a realloc counts its new size
+    long live;                     // Still allocated
+} AllocCounter;
+
+// Block the profiler knows: what it counts against when it is freed
+typedef struct {
+    void* memory;
+    size_t size;
+    unsigned char phase;
+    unsigned char tag;
+} AllocRecord;
+
+static const char* phase_names[] = {"parse", "semantic", "ir", "optimize", "codegen"};
+
+_Static_assert(sizeof(phase_names) / sizeof(phase_names[0]) == ALLOC_PHASE_COUNT, "a name for every phase");
+
+// The pipelined lexer allocates on its own thread, so the tables have a lock
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static AllocCounter counters[ALLOC_PHASE_COUNT][ALLOC_TAG_COUNT];
+static AllocPhase phase = ALLOC_PHASE_PARSE;
+static AllocRecord* records = NULL;        // Open addressing by address, a power of two
+static size_t record_capacity = 0;
+static size_t record_count = 0;
+static long live_bytes = 0;
+static long peak_bytes = 0;
+static bool registered = false;
+
+static void printAtExit() {
+    printAllocProfile(stderr);
+}
+
+static size_t slotOf(void* memory) {
+    return (size_t)(((uintptr_t)memory >> 4) * 0x9E3779B97F4A7C15ull) & (record_capacity - 1);
+}
+
+static void insertRecord(AllocRecord record);
+
+static void growRecords() {
+    AllocRecord* old = records;
+    size_t oldCapacity = record_capacity;
+    record_capacity = record_capacity ? record_capacity * 2 : 4096;
+    records = calloc(record_capacity, sizeof(AllocRecord));
+    if (!records) {
+        fprintf(stderr, "Error: could not assign memory for the allocation profile.\n");
+        exit(EXIT_FAILURE);
+    }
+    record_count = 0;
+    for (size_t r = 0; r < oldCapacity; r++) {
+        if (old[r].memory) insertRecord(old[r]);
+    }
+    free(old);
+}
+
+static void insertRecord(AllocRecord record) {
+    if (2 * (record_count + 1) > record_capacity) growRecords();
+    size_t slot = slotOf(record.memory);
+    while (records[slot].memory) slot = (slot + 1) & (record_capacity - 1);
+    records[slot] = record;
+    record_count++;
+}
+
+// Take the record of the block out, with backward shifting so the probes stay unbroken
+static bool removeRecord(void* memory, AllocRecord* removed) {
+    if (!record_capacity) return false;
+    size_t slot = slotOf(memory);
+    while (records[slot].memory != memory) {
+        if (!records[slot].memory) return false;
+        slot = (slot + 1) & (record_capacity - 1);
+    }
+    *removed = records[slot];
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & (record_capacity - 1); records[next].memory; next = (next + 1) & (record_capacity - 1)) {
+        size_t home = slotOf(records[next].memory);
+        // The entry can move into the hole when its home is not between the hole and it
+        if (((next - home) & (record_capacity - 1)) >= ((next - hole) & (record_capacity - 1))) {
+            records[hole] = records[next];
+            hole = next;
+        }
+    }
+    records[hole].memory = NULL;
+    record_count--;
+    return true;
+}
+
+static void countFreed(AllocRecord* record) {
+    counters[record->phase][record->tag].live -= record->size;
+    live_bytes -= record->size;
+}
+
+static void forget(void* memory) {
+    AllocRecord record;
+    if (removeRecord(memory, &record)) countFreed(&record);
+}
+
+static void track(void* memory, size_t size, int tag) {
+    if (!memory) return;
+    if (tag < 0 || tag >= ALLOC_TAG_COUNT) tag = ALLOC_ANALYSIS;
+    if (!registered) {
+        registered = true;
+        atexit(printAtExit);
+    }
+    // A block freed with free comes back at the same address, its old record is stale
+    forget(memory);
+    AllocCounter* counter = &counters[phase][tag];
+    counter->calls++;
+    counter->bytes += size;
+    counter->live += size;
+    live_bytes += size;
+    if (live_bytes > peak_bytes) peak_bytes = live_bytes;
+    insertRecord((AllocRecord){memory, size, phase, tag});
+}
+
+void* compilerMalloc(size_t size, int tag) {
+    void* memory = malloc(size);
+    pthread_mutex_lock(&lock);
+    track(memory, size, tag);
+    pthread_mutex_unlock(&lock);
+    return memory;
+}
+
+void* compilerCalloc(size_t count, size_t size, int tag) {
+    void* memory = calloc(count, size);
+    pthread_mutex_lock(&lock);
+    track(memory, count * size, tag);
+    pthread_mutex_unlock(&lock);
+    return memory;
+}
+
+void* compilerRealloc(void* memory, size_t size, int tag) {
+    // Held across the call: once the old block is freed another thread could get its address
+    pthread_mutex_lock(&lock);
+    AllocRecord old;
+    bool known = memory && removeRecord(memory, &old);
+    void* moved = realloc(memory, size);
+    if (known && !moved && size) insertRecord(old);     // It failed, the old block is still there
+    else if (known) countFreed(&old);
+    track(moved, size, tag);
+    pthread_mutex_unlock(&lock);
+    return moved;
+}
+
+char* compilerStrdup(const char* text, int tag) {
+    char* copy = strdup(text);
+    pthread_mutex_lock(&lock);
+    track(copy, strlen(text) + 1, tag);
+    pthread_mutex_unlock(&lock);
+    return copy;
+}
+
+char* compilerStrndup(const char* text, size_t length, int tag) {
+    char* copy = strndup(text, length);
+    pthread_mutex_lock(&lock);
+    if (copy) track(copy, strlen(copy) + 1, tag);
+    pthread_mutex_unlock(&lock);
+    return copy;
+}
+
+void compilerFree(void* memory) {
+    if (!memory) return;
+    pthread_mutex_lock(&lock);
+    forget(memory);
+    free(memory);
+    pthread_mutex_unlock(&lock);
+}
+
+void setAllocPhase(AllocPhase next) {
+    pthread_mutex_lock(&lock);
+    phase = next;
+    pthread_mutex_unlock(&lock);
+}
+
+void printAllocProfile(FILE* out) {
+    pthread_mutex_lock(&lock);
+    // Rows by bytes, the largest first
+    int order[ALLOC_PHASE_COUNT * ALLOC_TAG_COUNT];
+    int rows = 0;
+    long calls = 0;
+    long bytes = 0;
+    for (int p = 0; p < ALLOC_PHASE_COUNT; p++) {
+        for (int t = 0; t < ALLOC_TAG_COUNT; t++) {
+            if (!counters[p][t].calls) continue;
+            calls += counters[p][t].calls;
+            bytes += counters[p][t].bytes;
+            int row = rows++;
+            while (row > 0 && counters[order[row - 1] / ALLOC_TAG_COUNT][order[row - 1] % ALLOC_TAG_COUNT].bytes < counters[p][t].bytes) {
+                order[row] = order[row - 1];
+                row--;
+            }
+            order[row] = p * ALLOC_TAG_COUNT + t;
+        }
+    }
+    fprintf(out, "Allocation profile: %ld calls, %ld bytes, %ld bytes live at the end, %ld at the peak.\n",
+            calls, bytes, live_bytes, peak_bytes);
+    fprintf(out, "  %-9s %-16s %10s %14s %12s\n", "phase", "site", "calls", "bytes", "live");
+    for (int r = 0; r < rows; r++) {
+        AllocCounter* counter = &counters[order[r] / ALLOC_TAG_COUNT][order[r] % ALLOC_TAG_COUNT];
+        fprintf(out, "  %-9s %-16s %10ld %14ld %12ld\n", phase_names[order[r] / ALLOC_TAG_COUNT],
+                tag_names[order[r] % ALLOC_TAG_COUNT], counter->calls, counter->bytes, counter->live);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+#endif // ALLOC_PROFILE
@@ -0,0 +1,73 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include "ast.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Allocations of the compiler go through these calls with a tag for the site. In a build with
+// ALLOC_PROFILE defined (make ALLOC_PROFILE=1) every tag of every phase counts its calls, bytes
+// and live bytes, and the totals are printed into stderr at exit; otherwise they are the calls
+// of the C library. Memory of these calls can be given to free and the other way round: the
+// profiler keeps its records aside, a block it does not know is just freed.
+
+// Phases of a compilation, set by the driver before each one runs
+typedef enum {
+    ALLOC_PHASE_PARSE,             // Interfaces, lexer, parser and lazy bodies
+    ALLOC_PHASE_SEMANTIC,
+    ALLOC_PHASE_IR,                // Lowering into the intermediate code
+    ALLOC_PHASE_OPTIMIZE,          // Escape analysis, tail calls and loops
+    ALLOC_PHASE_CODEGEN,           // Layout, register allocation, code and peephole
+    ALLOC_PHASE_COUNT
+} AllocPhase;
+
+// Sites: the kind of the AST node (ASTNodeType) for the nodes and their strings, or one of these
+typedef enum {
+    ALLOC_TOKEN = AST_LAZY_BODY + 1,   // Text of the tokens made by the lexer
+    ALLOC_SYMBOLS,                 // Names and types of the symbol table
+    ALLOC_MEMBER_LISTS,            // Attribute, method and parameter lists of the symbols
+    ALLOC_IR,                      // Intermediate code
+    ALLOC_ANALYSIS,                // Graphs, sets and tables of the optimizations and of the layout
+    ALLOC_CODE,                    // VYPcode and assembly
+    ALLOC_MODULES,                 // Incremental cache, interfaces, streaming, pipelined lexer, batch, server
+    ALLOC_VM,                      // Interpreter: loaded code, heap and bytecode
+    ALLOC_TAG_COUNT
+} AllocTag;
+
+#ifdef ALLOC_PROFILE
+
+void* compilerMalloc(size_t size, int tag);
+void* compilerCalloc(size_t count, size_t size, int tag);
+void* compilerRealloc(void* memory, size_t size, int tag);
+char* compilerStrdup(const char* text, int tag);
+char* compilerStrndup(const char* text, size_t length, int tag);
+void compilerFree(void* memory);
+void setAllocPhase(AllocPhase phase);
+
+// Totals so far, by phase and tag (the exit prints them too)
+void printAllocProfile(FILE* out);
+
+#else
+
+#define compilerMalloc(size, tag) malloc(size)
+#define compilerCalloc(count, size, tag) calloc(count, size)
+#define compilerRealloc(memory, size, tag) realloc(memory, size)
+#define compilerStrdup(text, tag) strdup(text)
+#define compilerStrndup(text, length, tag) strndup(text, length)
+#define compilerFree(memory) free(memory)
+#define setAllocPhase(phase) ((void)(phase))
+#define printAllocProfile(out) ((void)(out))
+
+#endif // ALLOC_PROFILE
+
+// The same calls for memory the caller cannot do without: when it runs out they print the site
+// into stderr and exit with the status of setAllocFailureStatus (EXIT_FAILURE unless changed).
+// A count or size of zero still gets a block.
+void* checkedMalloc(size_t size, int tag);
+void* checkedCalloc(size_t count, size_t size, int tag);
+void* checkedRealloc(void* memory, size_t size, int tag);
+char* checkedStrdup(const char* text, int tag);
+void setAllocFailureStatus(int status);
+
+#endif // ALLOC_H
@@ -1,11 +1,12 @@
 #include "ast.h"
+#include "alloc.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 // Function to create a program node
 ASTProgramNode* createProgramNode(ASTNode* classes, ASTNode* functions) {
-    ASTProgramNode* node = (ASTProgramNode*)malloc(sizeof(ASTProgramNode));
+    ASTProgramNode* node = (ASTProgramNode*)compilerMalloc(sizeof(ASTProgramNode), AST_PROGRAM);
     if (!node) {
         fprintf(stderr, "Error: You could not assign memory for astprogramnode.\n");
         exit(EXIT_FAILURE);
@@ -18,28 +19,29 @@ ASTProgramNode* createProgramNode(ASTNode* classes, ASTNode* functions) {
 }
 
 ASTClassNode* createClassNode(const char* name, const char* parent, ASTNode* members) {
-    ASTClassNode* node = (ASTClassNode*)malloc(sizeof(ASTClassNode));
+    ASTClassNode* node = (ASTClassNode*)compilerMalloc(sizeof(ASTClassNode), AST_CLASS);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTClassNode.\n");
         exit(EXIT_FAILURE);
     }
-    //node->base.next = NULL;
+    node->base.next = NULL;
     node->base.type = AST_CLASS;
-    node->name = strdup(name);  // copy the name of the class
-    node->parent = parent ? strdup(parent) : NULL;  // If you have a base class
+    node->name = compilerStrdup(name, AST_CLASS);  // copy the name of the class
+    node->parent = parent ? compilerStrdup(parent, AST_CLASS) : NULL;  // If you have a base class
     node->members = members;    // class members (functions or attributes)
     return node;
 }
 
 ASTFunctionNode* createFunctionNode(const char* name, const char* returnType, ASTNode* parameters, ASTNode* body) {
-    ASTFunctionNode* node = (ASTFunctionNode*)malloc(sizeof(ASTFunctionNode));
+    ASTFunctionNode* node = (ASTFunctionNode*)compilerMalloc(sizeof(ASTFunctionNode), AST_FUNCTION);
     if (!node) {
         fprintf(stderr, "Error: You could not assign memory for astfunctionnode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_FUNCTION; // Assign the node type
-    node->name = strdup(name);      // Copy the name of the function
-    node->returnType = strdup(returnType); // Copy the type of return
+    node->base.next = NULL;
+    node->name = compilerStrdup(name, AST_FUNCTION);      // Copy the name of the function
+    node->returnType = compilerStrdup(returnType, AST_FUNCTION); // Copy the type of return
     node->parameters = parameters ? parameters : NULL; // Parameter list
     node->body = body;             // Body of the function
 
@@ -57,22 +59,22 @@ ASTFunctionNode* createFunctionNode(const char* name, const char* returnType, AS
 
 // Function to create a declaration node
 ASTDeclarationNode* createDeclarationNode(const char* type, const char* name, ASTNode* init) {
-    ASTDeclarationNode* node = (ASTDeclarationNode*)malloc(sizeof(ASTDeclarationNode));
+    ASTDeclarationNode* node = (ASTDeclarationNode*)compilerMalloc(sizeof(ASTDeclarationNode), AST_DECLARATION);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTDeclarationNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_DECLARATION;  // Assign the node type
     node->base.next = NULL;             // Without next node
-    node->type = strdup(type);          // Copy the type of variable
-    node->name = strdup(name);          // Copy the name of the variable
+    node->type = compilerStrdup(type, AST_DECLARATION);          // Copy the type of variable
+    node->name = compilerStrdup(name, AST_DECLARATION);          // Copy the name of the variable
     node->init = init;                  // Initialization expression (it can be null)
     return node;
 }
 
 // Function to create a statement list node
 ASTDeclarationListNode* createDeclarationListNode(ASTNode* declaration, ASTNode* rest) {
-    ASTDeclarationListNode* node = (ASTDeclarationListNode*)malloc(sizeof(ASTDeclarationListNode));
+    ASTDeclarationListNode* node = (ASTDeclarationListNode*)compilerMalloc(sizeof(ASTDeclarationListNode), AST_DECLARATION);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTDeclarationListNode.\n");
         exit(EXIT_FAILURE);
@@ -86,12 +88,13 @@ ASTDeclarationListNode* createDeclarationListNode(ASTNode* declaration, ASTNode*
 //Op Nodes
 
 ASTBinaryOpNode* createBinaryOpNode(BinaryOperator op, ASTNode* left, ASTNode* right) {
-    ASTBinaryOpNode* node = (ASTBinaryOpNode*)malloc(sizeof(ASTBinaryOpNode));
+    ASTBinaryOpNode* node = (ASTBinaryOpNode*)compilerMalloc(sizeof(ASTBinaryOpNode), AST_BINARY_OP);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTBinaryOpNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_BINARY_OP;
+    node->base.next = NULL;
     node->left = left;
     node->right = right;
     node->op = op;
@@ -99,38 +102,40 @@ ASTBinaryOpNode* createBinaryOpNode(BinaryOperator op, ASTNode* left, ASTNode* r
 }
 
 ASTUnaryOpNode* createUnaryOpNode(UnaryOperator op, ASTNode* operand) {
-    ASTUnaryOpNode* node = (ASTUnaryOpNode*)malloc(sizeof(ASTUnaryOpNode));
+    ASTUnaryOpNode* node = (ASTUnaryOpNode*)compilerMalloc(sizeof(ASTUnaryOpNode), AST_UNARY_OP);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTUnaryOpNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_UNARY_OP;
+    node->base.next = NULL;
     node->operand = operand;
     node->op = op;
     return node;
 }
 
 ASTLiteralNode* createLiteralNode(const char* value, const char* type) {
-    ASTLiteralNode* node = (ASTLiteralNode*)malloc(sizeof(ASTLiteralNode));
+    ASTLiteralNode* node = (ASTLiteralNode*)compilerMalloc(sizeof(ASTLiteralNode), AST_LITERAL);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTLiteralNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_LITERAL;
-    node->value = strdup(value);
-    node->literalType = strdup(type);
+    node->base.next = NULL;
+    node->value = compilerStrdup(value, AST_LITERAL);
+    node->literalType = compilerStrdup(type, AST_LITERAL);
     return node;
 }
 
 ASTVariableNode* createVariableNode(const char* name) {
-    ASTVariableNode* node = (ASTVariableNode*)malloc(sizeof(ASTVariableNode));
+    ASTVariableNode* node = (ASTVariableNode*)compilerMalloc(sizeof(ASTVariableNode), AST_VARIABLE);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTVariableNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_VARIABLE;
     node->base.next = NULL;
-    node->name = strdup(name);
+    node->name = compilerStrdup(name, AST_VARIABLE);
     return node;
 }
 
@@ -149,7 +154,7 @@ ASTNode* appendNode(ASTNode* list, ASTNode* node) {
 
 // Function to create a block node
 ASTBlockNode* createBlockNode(ASTNode* statements) {
-    ASTBlockNode* node = (ASTBlockNode*)malloc(sizeof(ASTBlockNode));
+    ASTBlockNode* node = (ASTBlockNode*)compilerMalloc(sizeof(ASTBlockNode), AST_BLOCK);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTBlockNode.\n");
         exit(EXIT_FAILURE);
@@ -162,25 +167,27 @@ ASTBlockNode* createBlockNode(ASTNode* statements) {
 
 // Function to create a new node
 ASTNewNode* createNewNode(const char* className, ASTNode* arguments) {
-    ASTNewNode* node = (ASTNewNode*)malloc(sizeof(ASTNewNode));
+    ASTNewNode* node = (ASTNewNode*)compilerMalloc(sizeof(ASTNewNode), AST_NEW);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTNewNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_NEW;
-    node->className = strdup(className); // Copy of the class name
+    node->base.next = NULL;
+    node->className = compilerStrdup(className, AST_NEW); // Copy of the class name
     node->arguments = arguments;        // List of Arguments
     return node;
 }
 
 // Function to create the IF node
 ASTIfNode* createIfNode(ASTNode* condition, ASTNode* trueBlock, ASTNode* falseBlock) {
-    ASTIfNode* node = (ASTIfNode*)malloc(sizeof(ASTIfNode));
+    ASTIfNode* node = (ASTIfNode*)compilerMalloc(sizeof(ASTIfNode), AST_IF);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTIfNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_IF;
+    node->base.next = NULL;
     node->condition = condition;
     node->trueBlock = trueBlock;
     node->falseBlock = falseBlock;
@@ -189,12 +196,13 @@ ASTIfNode* createIfNode(ASTNode* condition, ASTNode* trueBlock, ASTNode* falseBl
 
 // Function to create the While node
 ASTWhileNode* createWhileNode(ASTNode* condition, ASTNode* body) {
-    ASTWhileNode* node = (ASTWhileNode*)malloc(sizeof(ASTWhileNode));
+    ASTWhileNode* node = (ASTWhileNode*)compilerMalloc(sizeof(ASTWhileNode), AST_WHILE);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTWhileNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_WHILE;
+    node->base.next = NULL;
     node->condition = condition;
     node->body = body;
     return node;
@@ -202,63 +210,69 @@ ASTWhileNode* createWhileNode(ASTNode* condition, ASTNode* body) {
 
 // Function to create the return node
 ASTReturnNode* createReturnNode(ASTNode* expression) {
-    ASTReturnNode* node = (ASTReturnNode*)malloc(sizeof(ASTReturnNode));
+    ASTReturnNode* node = (ASTReturnNode*)compilerMalloc(sizeof(ASTReturnNode), AST_RETURN);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTReturnNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_RETURN;
+    node->base.next = NULL;
     node->expression = expression;
     return node;
 }
 
 // Function to create the print node
 ASTPrintNode* createPrintNode(ASTNode* arguments) {
-    ASTPrintNode* node = (ASTPrintNode*)malloc(sizeof(ASTPrintNode));
+    ASTPrintNode* node = (ASTPrintNode*)compilerMalloc(sizeof(ASTPrintNode), AST_PRINT);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTPrintNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_PRINT;
+    node->base.next = NULL;
     node->arguments = arguments;
     return node;
 }
 
 //FUNCTION READING
 ASTFunctionCallNode* createFunctionCallNode(const char* functionName, ASTNode* arguments) {
-    ASTFunctionCallNode* node = (ASTFunctionCallNode*)malloc(sizeof(ASTFunctionCallNode));
+    ASTFunctionCallNode* node = (ASTFunctionCallNode*)compilerMalloc(sizeof(ASTFunctionCallNode), AST_FUNCTION_CALL);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTFunctionCallNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_FUNCTION_CALL;
-    node->functionName = strdup(functionName); // Copy of the function name
+    node->base.next = NULL;
+    node->context = NULL;                      // Plain call, no context expression
+    node->functionName = compilerStrdup(functionName, AST_FUNCTION_CALL); // Copy of the function name
     node->arguments = arguments;               // List of Arguments
     return node;
 }
 
 //
 ASTMemberAccessNode* createMemberAccessNode(ASTNode* expression, const char* memberName) {
-    ASTMemberAccessNode* node = (ASTMemberAccessNode*)malloc(sizeof(ASTMemberAccessNode));
+    ASTMemberAccessNode* node = (ASTMemberAccessNode*)compilerMalloc(sizeof(ASTMemberAccessNode), AST_MEMBER_ACCESS);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTMemberAccessNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_MEMBER_ACCESS;
+    node->base.next = NULL;
     node->expression = expression;
-    node->memberName = strdup(memberName);  // Copy the member's name
+    node->memberName = compilerStrdup(memberName, AST_MEMBER_ACCESS);  // Copy the member's name
     return node;
 }
 
 ASTMethodCallNode* createMethodCallNode(ASTNode* expression, const char* methodName, ASTNode* arguments) {
-    ASTMethodCallNode* node = (ASTMethodCallNode*)malloc(sizeof(ASTMethodCallNode));
+    ASTMethodCallNode* node = (ASTMethodCallNode*)compilerMalloc(sizeof(ASTMethodCallNode), AST_METHOD_CALL);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTMethodCallNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_METHOD_CALL;
+    node->base.next = NULL;
     node->expression = expression;
-    node->methodName = strdup(methodName);  // Copy the name of the method
+    node->methodName = compilerStrdup(methodName, AST_METHOD_CALL);  // Copy the name of the method
     node->arguments = arguments;            // Assign the arguments
     return node;
 }
@@ -266,12 +280,13 @@ ASTMethodCallNode* createMethodCallNode(ASTNode* expression, const char* methodN
 //Function to create identifiers list
 
 ASTNode* createIdentifierListNode(ASTNode* first, ASTNode* second) {
-    ASTIdentifierListNode* node = (ASTIdentifierListNode*)malloc(sizeof(ASTIdentifierListNode));
+    ASTIdentifierListNode* node = (ASTIdentifierListNode*)compilerMalloc(sizeof(ASTIdentifierListNode), AST_IDENTIFIER_LIST);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTIdentifierListNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_IDENTIFIER_LIST;
+    node->base.next = NULL;
     node->identifiers = first;  // The first identifier
     if (second) {
         // If there is a second identifier, we add it to the list
@@ -285,47 +300,51 @@ ASTNode* createIdentifierListNode(ASTNode* first, ASTNode* second) {
 }
 
 ASTNode* createStringLiteralNode(const char* value) {
-    ASTStringLiteralNode* node = (ASTStringLiteralNode*)malloc(sizeof(ASTStringLiteralNode));
+    ASTStringLiteralNode* node = (ASTStringLiteralNode*)compilerMalloc(sizeof(ASTStringLiteralNode), AST_STRING_LITERAL);
     if (!node) {
         fprintf(stderr, "Error allocating memory for string literal node.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_STRING_LITERAL;
-    node->value = strdup(value);
+    node->base.next = NULL;
+    node->value = compilerStrdup(value, AST_STRING_LITERAL);
     return (ASTNode*)node;
 }
 
 //Función super
 ASTNode* createSuperNode() {
-    ASTSuperNode* node = (ASTSuperNode*)malloc(sizeof(ASTSuperNode));
+    ASTSuperNode* node = (ASTSuperNode*)compilerMalloc(sizeof(ASTSuperNode), AST_SUPER);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTSuperNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_SUPER;
+    node->base.next = NULL;
     return (ASTNode*)node;
 }
 
 //castTipo
 ASTTypeCastNode* createTypeCastNode(const char* typeName, ASTNode* expression) {
-    ASTTypeCastNode* node = (ASTTypeCastNode*)malloc(sizeof(ASTTypeCastNode));
+    ASTTypeCastNode* node = (ASTTypeCastNode*)compilerMalloc(sizeof(ASTTypeCastNode), AST_TYPE_CAST);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTTypeCastNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_TYPE_CAST;
-    node->typeName = strdup(typeName);  // Copy the name of the type
+    node->base.next = NULL;
+    node->typeName = compilerStrdup(typeName, AST_TYPE_CAST);  // Copy the name of the type
     node->expression = expression;     // The expression to convert
     return node;
 }
 
 ASTFunctionCallNode* createFunctionCallWithContextNode(ASTNode* context, ASTNode* arguments) {
-    ASTFunctionCallNode* node = (ASTFunctionCallNode*)malloc(sizeof(ASTFunctionCallNode));
+    ASTFunctionCallNode* node = (ASTFunctionCallNode*)compilerMalloc(sizeof(ASTFunctionCallNode), AST_FUNCTION_CALL);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTFunctionCallNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_FUNCTION_CALL;
+    node->base.next = NULL;
     node->context = context;     // Node before parentheses (context)
     node->functionName = NULL;   // This can be null if we only use context
     node->arguments = arguments; // List of Arguments
@@ -333,11 +352,124 @@ ASTFunctionCallNode* createFunctionCallWithContextNode(ASTNode* context, ASTNode
 }
 
 ASTThisNode* createThisNode() {
-    ASTThisNode* node = (ASTThisNode*)malloc(sizeof(ASTThisNode));
+    ASTThisNode* node = (ASTThisNode*)compilerMalloc(sizeof(ASTThisNode), AST_THIS);
     if (!node) {
         fprintf(stderr, "Error: no se pudo asignar memoria para ASTThisNode.\n");
         exit(EXIT_FAILURE);
     }
     node->base.type = AST_THIS;  // Be sure to have an Ast_This type
+    node->base.next = NULL;
+    return node;
+}
+ASTLazyBodyNode* createLazyBodyNode(LazyToken* tokens, int count) {
+    ASTLazyBodyNode* node = (ASTLazyBodyNode*)checkedMalloc(sizeof(ASTLazyBodyNode), AST_LAZY_BODY);
+    node->base.type = AST_LAZY_BODY;
+    node->base.next = NULL;
+    node->tokens = tokens;
+    node->count = count;
     return node;
-}
\ No newline at end of file
+}
+
+//Release
+
+static void freeASTNode(ASTNode* node) {
+    switch (node->type) {
+        case AST_PROGRAM:
+            freeAST(((ASTProgramNode*)node)->classes);
+            freeAST(((ASTProgramNode*)node)->functions);
+            break;
+        case AST_CLASS:
+            compilerFree(((ASTClassNode*)node)->name);
+            compilerFree(((ASTClassNode*)node)->parent);
+            freeAST(((ASTClassNode*)node)->members);
+            break;
+        case AST_FUNCTION:
+            compilerFree(((ASTFunctionNode*)node)->name);
+            compilerFree(((ASTFunctionNode*)node)->returnType);
+            freeAST(((ASTFunctionNode*)node)->parameters);
+            freeAST(((ASTFunctionNode*)node)->body);
+            break;
+        case AST_DECLARATION:
+            compilerFree(((ASTDeclarationNode*)node)->type);
+            compilerFree(((ASTDeclarationNode*)node)->name);
+            freeAST(((ASTDeclarationNode*)node)->init);
+            break;
+        case AST_BLOCK:
+            freeAST(((ASTBlockNode*)node)->statements);
+            break;
+        case AST_IF:
+            freeAST(((ASTIfNode*)node)->condition);
+            freeAST(((ASTIfNode*)node)->trueBlock);
+            freeAST(((ASTIfNode*)node)->falseBlock);
+            break;
+        case AST_WHILE:
+            freeAST(((ASTWhileNode*)node)->condition);
+            freeAST(((ASTWhileNode*)node)->body);
+            break;
+        case AST_RETURN:
+            freeAST(((ASTReturnNode*)node)->expression);
+            break;
+        case AST_PRINT:
+            freeAST(((ASTPrintNode*)node)->arguments);
+            break;
+        case AST_VARIABLE:
+            compilerFree(((ASTVariableNode*)node)->name);
+            break;
+        case AST_LITERAL:
+            compilerFree(((ASTLiteralNode*)node)->value);
+            compilerFree(((ASTLiteralNode*)node)->literalType);
+            break;
+        case AST_BINARY_OP:
+            freeAST(((ASTBinaryOpNode*)node)->left);
+            freeAST(((ASTBinaryOpNode*)node)->right);
+            break;
+        case AST_UNARY_OP:
+            freeAST(((ASTUnaryOpNode*)node)->operand);
+            break;
+        case AST_FUNCTION_CALL:
+            compilerFree(((ASTFunctionCallNode*)node)->functionName);
+            freeAST(((ASTFunctionCallNode*)node)->context);
+            freeAST(((ASTFunctionCallNode*)node)->arguments);
+            break;
+        case AST_NEW:
+            compilerFree(((ASTNewNode*)node)->className);
+            freeAST(((ASTNewNode*)node)->arguments);
+            break;
+        case AST_MEMBER_ACCESS:
+            freeAST(((ASTMemberAccessNode*)node)->expression);
+            compilerFree(((ASTMemberAccessNode*)node)->memberName);
+            break;
+        case AST_METHOD_CALL:
+            freeAST(((ASTMethodCallNode*)node)->expression);
+            compilerFree(((ASTMethodCallNode*)node)->methodName);
+            freeAST(((ASTMethodCallNode*)node)->arguments);
+            break;
+        case AST_IDENTIFIER_LIST:
+            freeAST(((ASTIdentifierListNode*)node)->identifiers);
+            break;
+        case AST_STRING_LITERAL:
+            compilerFree(((ASTStringLiteralNode*)node)->value);
+            break;
+        case AST_TYPE_CAST:
+            compilerFree(((ASTTypeCastNode*)node)->typeName);
+            freeAST(((ASTTypeCastNode*)node)->expression);
+            break;
+        case AST_LAZY_BODY: {
+            ASTLazyBodyNode* body = (ASTLazyBodyNode*)node;
+            for (int t = 0; t < body->count; t++) compilerFree(body->tokens[t].sval);
+            compilerFree(body->tokens);
+            break;
+        }
+        default:
+            break;                      // this, super
+    }
+    compilerFree(node);
+}
+
+void freeAST(ASTNode* node) {
+    while (node) {
+        ASTNode* next = node->next;
+        freeASTNode(node);
+        node = next;
+    }
+}
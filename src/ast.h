@@ -52,6 +52,7 @@ typedef enum {
     AST_SUPER,
     AST_TYPE_CAST,
     AST_THIS,
+    AST_LAZY_BODY,  // Body of a function kept in tokens (lazy parsing)
 } ASTNodeType;
 
 // Generic AST node
@@ -62,6 +63,13 @@ typedef struct ASTNode {
 
 extern ASTNode* root;
 
+// When set, the parser passes every top-level class and function to it as soon as the node is
+// complete. A node it keeps (returning true) is left out of the program built in root.
+extern bool (*unit_parsed)(ASTNode* unit);
+
+// When set, the parser reads its tokens from it instead of yylex (the pipelined lexer)
+extern int (*token_reader)();
+
 // Program node
 typedef struct {
     ASTNode base;                  // Base knot
@@ -216,6 +224,26 @@ typedef struct ASTThisNode {
     ASTNode base; // Nodo base
 } ASTThisNode;
 
+// Token read by the lexer with its value (sval for names, types and strings, ival for numbers)
+typedef struct {
+    int token;
+    int ival;
+    char* sval;
+} LazyToken;
+
+// Body of a function or method skipped by the lazy parser, from its '{' to its '}'
+typedef struct ASTLazyBodyNode {
+    ASTNode base;
+    LazyToken* tokens;
+    int count;
+} ASTLazyBodyNode;
+
+// With lazy_bodies set, the parser keeps the tokens of the function and method bodies in an
+// ASTLazyBodyNode instead of parsing them; parseLazyBody turns one into its block later (null
+// on a syntax error, the node stays to the caller)
+extern bool lazy_bodies;
+ASTNode* parseLazyBody(ASTLazyBodyNode* body);
+
 // Functions to create nodes
 ASTProgramNode* createProgramNode(ASTNode* classes, ASTNode* functions);
 ASTClassNode* createClassNode(const char* name, const char* parent, ASTNode* members);
@@ -247,5 +275,9 @@ ASTNode* createSuperNode();
 ASTTypeCastNode* createTypeCastNode(const char* typeName, ASTNode* expression);
 ASTFunctionCallNode* createFunctionCallWithContextNode(ASTNode* context, ASTNode* arguments);
 ASTThisNode* createThisNode();
+ASTLazyBodyNode* createLazyBodyNode(LazyToken* tokens, int count);
+
+// Free the node, everything under it and the nodes after it in its list
+void freeAST(ASTNode* node);
 
 #endif // AST_H
@@ -0,0 +1,601 @@
+#include "astcache.h"
+#include "alloc.h"
+#include "hash.h"
+#include "buildstamp.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ASTCACHE_ALIGNMENT 8
+#define MAX_PATH 4096
+#define READ_CHUNK 65536
+#define ASTCACHE_MAX_SIZE UINT32_MAX     // The relocations are 32-bit offsets
+
+// The nodes of the file are the structs of this build
+#define ASTCACHE_COMPILER "vypcomp ast 1"
+
+// Fields of a node: the nodes it points to (lists, followed through next) and its strings
+typedef struct {
+    size_t size;
+    int node_count;
+    size_t nodes[3];
+    int string_count;
+    size_t strings[2];
+} NodeShape;
+
+static const NodeShape shapes[] = {
+    [AST_PROGRAM] = {sizeof(ASTProgramNode), 2, {offsetof(ASTProgramNode, classes), offsetof(ASTProgramNode, functions)}, 0, {0}},
+    [AST_CLASS] = {sizeof(ASTClassNode), 1, {offsetof(ASTClassNode, members)}, 2, {offsetof(ASTClassNode, name), offsetof(ASTClassNode, parent)}},
+    [AST_FUNCTION] = {sizeof(ASTFunctionNode), 2, {offsetof(ASTFunctionNode, parameters), offsetof(ASTFunctionNode, body)},
+                      2, {offsetof(ASTFunctionNode, name), offsetof(ASTFunctionNode, returnType)}},
+    [AST_DECLARATION] = {sizeof(ASTDeclarationNode), 1, {offsetof(ASTDeclarationNode, init)},
+                         2, {offsetof(ASTDeclarationNode, type), offsetof(ASTDeclarationNode, name)}},
+    [AST_ASSIGNMENT] = {sizeof(ASTNode), 0, {0}, 0, {0}},
+    [AST_BLOCK] = {sizeof(ASTBlockNode), 1, {offsetof(ASTBlockNode, statements)}, 0, {0}},
+    [AST_IF] = {sizeof(ASTIfNode), 3, {offsetof(ASTIfNode, condition), offsetof(ASTIfNode, trueBlock), offsetof(ASTIfNode, falseBlock)}, 0, {0}},
+    [AST_WHILE] = {sizeof(ASTWhileNode), 2, {offsetof(ASTWhileNode, condition), offsetof(ASTWhileNode, body)}, 0, {0}},
+    [AST_RETURN] = {sizeof(ASTReturnNode), 1, {offsetof(ASTReturnNode, expression)}, 0, {0}},
+    [AST_PRINT] = {sizeof(ASTPrintNode), 1, {offsetof(ASTPrintNode, arguments)}, 0, {0}},
+    [AST_EXPRESSION] = {sizeof(ASTNode), 0, {0}, 0, {0}},
+    [AST_VARIABLE] = {sizeof(ASTVariableNode), 0, {0}, 1, {offsetof(ASTVariableNode, name)}},
+    [AST_LITERAL] = {sizeof(ASTLiteralNode), 0, {0}, 2, {offsetof(ASTLiteralNode, value), offsetof(ASTLiteralNode, literalType)}},
+    [AST_BINARY_OP] = {sizeof(ASTBinaryOpNode), 2, {offsetof(ASTBinaryOpNode, left), offsetof(ASTBinaryOpNode, right)}, 0, {0}},
+    [AST_UNARY_OP] = {sizeof(ASTUnaryOpNode), 1, {offsetof(ASTUnaryOpNode, operand)}, 0, {0}},
+    [AST_FUNCTION_CALL] = {sizeof(ASTFunctionCallNode), 2, {offsetof(ASTFunctionCallNode, context), offsetof(ASTFunctionCallNode, arguments)},
+                           1, {offsetof(ASTFunctionCallNode, functionName)}},
+    [AST_NEW] = {sizeof(ASTNewNode), 1, {offsetof(ASTNewNode, arguments)}, 1, {offsetof(ASTNewNode, className)}},
+    [AST_MEMBER_ACCESS] = {sizeof(ASTMemberAccessNode), 1, {offsetof(ASTMemberAccessNode, expression)},
+                           1, {offsetof(ASTMemberAccessNode, memberName)}},
+    [AST_METHOD_CALL] = {sizeof(ASTMethodCallNode), 2, {offsetof(ASTMethodCallNode, expression), offsetof(ASTMethodCallNode, arguments)},
+                         1, {offsetof(ASTMethodCallNode, methodName)}},
+    [AST_IDENTIFIER_LIST] = {sizeof(ASTIdentifierListNode), 1, {offsetof(ASTIdentifierListNode, identifiers)}, 0, {0}},
+    [AST_STRING_LITERAL] = {sizeof(ASTStringLiteralNode), 0, {0}, 1, {offsetof(ASTStringLiteralNode, value)}},
+    [AST_SUPER] = {sizeof(ASTSuperNode), 0, {0}, 0, {0}},
+    [AST_TYPE_CAST] = {sizeof(ASTTypeCastNode), 1, {offsetof(ASTTypeCastNode, expression)}, 1, {offsetof(ASTTypeCastNode, typeName)}},
+    [AST_THIS] = {sizeof(ASTThisNode), 0, {0}, 0, {0}},
+    [AST_LAZY_BODY] = {sizeof(ASTLazyBodyNode), 0, {0}, 0, {0}},      // Its tokens are written apart
+};
+
+_Static_assert(sizeof(shapes) / sizeof(shapes[0]) == AST_LAZY_BODY + 1, "a shape for every node");
+
+static uint64_t compilerStamp() {
+    return hashText(hashText(HASH_SEED, ASTCACHE_COMPILER), build_stamp);
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + ASTCACHE_ALIGNMENT - 1) / ASTCACHE_ALIGNMENT * ASTCACHE_ALIGNMENT;
+}
+
+static void cachePath(const char* directory, const ASTCacheKey* key, char* path) {
+    snprintf(path, MAX_PATH, "%s/%016llx.ast", directory, (unsigned long long)key->hash);
+}
+
+bool hashSource(FILE* source, ASTCacheKey* key) {
+    key->hash = HASH_SEED;
+    key->size = 0;
+    unsigned char* chunk = checkedCalloc(READ_CHUNK, 1, ALLOC_MODULES);
+    size_t count;
+    while ((count = fread(chunk, 1, READ_CHUNK, source)) > 0) {
+        key->hash = hashBytes(key->hash, chunk, count);
+        key->size += count;
+    }
+    compilerFree(chunk);
+    bool read = !ferror(source);
+    rewind(source);
+    return read;
+}
+
+//Writing
+
+// Growing array of records or bytes
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static size_t reserve(Buffer* buffer, size_t size) {
+    size_t start = alignOffset(buffer->size);
+    if (start + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (capacity < start + size) capacity *= 2;
+        buffer->data = checkedRealloc(buffer->data, capacity, ALLOC_MODULES);
+        memset(buffer->data + buffer->capacity, 0, capacity - buffer->capacity);
+        buffer->capacity = capacity;
+    }
+    buffer->size = start + size;
+    return start;
+}
+
+// Offsets of the pointer fields in the nodes buffer
+typedef struct {
+    uint64_t* fields;
+    size_t count;
+    size_t capacity;
+} FieldList;
+
+static void addField(FieldList* list, uint64_t field) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->fields = checkedRealloc(list->fields, list->capacity * sizeof(uint64_t), ALLOC_MODULES);
+    }
+    list->fields[list->count++] = field;
+}
+
+typedef struct {
+    Buffer nodes;
+    Buffer pool;
+    FieldList node_fields;         // Fields that point into the nodes, offset in the nodes buffer
+    FieldList string_fields;       // Fields that point into the pool, offset in the pool
+    uint32_t* buckets;             // Offset + 1 of every string of the pool by hash, 0 when empty
+    size_t bucket_count;           // A power of two, at most half used
+    int string_count;
+    int node_count;
+} CacheWriter;
+
+static void growBuckets(CacheWriter* writer) {
+    size_t count = writer->bucket_count ? writer->bucket_count * 2 : 1024;
+    uint32_t* buckets = checkedCalloc(count, sizeof(uint32_t), ALLOC_MODULES);
+    for (size_t b = 0; b < writer->bucket_count; b++) {
+        if (!writer->buckets[b]) continue;
+        size_t slot = hashText(HASH_SEED, writer->pool.data + writer->buckets[b] - 1) & (count - 1);
+        while (buckets[slot]) slot = (slot + 1) & (count - 1);
+        buckets[slot] = writer->buckets[b];
+    }
+    compilerFree(writer->buckets);
+    writer->buckets = buckets;
+    writer->bucket_count = count;
+}
+
+// Offset of the string in the pool, added the first time it is seen
+static uint32_t internString(CacheWriter* writer, const char* text) {
+    if (2 * (writer->string_count + 1) > (int)writer->bucket_count) growBuckets(writer);
+    size_t slot = hashText(HASH_SEED, text) & (writer->bucket_count - 1);
+    while (writer->buckets[slot]) {
+        uint32_t offset = writer->buckets[slot] - 1;
+        if (strcmp(writer->pool.data + offset, text) == 0) return offset;
+        slot = (slot + 1) & (writer->bucket_count - 1);
+    }
+    // The strings follow each other in the pool, without alignment
+    size_t length = strlen(text) + 1;
+    uint32_t offset = writer->pool.size;
+    if (offset + length > writer->pool.capacity) {
+        size_t capacity = writer->pool.capacity ? writer->pool.capacity : 4096;
+        while (capacity < offset + length) capacity *= 2;
+        writer->pool.data = checkedRealloc(writer->pool.data, capacity, ALLOC_MODULES);
+        writer->pool.capacity = capacity;
+    }
+    memcpy(writer->pool.data + offset, text, length);
+    writer->pool.size = offset + length;
+    writer->buckets[slot] = offset + 1;
+    writer->string_count++;
+    return offset;
+}
+
+static void setField(CacheWriter* writer, uint64_t field, uintptr_t value) {
+    memcpy(writer->nodes.data + field, &value, sizeof(value));
+}
+
+static void writeString(CacheWriter* writer, uint64_t field, const char* text) {
+    if (!text) {
+        setField(writer, field, 0);
+        return;
+    }
+    setField(writer, field, internString(writer, text));
+    addField(&writer->string_fields, field);
+}
+
+static void linkRecord(CacheWriter* writer, uint64_t field, uint64_t target) {
+    setField(writer, field, target);
+    addField(&writer->node_fields, field);
+}
+
+static uint64_t writeList(CacheWriter* writer, ASTNode* node);
+
+static uint64_t writeNode(CacheWriter* writer, ASTNode* node) {
+    const NodeShape* shape = &shapes[node->type];
+    uint64_t record = reserve(&writer->nodes, shape->size);
+    memcpy(writer->nodes.data + record, node, shape->size);
+    writer->node_count++;
+    setField(writer, record + offsetof(ASTNode, next), 0);
+    for (int s = 0; s < shape->string_count; s++) {
+        writeString(writer, record + shape->strings[s], *(char**)((char*)node + shape->strings[s]));
+    }
+    for (int n = 0; n < shape->node_count; n++) setField(writer, record + shape->nodes[n], 0);
+    for (int n = 0; n < shape->node_count; n++) {
+        ASTNode* child = *(ASTNode**)((char*)node + shape->nodes[n]);
+        if (child) linkRecord(writer, record + shape->nodes[n], writeList(writer, child));
+    }
+    if (node->type == AST_LAZY_BODY) {
+        ASTLazyBodyNode* body = (ASTLazyBodyNode*)node;
+        setField(writer, record + offsetof(ASTLazyBodyNode, tokens), 0);
+        if (body->tokens) {
+            uint64_t tokens = reserve(&writer->nodes, body->count * sizeof(LazyToken));
+            memcpy(writer->nodes.data + tokens, body->tokens, body->count * sizeof(LazyToken));
+            for (int t = 0; t < body->count; t++) {
+                writeString(writer, tokens + t * sizeof(LazyToken) + offsetof(LazyToken, sval), body->tokens[t].sval);
+            }
+            linkRecord(writer, record + offsetof(ASTLazyBodyNode, tokens), tokens);
+        }
+    }
+    return record;
+}
+
+// The nodes of a list one after the other, linked through next without recursion
+static uint64_t writeList(CacheWriter* writer, ASTNode* node) {
+    uint64_t first = writeNode(writer, node);
+    uint64_t previous = first;
+    for (node = node->next; node; node = node->next) {
+        uint64_t record = writeNode(writer, node);
+        linkRecord(writer, previous + offsetof(ASTNode, next), record);
+        previous = record;
+    }
+    return first;
+}
+
+static void writeStringList(CacheWriter* writer, uint64_t field, char** list, int count) {
+    setField(writer, field, 0);
+    if (!list) return;
+    uint64_t block = reserve(&writer->nodes, count * sizeof(char*));
+    for (int i = 0; i < count; i++) writeString(writer, block + i * sizeof(char*), list[i]);
+    linkRecord(writer, field, block);
+}
+
+static uint64_t writeSymbols(CacheWriter* writer, SymbolTable* table) {
+    uint64_t symbols = reserve(&writer->nodes, table->symbol_count * sizeof(Symbol));
+    memcpy(writer->nodes.data + symbols, table->symbols, table->symbol_count * sizeof(Symbol));
+    for (int i = 0; i < table->symbol_count; i++) {
+        Symbol* symbol = &table->symbols[i];
+        uint64_t record = symbols + i * sizeof(Symbol);
+        writeString(writer, record + offsetof(Symbol, name), symbol->name);
+        writeString(writer, record + offsetof(Symbol, type), symbol->type);
+        if (symbol->is_function) {
+            writeStringList(writer, record + offsetof(Symbol, func.parameters), symbol->func.parameters, symbol->func.param_count);
+        } else if (symbol->is_class) {
+            writeStringList(writer, record + offsetof(Symbol, class.methods), symbol->class.methods, symbol->class.method_count);
+            writeStringList(writer, record + offsetof(Symbol, class.attributes), symbol->class.attributes, symbol->class.attr_count);
+            writeString(writer, record + offsetof(Symbol, class.parentClass), symbol->class.parentClass);
+        } else {
+            // Variables leave the lists unset
+            memset(writer->nodes.data + record + offsetof(Symbol, func), 0, sizeof(Symbol) - offsetof(Symbol, func));
+        }
+    }
+    return symbols;
+}
+
+static int compareFields(const void* a, const void* b) {
+    uint32_t left = *(const uint32_t*)a;
+    uint32_t right = *(const uint32_t*)b;
+    return left < right ? -1 : left > right;
+}
+
+// The offsets of the fields become offsets in the file; the relocations go in order, so the
+// loader walks the mapping forwards
+static uint32_t* placeFields(CacheWriter* writer, ASTCacheHeader* header) {
+    uint32_t* relocations = checkedCalloc(header->relocation_count, sizeof(uint32_t), ALLOC_MODULES);
+    size_t r = 0;
+    for (int list = 0; list < 2; list++) {
+        FieldList* fields = list == 0 ? &writer->node_fields : &writer->string_fields;
+        uint64_t base = list == 0 ? header->nodes_offset : header->pool_offset;
+        for (size_t f = 0; f < fields->count; f++) {
+            uintptr_t value;
+            memcpy(&value, writer->nodes.data + fields->fields[f], sizeof(value));
+            setField(writer, fields->fields[f], value + base);
+            relocations[r++] = header->nodes_offset + fields->fields[f];
+        }
+    }
+    qsort(relocations, r, sizeof(uint32_t), compareFields);
+    return relocations;
+}
+
+static void freeWriter(CacheWriter* writer) {
+    compilerFree(writer->nodes.data);
+    compilerFree(writer->pool.data);
+    compilerFree(writer->node_fields.fields);
+    compilerFree(writer->string_fields.fields);
+    compilerFree(writer->buckets);
+}
+
+static void writePadding(FILE* out, uint64_t* position, uint64_t offset) {
+    for (; *position < offset; (*position)++) fputc(0, out);
+}
+
+bool saveASTCache(const char* directory, const ASTCacheKey* key, ASTNode* program, SymbolTable* table, ASTCacheStats* stats) {
+    memset(stats, 0, sizeof(ASTCacheStats));
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+        perror("Error creating the cache directory");
+        return false;
+    }
+    CacheWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    internString(&writer, "");         // The pool is never empty, its last byte ends a string
+    uint64_t rootRecord = writeList(&writer, program);
+    uint64_t symbolsRecord = writeSymbols(&writer, table);
+
+    ASTCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ASTCACHE_MAGIC, 4);
+    header.version = ASTCACHE_VERSION;
+    header.compiler = compilerStamp();
+    header.source_hash = key->hash;
+    header.source_size = key->size;
+    header.node_count = writer.node_count;
+    header.symbol_count = table->symbol_count;
+    header.nodes_offset = alignOffset(sizeof(header));
+    header.root = header.nodes_offset + rootRecord;
+    header.symbols = header.nodes_offset + symbolsRecord;
+    header.relocations_offset = alignOffset(header.nodes_offset + writer.nodes.size);
+    header.relocation_count = writer.node_fields.count + writer.string_fields.count;
+    header.pool_offset = header.relocations_offset + header.relocation_count * sizeof(uint32_t);
+    header.size = header.pool_offset + writer.pool.size;
+    stats->nodes = writer.node_count;
+    stats->symbols = table->symbol_count;
+    stats->strings = writer.string_count;
+    stats->relocations = header.relocation_count;
+    stats->bytes = header.size;
+    if (header.size > ASTCACHE_MAX_SIZE) {
+        freeWriter(&writer);
+        return false;
+    }
+    uint32_t* relocations = placeFields(&writer, &header);
+
+    // The bytes of the file in order, the padding included
+    static const char zeros[ASTCACHE_ALIGNMENT];
+    uint64_t checksum = hashBytes(HASH_SEED, &header, offsetof(ASTCacheHeader, checksum));
+    checksum = hashBytes(checksum, zeros, header.nodes_offset - sizeof(header));
+    checksum = hashBytes(checksum, writer.nodes.data, writer.nodes.size);
+    checksum = hashBytes(checksum, zeros, header.relocations_offset - header.nodes_offset - writer.nodes.size);
+    checksum = hashBytes(checksum, relocations, header.relocation_count * sizeof(uint32_t));
+    header.checksum = hashBytes(checksum, writer.pool.data, writer.pool.size);
+
+    // Written under another name first, so a concurrent build never maps half a file
+    char path[MAX_PATH];
+    char temporary[MAX_PATH + 32];
+    cachePath(directory, key, path);
+    snprintf(temporary, sizeof(temporary), "%s.%ld.tmp", path, (long)getpid());
+    FILE* out = fopen(temporary, "wb");
+    bool saved = false;
+    if (out) {
+        uint64_t position = sizeof(header);
+        fwrite(&header, sizeof(header), 1, out);
+        writePadding(out, &position, header.nodes_offset);
+        fwrite(writer.nodes.data, 1, writer.nodes.size, out);
+        position += writer.nodes.size;
+        writePadding(out, &position, header.relocations_offset);
+        fwrite(relocations, sizeof(uint32_t), header.relocation_count, out);
+        fwrite(writer.pool.data, 1, writer.pool.size, out);
+        saved = fclose(out) == 0 && rename(temporary, path) == 0;
+        if (!saved) remove(temporary);
+    }
+    compilerFree(relocations);
+    freeWriter(&writer);
+    return saved;
+}
+
+//Reading
+
+// The sections are inside the file and in order, and the bytes are the ones that were written.
+// What the nodes and the symbols hold is checked once they are relocated.
+static const char* checkHeader(ASTCacheHeader* header, size_t size, const ASTCacheKey* key) {
+    if (memcmp(header->magic, ASTCACHE_MAGIC, 4) != 0) return "not an AST cache file";
+    if (header->version != ASTCACHE_VERSION) return "unsupported version";
+    if (header->compiler != compilerStamp()) return "written by another build of vypcomp";
+    if (header->source_hash != key->hash || header->source_size != key->size) return "written for another source";
+    if (header->size != size) return "truncated file";
+    if (header->nodes_offset < sizeof(ASTCacheHeader) || header->nodes_offset % ASTCACHE_ALIGNMENT != 0 ||
+        header->relocations_offset < header->nodes_offset || header->relocations_offset % ASTCACHE_ALIGNMENT != 0 ||
+        header->relocations_offset > size ||
+        header->relocation_count > (size - header->relocations_offset) / sizeof(uint32_t) ||
+        header->pool_offset != header->relocations_offset + header->relocation_count * sizeof(uint32_t) ||
+        header->pool_offset >= size || ((const char*)header)[size - 1] != 0) {
+        return "section out of the file";
+    }
+    uint64_t checksum = hashBytes(HASH_SEED, header, offsetof(ASTCacheHeader, checksum));
+    if (hashBytes(checksum, (const char*)header + sizeof(ASTCacheHeader), size - sizeof(ASTCacheHeader)) != header->checksum) {
+        return "checksum mismatch";
+    }
+    if (header->node_count < 1 || (uint64_t)header->node_count > (header->relocations_offset - header->nodes_offset) / sizeof(ASTNode) ||
+        header->symbol_count < 0 || header->symbol_count > MAX_SYMBOLS ||
+        header->root < header->nodes_offset || header->root % ASTCACHE_ALIGNMENT != 0 ||
+        header->root + sizeof(ASTProgramNode) > header->relocations_offset ||
+        header->symbols < header->nodes_offset || header->symbols % ASTCACHE_ALIGNMENT != 0 ||
+        header->symbols + header->symbol_count * sizeof(Symbol) > header->relocations_offset) {
+        return "invalid root or symbols";
+    }
+    return NULL;
+}
+
+// Turn the offsets of the pointer fields into addresses of the mapping. The writer sorts them,
+// so a field listed twice, which would move twice, is found by the order.
+static const char* relocate(char* base, ASTCacheHeader* header) {
+    const uint32_t* relocations = (const uint32_t*)(base + header->relocations_offset);
+    for (uint64_t r = 0; r < header->relocation_count; r++) {
+        uint32_t field = relocations[r];
+        if (field < header->nodes_offset || field % sizeof(uintptr_t) != 0 ||
+            field + sizeof(uintptr_t) > header->relocations_offset) {
+            return "relocation out of the nodes";
+        }
+        if (r > 0 && field <= relocations[r - 1]) return "relocations out of order";
+        uintptr_t value;
+        memcpy(&value, base + field, sizeof(value));
+        if (value == 0 || value >= header->size) return "pointer out of the file";
+        value += (uintptr_t)base;
+        memcpy(base + field, &value, sizeof(value));
+    }
+    return NULL;
+}
+
+// Walk of the relocated tree: every node is reached once, from the root, and the header counts
+// them all
+typedef struct {
+    char* base;
+    ASTCacheHeader* header;
+    unsigned char* reached;        // A bit for every aligned offset of the nodes section
+    ASTNode** pending;             // Nodes reached whose fields are still to check
+    int pending_count;
+    int node_count;
+} CacheChecker;
+
+// Null, or a block of size bytes in the nodes section
+static bool inNodes(CacheChecker* checker, const void* pointer, size_t size) {
+    if (!pointer) return true;
+    const char* at = pointer;
+    const char* start = checker->base + checker->header->nodes_offset;
+    const char* end = checker->base + checker->header->relocations_offset;
+    return at >= start && at <= end && (size_t)(end - at) >= size && (at - start) % ASTCACHE_ALIGNMENT == 0;
+}
+
+// Null, or a string of the pool: the last byte of the file ends it
+static bool inPool(CacheChecker* checker, const char* text) {
+    return !text || (text >= checker->base + checker->header->pool_offset && text < checker->base + checker->header->size);
+}
+
+// Bytes of a bool that the compiler did not write can be neither true nor false
+static bool isFlag(const bool* flag) {
+    unsigned char byte;
+    memcpy(&byte, flag, 1);
+    return byte <= 1;
+}
+
+static const char* reachNode(CacheChecker* checker, ASTNode* node) {
+    if (!node) return NULL;
+    if (!inNodes(checker, node, sizeof(ASTNode))) return "node out of the nodes";
+    size_t slot = ((char*)node - checker->base - checker->header->nodes_offset) / ASTCACHE_ALIGNMENT;
+    if (checker->reached[slot / 8] & (1 << slot % 8)) return "node reached twice";
+    if (checker->node_count == checker->header->node_count) return "more nodes than counted";
+    checker->reached[slot / 8] |= 1 << slot % 8;
+    checker->pending[checker->pending_count++] = node;
+    checker->node_count++;
+    return NULL;
+}
+
+static const char* checkNode(CacheChecker* checker, ASTNode* node) {
+    if ((unsigned)node->type > AST_LAZY_BODY) return "unknown node type";
+    const NodeShape* shape = &shapes[node->type];
+    if (!inNodes(checker, node, shape->size)) return "node out of the nodes";
+    for (int s = 0; s < shape->string_count; s++) {
+        if (!inPool(checker, *(char**)((char*)node + shape->strings[s]))) return "string out of the pool";
+    }
+    switch (node->type) {
+        case AST_FUNCTION:
+            if (((ASTFunctionNode*)node)->param_count < 0) return "invalid parameter count";
+            break;
+        case AST_BINARY_OP:
+            if ((unsigned)((ASTBinaryOpNode*)node)->op > OP_NE) return "unknown binary operator";
+            break;
+        case AST_UNARY_OP:
+            if ((unsigned)((ASTUnaryOpNode*)node)->op > OP_NOT) return "unknown unary operator";
+            break;
+        case AST_LAZY_BODY: {
+            ASTLazyBodyNode* body = (ASTLazyBodyNode*)node;
+            if (body->count < 0 || (body->count > 0 && !body->tokens) ||
+                !inNodes(checker, body->tokens, (size_t)body->count * sizeof(LazyToken))) {
+                return "tokens out of the nodes";
+            }
+            for (int t = 0; t < body->count; t++) {
+                if (!inPool(checker, body->tokens[t].sval)) return "string out of the pool";
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    const char* problem = reachNode(checker, node->next);
+    for (int n = 0; !problem && n < shape->node_count; n++) {
+        problem = reachNode(checker, *(ASTNode**)((char*)node + shape->nodes[n]));
+    }
+    return problem;
+}
+
+static const char* checkStringList(CacheChecker* checker, char** list, int count) {
+    if (count < 0 || !inNodes(checker, list, (size_t)count * sizeof(char*))) return "symbol list out of the nodes";
+    for (int i = 0; list && i < count; i++) {
+        if (!inPool(checker, list[i])) return "string out of the pool";
+    }
+    return NULL;
+}
+
+static const char* checkSymbol(CacheChecker* checker, Symbol* symbol) {
+    if (!inPool(checker, symbol->name) || !inPool(checker, symbol->type)) return "string out of the pool";
+    if (!isFlag(&symbol->defined) || !isFlag(&symbol->is_function) || !isFlag(&symbol->is_class) || !isFlag(&symbol->is_object)) {
+        return "invalid symbol flag";
+    }
+    if (symbol->is_function) return checkStringList(checker, symbol->func.parameters, symbol->func.param_count);
+    if (!symbol->is_class) return NULL;
+    const char* problem = checkStringList(checker, symbol->class.methods, symbol->class.method_count);
+    if (!problem) problem = checkStringList(checker, symbol->class.attributes, symbol->class.attr_count);
+    if (!problem && !inPool(checker, symbol->class.parentClass)) problem = "string out of the pool";
+    return problem;
+}
+
+static const char* checkContents(char* base, ASTCacheHeader* header) {
+    CacheChecker checker = {base, header, NULL, NULL, 0, 0};
+    size_t slots = (header->relocations_offset - header->nodes_offset) / ASTCACHE_ALIGNMENT;
+    checker.reached = checkedCalloc(slots / 8 + 1, 1, ALLOC_MODULES);
+    checker.pending = checkedCalloc(header->node_count, sizeof(ASTNode*), ALLOC_MODULES);
+    ASTNode* program = (ASTNode*)(base + header->root);
+    const char* problem = program->type == AST_PROGRAM && !program->next ? reachNode(&checker, program) : "invalid root";
+    while (!problem && checker.pending_count > 0) problem = checkNode(&checker, checker.pending[--checker.pending_count]);
+    if (!problem && checker.node_count != header->node_count) problem = "fewer nodes than counted";
+    Symbol* symbols = (Symbol*)(base + header->symbols);
+    for (int i = 0; !problem && i < header->symbol_count; i++) problem = checkSymbol(&checker, &symbols[i]);
+    compilerFree(checker.reached);
+    compilerFree(checker.pending);
+    return problem;
+}
+
+bool loadASTCache(const char* directory, const ASTCacheKey* key, ASTNode** program, SymbolTable* table, ASTCacheStats* stats) {
+    memset(stats, 0, sizeof(ASTCacheStats));
+    char path[MAX_PATH];
+    cachePath(directory, key, path);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (uint64_t)info.st_size < sizeof(ASTCacheHeader)) {
+        close(fd);
+        return false;
+    }
+    // Private and writable: the relocations and whatever the later phases change stay in memory
+    char* mapping = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+    ASTCacheHeader* header = (ASTCacheHeader*)mapping;
+    const char* problem = checkHeader(header, info.st_size, key);
+    if (!problem) problem = relocate(mapping, header);
+    if (!problem) problem = checkContents(mapping, header);
+    if (problem) {
+        printf("AST cache: %s ignored, %s.\n", path, problem);
+        munmap(mapping, info.st_size);
+        return false;
+    }
+
+    *program = (ASTNode*)(mapping + header->root);
+    memcpy(table->symbols, mapping + header->symbols, header->symbol_count * sizeof(Symbol));
+    table->symbol_count = header->symbol_count;
+    stats->nodes = header->node_count;
+    stats->symbols = header->symbol_count;
+    stats->relocations = header->relocation_count;
+    stats->bytes = header->size;
+    return true;
+}
+
+bool readASTCacheKey(const char* path, ASTCacheKey* key) {
+    FILE* in = fopen(path, "rb");
+    if (!in) return false;
+    ASTCacheHeader header;
+    bool read = fread(&header, sizeof(header), 1, in) == 1;
+    fclose(in);
+    if (!read || memcmp(header.magic, ASTCACHE_MAGIC, 4) != 0 || header.version != ASTCACHE_VERSION ||
+        header.compiler != compilerStamp()) {
+        return false;
+    }
+    key->hash = header.source_hash;
+    key->size = header.source_size;
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef ASTCACHE_H
+#define ASTCACHE_H
+
+#include "ast.h"
+#include "symbol_table.h"
+#include <stdio.h>
+#include <stdint.h>
+
+#define ASTCACHE_MAGIC "VYPA"
+#define ASTCACHE_VERSION 2
+#define ASTCACHE_DEFAULT_DIR ".vypcache"   // Shared with the incremental builds, the names differ
+
+// Parsed program cached by vypcomp --ast-cache, named after the hash of the source text:
+//
+//   header | nodes and symbols | relocations | pool
+//
+// Every node is stored as its struct of ast.h, and the symbols as the Symbol structs of the
+// table, so the mapped file is used in place. A pointer field holds the offset of what it points
+// to in the file (0 for null) and the relocations list the offsets of those fields, in 32 bits
+// (a file is at most 4 GB): loading adds the address of the mapping to each of them, nothing
+// else is copied. The strings of the nodes and of the symbols are in the pool, each one once.
+// The layout is the one of the build that wrote the file, so another build of vypcomp ignores it.
+// The checksum covers the whole file but itself; a file that fails it, or whose nodes, symbols
+// and strings do not hold together once relocated, is a miss and the source is parsed.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t compiler;                 // Build of vypcomp that wrote it
+    uint64_t source_hash;
+    uint64_t source_size;
+    int32_t node_count;
+    int32_t symbol_count;
+    uint64_t root;                     // Offset of the ASTProgramNode
+    uint64_t symbols;                  // Offset of the Symbol array
+    uint64_t nodes_offset;
+    uint64_t relocations_offset;
+    uint64_t relocation_count;
+    uint64_t pool_offset;
+    uint64_t size;                     // Bytes of the whole file
+    uint64_t checksum;                 // hashBytes of the file without this field
+} ASTCacheHeader;
+
+// What the cache knows of a source before it is parsed
+typedef struct {
+    uint64_t hash;
+    uint64_t size;
+} ASTCacheKey;
+
+typedef struct {
+    int nodes;
+    int symbols;
+    int strings;                       // Distinct strings in the pool
+    long relocations;
+    long bytes;
+} ASTCacheStats;
+
+// Hash the whole source and rewind it for the parser; false when it cannot be read
+bool hashSource(FILE* source, ASTCacheKey* key);
+
+// Map the program of the key from the cache directory. On a hit root comes from the mapping,
+// which stays until the exit, and its symbols replace the ones of the table. A missing file, one
+// of another source or build, or a damaged one is a miss.
+bool loadASTCache(const char* directory, const ASTCacheKey* key, ASTNode** program, SymbolTable* table, ASTCacheStats* stats);
+
+// Key of the source of a cache file, from its header; false when it is not a file of this build
+bool readASTCacheKey(const char* path, ASTCacheKey* key);
+
+// Store the program just parsed and its symbols under the key (the directory is created if
+// missing); false when they could not be written, which does not stop the compilation
+bool saveASTCache(const char* directory, const ASTCacheKey* key, ASTNode* program, SymbolTable* table, ASTCacheStats* stats);
+
+#endif // ASTCACHE_H
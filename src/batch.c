@@ -0,0 +1,161 @@
+#include "batch.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define BATCH_ERROR 19                 // Status of a job that could not be started
+
+static char* copyString(const char* text) {
+    char* copy = checkedCalloc(strlen(text) + 1, 1, ALLOC_MODULES);
+    strcpy(copy, text);
+    return copy;
+}
+
+Batch* createBatch() {
+    return checkedCalloc(1, sizeof(Batch), ALLOC_MODULES);
+}
+
+void freeBatch(Batch* batch) {
+    if (!batch) return;
+    for (int j = 0; j < batch->count; j++) {
+        free(batch->jobs[j].input);
+        free(batch->jobs[j].output);
+    }
+    free(batch->jobs);
+    free(batch);
+}
+
+// Input name with the extension in place of its own: tests/a.vyp -> tests/a.vc
+static char* outputNameFor(const char* input, const char* extension) {
+    const char* slash = strrchr(input, '/');
+    const char* dot = strrchr(input, '.');
+    size_t length = dot && (!slash || dot > slash) ? (size_t)(dot - input) : strlen(input);
+    char* name = checkedCalloc(length + strlen(extension) + 1, 1, ALLOC_MODULES);
+    memcpy(name, input, length);
+    strcpy(name + length, extension);
+    return name;
+}
+
+void addBatchJob(Batch* batch, const char* input, const char* output, const char* extension) {
+    if (batch->count == batch->capacity) {
+        batch->capacity = batch->capacity ? batch->capacity * 2 : 16;
+        batch->jobs = checkedRealloc(batch->jobs, batch->capacity * sizeof(BatchJob), ALLOC_MODULES);
+    }
+    BatchJob* job = &batch->jobs[batch->count++];
+    job->input = copyString(input);
+    job->output = output ? copyString(output) : outputNameFor(input, extension);
+}
+
+bool readManifest(Batch* batch, FILE* in, const char* extension) {
+    char* line = NULL;
+    size_t capacity = 0;
+    int number = 0;
+    bool ok = true;
+    while (ok && getline(&line, &capacity, in) >= 0) {
+        number++;
+        char* names[3] = {NULL, NULL, NULL};
+        int count = 0;
+        for (char* word = strtok(line, " \t\r\n"); word && count < 3; word = strtok(NULL, " \t\r\n")) {
+            names[count++] = word;
+        }
+        if (count == 0 || names[0][0] == '#') continue;
+        ok = count <= 2;
+        if (ok) addBatchJob(batch, names[0], names[1], extension);
+    }
+    free(line);
+    if (!ok) fprintf(stderr, "Error: line %d of the manifest is not valid.\n", number);
+    return ok;
+}
+
+//Workers
+
+// Run the job in a child whose stdout and stderr go to the log; returns its pid, 0 on failure
+static pid_t startJob(const BatchJob* job, FILE* log, BatchCompiler compile, void* context) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid != 0) return pid < 0 ? 0 : pid;
+
+    dup2(fileno(log), STDOUT_FILENO);
+    dup2(fileno(log), STDERR_FILENO);
+    setvbuf(stdout, NULL, _IOLBF, 0);      // Keeps the messages of both streams in order
+    int status = compile(job, context);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(status);
+}
+
+static void writeLog(const BatchJob* job, FILE* log, int status) {
+    printf("== %s -> %s (exit %d)\n", job->input, job->output, status);
+    if (log) {
+        char buffer[4096];
+        size_t read;
+        rewind(log);
+        while ((read = fread(buffer, 1, sizeof(buffer), log)) > 0) fwrite(buffer, 1, read, stdout);
+        fclose(log);
+    }
+    fflush(stdout);
+}
+
+int runBatch(Batch* batch, int workers, BatchCompiler compile, void* context, BatchStats* stats) {
+    if (workers <= 0) workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers <= 0) workers = 1;
+    if (workers > batch->count) workers = batch->count > 0 ? batch->count : 1;
+
+    pid_t* pids = checkedCalloc(batch->count, sizeof(pid_t), ALLOC_MODULES);
+    FILE** logs = checkedCalloc(batch->count, sizeof(FILE*), ALLOC_MODULES);
+    int* statuses = checkedCalloc(batch->count, sizeof(int), ALLOC_MODULES);
+    for (int j = 0; j < batch->count; j++) statuses[j] = -1;
+
+    int next = 0;                          // First job not started
+    int written = 0;                       // Jobs whose log is already in stdout
+    int running = 0;
+    int result = 0;
+    memset(stats, 0, sizeof(BatchStats));
+    stats->workers = workers;
+
+    while (written < batch->count) {
+        while (running < workers && next < batch->count) {
+            logs[next] = tmpfile();
+            pids[next] = logs[next] ? startJob(&batch->jobs[next], logs[next], compile, context) : 0;
+            if (pids[next]) {
+                running++;
+            } else {
+                fprintf(stderr, "Error: could not start the compilation of %s.\n", batch->jobs[next].input);
+                statuses[next] = BATCH_ERROR;
+            }
+            next++;
+        }
+
+        if (running > 0) {
+            int wait_status;
+            pid_t pid = waitpid(-1, &wait_status, 0);
+            if (pid < 0) break;
+            for (int j = 0; j < next; j++) {
+                if (pids[j] != pid) continue;
+                statuses[j] = WIFEXITED(wait_status) ? WEXITSTATUS(wait_status) : 128 + WTERMSIG(wait_status);
+                pids[j] = 0;
+                running--;
+            }
+        }
+
+        // The logs come out in the order of the jobs, whatever order they finish in
+        while (written < batch->count && statuses[written] >= 0) {
+            writeLog(&batch->jobs[written], logs[written], statuses[written]);
+            stats->files++;
+            if (statuses[written] != 0) {
+                stats->failed++;
+                if (result == 0) result = statuses[written];
+            }
+            written++;
+        }
+    }
+
+    free(pids);
+    free(logs);
+    free(statuses);
+    return result;
+}
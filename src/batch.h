@@ -0,0 +1,47 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#define BATCH_MAX_WORKERS 1024
+
+// One input of a batch and the file its code goes to
+typedef struct {
+    char* input;
+    char* output;
+} BatchJob;
+
+typedef struct {
+    BatchJob* jobs;
+    int count;
+    int capacity;
+} Batch;
+
+// Totals of a batch run
+typedef struct {
+    int files;
+    int failed;                    // Inputs whose compiler exited with a status other than 0
+    int workers;                   // Compilations that ran at the same time
+} BatchStats;
+
+// Compile one job and return the exit status of vypcomp for it
+typedef int (*BatchCompiler)(const BatchJob* job, void* context);
+
+Batch* createBatch();
+void freeBatch(Batch* batch);
+
+// Without an output the input name gets the extension instead of its own
+void addBatchJob(Batch* batch, const char* input, const char* output, const char* extension);
+
+// Manifest: one "input [output]" per line, blank lines and lines starting with # are skipped.
+// Returns false with the line printed into stderr when a line has more than two names.
+bool readManifest(Batch* batch, FILE* in, const char* extension);
+
+// Every job runs in its own process, at most workers at a time (0 = one per online processor).
+// The front end keeps its state in globals, so a process is the context of one file. What a
+// job prints into stdout and stderr is kept apart and written in one block, in the order of the
+// jobs. Returns the status of the first job that failed, 0 when all of them compiled.
+int runBatch(Batch* batch, int workers, BatchCompiler compile, void* context, BatchStats* stats);
+
+#endif // BATCH_H
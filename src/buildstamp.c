@@ -0,0 +1 @@
+const char build_stamp[] = "70870d79dca49dad0d7d852a327f947c344a6418287d8ce4ba8930b25c108eb6";
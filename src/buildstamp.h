@@ -0,0 +1,9 @@
+#ifndef BUILDSTAMP_H
+#define BUILDSTAMP_H
+
+// Checksum of every other object of vypcomp, written by the Makefile when it links vypcomp
+// (buildstamp.c is generated there). Any change to any part of the compiler changes it, so what
+// one build caches on disk is never taken by another.
+extern const char build_stamp[];
+
+#endif // BUILDSTAMP_H
@@ -0,0 +1,243 @@
+#include "bytecode.h"
+#include "alloc.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BYTECODE_BYTE_ORDER 0x01020304
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + BYTECODE_ALIGNMENT - 1) / BYTECODE_ALIGNMENT * BYTECODE_ALIGNMENT;
+}
+
+//Writing
+
+static bool sameString(VMString* a, VMString* b) {
+    return a->length == b->length && memcmp(a->codes, b->codes, a->length * sizeof(int64_t)) == 0;
+}
+
+// Index of every string of the code in the pool, where equal literals share their entry;
+// returns the number of entries, listed in unique
+static int internStrings(VMCode* code, int* pooled, int* unique) {
+    int buckets = 1;
+    while (buckets < code->string_count * 2) buckets *= 2;
+    int* table = checkedCalloc(buckets, sizeof(int), ALLOC_VM);    // Index in unique + 1, 0 when empty
+    int count = 0;
+    for (int s = 0; s < code->string_count; s++) {
+        VMString* string = &code->strings[s];
+        int bucket = (int)(hashBytes(HASH_SEED, string->codes, string->length * sizeof(int64_t)) & (buckets - 1));
+        while (table[bucket] && !sameString(&code->strings[unique[table[bucket] - 1]], string)) {
+            bucket = (bucket + 1) & (buckets - 1);
+        }
+        if (!table[bucket]) {
+            unique[count++] = s;
+            table[bucket] = count;
+        }
+        pooled[s] = table[bucket] - 1;
+    }
+    free(table);
+    return count;
+}
+
+static void writePadding(FILE* out, uint64_t* position, uint64_t offset) {
+    for (; *position < offset; (*position)++) fputc(0, out);
+}
+
+static void writeBytes(FILE* out, uint64_t* position, const void* data, size_t size) {
+    fwrite(data, 1, size, out);
+    *position += size;
+}
+
+int writeBytecode(VMCode* code, int registers, FILE* out) {
+    int* pooled = checkedCalloc(code->string_count, sizeof(int), ALLOC_VM);
+    int* unique = checkedCalloc(code->string_count, sizeof(int), ALLOC_VM);
+    int string_count = internStrings(code, pooled, unique);
+
+    BytecodeHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BYTECODE_MAGIC, 4);
+    header.version = BYTECODE_VERSION;
+    header.byte_order = BYTECODE_BYTE_ORDER;
+    header.instr_size = sizeof(VMInstr);
+    header.registers = registers;
+    header.count = code->count;
+    header.label_count = code->label_count;
+    header.string_count = string_count;
+    header.cache_count = code->cache_count;
+    header.code_offset = alignOffset(sizeof(header));
+    header.labels_offset = alignOffset(header.code_offset + (uint64_t)(code->count + 1) * sizeof(VMInstr));
+    header.strings_offset = alignOffset(header.labels_offset + (uint64_t)code->label_count * sizeof(VMLabel));
+    header.pool_offset = alignOffset(header.strings_offset + (uint64_t)string_count * sizeof(VMString));
+    uint64_t size = header.pool_offset;
+    for (int s = 0; s < string_count; s++) size += code->strings[unique[s]].length * sizeof(int64_t);
+    for (int l = 0; l < code->label_count; l++) size += strlen(code->labels[l].name) + 1;
+    header.size = size;
+
+    uint64_t position = 0;
+    writeBytes(out, &position, &header, sizeof(header));
+
+    // The handlers are addresses in the engine, it sets them when it starts
+    writePadding(out, &position, header.code_offset);
+    for (int i = 0; i <= code->count; i++) {
+        VMInstr instr = code->code[i];
+        instr.handler = NULL;
+        for (int o = 0; o < 3; o++) {
+            if (instr.operands[o].kind == VM_OPERAND_STR) instr.operands[o].value = pooled[instr.operands[o].value];
+        }
+        writeBytes(out, &position, &instr, sizeof(instr));
+    }
+
+    // Pointers are written as offsets in the container, the labels are still sorted by name
+    uint64_t names = header.pool_offset;
+    for (int s = 0; s < string_count; s++) names += code->strings[unique[s]].length * sizeof(int64_t);
+    writePadding(out, &position, header.labels_offset);
+    for (int l = 0; l < code->label_count; l++) {
+        VMLabel label;
+        memset(&label, 0, sizeof(label));
+        label.name = (char*)(uintptr_t)names;
+        label.target = code->labels[l].target;
+        writeBytes(out, &position, &label, sizeof(label));
+        names += strlen(code->labels[l].name) + 1;
+    }
+    uint64_t codes = header.pool_offset;
+    writePadding(out, &position, header.strings_offset);
+    for (int s = 0; s < string_count; s++) {
+        VMString string;
+        memset(&string, 0, sizeof(string));
+        string.codes = (int64_t*)(uintptr_t)codes;
+        string.length = code->strings[unique[s]].length;
+        writeBytes(out, &position, &string, sizeof(string));
+        codes += string.length * sizeof(int64_t);
+    }
+
+    writePadding(out, &position, header.pool_offset);
+    for (int s = 0; s < string_count; s++) {
+        VMString* string = &code->strings[unique[s]];
+        writeBytes(out, &position, string->codes, string->length * sizeof(int64_t));
+    }
+    for (int l = 0; l < code->label_count; l++) {
+        writeBytes(out, &position, code->labels[l].name, strlen(code->labels[l].name) + 1);
+    }
+
+    free(pooled);
+    free(unique);
+    return ferror(out) ? 1 : 0;
+}
+
+//Loading
+
+bool isBytecodeFile(FILE* in) {
+    char magic[4];
+    bool found = fread(magic, 1, 4, in) == 4 && memcmp(magic, BYTECODE_MAGIC, 4) == 0;
+    rewind(in);
+    return found;
+}
+
+// Section of count records of size bytes, inside the container and aligned
+static bool validSection(BytecodeHeader* header, uint64_t offset, uint64_t count, uint64_t size) {
+    return offset % BYTECODE_ALIGNMENT == 0 && offset >= sizeof(BytecodeHeader) && offset <= header->size &&
+           count <= (header->size - offset) / size;
+}
+
+static const char* checkHeader(BytecodeHeader* header, uint64_t size) {
+    if (header->version != BYTECODE_VERSION) return "unsupported version";
+    if (header->byte_order != BYTECODE_BYTE_ORDER || header->instr_size != sizeof(VMInstr)) return "written by another kind of machine";
+    if (header->size != size) return "truncated";
+    if (header->count < 0 || header->label_count < 0 || header->string_count < 0 || header->cache_count < 0) return "negative count";
+    if (!validSection(header, header->code_offset, (uint64_t)header->count + 1, sizeof(VMInstr)) ||
+        !validSection(header, header->labels_offset, header->label_count, sizeof(VMLabel)) ||
+        !validSection(header, header->strings_offset, header->string_count, sizeof(VMString)) ||
+        !validSection(header, header->pool_offset, 0, 1)) {
+        return "section out of the file";
+    }
+    return NULL;
+}
+
+// Turn the offsets of the labels and strings into pointers in the mapping, once they are checked
+static const char* relocate(VMCode* code, BytecodeHeader* header) {
+    char* base = code->mapping;
+    for (int l = 0; l < code->label_count; l++) {
+        uint64_t offset = (uintptr_t)code->labels[l].name;
+        if (offset < header->pool_offset || offset >= header->size) return "label name out of the pool";
+        if (!memchr(base + offset, '\0', header->size - offset)) return "unterminated label name";
+        if (code->labels[l].target < 0 || code->labels[l].target > code->count) return "label out of the code";
+        code->labels[l].name = base + offset;
+    }
+    for (int s = 0; s < code->string_count; s++) {
+        uint64_t offset = (uintptr_t)code->strings[s].codes;
+        int64_t length = code->strings[s].length;
+        if (offset < header->pool_offset || offset % sizeof(int64_t) != 0 || offset > header->size ||
+            length < 0 || (uint64_t)length > (header->size - offset) / sizeof(int64_t)) {
+            return "string out of the pool";
+        }
+        code->strings[s].codes = (int64_t*)(base + offset);
+    }
+    for (int i = 0; i <= code->count; i++) {
+        if (!checkVMInstr(code, &code->code[i], header->registers)) return "invalid instruction";
+    }
+    return NULL;
+}
+
+VMCode* mapBytecode(const char* path, VMOptions* options, int* status) {
+    *status = VM_ERROR_SYNTAX;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening file");
+        *status = VM_ERROR_ARGUMENTS;
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (uint64_t)info.st_size < sizeof(BytecodeHeader)) {
+        close(fd);
+        fprintf(stderr, "Error: %s is not a bytecode container.\n", path);
+        return NULL;
+    }
+
+    // Private and writable: the engine stores its handlers in the instructions, which only copies
+    // the pages of code that the program runs
+    void* mapping = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Error mapping file");
+        *status = VM_ERROR_INTERNAL;
+        return NULL;
+    }
+
+    BytecodeHeader* header = mapping;
+    const char* problem = checkHeader(header, info.st_size);
+    if (!problem && header->registers != options->registers) {
+        fprintf(stderr, "Error: %s was compiled for %d registers.\n", path, header->registers);
+        munmap(mapping, info.st_size);
+        *status = VM_ERROR_ARGUMENTS;
+        return NULL;
+    }
+    if (problem) {
+        fprintf(stderr, "Error: bytecode container %s: %s.\n", path, problem);
+        munmap(mapping, info.st_size);
+        return NULL;
+    }
+
+    VMCode* code = checkedCalloc(1, sizeof(VMCode), ALLOC_VM);
+    code->mapping = mapping;
+    code->mapping_size = info.st_size;
+    code->code = (VMInstr*)((char*)mapping + header->code_offset);
+    code->count = header->count;
+    code->labels = (VMLabel*)((char*)mapping + header->labels_offset);
+    code->label_count = header->label_count;
+    code->strings = (VMString*)((char*)mapping + header->strings_offset);
+    code->string_count = header->string_count;
+    code->caches = checkedCalloc(header->cache_count, sizeof(VMCallCache), ALLOC_VM);
+    code->cache_count = header->cache_count;
+    problem = relocate(code, header);
+    if (problem) {
+        fprintf(stderr, "Error: bytecode container %s: %s.\n", path, problem);
+        freeVMCode(code);
+        return NULL;
+    }
+    *status = VM_OK;
+    return code;
+}
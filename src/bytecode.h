@@ -0,0 +1,48 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "interp.h"
+#include <stdio.h>
+#include <stdint.h>
+
+#define BYTECODE_MAGIC "VYPB"
+#define BYTECODE_VERSION 1
+#define BYTECODE_ALIGNMENT 64          // Sections start on a cache line
+
+// Binary container of a decoded program, written by vypcomp --binary and mapped by vypint.
+// The sections have the layout of the engine structures, so the loader only has to turn the
+// offsets of the labels and strings into pointers; the instructions run where they are mapped.
+//
+//   header | instructions (VMInstr, halt included) | labels (VMLabel) | strings (VMString) |
+//   pool: the code points of the strings (int64_t), then the label names (NUL terminated)
+//
+// Every string literal of the program is in the pool once. The container is only valid for the
+// machine that wrote it (byte order and structure sizes) and the register count of the header.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;               // 0x01020304 as written by the machine
+    uint32_t instr_size;               // sizeof(VMInstr)
+    int32_t registers;                 // General purpose registers the operands were decoded for
+    int32_t count;                     // Instructions without the halt
+    int32_t label_count;
+    int32_t string_count;
+    int32_t cache_count;
+    int32_t reserved;
+    uint64_t code_offset;
+    uint64_t labels_offset;
+    uint64_t strings_offset;
+    uint64_t pool_offset;
+    uint64_t size;                     // Bytes of the whole container
+} BytecodeHeader;
+
+// Write the decoded program; 0 on success
+int writeBytecode(VMCode* code, int registers, FILE* out);
+
+// True when the file starts with the magic of a container; the file is left at its start
+bool isBytecodeFile(FILE* in);
+
+// Map a container and check it; NULL with the exit code in status when it is not valid
+VMCode* mapBytecode(const char* path, VMOptions* options, int* status);
+
+#endif // BYTECODE_H
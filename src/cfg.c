@@ -0,0 +1,125 @@
+#include "cfg.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static bool isJump(IRInstr* instr) {
+    return instr->op == IR_JUMP || instr->op == IR_JUMPZ || instr->op == IR_JUMPNZ;
+}
+
+// Instructions after which a new block starts
+static bool endsBlock(IRInstr* instr) {
+    return isJump(instr) || instr->op == IR_RETURN;
+}
+
+static void addEdge(ControlFlowGraph* cfg, int from, int to) {
+    BasicBlock* source = &cfg->blocks[from];
+    for (int i = 0; i < source->successor_count; i++) {
+        if (source->successors[i] == to) return; // Both branches go to the same block
+    }
+    source->successors[source->successor_count++] = to;
+
+    BasicBlock* target = &cfg->blocks[to];
+    target->predecessors = checkedRealloc(target->predecessors, (target->predecessor_count + 1) * sizeof(int), ALLOC_ANALYSIS);
+    target->predecessors[target->predecessor_count++] = from;
+}
+
+int findBlockOfLabel(ControlFlowGraph* cfg, long label) {
+    for (int i = 0; i < cfg->block_count; i++) {
+        IRInstr* first = cfg->blocks[i].first;
+        if (first->op == IR_LABEL && first->imm == label) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ControlFlowGraph* buildCFG(IRFunction* function) {
+    ControlFlowGraph* cfg = (ControlFlowGraph*)checkedMalloc(sizeof(ControlFlowGraph), ALLOC_ANALYSIS);
+    cfg->function = function;
+    cfg->blocks = NULL;
+    cfg->block_count = 0;
+    cfg->dominators = NULL;
+
+    // Count the leaders: first instruction, labels and instructions after a jump
+    int capacity = 0;
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        if (instr == function->first || instr->op == IR_LABEL || endsBlock(instr->prev)) {
+            capacity++;
+        }
+    }
+    cfg->blocks = (BasicBlock*)checkedCalloc(capacity ? capacity : 1, sizeof(BasicBlock), ALLOC_ANALYSIS);
+
+    // Split the instruction list into blocks
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        bool leader = instr == function->first || instr->op == IR_LABEL || endsBlock(instr->prev);
+        if (leader) {
+            BasicBlock* block = &cfg->blocks[cfg->block_count];
+            block->id = cfg->block_count++;
+            block->first = instr;
+        }
+        cfg->blocks[cfg->block_count - 1].last = instr;
+    }
+
+    // Connect the blocks
+    for (int i = 0; i < cfg->block_count; i++) {
+        IRInstr* last = cfg->blocks[i].last;
+        if (isJump(last)) {
+            int target = findBlockOfLabel(cfg, last->imm);
+            if (target >= 0) addEdge(cfg, i, target);
+        }
+        bool fallsThrough = last->op != IR_JUMP && last->op != IR_RETURN;
+        if (fallsThrough && i + 1 < cfg->block_count) {
+            addEdge(cfg, i, i + 1);
+        }
+    }
+    return cfg;
+}
+
+// Iterate dom(b) = {b} + intersection of dom(p) for every predecessor p until nothing changes
+void computeDominators(ControlFlowGraph* cfg) {
+    int n = cfg->block_count;
+    compilerFree(cfg->dominators);
+    cfg->dominators = (bool*)checkedMalloc((n ? n * n : 1) * sizeof(bool), ALLOC_ANALYSIS);
+    for (int b = 0; b < n; b++) {
+        for (int d = 0; d < n; d++) {
+            cfg->dominators[b * n + d] = b == 0 ? d == 0 : true;
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = 1; b < n; b++) {
+            BasicBlock* block = &cfg->blocks[b];
+            for (int d = 0; d < n; d++) {
+                bool dominated = d == b;
+                if (!dominated && block->predecessor_count > 0) {
+                    dominated = true;
+                    for (int p = 0; p < block->predecessor_count && dominated; p++) {
+                        dominated = cfg->dominators[block->predecessors[p] * n + d];
+                    }
+                }
+                if (cfg->dominators[b * n + d] != dominated) {
+                    cfg->dominators[b * n + d] = dominated;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+bool dominates(ControlFlowGraph* cfg, int dominator, int block) {
+    return cfg->dominators && cfg->dominators[block * cfg->block_count + dominator];
+}
+
+void freeCFG(ControlFlowGraph* cfg) {
+    if (!cfg) return;
+    for (int i = 0; i < cfg->block_count; i++) {
+        compilerFree(cfg->blocks[i].predecessors);
+    }
+    compilerFree(cfg->blocks);
+    compilerFree(cfg->dominators);
+    compilerFree(cfg);
+}
@@ -0,0 +1,33 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "ir.h"
+
+#define MAX_SUCCESSORS 2
+
+// Straight-line sequence of IR instructions
+typedef struct {
+    int id;                        // Position of the block in the function
+    IRInstr* first;                // First instruction (usually a label)
+    IRInstr* last;                 // Last instruction (usually a jump or return)
+    int successors[MAX_SUCCESSORS];
+    int successor_count;
+    int* predecessors;
+    int predecessor_count;
+} BasicBlock;
+
+// Control-flow graph of one function, blocks are kept in instruction order
+typedef struct {
+    IRFunction* function;
+    BasicBlock* blocks;
+    int block_count;
+    bool* dominators;              // [b * block_count + d] is true when d dominates b (null until computed)
+} ControlFlowGraph;
+
+ControlFlowGraph* buildCFG(IRFunction* function);
+int findBlockOfLabel(ControlFlowGraph* cfg, long label);
+void computeDominators(ControlFlowGraph* cfg);
+bool dominates(ControlFlowGraph* cfg, int dominator, int block);
+void freeCFG(ControlFlowGraph* cfg);
+
+#endif // CFG_H
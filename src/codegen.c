@@ -0,0 +1,668 @@
+#include "codegen.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_LABEL 256
+#define MAX_USES 64
+
+// State of the generation of one function
+typedef struct {
+    IRProgram* program;
+    VCProgram* out;
+    IRFunction* function;          // Function being translated
+    RegisterAllocation* allocation;
+    ProgramLayout* layout;         // Attribute offsets and vtables of the classes
+    Profile* profile;              // Counters of an instrumented run (can be null)
+    bool failed;
+} CodeGenerator;
+
+static VCOperand fp(long offset) {
+    return vcStack(FRAME_REGISTER, offset);
+}
+
+static VCOperand sp(long offset) {
+    return vcStack(VC_REG_SP, offset);
+}
+
+static VCOperand scratch() {
+    return vcReg(SCRATCH_REGISTER);
+}
+
+static void reportError(CodeGenerator* gen, const char* message, const char* detail) {
+    fprintf(stderr, "Error: %s '%s'.\n", message, detail ? detail : "?");
+    gen->failed = true;
+}
+
+//Labels
+
+static void functionLabel(char* buffer, const char* name) {
+    snprintf(buffer, MAX_LABEL, "f.%s", name);
+}
+
+static void localLabel(char* buffer, IRFunction* function, long label) {
+    snprintf(buffer, MAX_LABEL, "l.%s.%ld", function->name, label);
+}
+
+static void newRoutineLabel(char* buffer, const char* className) {
+    snprintf(buffer, MAX_LABEL, "n.%s", className);
+}
+
+//Locations
+
+// Operand that reads a virtual register
+static VCOperand valueOperand(CodeGenerator* gen, int value) {
+    ValueLocation location = gen->allocation->locations[value];
+    switch (location.kind) {
+        case LOCATION_REGISTER:
+            return vcReg(location.index);
+        case LOCATION_STACK:
+            return fp(location.index);
+        case LOCATION_PARAM:
+            // Arguments are just below the return address: [$7-1-count .. $7-2]
+            return fp(-1 - gen->function->param_count + location.index);
+        default:
+            return vcImm(0);
+    }
+}
+
+// Register where an instruction can write a virtual register
+static VCOperand destRegister(CodeGenerator* gen, int value) {
+    ValueLocation location = gen->allocation->locations[value];
+    return location.kind == LOCATION_REGISTER ? vcReg(location.index) : scratch();
+}
+
+// Move the scratch register to the home of a virtual register kept in the stack
+static void storeDest(CodeGenerator* gen, int value) {
+    if (gen->allocation->locations[value].kind != LOCATION_REGISTER) {
+        emitVC2(gen->out, VC_SET, valueOperand(gen, value), scratch());
+    }
+}
+
+static void emitMove(CodeGenerator* gen, int dst, VCOperand source) {
+    VCOperand target = valueOperand(gen, dst);
+    if (!sameVCOperand(target, source)) {
+        emitVC2(gen->out, VC_SET, target, source);
+    }
+}
+
+static void emitBinary(CodeGenerator* gen, VCOpcode op, IRInstr* instr) {
+    VCOperand dst = destRegister(gen, instr->dst);
+    emitVC3(gen->out, op, dst, valueOperand(gen, instr->src1), valueOperand(gen, instr->src2));
+    storeDest(gen, instr->dst);
+}
+
+// a <= b is !(a > b), a != b is !(a == b)
+static void emitNegatedBinary(CodeGenerator* gen, VCOpcode op, IRInstr* instr) {
+    VCOperand dst = destRegister(gen, instr->dst);
+    emitVC3(gen->out, op, dst, valueOperand(gen, instr->src1), valueOperand(gen, instr->src2));
+    emitVC2(gen->out, VC_NOT, dst, dst);
+    storeDest(gen, instr->dst);
+}
+
+//Calls
+
+// Calling convention: arguments at [$SP+1..$SP+n], return address at [$SP+n+1],
+// result in the scratch register. Every register is clobbered by the callee.
+// The target is a label or a register with the chunk id of a string that holds one.
+static void emitCallSequence(VCProgram* out, VCOperand target, VCOperand* args, int arg_count) {
+    for (int i = 0; i < arg_count; i++) {
+        emitVC2(out, VC_SET, sp(i + 1), args[i]);
+    }
+    emitVC3(out, VC_ADDI, vcReg(VC_REG_SP), vcReg(VC_REG_SP), vcImm(arg_count + 1));
+    emitVC2(out, VC_CALL, sp(0), target);
+    emitVC3(out, VC_SUBI, vcReg(VC_REG_SP), vcReg(VC_REG_SP), vcImm(arg_count + 1));
+}
+
+// Label of the code that a call runs. Fails for a method with overrides in the subclasses of
+// the static class of the receiver, the vtable of the object decides at run time.
+static bool findStaticTarget(CodeGenerator* gen, IRInstr* instr, char* label, int* slot) {
+    *slot = -1;
+    if (instr->op == IR_CALL_METHOD) {
+        const char* staticClass = gen->function->values[instr->args[0]].className;
+        const char* method = strchr(instr->name, '.');
+        *slot = method ? getMethodSlot(gen->layout, staticClass, method + 1) : -1;
+        if (*slot >= 0 && (gen->program->open_classes || isMethodOverridden(gen->layout, staticClass, *slot))) {
+            return false;
+        }
+    }
+    functionLabel(label, instr->name);
+    return true;
+}
+
+static void emitCall(CodeGenerator* gen, IRInstr* instr) {
+    VCOperand* args = checkedMalloc((instr->arg_count + 1) * sizeof(VCOperand), ALLOC_CODE);
+    for (int i = 0; i < instr->arg_count; i++) {
+        args[i] = valueOperand(gen, instr->args[i]);
+    }
+
+    char label[MAX_LABEL];
+    int slot;
+    if (findStaticTarget(gen, instr, label, &slot)) {
+        emitCallSequence(gen->out, vcLabel(label), args, instr->arg_count);
+    } else {
+        // vtable = receiver[0]; target = vtable[VTABLE_FIRST_METHOD + slot]
+        emitVC3(gen->out, VC_GETWORD, scratch(), args[0], vcImm(0));
+        emitVC3(gen->out, VC_GETWORD, scratch(), scratch(), vcImm(VTABLE_FIRST_METHOD + slot));
+        emitCallSequence(gen->out, scratch(), args, instr->arg_count);
+    }
+    compilerFree(args);
+
+    if (instr->dst >= 0) {
+        emitMove(gen, instr->dst, scratch());
+    }
+}
+
+static void emitRuntimeCall(CodeGenerator* gen, const char* label, IRInstr* instr, int* values, int count) {
+    VCOperand args[3];
+    for (int i = 0; i < count; i++) {
+        args[i] = valueOperand(gen, values[i]);
+    }
+    emitCallSequence(gen->out, vcLabel(label), args, count);
+    emitMove(gen, instr->dst, scratch());
+}
+
+// rt.concat takes the pieces followed by how many there are
+static void emitConcatCall(CodeGenerator* gen, IRInstr* instr) {
+    VCOperand* args = checkedMalloc((instr->arg_count + 1) * sizeof(VCOperand), ALLOC_CODE);
+    for (int i = 0; i < instr->arg_count; i++) {
+        args[i] = valueOperand(gen, instr->args[i]);
+    }
+    args[instr->arg_count] = vcImm(instr->arg_count);
+    emitCallSequence(gen->out, vcLabel("rt.concat"), args, instr->arg_count + 1);
+    compilerFree(args);
+    emitMove(gen, instr->dst, scratch());
+}
+
+//Frames
+
+static void emitPrologue(VCProgram* out, const char* label, int frame_size) {
+    emitVC1(out, VC_LABEL, vcLabel(label));
+    emitVC2(out, VC_SET, sp(1), vcReg(FRAME_REGISTER));           // Save the caller's frame pointer
+    emitVC3(out, VC_ADDI, vcReg(VC_REG_SP), vcReg(VC_REG_SP), vcImm(1));
+    emitVC2(out, VC_SET, vcReg(FRAME_REGISTER), vcReg(VC_REG_SP));
+    if (frame_size > 0) {
+        emitVC3(out, VC_ADDI, vcReg(VC_REG_SP), vcReg(VC_REG_SP), vcImm(frame_size));
+    }
+}
+
+// Leave $SP at the return address of the caller
+static void emitFrameRelease(VCProgram* out) {
+    emitVC2(out, VC_SET, vcReg(VC_REG_SP), vcReg(FRAME_REGISTER));
+    emitVC2(out, VC_SET, vcReg(FRAME_REGISTER), sp(0));
+    emitVC3(out, VC_SUBI, vcReg(VC_REG_SP), vcReg(VC_REG_SP), vcImm(1));
+}
+
+static void emitEpilogue(VCProgram* out) {
+    emitFrameRelease(out);
+    emitVC1(out, VC_RETURN, sp(0));
+}
+
+//Tail calls
+
+// A call whose result is returned right away, with as many arguments as the function has
+// parameters so the callee can take over the frame. JUMP only takes a label, so the target
+// has to be known.
+static bool isTailCall(CodeGenerator* gen, IRInstr* instr, char* label) {
+    if (instr->op != IR_CALL && instr->op != IR_CALL_METHOD) return false;
+    IRInstr* next = instr->next;
+    int slot;
+    return next && next->op == IR_RETURN && (next->src1 < 0 || next->src1 == instr->dst) &&
+           instr->arg_count == gen->function->param_count && findStaticTarget(gen, instr, label, &slot);
+}
+
+// The arguments replace the parameters, the return address stays where it is and the callee
+// returns straight to our caller
+static void emitTailCall(CodeGenerator* gen, const char* label, IRInstr* instr) {
+    int count = instr->arg_count;
+    VCOperand* args = checkedMalloc((count + 1) * sizeof(VCOperand), ALLOC_CODE);
+
+    // A parameter slot overwritten before it is read goes through the free stack first
+    bool direct = true;
+    for (int i = 0; i < count; i++) {
+        args[i] = valueOperand(gen, instr->args[i]);
+        ValueLocation location = gen->allocation->locations[instr->args[i]];
+        if (location.kind == LOCATION_PARAM && location.index < i) direct = false;
+    }
+    for (int i = 0; i < count && !direct; i++) {
+        emitVC2(gen->out, VC_SET, sp(i + 1), args[i]);
+        args[i] = sp(i + 1);
+    }
+    for (int i = 0; i < count; i++) {
+        VCOperand slot = fp(-1 - count + i);
+        if (!sameVCOperand(slot, args[i])) emitVC2(gen->out, VC_SET, slot, args[i]);
+    }
+    compilerFree(args);
+
+    emitFrameRelease(gen->out);
+    emitVC1(gen->out, VC_JUMP, vcLabel(label));
+}
+
+//Instructions
+
+static void generateInstr(CodeGenerator* gen, IRInstr* instr) {
+    VCProgram* out = gen->out;
+    IRValue* values = gen->function->values;
+    char label[MAX_LABEL];
+
+    switch (instr->op) {
+        case IR_CONST_INT:
+            emitMove(gen, instr->dst, vcImm(instr->imm));
+            break;
+        case IR_CONST_STR:
+            emitMove(gen, instr->dst, vcStr(instr->name));
+            break;
+        case IR_MOVE:
+            emitMove(gen, instr->dst, valueOperand(gen, instr->src1));
+            break;
+        case IR_ADD: emitBinary(gen, VC_ADDI, instr); break;
+        case IR_SUB: emitBinary(gen, VC_SUBI, instr); break;
+        case IR_MUL: emitBinary(gen, VC_MULI, instr); break;
+        case IR_DIV: emitBinary(gen, VC_DIVI, instr); break;
+        case IR_LT:
+            emitBinary(gen, values[instr->src1].type == IR_TYPE_STRING ? VC_LTS : VC_LTI, instr);
+            break;
+        case IR_GT:
+            emitBinary(gen, values[instr->src1].type == IR_TYPE_STRING ? VC_GTS : VC_GTI, instr);
+            break;
+        case IR_LE:
+            emitNegatedBinary(gen, values[instr->src1].type == IR_TYPE_STRING ? VC_GTS : VC_GTI, instr);
+            break;
+        case IR_GE:
+            emitNegatedBinary(gen, values[instr->src1].type == IR_TYPE_STRING ? VC_LTS : VC_LTI, instr);
+            break;
+        case IR_EQ:
+            emitBinary(gen, values[instr->src1].type == IR_TYPE_STRING ? VC_EQS : VC_EQI, instr);
+            break;
+        case IR_NE:
+            emitNegatedBinary(gen, values[instr->src1].type == IR_TYPE_STRING ? VC_EQS : VC_EQI, instr);
+            break;
+        case IR_NOT: {
+            VCOperand dst = destRegister(gen, instr->dst);
+            emitVC2(out, VC_NOT, dst, valueOperand(gen, instr->src1));
+            storeDest(gen, instr->dst);
+            break;
+        }
+        case IR_NEG: {
+            VCOperand dst = destRegister(gen, instr->dst);
+            emitVC3(out, VC_SUBI, dst, vcImm(0), valueOperand(gen, instr->src1));
+            storeDest(gen, instr->dst);
+            break;
+        }
+        case IR_CONCAT:
+            emitConcatCall(gen, instr);
+            break;
+        case IR_INT2STR: {
+            VCOperand dst = destRegister(gen, instr->dst);
+            emitVC2(out, VC_INT2STRING, dst, valueOperand(gen, instr->src1));
+            storeDest(gen, instr->dst);
+            break;
+        }
+        case IR_STRLEN: {
+            VCOperand dst = destRegister(gen, instr->dst);
+            emitVC2(out, VC_GETSIZE, dst, valueOperand(gen, instr->src1));
+            storeDest(gen, instr->dst);
+            break;
+        }
+        case IR_SUBSTR:
+            emitRuntimeCall(gen, "rt.substr", instr, instr->args, 3);
+            break;
+        case IR_READ_INT:
+        case IR_READ_STR: {
+            VCOperand dst = destRegister(gen, instr->dst);
+            emitVC1(out, instr->op == IR_READ_INT ? VC_READI : VC_READS, dst);
+            storeDest(gen, instr->dst);
+            break;
+        }
+        case IR_PRINT: {
+            IRType type = values[instr->src1].type;
+            if (type != IR_TYPE_INT && type != IR_TYPE_STRING) {
+                reportError(gen, "print of a value that is not primitive in", gen->function->name);
+                break;
+            }
+            emitVC1(out, type == IR_TYPE_INT ? VC_WRITEI : VC_WRITES, valueOperand(gen, instr->src1));
+            break;
+        }
+        case IR_NEW:
+            newRoutineLabel(label, instr->name);
+            emitCallSequence(out, vcLabel(label), NULL, 0);
+            emitMove(gen, instr->dst, scratch());
+            break;
+        case IR_GETFIELD: {
+            int index = getFieldOffset(gen->layout, values[instr->src1].className, instr->name);
+            if (index < 0) {
+                reportError(gen, "unknown attribute", instr->name);
+                break;
+            }
+            VCOperand dst = destRegister(gen, instr->dst);
+            emitVC3(out, VC_GETWORD, dst, valueOperand(gen, instr->src1), vcImm(index));
+            storeDest(gen, instr->dst);
+            break;
+        }
+        case IR_SETFIELD: {
+            int index = getFieldOffset(gen->layout, values[instr->src1].className, instr->name);
+            if (index < 0) {
+                reportError(gen, "unknown attribute", instr->name);
+                break;
+            }
+            emitVC3(out, VC_SETWORD, valueOperand(gen, instr->src1), vcImm(index), valueOperand(gen, instr->src2));
+            break;
+        }
+        case IR_CALL:
+        case IR_CALL_METHOD:
+            emitCall(gen, instr);
+            break;
+        case IR_LABEL:
+            localLabel(label, gen->function, instr->imm);
+            emitVC1(out, VC_LABEL, vcLabel(label));
+            break;
+        case IR_JUMP:
+            localLabel(label, gen->function, instr->imm);
+            emitVC1(out, VC_JUMP, vcLabel(label));
+            break;
+        case IR_JUMPZ:
+        case IR_JUMPNZ:
+            localLabel(label, gen->function, instr->imm);
+            emitVC2(out, instr->op == IR_JUMPZ ? VC_JUMPZ : VC_JUMPNZ, vcLabel(label),
+                    valueOperand(gen, instr->src1));
+            break;
+        case IR_RETURN:
+            if (instr->src1 >= 0) {
+                emitVC2(out, VC_SET, scratch(), valueOperand(gen, instr->src1));
+            }
+            emitEpilogue(out);
+            break;
+        default:
+            reportError(gen, "unsupported intermediate instruction", getIROpcodeName(instr->op));
+            break;
+    }
+}
+
+//Profile
+
+// Executions of the instructions that use or define each value, from the entries of the function
+// and the counts of its labels; null when the profile has never seen the function run
+static long long* computeValueWeights(CodeGenerator* gen, IRFunction* function) {
+    char label[MAX_LABEL];
+    functionLabel(label, function->name);
+    ProfileEntry* entry = gen->profile ? findProfileEntry(gen->profile, PROFILE_FUNCTION, label) : NULL;
+    if (!entry) return NULL;
+
+    long long* weights = checkedCalloc(function->value_count, sizeof(long long), ALLOC_CODE);
+    long long frequency = entry->count;
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        if (instr->op == IR_LABEL) {
+            localLabel(label, function, instr->imm);
+            frequency = getProfileCount(gen->profile, PROFILE_BLOCK, label);
+        }
+        int uses[MAX_USES];
+        int count = getIRInstrUses(instr, uses, MAX_USES);
+        for (int u = 0; u < count; u++) weights[uses[u]] += frequency;
+        if (instr->dst >= 0) weights[instr->dst] += frequency;
+
+        if (instr->op == IR_JUMP || instr->op == IR_RETURN) {
+            frequency = 0;                         // Only a label makes the next code reachable
+        } else if (instr->op == IR_JUMPZ || instr->op == IR_JUMPNZ) {
+            // The branches to one label are counted together, so this is an upper bound
+            localLabel(label, function, instr->imm);
+            ProfileEntry* branch = findProfileEntry(gen->profile, PROFILE_BRANCH, label);
+            if (branch && branch->other < frequency) frequency = branch->other;
+        }
+    }
+    return weights;
+}
+
+static void generateFunction(CodeGenerator* gen, IRFunction* function, CodegenStats* stats) {
+    char label[MAX_LABEL];
+    gen->function = function;
+    long long* weights = computeValueWeights(gen, function);
+    gen->allocation = allocateRegisters(function, ALLOCATABLE_REGISTERS, weights);
+    if (weights && stats) stats->profiled_functions++;
+    compilerFree(weights);
+
+    functionLabel(label, function->name);
+    emitPrologue(gen->out, label, gen->allocation->frame_size);
+
+    // Parameters that got a register are loaded once
+    for (int v = 0; v < function->value_count; v++) {
+        if (function->values[v].paramIndex >= 0 && gen->allocation->locations[v].kind == LOCATION_REGISTER) {
+            emitVC2(gen->out, VC_SET, vcReg(gen->allocation->locations[v].index),
+                    fp(-1 - function->param_count + function->values[v].paramIndex));
+        }
+    }
+
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        if (isTailCall(gen, instr, label)) {
+            emitTailCall(gen, label, instr);
+            instr = instr->next;                   // The return is done by the callee
+            continue;
+        }
+        generateInstr(gen, instr);
+    }
+
+    if (stats) {
+        stats->function_count++;
+        stats->frame_slots += gen->allocation->frame_size;
+        stats->register_values += gen->allocation->register_count;
+        stats->spilled_values += gen->allocation->spilled_count;
+    }
+    freeRegisterAllocation(gen->allocation);
+    gen->allocation = NULL;
+}
+
+//Runtime routines
+
+// Fill the vtable of every class once, at the start of the program. Its chunk id is kept in
+// a stack word below the frame of main.
+static void generateVtables(ProgramLayout* layout, VCProgram* out) {
+    char label[MAX_LABEL];
+    for (int c = 0; c < layout->class_count; c++) {
+        ClassLayout* current = &layout->classes[c];
+        emitVC2(out, VC_CREATE, vcReg(0), vcImm(VTABLE_FIRST_METHOD + current->method_count));
+        emitVC3(out, VC_SETWORD, vcReg(0), vcImm(VTABLE_CLASS_NAME), vcStr(current->name));
+        for (int m = 0; m < current->method_count; m++) {
+            snprintf(label, MAX_LABEL, "f.%s.%s", current->methods[m].owner, current->methods[m].name);
+            emitVC3(out, VC_SETWORD, vcReg(0), vcImm(VTABLE_FIRST_METHOD + m), vcStr(label));
+        }
+        emitVC2(out, VC_SET, vcAbsolute(current->vtable_address), vcReg(0));
+    }
+    if (layout->class_count > 0) {
+        emitVC3(out, VC_ADDI, vcReg(VC_REG_SP), vcReg(VC_REG_SP), vcImm(layout->class_count));
+    }
+}
+
+// Create the chunk of an object, initialize its attributes and run the constructor chain
+static void generateNewRoutine(CodeGenerator* gen, ASTClassNode* classNode) {
+    IRProgram* program = gen->program;
+    VCProgram* out = gen->out;
+    ClassLayout* objectLayout = findClassLayout(gen->layout, classNode->name);
+    if (!objectLayout) {
+        reportError(gen, "no object layout (inheritance cycle?) for the class", classNode->name);
+        return;
+    }
+
+    char label[MAX_LABEL];
+    newRoutineLabel(label, classNode->name);
+    emitPrologue(out, label, 1);
+    emitVC2(out, VC_CREATE, vcReg(0), vcImm(objectLayout->size));
+    emitVC3(out, VC_SETWORD, vcReg(0), vcImm(0), vcAbsolute(objectLayout->vtable_address));
+    for (int f = 0; f < objectLayout->field_count; f++) {
+        FieldLayout* field = &objectLayout->fields[f];
+        VCOperand init = strcmp(field->type, "string") == 0 ? vcStr("") : vcImm(0);
+        emitVC3(out, VC_SETWORD, vcReg(0), vcImm(field->offset), init);
+    }
+    emitVC2(out, VC_SET, fp(1), vcReg(0));
+
+    // Constructors from the root of the hierarchy down to the class itself
+    ASTClassNode* chain[MAX_SYMBOLS];
+    int depth = 0;
+    for (ASTClassNode* current = classNode; current && depth < MAX_SYMBOLS;
+         current = findIRClass(program, current->parent)) {
+        chain[depth++] = current;
+    }
+    while (depth > 0) {
+        ASTClassNode* current = chain[--depth];
+        for (ASTNode* member = current->members; member; member = member->next) {
+            if (member->type != AST_FUNCTION || strcmp(((ASTFunctionNode*)member)->name, current->name) != 0) {
+                continue;
+            }
+            char constructor[MAX_LABEL];
+            snprintf(constructor, MAX_LABEL, "f.%s.%s", current->name, current->name);
+            VCOperand self = fp(1);
+            emitCallSequence(out, vcLabel(constructor), &self, 1);
+        }
+    }
+
+    emitVC2(out, VC_SET, scratch(), fp(1));
+    emitEpilogue(out);
+}
+
+// rt.concat(s0, ..., sn-1, n): measure every piece, allocate the result once and copy them
+static void generateConcatRoutine(VCProgram* out) {
+    emitPrologue(out, "rt.concat", 1);
+    emitVC2(out, VC_SET, vcReg(0), fp(-2));                       // n
+    emitVC3(out, VC_SUBI, vcReg(1), vcReg(FRAME_REGISTER), vcImm(2));
+    emitVC3(out, VC_SUBI, vcReg(1), vcReg(1), vcReg(0));          // Address of the first piece
+    emitVC2(out, VC_SET, vcReg(2), vcImm(0));
+    emitVC2(out, VC_SET, vcReg(3), vcImm(0));
+    emitVC1(out, VC_LABEL, vcLabel("rt.concat.size"));
+    emitVC3(out, VC_LTI, vcReg(4), vcReg(3), vcReg(0));
+    emitVC2(out, VC_JUMPZ, vcLabel("rt.concat.create"), vcReg(4));
+    emitVC3(out, VC_ADDI, vcReg(4), vcReg(1), vcReg(3));
+    emitVC2(out, VC_GETSIZE, vcReg(4), vcStack(4, 0));
+    emitVC3(out, VC_ADDI, vcReg(2), vcReg(2), vcReg(4));
+    emitVC3(out, VC_ADDI, vcReg(3), vcReg(3), vcImm(1));
+    emitVC1(out, VC_JUMP, vcLabel("rt.concat.size"));
+
+    // The result starts as a copy of the first piece grown to the total size
+    emitVC1(out, VC_LABEL, vcLabel("rt.concat.create"));
+    emitVC2(out, VC_COPY, vcReg(5), vcStack(1, 0));
+    emitVC2(out, VC_RESIZE, vcReg(5), vcReg(2));
+    emitVC2(out, VC_GETSIZE, vcReg(2), vcStack(1, 0));             // Position in the result
+    emitVC2(out, VC_SET, vcReg(3), vcImm(1));                      // Current piece
+    emitVC1(out, VC_LABEL, vcLabel("rt.concat.piece"));
+    emitVC3(out, VC_LTI, vcReg(0), vcReg(3), fp(-2));
+    emitVC2(out, VC_JUMPZ, vcLabel("rt.concat.done"), vcReg(0));
+    emitVC3(out, VC_ADDI, vcReg(4), vcReg(1), vcReg(3));
+    emitVC2(out, VC_SET, vcReg(4), vcStack(4, 0));
+    emitVC2(out, VC_GETSIZE, scratch(), vcReg(4));
+    emitVC2(out, VC_SET, fp(1), scratch());
+    emitVC2(out, VC_SET, vcReg(0), vcImm(0));
+    emitVC1(out, VC_LABEL, vcLabel("rt.concat.copy"));
+    emitVC3(out, VC_LTI, scratch(), vcReg(0), fp(1));
+    emitVC2(out, VC_JUMPZ, vcLabel("rt.concat.next"), scratch());
+    emitVC3(out, VC_GETWORD, scratch(), vcReg(4), vcReg(0));
+    emitVC3(out, VC_SETWORD, vcReg(5), vcReg(2), scratch());
+    emitVC3(out, VC_ADDI, vcReg(0), vcReg(0), vcImm(1));
+    emitVC3(out, VC_ADDI, vcReg(2), vcReg(2), vcImm(1));
+    emitVC1(out, VC_JUMP, vcLabel("rt.concat.copy"));
+    emitVC1(out, VC_LABEL, vcLabel("rt.concat.next"));
+    emitVC3(out, VC_ADDI, vcReg(3), vcReg(3), vcImm(1));
+    emitVC1(out, VC_JUMP, vcLabel("rt.concat.piece"));
+
+    emitVC1(out, VC_LABEL, vcLabel("rt.concat.done"));
+    emitVC2(out, VC_SET, scratch(), vcReg(5));
+    emitEpilogue(out);
+}
+
+// rt.substr(s, i, n): embedded function subStr
+static void generateSubstrRoutine(VCProgram* out) {
+    emitPrologue(out, "rt.substr", 0);
+    emitVC2(out, VC_GETSIZE, vcReg(0), fp(-4));
+    emitVC2(out, VC_SET, vcReg(1), fp(-3));
+    emitVC2(out, VC_SET, vcReg(3), fp(-2));
+    emitVC3(out, VC_LTI, vcReg(2), vcReg(1), vcImm(0));
+    emitVC2(out, VC_JUMPNZ, vcLabel("rt.substr.empty"), vcReg(2));
+    emitVC3(out, VC_GTI, vcReg(2), vcReg(1), vcReg(0));
+    emitVC2(out, VC_JUMPNZ, vcLabel("rt.substr.empty"), vcReg(2));
+    emitVC3(out, VC_LTI, vcReg(2), vcReg(3), vcImm(0));
+    emitVC2(out, VC_JUMPNZ, vcLabel("rt.substr.empty"), vcReg(2));
+    emitVC3(out, VC_SUBI, vcReg(4), vcReg(0), vcReg(1));
+    emitVC3(out, VC_GTI, vcReg(2), vcReg(3), vcReg(4));
+    emitVC2(out, VC_JUMPZ, vcLabel("rt.substr.copy"), vcReg(2));
+    emitVC2(out, VC_SET, vcReg(3), vcReg(4));                     // Only the remaining characters
+    emitVC1(out, VC_LABEL, vcLabel("rt.substr.copy"));
+    emitVC2(out, VC_CREATE, vcReg(5), vcReg(3));
+    emitVC2(out, VC_SET, vcReg(2), vcImm(0));
+    emitVC1(out, VC_LABEL, vcLabel("rt.substr.loop"));
+    emitVC3(out, VC_LTI, vcReg(4), vcReg(2), vcReg(3));
+    emitVC2(out, VC_JUMPZ, vcLabel("rt.substr.done"), vcReg(4));
+    emitVC3(out, VC_ADDI, vcReg(4), vcReg(1), vcReg(2));
+    emitVC3(out, VC_GETWORD, vcReg(4), fp(-4), vcReg(4));
+    emitVC3(out, VC_SETWORD, vcReg(5), vcReg(2), vcReg(4));
+    emitVC3(out, VC_ADDI, vcReg(2), vcReg(2), vcImm(1));
+    emitVC1(out, VC_JUMP, vcLabel("rt.substr.loop"));
+    emitVC1(out, VC_LABEL, vcLabel("rt.substr.empty"));
+    emitVC2(out, VC_CREATE, vcReg(5), vcImm(0));
+    emitVC1(out, VC_LABEL, vcLabel("rt.substr.done"));
+    emitVC2(out, VC_SET, scratch(), vcReg(5));
+    emitEpilogue(out);
+}
+
+// Entry point: build the vtables, call main and jump over the routines
+static void generateEntry(CodeGenerator* gen) {
+    generateVtables(gen->layout, gen->out);
+    emitCallSequence(gen->out, vcLabel("f.main"), NULL, 0);
+    emitVC1(gen->out, VC_JUMP, vcLabel("rt.end"));
+}
+
+static void generateRoutines(CodeGenerator* gen) {
+    for (ASTNode* node = gen->program->ast->classes; node; node = node->next) {
+        generateNewRoutine(gen, (ASTClassNode*)node);
+    }
+    generateConcatRoutine(gen->out);
+    generateSubstrRoutine(gen->out);
+    emitVC1(gen->out, VC_LABEL, vcLabel("rt.end"));
+}
+
+// Free the generator and return its code, null when something failed
+static VCProgram* finishGenerator(CodeGenerator* gen) {
+    freeProgramLayout(gen->layout);
+    if (gen->failed) {
+        freeVCProgram(gen->out);
+        return NULL;
+    }
+    return gen->out;
+}
+
+VCProgram* generateVYPcode(IRProgram* program, Profile* profile, CodegenStats* stats) {
+    CodeGenerator gen = {program, createVCProgram(), NULL, NULL, buildProgramLayout(program), profile, false};
+    if (stats) memset(stats, 0, sizeof(CodegenStats));
+
+    generateEntry(&gen);
+    for (IRFunction* function = program->functions; function; function = function->next) {
+        generateFunction(&gen, function, stats);
+    }
+    generateRoutines(&gen);
+    return finishGenerator(&gen);
+}
+
+VCProgram* generateFunctionVYPcode(IRProgram* program, IRFunction* function, CodegenStats* stats) {
+    CodeGenerator gen = {program, createVCProgram(), NULL, NULL, buildProgramLayout(program), NULL, false};
+    generateFunction(&gen, function, stats);
+    return finishGenerator(&gen);
+}
+
+VCProgram* generateEntryVYPcode(IRProgram* program) {
+    CodeGenerator gen = {program, createVCProgram(), NULL, NULL, buildProgramLayout(program), NULL, false};
+    generateEntry(&gen);
+    return finishGenerator(&gen);
+}
+
+VCProgram* generateRoutinesVYPcode(IRProgram* program) {
+    CodeGenerator gen = {program, createVCProgram(), NULL, NULL, buildProgramLayout(program), NULL, false};
+    generateRoutines(&gen);
+    return finishGenerator(&gen);
+}
+
+VCProgram* linkVYPcode(IRProgram* program, VCProgram** functions, int count) {
+    CodeGenerator gen = {program, createVCProgram(), NULL, NULL, buildProgramLayout(program), NULL, false};
+    generateEntry(&gen);
+    for (int f = 0; f < count; f++) {
+        appendVCProgram(gen.out, functions[f]);
+        functions[f] = NULL;
+    }
+    generateRoutines(&gen);
+    return finishGenerator(&gen);
+}
@@ -0,0 +1,33 @@
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include "ir.h"
+#include "regalloc.h"
+#include "vypcode.h"
+#include "layout.h"
+#include "profile.h"
+
+// Totals of the register allocation over the whole program
+typedef struct {
+    int function_count;
+    int frame_slots;               // Sum of the frame sizes
+    int register_values;           // Virtual registers kept in VYPcode registers
+    int spilled_values;            // Virtual registers kept in the stack
+    int profiled_functions;        // Functions whose registers were allocated with profile weights
+} CodegenStats;
+
+// Translate the intermediate code into VYPcode, returns null on error. With a profile, the values
+// used in the code that ran most get the registers.
+VCProgram* generateVYPcode(IRProgram* program, Profile* profile, CodegenStats* stats);
+
+// The same code in pieces, for the incremental builds: the code of one function (without a
+// profile), and the whole program around the code of every function in the order of the IR.
+// linkVYPcode takes the pieces over, stats are added to the ones already counted.
+VCProgram* generateFunctionVYPcode(IRProgram* program, IRFunction* function, CodegenStats* stats);
+VCProgram* linkVYPcode(IRProgram* program, VCProgram** functions, int count);
+
+// What linkVYPcode puts before and after the functions, for code written out piece by piece
+VCProgram* generateEntryVYPcode(IRProgram* program);
+VCProgram* generateRoutinesVYPcode(IRProgram* program);
+
+#endif // CODEGEN_H
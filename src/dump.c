@@ -0,0 +1,452 @@
+#include "dump.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+// Children of a node: the field of the parent they hang from
+typedef enum {
+    FIELD_NONE,
+    FIELD_CLASSES,
+    FIELD_FUNCTIONS,
+    FIELD_MEMBERS,
+    FIELD_PARAMETERS,
+    FIELD_BODY,
+    FIELD_INIT,
+    FIELD_STATEMENTS,
+    FIELD_CONDITION,
+    FIELD_TRUE_BLOCK,
+    FIELD_FALSE_BLOCK,
+    FIELD_EXPRESSION,
+    FIELD_ARGUMENTS,
+    FIELD_LEFT,
+    FIELD_RIGHT,
+    FIELD_OPERAND,
+    FIELD_CONTEXT,
+    FIELD_IDENTIFIERS,
+    FIELD_COUNT
+} DumpField;
+
+// Names with their lengths, copied into the JSON without looking for their end
+typedef struct {
+    const char* text;
+    size_t length;
+} Name;
+
+#define NAME(text) {text, sizeof(text) - 1}
+
+static const Name field_names[] = {
+    NAME(""), NAME("classes"), NAME("functions"), NAME("members"), NAME("parameters"), NAME("body"),
+    NAME("init"), NAME("statements"), NAME("condition"), NAME("trueBlock"), NAME("falseBlock"),
+    NAME("expression"), NAME("arguments"), NAME("left"), NAME("right"), NAME("operand"),
+    NAME("context"), NAME("identifiers"),
+};
+
+static const Name kind_names[] = {
+    NAME("program"), NAME("class"), NAME("function"), NAME("declaration"), NAME("assignment"),
+    NAME("block"), NAME("if"), NAME("while"), NAME("return"), NAME("print"), NAME("expression"),
+    NAME("variable"), NAME("literal"), NAME("binary_op"), NAME("unary_op"), NAME("function_call"),
+    NAME("new"), NAME("member_access"), NAME("method_call"), NAME("identifier_list"),
+    NAME("string_literal"), NAME("super"), NAME("type_cast"), NAME("this"), NAME("lazy_body"),
+};
+
+static const char* binary_operators[] = {"=", "+", "-", "*", "/", "<", ">", "<=", ">=", "==", "!="};
+static const char* unary_operators[] = {"-", "!"};
+static const char* symbol_kinds[] = {"variable", "function", "class", "object"};
+
+_Static_assert(sizeof(field_names) / sizeof(field_names[0]) == FIELD_COUNT, "a name for every field");
+_Static_assert(sizeof(kind_names) / sizeof(kind_names[0]) == AST_LAZY_BODY + 1, "a name for every node");
+_Static_assert(sizeof(binary_operators) / sizeof(binary_operators[0]) == OP_NE + 1, "a symbol for every operator");
+
+typedef struct {
+    FILE* out;
+    DumpFormat format;
+    long nodes;
+    long symbols;
+    long bytes;
+    bool failed;
+    size_t used;
+    char buffer[DUMP_BUFFER_SIZE];
+} Dumper;
+
+bool parseDumpFormat(const char* name, DumpFormat* format) {
+    if (strcmp(name, "text") == 0) *format = DUMP_TEXT;
+    else if (strcmp(name, "jsonl") == 0) *format = DUMP_JSONL;
+    else if (strcmp(name, "binary") == 0) *format = DUMP_BINARY;
+    else return false;
+    return true;
+}
+
+const char* getDumpFieldName(int field) {
+    return field > FIELD_NONE && field < FIELD_COUNT ? field_names[field].text : NULL;
+}
+
+//Buffer
+
+static void flushDump(Dumper* dumper) {
+    if (dumper->used && fwrite(dumper->buffer, 1, dumper->used, dumper->out) != dumper->used) dumper->failed = true;
+    dumper->bytes += dumper->used;
+    dumper->used = 0;
+}
+
+// Room for size bytes in the buffer, at most DUMP_BUFFER_SIZE
+static char* reserveDump(Dumper* dumper, size_t size) {
+    if (dumper->used + size > DUMP_BUFFER_SIZE) flushDump(dumper);
+    char* room = dumper->buffer + dumper->used;
+    dumper->used += size;
+    return room;
+}
+
+static void writeBytes(Dumper* dumper, const char* data, size_t length) {
+    if (length > DUMP_BUFFER_SIZE / 2) {
+        flushDump(dumper);
+        if (fwrite(data, 1, length, dumper->out) != length) dumper->failed = true;
+        dumper->bytes += length;
+        return;
+    }
+    memcpy(reserveDump(dumper, length), data, length);
+}
+
+static void writeByte(Dumper* dumper, char byte) {
+    *reserveDump(dumper, 1) = byte;
+}
+
+#define writeLiteral(dumper, text) writeBytes(dumper, text, sizeof(text) - 1)
+
+static void writeDecimal(Dumper* dumper, long value) {
+    char digits[24];
+    int start = sizeof(digits);
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    do {
+        digits[--start] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) digits[--start] = '-';
+    writeBytes(dumper, digits + start, sizeof(digits) - start);
+}
+
+static void writeVarint(Dumper* dumper, uint64_t value) {
+    char* room = reserveDump(dumper, 10);
+    size_t length = 0;
+    do {
+        unsigned char byte = value & 0x7F;
+        value >>= 7;
+        room[length++] = value ? byte | 0x80 : byte;
+    } while (value);
+    dumper->used -= 10 - length;
+}
+
+// Runs of plain characters are copied at once, only quotes, backslashes and controls are escaped
+static void writeJSONString(Dumper* dumper, const char* text) {
+    if (!text) {
+        writeLiteral(dumper, "null");
+        return;
+    }
+    writeByte(dumper, '"');
+    const char* run = text;
+    for (const char* c = text; *c; c++) {
+        unsigned char character = *c;
+        if (character >= 0x20 && character != '"' && character != '\\') continue;
+        writeBytes(dumper, run, c - run);
+        run = c + 1;
+        switch (character) {
+            case '"': writeLiteral(dumper, "\\\""); break;
+            case '\\': writeLiteral(dumper, "\\\\"); break;
+            case '\n': writeLiteral(dumper, "\\n"); break;
+            case '\t': writeLiteral(dumper, "\\t"); break;
+            case '\r': writeLiteral(dumper, "\\r"); break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', "0123456789abcdef"[character >> 4], "0123456789abcdef"[character & 15]};
+                writeBytes(dumper, escape, sizeof(escape));
+            }
+        }
+    }
+    writeBytes(dumper, run, strlen(run));
+    writeByte(dumper, '"');
+}
+
+static void writeBinaryString(Dumper* dumper, const char* text) {
+    if (!text) {
+        writeVarint(dumper, 0);
+        return;
+    }
+    size_t length = strlen(text);
+    writeVarint(dumper, length + 1);
+    writeBytes(dumper, text, length);
+}
+
+//Values
+
+// The keys are literals: the separator, the key and the colon are copied as one piece
+#define KEY(key) ",\"" key "\":", sizeof(",\"" key "\":") - 1
+
+static void writeString(Dumper* dumper, const char* key, size_t keyLength, const char* text) {
+    if (dumper->format == DUMP_BINARY) {
+        writeBinaryString(dumper, text);
+        return;
+    }
+    writeBytes(dumper, key, keyLength);
+    writeJSONString(dumper, text);
+}
+
+static void writeNumber(Dumper* dumper, const char* key, size_t keyLength, long value) {
+    if (dumper->format == DUMP_BINARY) {
+        writeVarint(dumper, (uint64_t)value);
+        return;
+    }
+    writeBytes(dumper, key, keyLength);
+    writeDecimal(dumper, value);
+}
+
+// An enum value: its number in binary, its symbol in JSON
+static void writeOperator(Dumper* dumper, int value, const char* symbol) {
+    if (dumper->format == DUMP_BINARY) {
+        writeVarint(dumper, value);
+        return;
+    }
+    writeLiteral(dumper, ",\"op\":");
+    writeJSONString(dumper, symbol);
+}
+
+static void writeStringList(Dumper* dumper, const char* key, size_t keyLength, char** list, int count) {
+    if (dumper->format == DUMP_BINARY) {
+        writeVarint(dumper, list ? count : 0);
+        for (int i = 0; list && i < count; i++) writeBinaryString(dumper, list[i]);
+        return;
+    }
+    writeBytes(dumper, key, keyLength);
+    writeByte(dumper, '[');
+    for (int i = 0; list && i < count; i++) {
+        if (i > 0) writeByte(dumper, ',');
+        writeJSONString(dumper, list[i]);
+    }
+    writeByte(dumper, ']');
+}
+
+//Nodes
+
+static void dumpList(Dumper* dumper, ASTNode* node, long parent, DumpField field);
+
+// The values of the node itself, in the order of the binary records
+static void dumpValues(Dumper* dumper, ASTNode* node) {
+    switch (node->type) {
+        case AST_CLASS:
+            writeString(dumper, KEY("name"), ((ASTClassNode*)node)->name);
+            writeString(dumper, KEY("extends"), ((ASTClassNode*)node)->parent);
+            break;
+        case AST_FUNCTION:
+            writeString(dumper, KEY("name"), ((ASTFunctionNode*)node)->name);
+            writeString(dumper, KEY("returnType"), ((ASTFunctionNode*)node)->returnType);
+            writeNumber(dumper, KEY("param_count"), ((ASTFunctionNode*)node)->param_count);
+            break;
+        case AST_DECLARATION:
+            writeString(dumper, KEY("type"), ((ASTDeclarationNode*)node)->type);
+            writeString(dumper, KEY("name"), ((ASTDeclarationNode*)node)->name);
+            break;
+        case AST_VARIABLE:
+            writeString(dumper, KEY("name"), ((ASTVariableNode*)node)->name);
+            break;
+        case AST_LITERAL:
+            writeString(dumper, KEY("value"), ((ASTLiteralNode*)node)->value);
+            writeString(dumper, KEY("literalType"), ((ASTLiteralNode*)node)->literalType);
+            break;
+        case AST_BINARY_OP: {
+            BinaryOperator op = ((ASTBinaryOpNode*)node)->op;
+            writeOperator(dumper, op, op <= OP_NE ? binary_operators[op] : NULL);
+            break;
+        }
+        case AST_UNARY_OP: {
+            UnaryOperator op = ((ASTUnaryOpNode*)node)->op;
+            writeOperator(dumper, op, op <= OP_NOT ? unary_operators[op] : NULL);
+            break;
+        }
+        case AST_FUNCTION_CALL:
+            writeString(dumper, KEY("functionName"), ((ASTFunctionCallNode*)node)->functionName);
+            break;
+        case AST_NEW:
+            writeString(dumper, KEY("className"), ((ASTNewNode*)node)->className);
+            break;
+        case AST_MEMBER_ACCESS:
+            writeString(dumper, KEY("memberName"), ((ASTMemberAccessNode*)node)->memberName);
+            break;
+        case AST_METHOD_CALL:
+            writeString(dumper, KEY("methodName"), ((ASTMethodCallNode*)node)->methodName);
+            break;
+        case AST_STRING_LITERAL:
+            writeString(dumper, KEY("value"), ((ASTStringLiteralNode*)node)->value);
+            break;
+        case AST_TYPE_CAST:
+            writeString(dumper, KEY("typeName"), ((ASTTypeCastNode*)node)->typeName);
+            break;
+        case AST_LAZY_BODY:
+            writeNumber(dumper, KEY("count"), ((ASTLazyBodyNode*)node)->count);
+            break;
+        default:
+            break;                      // program, block, statements, this, super...
+    }
+}
+
+static void dumpChildren(Dumper* dumper, ASTNode* node, long id) {
+    switch (node->type) {
+        case AST_PROGRAM:
+            dumpList(dumper, ((ASTProgramNode*)node)->classes, id, FIELD_CLASSES);
+            dumpList(dumper, ((ASTProgramNode*)node)->functions, id, FIELD_FUNCTIONS);
+            break;
+        case AST_CLASS:
+            dumpList(dumper, ((ASTClassNode*)node)->members, id, FIELD_MEMBERS);
+            break;
+        case AST_FUNCTION:
+            dumpList(dumper, ((ASTFunctionNode*)node)->parameters, id, FIELD_PARAMETERS);
+            dumpList(dumper, ((ASTFunctionNode*)node)->body, id, FIELD_BODY);
+            break;
+        case AST_DECLARATION:
+            dumpList(dumper, ((ASTDeclarationNode*)node)->init, id, FIELD_INIT);
+            break;
+        case AST_BLOCK:
+            dumpList(dumper, ((ASTBlockNode*)node)->statements, id, FIELD_STATEMENTS);
+            break;
+        case AST_IF:
+            dumpList(dumper, ((ASTIfNode*)node)->condition, id, FIELD_CONDITION);
+            dumpList(dumper, ((ASTIfNode*)node)->trueBlock, id, FIELD_TRUE_BLOCK);
+            dumpList(dumper, ((ASTIfNode*)node)->falseBlock, id, FIELD_FALSE_BLOCK);
+            break;
+        case AST_WHILE:
+            dumpList(dumper, ((ASTWhileNode*)node)->condition, id, FIELD_CONDITION);
+            dumpList(dumper, ((ASTWhileNode*)node)->body, id, FIELD_BODY);
+            break;
+        case AST_RETURN:
+            dumpList(dumper, ((ASTReturnNode*)node)->expression, id, FIELD_EXPRESSION);
+            break;
+        case AST_PRINT:
+            dumpList(dumper, ((ASTPrintNode*)node)->arguments, id, FIELD_ARGUMENTS);
+            break;
+        case AST_BINARY_OP:
+            dumpList(dumper, ((ASTBinaryOpNode*)node)->left, id, FIELD_LEFT);
+            dumpList(dumper, ((ASTBinaryOpNode*)node)->right, id, FIELD_RIGHT);
+            break;
+        case AST_UNARY_OP:
+            dumpList(dumper, ((ASTUnaryOpNode*)node)->operand, id, FIELD_OPERAND);
+            break;
+        case AST_FUNCTION_CALL:
+            dumpList(dumper, ((ASTFunctionCallNode*)node)->context, id, FIELD_CONTEXT);
+            dumpList(dumper, ((ASTFunctionCallNode*)node)->arguments, id, FIELD_ARGUMENTS);
+            break;
+        case AST_NEW:
+            dumpList(dumper, ((ASTNewNode*)node)->arguments, id, FIELD_ARGUMENTS);
+            break;
+        case AST_MEMBER_ACCESS:
+            dumpList(dumper, ((ASTMemberAccessNode*)node)->expression, id, FIELD_EXPRESSION);
+            break;
+        case AST_METHOD_CALL:
+            dumpList(dumper, ((ASTMethodCallNode*)node)->expression, id, FIELD_EXPRESSION);
+            dumpList(dumper, ((ASTMethodCallNode*)node)->arguments, id, FIELD_ARGUMENTS);
+            break;
+        case AST_IDENTIFIER_LIST:
+            dumpList(dumper, ((ASTIdentifierListNode*)node)->identifiers, id, FIELD_IDENTIFIERS);
+            break;
+        case AST_TYPE_CAST:
+            dumpList(dumper, ((ASTTypeCastNode*)node)->expression, id, FIELD_EXPRESSION);
+            break;
+        default:
+            break;
+    }
+}
+
+static void dumpNode(Dumper* dumper, ASTNode* node, long parent, DumpField field) {
+    long id = ++dumper->nodes;
+    static const Name unknown = NAME("unknown");
+    const Name* kind = node->type <= AST_LAZY_BODY ? &kind_names[node->type] : &unknown;
+    if (dumper->format == DUMP_BINARY) {
+        writeByte(dumper, 'N');
+        writeVarint(dumper, node->type);
+        writeVarint(dumper, parent);
+        writeVarint(dumper, field);
+        dumpValues(dumper, node);
+    } else {
+        writeLiteral(dumper, "{\"node\":");
+        writeDecimal(dumper, id);
+        if (parent) {
+            writeLiteral(dumper, ",\"parent\":");
+            writeDecimal(dumper, parent);
+            writeLiteral(dumper, ",\"field\":\"");
+            writeBytes(dumper, field_names[field].text, field_names[field].length);
+            writeLiteral(dumper, "\",\"kind\":\"");
+        } else {
+            writeLiteral(dumper, ",\"kind\":\"");
+        }
+        writeBytes(dumper, kind->text, kind->length);
+        writeByte(dumper, '"');
+        dumpValues(dumper, node);
+        writeLiteral(dumper, "}\n");
+    }
+    dumpChildren(dumper, node, id);
+}
+
+// The nodes of a list in order, through next without recursion
+static void dumpList(Dumper* dumper, ASTNode* node, long parent, DumpField field) {
+    for (; node; node = node->next) dumpNode(dumper, node, parent, field);
+}
+
+//Symbols
+
+static void dumpSymbol(Dumper* dumper, Symbol* symbol, int index) {
+    int kind = symbol->is_function ? 1 : symbol->is_class ? 2 : symbol->is_object ? 3 : 0;
+    if (dumper->format == DUMP_BINARY) {
+        writeByte(dumper, 'S');
+        writeVarint(dumper, kind);
+        writeByte(dumper, symbol->defined);
+        writeBinaryString(dumper, symbol->name);
+        writeBinaryString(dumper, symbol->type);
+    } else {
+        writeLiteral(dumper, "{\"symbol\":");
+        writeDecimal(dumper, index);
+        writeString(dumper, KEY("name"), symbol->name);
+        writeString(dumper, KEY("type"), symbol->type);
+        writeLiteral(dumper, ",\"kind\":");
+        writeJSONString(dumper, symbol_kinds[kind]);
+        if (symbol->defined) writeLiteral(dumper, ",\"defined\":true");
+        else writeLiteral(dumper, ",\"defined\":false");
+    }
+    if (symbol->is_function) {
+        writeStringList(dumper, KEY("parameters"), symbol->func.parameters, symbol->func.param_count);
+    } else if (symbol->is_class) {
+        writeString(dumper, KEY("extends"), symbol->class.parentClass);
+        writeStringList(dumper, KEY("methods"), symbol->class.methods, symbol->class.method_count);
+        writeStringList(dumper, KEY("attributes"), symbol->class.attributes, symbol->class.attr_count);
+    }
+    if (dumper->format != DUMP_BINARY) writeLiteral(dumper, "}\n");
+    dumper->symbols++;
+}
+
+bool dumpProgram(ASTNode* program, SymbolTable* table, DumpFormat format, FILE* out, DumpStats* stats) {
+    Dumper* dumper = checkedMalloc(sizeof(Dumper), ALLOC_MODULES);
+    dumper->out = out;
+    dumper->format = format;
+    dumper->nodes = 0;
+    dumper->symbols = 0;
+    dumper->bytes = 0;
+    dumper->failed = false;
+    dumper->used = 0;
+
+    if (format == DUMP_BINARY) {
+        writeLiteral(dumper, DUMP_MAGIC);
+        writeVarint(dumper, DUMP_VERSION);
+    }
+    dumpList(dumper, program, 0, FIELD_NONE);
+    for (int s = 0; s < table->symbol_count; s++) dumpSymbol(dumper, &table->symbols[s], s);
+    if (format == DUMP_BINARY) {
+        writeByte(dumper, 'E');
+        writeVarint(dumper, dumper->nodes);
+        writeVarint(dumper, dumper->symbols);
+    }
+    flushDump(dumper);
+    if (fflush(out) != 0) dumper->failed = true;
+
+    stats->nodes = dumper->nodes;
+    stats->symbols = dumper->symbols;
+    stats->bytes = dumper->bytes;
+    bool written = !dumper->failed;
+    compilerFree(dumper);
+    return written;
+}
@@ -0,0 +1,56 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+#include "ast.h"
+#include "symbol_table.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+#define DUMP_MAGIC "VYPD"
+#define DUMP_VERSION 1
+#define DUMP_BUFFER_SIZE 65536
+
+// Formats of vypcomp --dump. Text is the listing of printAST and print_symbol_table; the others
+// are written by dumpProgram for tools, one record per node and per symbol, the nodes first in
+// preorder (a node before its children, the lists in their order) and numbered from 1.
+//
+// JSON Lines: one object per line.
+//   {"node":3,"parent":2,"field":"members","kind":"function","name":"f","returnType":"int","param_count":1}
+//   {"symbol":0,"name":"f","type":"int","kind":"function","defined":false,"parameters":["int"]}
+// A node has the fields of its struct in ast.h and the root has no parent or field; a class,
+// node or symbol, names its parent class in "extends". The kind of a symbol is variable,
+// function, class or object, a function adds "parameters" and a class "methods" and "attributes".
+//
+// Binary: DUMP_MAGIC, the version, then the records, each one a byte and its values. Numbers
+// are unsigned LEB128 varints; a string is its length + 1 as a varint and its bytes, 0 for null.
+//   'N' kind parent field ...   kind is the ASTNodeType, parent 0 for the root, field the index
+//                               in getDumpFieldName; then the values of the node, in the order
+//                               of the JSON Lines keys (operators by their enum value)
+//   'S' kind defined name type ...   kind 0 to 3 as above, defined a byte; a function adds its
+//                               parameters (count and strings), a class its parent, methods and
+//                               attributes
+//   'E' nodes symbols           the end, with the counts
+typedef enum {
+    DUMP_NONE,
+    DUMP_TEXT,
+    DUMP_JSONL,
+    DUMP_BINARY,
+} DumpFormat;
+
+typedef struct {
+    long nodes;
+    long symbols;
+    long bytes;
+} DumpStats;
+
+// Format of the name given to --dump, false when there is none with that name
+bool parseDumpFormat(const char* name, DumpFormat* format);
+
+// Name of a field of the binary records ("classes", "body"...), null when out of range
+const char* getDumpFieldName(int field);
+
+// Write the AST under program and the symbol table in JSON Lines or binary, through a buffer of
+// DUMP_BUFFER_SIZE bytes and without building strings; false when out could not be written
+bool dumpProgram(ASTNode* program, SymbolTable* table, DumpFormat format, FILE* out, DumpStats* stats);
+
+#endif // DUMP_H
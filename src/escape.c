@@ -0,0 +1,270 @@
+#include "escape.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_USES 64
+
+// Attribute of an object replaced by a virtual register
+typedef struct {
+    ASTDeclarationNode* field;
+    int value;                     // Created when the object is replaced
+} Scalar;
+
+// Analysis of one allocation
+typedef struct {
+    IRProgram* program;
+    IRFunction* function;
+    IRInstr* allocation;           // The 'new' being analyzed
+    Scalar* scalars;
+    int scalar_count;
+} LocalObject;
+
+//Classes
+
+// The constructors receive the object as 'this', so objects of classes with one always escape
+static bool hasConstructor(IRProgram* program, const char* className) {
+    for (ASTClassNode* current = findIRClass(program, className); current;
+         current = findIRClass(program, current->parent)) {
+        for (ASTNode* member = current->members; member; member = member->next) {
+            if (member->type == AST_FUNCTION && strcmp(((ASTFunctionNode*)member)->name, current->name) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// One virtual register per attribute name; an attribute that hides an inherited one with the
+// same name is the inherited one, like in the object layout
+static void createScalars(LocalObject* object, ASTClassNode* classNode) {
+    if (!classNode) return;
+    createScalars(object, findIRClass(object->program, classNode->parent));
+
+    for (ASTNode* member = classNode->members; member; member = member->next) {
+        if (member->type != AST_DECLARATION) continue;
+        ASTDeclarationNode* field = (ASTDeclarationNode*)member;
+        bool known = false;
+        for (int s = 0; s < object->scalar_count; s++) {
+            if (strcmp(object->scalars[s].field->name, field->name) == 0) known = true;
+        }
+        if (known) continue;
+
+        object->scalars = checkedRealloc(object->scalars, (object->scalar_count + 1) * sizeof(Scalar), ALLOC_ANALYSIS);
+        Scalar* scalar = &object->scalars[object->scalar_count++];
+        scalar->field = field;
+        scalar->value = -1;
+    }
+}
+
+static Scalar* findScalar(LocalObject* object, const char* name) {
+    for (int s = 0; s < object->scalar_count; s++) {
+        if (strcmp(object->scalars[s].field->name, name) == 0) return &object->scalars[s];
+    }
+    return NULL;
+}
+
+//References
+
+// What is known about the references to the object at one point of the function
+typedef struct {
+    bool* may;                     // The value can hold the object
+    bool* must;                    // The value holds the object on every path (never another one or null)
+} References;
+
+// A new execution of the allocation creates another object: the values that held the previous
+// one can still reach an object of this allocation, but not the current one
+static void transfer(LocalObject* object, IRInstr* instr, References* refs) {
+    if (instr == object->allocation) {
+        memset(refs->must, 0, object->function->value_count * sizeof(bool));
+        refs->may[instr->dst] = true;
+        refs->must[instr->dst] = true;
+    } else if (instr->dst >= 0) {
+        bool copy = instr->op == IR_MOVE;
+        refs->may[instr->dst] = copy && refs->may[instr->src1];
+        refs->must[instr->dst] = copy && refs->must[instr->src1];
+    }
+}
+
+// Whether a use of a value that can hold the object keeps it inside the function. Passing it to
+// a call, returning it, storing it in an attribute or comparing it lets it escape; attribute
+// accesses are only allowed through a value that holds exactly this object.
+static bool isLocalUse(LocalObject* object, IRInstr* instr, int value, References* refs) {
+    switch (instr->op) {
+        case IR_MOVE:
+            return true;
+        case IR_GETFIELD:
+            return refs->must[value] && findScalar(object, instr->name);
+        case IR_SETFIELD:
+            return value == instr->src1 && !refs->may[instr->src2] && refs->must[value] &&
+                   findScalar(object, instr->name);
+        default:
+            return false;
+    }
+}
+
+// Forward analysis of the references: the "may" sets are joined and the "must" sets intersected
+// at the entry of every block. Then every use of a value that can hold the object is checked and
+// the ones to rewrite are collected.
+static bool isLocalObject(LocalObject* object, IRInstr*** rewrites, int* rewrite_count) {
+    IRFunction* function = object->function;
+    ControlFlowGraph* cfg = buildCFG(function);
+    int value_count = function->value_count;
+    bool* mayIn = checkedCalloc(cfg->block_count * value_count, sizeof(bool), ALLOC_ANALYSIS);
+    bool* mustIn = checkedCalloc(cfg->block_count * value_count, sizeof(bool), ALLOC_ANALYSIS);
+    References refs;
+    refs.may = checkedCalloc(value_count, sizeof(bool), ALLOC_ANALYSIS);
+    refs.must = checkedCalloc(value_count, sizeof(bool), ALLOC_ANALYSIS);
+
+    for (int b = 1; b < cfg->block_count; b++) {
+        memset(&mustIn[b * value_count], 1, value_count * sizeof(bool));
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = 0; b < cfg->block_count; b++) {
+            memcpy(refs.may, &mayIn[b * value_count], value_count * sizeof(bool));
+            memcpy(refs.must, &mustIn[b * value_count], value_count * sizeof(bool));
+            for (IRInstr* instr = cfg->blocks[b].first; ; instr = instr->next) {
+                transfer(object, instr, &refs);
+                if (instr == cfg->blocks[b].last) break;
+            }
+            for (int s = 0; s < cfg->blocks[b].successor_count; s++) {
+                int successor = cfg->blocks[b].successors[s] * value_count;
+                for (int v = 0; v < value_count; v++) {
+                    if (refs.may[v] && !mayIn[successor + v]) {
+                        mayIn[successor + v] = true;
+                        changed = true;
+                    }
+                    if (!refs.must[v] && mustIn[successor + v]) {
+                        mustIn[successor + v] = false;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    int instr_count = 0;
+    for (IRInstr* instr = function->first; instr; instr = instr->next) instr_count++;
+    *rewrites = checkedCalloc(instr_count, sizeof(IRInstr*), ALLOC_ANALYSIS);
+    *rewrite_count = 0;
+
+    bool local = true;
+    for (int b = 0; b < cfg->block_count && local; b++) {
+        memcpy(refs.may, &mayIn[b * value_count], value_count * sizeof(bool));
+        memcpy(refs.must, &mustIn[b * value_count], value_count * sizeof(bool));
+        for (IRInstr* instr = cfg->blocks[b].first; local; instr = instr->next) {
+            int uses[MAX_USES];
+            int count = getIRInstrUses(instr, uses, MAX_USES);
+            bool rewrite = instr == object->allocation;
+            for (int i = 0; i < count && local; i++) {
+                if (!refs.may[uses[i]]) continue;
+                local = isLocalUse(object, instr, uses[i], &refs);
+                rewrite = true;
+            }
+            if (rewrite) (*rewrites)[(*rewrite_count)++] = instr;
+            transfer(object, instr, &refs);
+            if (instr == cfg->blocks[b].last) break;
+        }
+    }
+
+    compilerFree(refs.may);
+    compilerFree(refs.must);
+    compilerFree(mayIn);
+    compilerFree(mustIn);
+    freeCFG(cfg);
+    return local;
+}
+
+//Scalar replacement
+
+// The allocation sets the attributes to their default values, the accesses become moves and
+// the copies of the reference go away
+static void replaceObject(LocalObject* object, IRInstr** rewrites, int rewrite_count) {
+    IRFunction* function = object->function;
+    IRInstr* allocation = object->allocation;
+    for (int s = 0; s < object->scalar_count; s++) {
+        ASTDeclarationNode* field = object->scalars[s].field;
+        IRInstr* init;
+        if (strcmp(field->type, "string") == 0) {
+            object->scalars[s].value = newIRValue(function, IR_TYPE_STRING, NULL, field->name);
+            init = createIRInstr(IR_CONST_STR, object->scalars[s].value, -1, -1);
+            init->name = compilerStrdup("", ALLOC_ANALYSIS);
+        } else {
+            bool isInt = strcmp(field->type, "int") == 0;
+            object->scalars[s].value = newIRValue(function, isInt ? IR_TYPE_INT : IR_TYPE_OBJECT,
+                                                  isInt ? NULL : field->type, field->name);
+            init = createIRInstr(IR_CONST_INT, object->scalars[s].value, -1, -1);
+        }
+        insertIRInstrBefore(function, allocation, init);
+    }
+
+    for (int r = 0; r < rewrite_count; r++) {
+        IRInstr* instr = rewrites[r];
+        if (instr->op == IR_NEW || instr->op == IR_MOVE) {
+            removeIRInstr(function, instr);
+            freeIRInstr(instr);
+        } else if (instr->op == IR_GETFIELD) {
+            instr->op = IR_MOVE;
+            instr->src1 = findScalar(object, instr->name)->value;
+            compilerFree(instr->name);
+            instr->name = NULL;
+        } else {
+            instr->op = IR_MOVE;
+            instr->dst = findScalar(object, instr->name)->value;
+            instr->src1 = instr->src2;
+            instr->src2 = -1;
+            compilerFree(instr->name);
+            instr->name = NULL;
+        }
+    }
+}
+
+static void optimizeAllocation(IRProgram* program, IRFunction* function, IRInstr* allocation,
+                               EscapeStats* stats) {
+    if (hasConstructor(program, allocation->name)) return;
+
+    LocalObject object;
+    object.program = program;
+    object.function = function;
+    object.allocation = allocation;
+    object.scalars = NULL;
+    object.scalar_count = 0;
+    createScalars(&object, findIRClass(program, allocation->name));
+
+    IRInstr** rewrites;
+    int rewrite_count;
+    if (isLocalObject(&object, &rewrites, &rewrite_count)) {
+        replaceObject(&object, rewrites, rewrite_count);
+        stats->replaced++;
+        stats->scalars += object.scalar_count;
+    }
+    compilerFree(rewrites);
+    compilerFree(object.scalars);
+}
+
+void replaceLocalObjects(IRProgram* program, EscapeStats* stats) {
+    EscapeStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(EscapeStats));
+
+    for (IRFunction* function = program->functions; function; function = function->next) {
+        int count = 0;
+        for (IRInstr* instr = function->first; instr; instr = instr->next) {
+            if (instr->op == IR_NEW) count++;
+        }
+        // The list is taken first, the replacement removes instructions
+        IRInstr** allocations = checkedCalloc(count, sizeof(IRInstr*), ALLOC_ANALYSIS);
+        count = 0;
+        for (IRInstr* instr = function->first; instr; instr = instr->next) {
+            if (instr->op == IR_NEW) allocations[count++] = instr;
+        }
+        for (int i = 0; i < count; i++) {
+            optimizeAllocation(program, function, allocations[i], stats);
+        }
+        stats->allocations += count;
+        compilerFree(allocations);
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include "ir.h"
+#include "cfg.h"
+
+// Totals of the escape analysis over the whole program
+typedef struct {
+    int allocations;               // 'new' instructions found
+    int replaced;                  // Allocations removed, their attributes became virtual registers
+    int scalars;                   // Virtual registers created for those attributes
+} EscapeStats;
+
+// Replace the objects that never leave the function that creates them by one value per attribute
+void replaceLocalObjects(IRProgram* program, EscapeStats* stats);
+
+#endif // ESCAPE_H
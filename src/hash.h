@@ -0,0 +1,25 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// FNV-1a on 64 bits: the fingerprints and keys of the caches, the stamps of the compiler and the
+// tables of interned strings. A hash goes on from the one of the data before it, so a key made
+// of several parts hashes them one after the other starting from HASH_SEED.
+#define HASH_SEED 14695981039346656037ULL
+#define HASH_PRIME 1099511628211ULL
+
+static inline uint64_t hashBytes(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ bytes[i]) * HASH_PRIME;
+    return hash;
+}
+
+// Without the terminator
+static inline uint64_t hashText(uint64_t hash, const char* text) {
+    return hashBytes(hash, text, strlen(text));
+}
+
+#endif // HASH_H
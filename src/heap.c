@@ -0,0 +1,250 @@
+#include "heap.h"
+#include "interp.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Append to one of the id lists of the heap
+static void pushId(int64_t** list, int64_t* count, int64_t* capacity, int64_t id) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 256;
+        *list = checkedRealloc(*list, *capacity * sizeof(int64_t), ALLOC_VM);
+    }
+    (*list)[(*count)++] = id;
+}
+
+void initHeap(VMHeap* heap, int64_t nursery_size, int64_t limit) {
+    memset(heap, 0, sizeof(VMHeap));
+    if (limit > 0 && nursery_size > limit / 2) nursery_size = limit / 2;
+    heap->nursery_size = nursery_size;
+    heap->nursery = checkedCalloc(nursery_size, sizeof(int64_t), ALLOC_VM);
+    heap->chunk_capacity = 1024;
+    heap->chunks = checkedCalloc(heap->chunk_capacity, sizeof(VMChunk), ALLOC_VM);
+    heap->free_ids = checkedCalloc(heap->chunk_capacity, sizeof(int64_t), ALLOC_VM);
+    heap->chunk_count = 1;             // Id 0 is the undefined chunk
+    heap->limit = limit;
+    heap->major_threshold = limit > 0 && limit - nursery_size < HEAP_MIN_MAJOR ? limit - nursery_size : HEAP_MIN_MAJOR;
+}
+
+void freeHeap(VMHeap* heap) {
+    for (int64_t id = 1; id < heap->chunk_count; id++) {
+        if (heap->chunks[id].state == CHUNK_OLD) free(heap->chunks[id].items);
+    }
+    free(heap->chunks);
+    free(heap->free_ids);
+    free(heap->nursery);
+    free(heap->young);
+    free(heap->remembered);
+    free(heap->marking);
+}
+
+void rememberChunk(VMHeap* heap, int64_t id) {
+    heap->chunks[id].remembered = true;
+    pushId(&heap->remembered, &heap->remembered_count, &heap->remembered_capacity, id);
+}
+
+static void releaseId(VMHeap* heap, int64_t id) {
+    VMChunk* chunk = &heap->chunks[id];
+    if (chunk->state == CHUNK_OLD) {
+        free(chunk->items);
+        heap->old_words -= chunk->size;
+    }
+    if (chunk->label) heap->label_epoch++;
+    memset(chunk, 0, sizeof(VMChunk));
+    heap->free_ids[heap->free_count++] = id;
+    heap->stats.freed++;
+}
+
+//Marking
+
+// Mark the chunk the word can be the id of, when it is in the generation being collected
+static inline void markWord(VMHeap* heap, int64_t word, bool major) {
+    if (word <= 0 || word >= heap->chunk_count) return;
+    VMChunk* chunk = &heap->chunks[word];
+    if (chunk->marked || chunk->state == CHUNK_FREE || (!major && chunk->state != CHUNK_YOUNG)) return;
+    chunk->marked = true;
+    pushId(&heap->marking, &heap->marking_count, &heap->marking_capacity, word);
+}
+
+static void markWords(VMHeap* heap, const int64_t* words, int64_t count, bool major) {
+    for (int64_t i = 0; i < count; i++) markWord(heap, words[i], major);
+}
+
+static void markReachable(VMHeap* heap, bool major) {
+    markWords(heap, heap->registers, heap->register_count, major);
+    markWords(heap, heap->stack, heap->stack_used, major);
+    markWords(heap, heap->recent, HEAP_RECENT_CHUNKS, major);
+    if (!major) {
+        for (int64_t r = 0; r < heap->remembered_count; r++) {
+            VMChunk* chunk = &heap->chunks[heap->remembered[r]];
+            if (chunk->state == CHUNK_OLD) markWords(heap, chunk->items, chunk->size, major);
+        }
+    }
+    while (heap->marking_count > 0) {
+        VMChunk* chunk = &heap->chunks[heap->marking[--heap->marking_count]];
+        if (!chunk->leaf) markWords(heap, chunk->items, chunk->size, major);
+    }
+}
+
+//Collections
+
+// Copy the young chunks that are reachable out of the nursery and free the others. Every
+// survivor is promoted, so no old chunk holds a young id afterwards.
+static void collectMinor(VMHeap* heap) {
+    markReachable(heap, false);
+    for (int64_t y = 0; y < heap->young_count; y++) {
+        int64_t id = heap->young[y];
+        VMChunk* chunk = &heap->chunks[id];
+        if (chunk->state != CHUNK_YOUNG) continue;        // Destroyed, resized out or listed twice
+        if (!chunk->marked) {
+            releaseId(heap, id);
+            continue;
+        }
+        int64_t* items = checkedCalloc(chunk->size, sizeof(int64_t), ALLOC_VM);
+        memcpy(items, chunk->items, chunk->size * sizeof(int64_t));
+        chunk->items = items;
+        chunk->state = CHUNK_OLD;
+        chunk->marked = false;
+        heap->old_words += chunk->size;
+        heap->stats.promoted++;
+    }
+    for (int64_t r = 0; r < heap->remembered_count; r++) heap->chunks[heap->remembered[r]].remembered = false;
+    heap->remembered_count = 0;
+    heap->young_count = 0;
+    heap->nursery_used = 0;
+    heap->stats.minor_collections++;
+}
+
+// Mark from the roots and sweep the old generation; the nursery is empty after a minor collection
+static void collectMajor(VMHeap* heap) {
+    markReachable(heap, true);
+    for (int64_t id = 1; id < heap->chunk_count; id++) {
+        VMChunk* chunk = &heap->chunks[id];
+        if (chunk->state != CHUNK_OLD) continue;
+        if (chunk->marked) {
+            chunk->marked = false;
+        } else {
+            releaseId(heap, id);
+        }
+    }
+    // The next major collection waits until the old generation doubles
+    heap->major_threshold = heap->old_words * 2 > HEAP_MIN_MAJOR ? heap->old_words * 2 : HEAP_MIN_MAJOR;
+    if (heap->limit > 0 && heap->major_threshold > heap->limit - heap->nursery_size) {
+        heap->major_threshold = heap->limit - heap->nursery_size;
+    }
+    heap->stats.major_collections++;
+}
+
+void collectGarbage(VMHeap* heap, bool major) {
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    collectMinor(heap);
+    if (major || heap->old_words > heap->major_threshold) collectMajor(heap);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double pause = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+    heap->stats.total_pause += pause;
+    if (pause > heap->stats.max_pause) heap->stats.max_pause = pause;
+}
+
+//Allocation
+
+static bool fitsInLimit(VMHeap* heap, int64_t words) {
+    return heap->limit <= 0 || heap->old_words + heap->nursery_size + words <= heap->limit;
+}
+
+static int64_t newId(VMHeap* heap) {
+    if (heap->free_count > 0) return heap->free_ids[--heap->free_count];
+    if (heap->chunk_count == heap->chunk_capacity) {
+        heap->chunk_capacity *= 2;
+        heap->chunks = checkedRealloc(heap->chunks, heap->chunk_capacity * sizeof(VMChunk), ALLOC_VM);
+        heap->free_ids = checkedRealloc(heap->free_ids, heap->chunk_capacity * sizeof(int64_t), ALLOC_VM);
+        memset(&heap->chunks[heap->chunk_count], 0, (heap->chunk_capacity - heap->chunk_count) * sizeof(VMChunk));
+    }
+    return heap->chunk_count++;
+}
+
+// Room in the old generation, after a major collection if it is needed
+static bool reserveOld(VMHeap* heap, int64_t words) {
+    if (heap->old_words + words > heap->major_threshold || !fitsInLimit(heap, words)) collectGarbage(heap, true);
+    return fitsInLimit(heap, words);
+}
+
+int64_t allocateChunk(VMHeap* heap, int64_t size, bool leaf) {
+    bool young = size <= heap->nursery_size / 8;     // Large chunks go to the old generation
+    if (young && heap->nursery_used + size > heap->nursery_size) collectGarbage(heap, false);
+    if (!young && !reserveOld(heap, size)) return 0;
+
+    int64_t id = newId(heap);
+    VMChunk* chunk = &heap->chunks[id];
+    chunk->size = size;
+    chunk->leaf = leaf;
+    if (young) {
+        chunk->items = heap->nursery + heap->nursery_used;
+        chunk->state = CHUNK_YOUNG;
+        memset(chunk->items, 0, size * sizeof(int64_t));
+        heap->nursery_used += size;
+        pushId(&heap->young, &heap->young_count, &heap->young_capacity, id);
+    } else {
+        chunk->items = checkedCalloc(size, sizeof(int64_t), ALLOC_VM);
+        chunk->state = CHUNK_OLD;
+        heap->old_words += size;
+        if (!leaf) rememberChunk(heap, id);          // A copy can fill it with young ids
+    }
+
+    heap->recent[heap->recent_next] = id;
+    heap->recent_next = (heap->recent_next + 1) % HEAP_RECENT_CHUNKS;
+    if (heap->old_words + heap->nursery_used > heap->stats.peak_words) {
+        heap->stats.peak_words = heap->old_words + heap->nursery_used;
+    }
+    return id;
+}
+
+// A young chunk that grows gets new items in the nursery while they fit there, else it moves to
+// the old generation, where its items can be reallocated
+bool resizeChunk(VMHeap* heap, int64_t id, int64_t size) {
+    VMChunk* chunk = &heap->chunks[id];
+    if (chunk->state == CHUNK_YOUNG && size <= chunk->size) {
+        chunk->size = size;
+        return true;
+    }
+    if (chunk->state == CHUNK_YOUNG && size <= heap->nursery_size / 8 && heap->nursery_used + size <= heap->nursery_size) {
+        int64_t* items = heap->nursery + heap->nursery_used;
+        memcpy(items, chunk->items, chunk->size * sizeof(int64_t));
+        memset(items + chunk->size, 0, (size - chunk->size) * sizeof(int64_t));
+        heap->nursery_used += size;
+        chunk->items = items;
+        chunk->size = size;
+        return true;
+    }
+    int64_t growth = chunk->state == CHUNK_YOUNG ? size : size - chunk->size;
+    if (growth > 0 && !fitsInLimit(heap, growth)) {
+        heap->recent[heap->recent_next] = id;           // The chunk being resized survives
+        heap->recent_next = (heap->recent_next + 1) % HEAP_RECENT_CHUNKS;
+        collectGarbage(heap, true);
+        if (!fitsInLimit(heap, growth)) return false;
+        chunk = &heap->chunks[id];
+        growth = chunk->state == CHUNK_YOUNG ? size : size - chunk->size;
+    }
+
+    if (chunk->state == CHUNK_YOUNG) {
+        int64_t* items = checkedCalloc(size, sizeof(int64_t), ALLOC_VM);
+        memcpy(items, chunk->items, chunk->size * sizeof(int64_t));
+        chunk->items = items;
+        chunk->state = CHUNK_OLD;
+        if (!chunk->leaf) rememberChunk(heap, id);
+    } else {
+        chunk->items = checkedRealloc(chunk->items, size * sizeof(int64_t), ALLOC_VM);
+        if (size > chunk->size) memset(chunk->items + chunk->size, 0, (size - chunk->size) * sizeof(int64_t));
+    }
+    heap->old_words += growth;
+    chunk->size = size;
+    return true;
+}
+
+void destroyChunk(VMHeap* heap, int64_t id) {
+    if (findChunk(heap, id)) releaseId(heap, id);
+}
@@ -0,0 +1,97 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HEAP_DEFAULT_NURSERY (1 << 18) // Words of the nursery
+#define HEAP_MIN_MAJOR (1 << 20)       // Words of the old generation before the first major collection
+#define HEAP_RECENT_CHUNKS 4           // The last chunks created are roots (operands of the current instruction)
+
+typedef enum {
+    CHUNK_FREE,
+    CHUNK_YOUNG,                       // Its items are in the nursery
+    CHUNK_OLD,                         // Survived a collection or too large for the nursery
+} ChunkState;
+
+// Chunk of the heap. The ids are indexes in the chunk table and never move, the collector only
+// moves the items, so the program can keep ids in any word.
+typedef struct {
+    int64_t* items;
+    int64_t size;
+    uint8_t state;
+    bool label;                        // Resolved as the target of a call, inline caches depend on it
+    bool leaf;                         // Only characters, the collector does not look inside
+    bool marked;
+    bool remembered;                   // Old chunk that can hold ids of young ones
+} VMChunk;
+
+typedef struct {
+    long long minor_collections;
+    long long major_collections;
+    long long promoted;                // Chunks copied out of the nursery
+    long long freed;
+    int64_t peak_words;                // Most words of chunks allocated at once, nursery included
+    double max_pause;                  // Milliseconds
+    double total_pause;
+} VMHeapStats;
+
+// Generational heap: a bump allocated nursery whose survivors are copied to the old generation,
+// which is collected by mark and sweep. VYPcode words have no type, so every word of a root or
+// of a chunk that holds the id of a live chunk keeps it alive.
+typedef struct {
+    VMChunk* chunks;
+    int64_t chunk_count;
+    int64_t chunk_capacity;
+    int64_t* free_ids;
+    int64_t free_count;
+    int64_t* nursery;
+    int64_t nursery_size;
+    int64_t nursery_used;
+    int64_t* young;                    // Ids allocated in the nursery since the last collection
+    int64_t young_count;
+    int64_t young_capacity;
+    int64_t* remembered;               // Old chunks written with ids of young ones
+    int64_t remembered_count;
+    int64_t remembered_capacity;
+    int64_t* marking;                  // Work list of the marking
+    int64_t marking_count;
+    int64_t marking_capacity;
+    int64_t old_words;
+    int64_t major_threshold;           // Old words that start the next major collection
+    int64_t limit;                     // Maximum words of chunks, nursery included (0 = no limit)
+    int64_t recent[HEAP_RECENT_CHUNKS];
+    int recent_next;
+    int64_t* registers;                // Roots, set by the interpreter
+    int register_count;
+    int64_t* stack;
+    int64_t stack_used;                // Words of the stack that were ever written
+    long long label_epoch;             // Changes when a chunk used as a call target is freed
+    VMHeapStats stats;
+} VMHeap;
+
+void initHeap(VMHeap* heap, int64_t nursery_size, int64_t limit);
+void freeHeap(VMHeap* heap);
+
+// Id of a new chunk filled with zeros, 0 when the heap limit does not leave room for it
+int64_t allocateChunk(VMHeap* heap, int64_t size, bool leaf);
+bool resizeChunk(VMHeap* heap, int64_t id, int64_t size);
+void destroyChunk(VMHeap* heap, int64_t id);
+void collectGarbage(VMHeap* heap, bool major);
+void rememberChunk(VMHeap* heap, int64_t id);
+
+static inline VMChunk* findChunk(VMHeap* heap, int64_t id) {
+    return id > 0 && id < heap->chunk_count && heap->chunks[id].state != CHUNK_FREE ? &heap->chunks[id] : NULL;
+}
+
+// Write barrier of SETWORD
+static inline void recordWrite(VMHeap* heap, VMChunk* chunk, int64_t value) {
+    chunk->leaf = false;
+    if (chunk->state == CHUNK_OLD && !chunk->remembered && value > 0 && value < heap->chunk_count &&
+        heap->chunks[value].state == CHUNK_YOUNG) {
+        rememberChunk(heap, chunk - heap->chunks);
+    }
+}
+
+#endif // HEAP_H
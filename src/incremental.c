@@ -0,0 +1,466 @@
+#include "incremental.h"
+#include "alloc.h"
+#include "hash.h"
+#include "buildstamp.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MAX_PATH 4096
+
+// Code of another build of vypcomp is never taken from the cache
+#define CACHE_SEED "vypcomp cache 1"
+
+//Fingerprints
+
+static uint64_t hashInt(uint64_t hash, long value) {
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+// A null string hashes differently from an empty one and the end of every string is marked
+static uint64_t hashString(uint64_t hash, const char* text) {
+    if (!text) return hashInt(hash, -1);
+    return hashBytes(hash, text, strlen(text) + 1);
+}
+
+static uint64_t hashList(uint64_t hash, ASTNode* node);
+
+// Structure of a node and of everything under it
+static uint64_t hashNode(uint64_t hash, ASTNode* node) {
+    hash = hashInt(hash, node->type);
+    switch (node->type) {
+        case AST_CLASS: {
+            ASTClassNode* classNode = (ASTClassNode*)node;
+            hash = hashString(hashString(hash, classNode->name), classNode->parent);
+            return hashList(hash, classNode->members);
+        }
+        case AST_FUNCTION: {
+            ASTFunctionNode* function = (ASTFunctionNode*)node;
+            hash = hashString(hashString(hash, function->name), function->returnType);
+            return hashList(hashList(hash, function->parameters), function->body);
+        }
+        case AST_DECLARATION: {
+            ASTDeclarationNode* declaration = (ASTDeclarationNode*)node;
+            hash = hashString(hashString(hash, declaration->type), declaration->name);
+            return hashList(hash, declaration->init);
+        }
+        case AST_BLOCK:
+            return hashList(hash, ((ASTBlockNode*)node)->statements);
+        case AST_IF: {
+            ASTIfNode* ifNode = (ASTIfNode*)node;
+            hash = hashList(hashList(hash, ifNode->condition), ifNode->trueBlock);
+            return hashList(hash, ifNode->falseBlock);
+        }
+        case AST_WHILE:
+            return hashList(hashList(hash, ((ASTWhileNode*)node)->condition), ((ASTWhileNode*)node)->body);
+        case AST_RETURN:
+            return hashList(hash, ((ASTReturnNode*)node)->expression);
+        case AST_PRINT:
+            return hashList(hash, ((ASTPrintNode*)node)->arguments);
+        case AST_VARIABLE:
+            return hashString(hash, ((ASTVariableNode*)node)->name);
+        case AST_LITERAL:
+            return hashString(hashString(hash, ((ASTLiteralNode*)node)->value), ((ASTLiteralNode*)node)->literalType);
+        case AST_BINARY_OP: {
+            ASTBinaryOpNode* binary = (ASTBinaryOpNode*)node;
+            return hashList(hashList(hashInt(hash, binary->op), binary->left), binary->right);
+        }
+        case AST_UNARY_OP:
+            return hashList(hashInt(hash, ((ASTUnaryOpNode*)node)->op), ((ASTUnaryOpNode*)node)->operand);
+        case AST_FUNCTION_CALL: {
+            ASTFunctionCallNode* call = (ASTFunctionCallNode*)node;
+            hash = hashList(hashString(hash, call->functionName), call->context);
+            return hashList(hash, call->arguments);
+        }
+        case AST_NEW:
+            return hashList(hashString(hash, ((ASTNewNode*)node)->className), ((ASTNewNode*)node)->arguments);
+        case AST_MEMBER_ACCESS: {
+            ASTMemberAccessNode* access = (ASTMemberAccessNode*)node;
+            return hashString(hashList(hash, access->expression), access->memberName);
+        }
+        case AST_METHOD_CALL: {
+            ASTMethodCallNode* call = (ASTMethodCallNode*)node;
+            hash = hashString(hashList(hash, call->expression), call->methodName);
+            return hashList(hash, call->arguments);
+        }
+        case AST_IDENTIFIER_LIST:
+            return hashList(hash, ((ASTIdentifierListNode*)node)->identifiers);
+        case AST_STRING_LITERAL:
+            return hashString(hash, ((ASTStringLiteralNode*)node)->value);
+        case AST_TYPE_CAST:
+            return hashList(hashString(hash, ((ASTTypeCastNode*)node)->typeName), ((ASTTypeCastNode*)node)->expression);
+        default:
+            return hash;                           // this, super
+    }
+}
+
+static uint64_t hashList(uint64_t hash, ASTNode* node) {
+    for (; node; node = node->next) hash = hashNode(hash, node);
+    return hashInt(hash, -2);                      // End of the list
+}
+
+static uint64_t hashSignature(uint64_t hash, ASTFunctionNode* function) {
+    hash = hashString(hashString(hash, function->name), function->returnType);
+    for (ASTNode* parameter = function->parameters; parameter; parameter = parameter->next) {
+        if (parameter->type == AST_DECLARATION) hash = hashString(hash, ((ASTDeclarationNode*)parameter)->type);
+    }
+    return hashInt(hash, -2);
+}
+
+static uint64_t hashInterface(ASTNode* node) {
+    uint64_t hash = hashInt(HASH_SEED, node->type);
+    if (node->type == AST_FUNCTION) return hashSignature(hash, (ASTFunctionNode*)node);
+
+    ASTClassNode* classNode = (ASTClassNode*)node;
+    hash = hashString(hashString(hash, classNode->name), classNode->parent);
+    for (ASTNode* member = classNode->members; member; member = member->next) {
+        if (member->type == AST_FUNCTION) {
+            hash = hashSignature(hash, (ASTFunctionNode*)member);
+        } else if (member->type == AST_DECLARATION) {
+            ASTDeclarationNode* field = (ASTDeclarationNode*)member;
+            hash = hashString(hashString(hash, field->type), field->name);
+        }
+    }
+    return hash;
+}
+
+//Dependencies
+
+static void addCall(CompilationUnit* unit, const char* name) {
+    for (int c = 0; c < unit->call_count; c++) {
+        if (strcmp(unit->calls[c], name) == 0) return;
+    }
+    unit->calls = checkedRealloc(unit->calls, (unit->call_count + 1) * sizeof(char*), ALLOC_MODULES);
+    unit->calls[unit->call_count++] = compilerStrdup(name, ALLOC_MODULES);
+}
+
+// Names the unit calls, and the symbols of the variables it uses: the IR takes the type of a
+// variable whose declaration the parser dropped from the global symbol table
+static uint64_t collectUses(CompilationUnit* unit, ASTNode* node, SymbolTable* symbolTable, uint64_t hash) {
+    for (; node; node = node->next) {
+        switch (node->type) {
+            case AST_FUNCTION:
+                hash = collectUses(unit, ((ASTFunctionNode*)node)->body, symbolTable, hash);
+                break;
+            case AST_DECLARATION:
+                hash = collectUses(unit, ((ASTDeclarationNode*)node)->init, symbolTable, hash);
+                break;
+            case AST_BLOCK:
+                hash = collectUses(unit, ((ASTBlockNode*)node)->statements, symbolTable, hash);
+                break;
+            case AST_IF:
+                hash = collectUses(unit, ((ASTIfNode*)node)->condition, symbolTable, hash);
+                hash = collectUses(unit, ((ASTIfNode*)node)->trueBlock, symbolTable, hash);
+                hash = collectUses(unit, ((ASTIfNode*)node)->falseBlock, symbolTable, hash);
+                break;
+            case AST_WHILE:
+                hash = collectUses(unit, ((ASTWhileNode*)node)->condition, symbolTable, hash);
+                hash = collectUses(unit, ((ASTWhileNode*)node)->body, symbolTable, hash);
+                break;
+            case AST_RETURN:
+                hash = collectUses(unit, ((ASTReturnNode*)node)->expression, symbolTable, hash);
+                break;
+            case AST_PRINT:
+                hash = collectUses(unit, ((ASTPrintNode*)node)->arguments, symbolTable, hash);
+                break;
+            case AST_VARIABLE: {
+                const char* name = ((ASTVariableNode*)node)->name;
+                int index = find_symbol(symbolTable, name);
+                hash = hashString(hash, name);
+                if (index >= 0) {
+                    Symbol* symbol = &symbolTable->symbols[index];
+                    hash = hashString(hash, symbol->type);
+                    hash = hashInt(hash, symbol->is_function * 2 + symbol->is_class);
+                }
+                break;
+            }
+            case AST_BINARY_OP:
+                hash = collectUses(unit, ((ASTBinaryOpNode*)node)->left, symbolTable, hash);
+                hash = collectUses(unit, ((ASTBinaryOpNode*)node)->right, symbolTable, hash);
+                break;
+            case AST_UNARY_OP:
+                hash = collectUses(unit, ((ASTUnaryOpNode*)node)->operand, symbolTable, hash);
+                break;
+            case AST_FUNCTION_CALL: {
+                ASTFunctionCallNode* call = (ASTFunctionCallNode*)node;
+                if (call->functionName) addCall(unit, call->functionName);
+                if (call->context && call->context->type == AST_MEMBER_ACCESS) {
+                    addCall(unit, ((ASTMemberAccessNode*)call->context)->memberName);
+                }
+                hash = collectUses(unit, call->context, symbolTable, hash);
+                hash = collectUses(unit, call->arguments, symbolTable, hash);
+                break;
+            }
+            case AST_NEW:
+                hash = collectUses(unit, ((ASTNewNode*)node)->arguments, symbolTable, hash);
+                break;
+            case AST_MEMBER_ACCESS:
+                hash = collectUses(unit, ((ASTMemberAccessNode*)node)->expression, symbolTable, hash);
+                break;
+            case AST_METHOD_CALL:
+                addCall(unit, ((ASTMethodCallNode*)node)->methodName);
+                hash = collectUses(unit, ((ASTMethodCallNode*)node)->expression, symbolTable, hash);
+                hash = collectUses(unit, ((ASTMethodCallNode*)node)->arguments, symbolTable, hash);
+                break;
+            case AST_IDENTIFIER_LIST:
+                hash = collectUses(unit, ((ASTIdentifierListNode*)node)->identifiers, symbolTable, hash);
+                break;
+            case AST_TYPE_CAST:
+                hash = collectUses(unit, ((ASTTypeCastNode*)node)->expression, symbolTable, hash);
+                break;
+            default:
+                break;
+        }
+    }
+    return hash;
+}
+
+// Whether a call by the name can run code of the unit: the function itself, or any method
+// with that name, since a method call can reach every override
+static bool unitDefines(CompilationUnit* unit, const char* name) {
+    if (unit->node->type == AST_FUNCTION) return strcmp(unit->name, name) == 0;
+    for (ASTNode* member = ((ASTClassNode*)unit->node)->members; member; member = member->next) {
+        if (member->type == AST_FUNCTION && strcmp(((ASTFunctionNode*)member)->name, name) == 0) return true;
+    }
+    return false;
+}
+
+// Mark the units the unit can reach through calls
+static void markCallees(IncrementalBuild* build, int unit, bool* reached) {
+    if (reached[unit]) return;
+    reached[unit] = true;
+    CompilationUnit* current = &build->units[unit];
+    for (int c = 0; c < current->call_count; c++) {
+        for (int u = 0; u < build->count; u++) {
+            if (!reached[u] && unitDefines(&build->units[u], current->calls[c])) markCallees(build, u, reached);
+        }
+    }
+}
+
+//Cache
+
+// Path of the code of one function of a unit
+static void cachePath(IncrementalBuild* build, CompilationUnit* unit, const char* function, char* path) {
+    uint64_t key = hashString(hashInt(HASH_SEED, (long)unit->key), function);
+    snprintf(path, MAX_PATH, "%s/%016llx.vc", build->directory, (unsigned long long)key);
+}
+
+// Name of every IR function of the unit, as buildIR gives them
+static int getUnitFunctions(CompilationUnit* unit, char names[][MAX_PATH], int max) {
+    if (unit->node->type == AST_FUNCTION) {
+        snprintf(names[0], MAX_PATH, "%s", unit->name);
+        return 1;
+    }
+    int count = 0;
+    for (ASTNode* member = ((ASTClassNode*)unit->node)->members; member && count < max; member = member->next) {
+        if (member->type == AST_FUNCTION) {
+            snprintf(names[count++], MAX_PATH, "%s.%s", unit->name, ((ASTFunctionNode*)member)->name);
+        }
+    }
+    return count;
+}
+
+// A piece of the cache starts with a line of the key of its unit and the hash of the code after
+// it. A piece that does not match, or whose code cannot be read, is a miss.
+#define PIECE_HEADER "vypcomp-cache %016llx %016llx\n"
+#define PIECE_HEADER_SIZE 48
+
+static VCProgram* readCachedCode(const char* path, uint64_t key) {
+    FILE* in = fopen(path, "r");
+    if (!in) return NULL;
+    struct stat status;
+    char* text = NULL;
+    bool read = fstat(fileno(in), &status) == 0 && status.st_size > PIECE_HEADER_SIZE;
+    if (read) {
+        text = checkedCalloc(status.st_size + 1, 1, ALLOC_MODULES);
+        read = fread(text, 1, status.st_size, in) == (size_t)status.st_size;
+    }
+    fclose(in);
+
+    VCProgram* code = NULL;
+    unsigned long long pieceKey, pieceHash;
+    if (read && sscanf(text, PIECE_HEADER, &pieceKey, &pieceHash) == 2 && text[PIECE_HEADER_SIZE - 1] == '\n' && pieceKey == key) {
+        char* body = text + PIECE_HEADER_SIZE;
+        size_t length = status.st_size - PIECE_HEADER_SIZE;
+        FILE* bodyIn = hashBytes(HASH_SEED, body, length) == pieceHash ? fmemopen(body, length, "r") : NULL;
+        if (bodyIn) {
+            code = readVYPcode(bodyIn);
+            fclose(bodyIn);
+        }
+    }
+    compilerFree(text);
+    return code;
+}
+
+// Written under another name first, so a concurrent build never reads half a file
+static void writeCachedCode(const char* path, uint64_t key, VCProgram* code) {
+    char* body = NULL;
+    size_t length = 0;
+    FILE* bodyOut = open_memstream(&body, &length);
+    if (!bodyOut) return;
+    int result = writeVYPcode(code, bodyOut);
+    if (fclose(bodyOut) != 0 || result != 0) {
+        free(body);
+        return;
+    }
+
+    char temporary[MAX_PATH + 32];
+    snprintf(temporary, sizeof(temporary), "%s.%ld.tmp", path, (long)getpid());
+    FILE* out = fopen(temporary, "w");
+    if (out) {
+        bool written = fprintf(out, PIECE_HEADER, (unsigned long long)key, (unsigned long long)hashBytes(HASH_SEED, body, length)) == PIECE_HEADER_SIZE;
+        written = fwrite(body, 1, length, out) == length && written;
+        if (fclose(out) != 0 || !written || rename(temporary, path) != 0) remove(temporary);
+    }
+    free(body);
+}
+
+// Read and check every piece of a unit; false, with none of them kept, on the first miss
+static bool loadCachedUnit(IncrementalBuild* build, CompilationUnit* unit, char functions[][MAX_PATH]) {
+    int count = getUnitFunctions(unit, functions, MAX_METHODS);
+    unit->pieces = checkedCalloc(count, sizeof(VCProgram*), ALLOC_MODULES);
+    for (int f = 0; f < count; f++) {
+        char path[MAX_PATH];
+        cachePath(build, unit, functions[f], path);
+        unit->pieces[f] = access(path, R_OK) == 0 ? readCachedCode(path, unit->key) : NULL;
+        if (unit->pieces[f]) continue;
+        if (access(path, F_OK) == 0) build->rejected++;
+        for (int done = 0; done < f; done++) freeVCProgram(unit->pieces[done]);
+        compilerFree(unit->pieces);
+        unit->pieces = NULL;
+        return false;
+    }
+    unit->piece_count = count;
+    return true;
+}
+
+IncrementalBuild* openIncrementalBuild(ASTProgramNode* program, SymbolTable* symbolTable, const char* directory) {
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+        perror("Error creating the cache directory");
+        return NULL;
+    }
+    IncrementalBuild* build = checkedCalloc(1, sizeof(IncrementalBuild), ALLOC_MODULES);
+    build->directory = compilerStrdup(directory, ALLOC_MODULES);
+    for (ASTNode* node = program->classes; node; node = node->next) build->count++;
+    for (ASTNode* node = program->functions; node; node = node->next) build->count++;
+    build->units = checkedCalloc(build->count, sizeof(CompilationUnit), ALLOC_MODULES);
+
+    // Every unit sees the interfaces of all of them
+    uint64_t interfaces = hashString(hashString(HASH_SEED, CACHE_SEED), build_stamp);
+    int u = 0;
+    for (int list = 0; list < 2; list++) {
+        for (ASTNode* node = list == 0 ? program->classes : program->functions; node; node = node->next, u++) {
+            CompilationUnit* unit = &build->units[u];
+            unit->node = node;
+            unit->name = node->type == AST_CLASS ? ((ASTClassNode*)node)->name : ((ASTFunctionNode*)node)->name;
+            unit->interface_hash = hashInterface(node);
+            unit->body_hash = hashNode(HASH_SEED, node);
+            interfaces = hashInt(interfaces, (long)unit->interface_hash);
+        }
+    }
+
+    bool* reached = checkedCalloc(build->count, sizeof(bool), ALLOC_MODULES);
+    char (*functions)[MAX_PATH] = checkedCalloc(MAX_METHODS, MAX_PATH, ALLOC_MODULES);
+    for (u = 0; u < build->count; u++) {
+        CompilationUnit* unit = &build->units[u];
+        ASTNode* uses = unit->node->type == AST_CLASS ? ((ASTClassNode*)unit->node)->members : ((ASTFunctionNode*)unit->node)->body;
+        uint64_t key = collectUses(unit, uses, symbolTable, interfaces);
+        memset(reached, 0, build->count * sizeof(bool));
+        markCallees(build, u, reached);
+        for (int other = 0; other < build->count; other++) {
+            if (reached[other]) key = hashInt(key, (long)build->units[other].body_hash);
+        }
+        unit->key = key;
+
+        unit->cached = loadCachedUnit(build, unit, functions);
+        if (!unit->cached) build->changed++;
+    }
+
+    // The optimizations of a changed unit read the IR of everything it can call
+    for (u = 0; u < build->count; u++) {
+        if (build->units[u].cached) continue;
+        memset(reached, 0, build->count * sizeof(bool));
+        markCallees(build, u, reached);
+        for (int other = 0; other < build->count; other++) {
+            if (reached[other]) build->units[other].lowered = true;
+        }
+    }
+    compilerFree(functions);
+    compilerFree(reached);
+    return build;
+}
+
+void freeIncrementalBuild(IncrementalBuild* build) {
+    if (!build) return;
+    for (int u = 0; u < build->count; u++) {
+        for (int c = 0; c < build->units[u].call_count; c++) compilerFree(build->units[u].calls[c]);
+        compilerFree(build->units[u].calls);
+        for (int p = 0; p < build->units[u].piece_count; p++) freeVCProgram(build->units[u].pieces[p]);
+        compilerFree(build->units[u].pieces);
+    }
+    compilerFree(build->units);
+    compilerFree(build->directory);
+    compilerFree(build);
+}
+
+bool* getLoweredUnits(IncrementalBuild* build) {
+    bool* lowered = checkedCalloc(build->count, sizeof(bool), ALLOC_MODULES);
+    for (int u = 0; u < build->count; u++) lowered[u] = build->units[u].lowered;
+    return lowered;
+}
+
+static IRFunction* findIRFunction(IRProgram* program, const char* name) {
+    for (IRFunction* function = program->functions; function; function = function->next) {
+        if (strcmp(function->name, name) == 0) return function;
+    }
+    return NULL;
+}
+
+VCProgram* generateIncrementalVYPcode(IncrementalBuild* build, IRProgram* program, CodegenStats* stats) {
+    if (stats) memset(stats, 0, sizeof(CodegenStats));
+    char (*functions)[MAX_PATH] = checkedCalloc(MAX_METHODS, MAX_PATH, ALLOC_MODULES);
+    int capacity = 0;
+    for (int u = 0; u < build->count; u++) capacity += getUnitFunctions(&build->units[u], functions, MAX_METHODS);
+    VCProgram** pieces = checkedCalloc(capacity, sizeof(VCProgram*), ALLOC_MODULES);
+    char path[MAX_PATH];
+    int count = 0;
+    bool failed = false;
+
+    for (int u = 0; u < build->count && !failed; u++) {
+        CompilationUnit* unit = &build->units[u];
+        int function_count = getUnitFunctions(unit, functions, MAX_METHODS);
+        for (int f = 0; f < function_count && !failed; f++) {
+            cachePath(build, unit, functions[f], path);
+            VCProgram* piece = NULL;
+            if (unit->cached && f < unit->piece_count) {
+                piece = unit->pieces[f];           // Taken over by the link
+                unit->pieces[f] = NULL;
+                build->cached_functions++;
+            }
+            if (!piece) {
+                IRFunction* function = findIRFunction(program, functions[f]);
+                if (!function) {
+                    fprintf(stderr, "Error: the cache has no valid code for '%s' (remove %s).\n", functions[f], build->directory);
+                    failed = true;
+                    break;
+                }
+                piece = generateFunctionVYPcode(program, function, stats);
+                if (!piece) {
+                    failed = true;
+                    break;
+                }
+                writeCachedCode(path, unit->key, piece);
+            }
+            pieces[count++] = piece;
+        }
+    }
+    compilerFree(functions);
+
+    VCProgram* code = failed ? NULL : linkVYPcode(program, pieces, count);
+    for (int p = 0; p < count; p++) freeVCProgram(pieces[p]);
+    compilerFree(pieces);
+    return code;
+}
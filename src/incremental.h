@@ -0,0 +1,55 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "ast.h"
+#include "ir.h"
+#include "codegen.h"
+#include "vypcode.h"
+#include <stdint.h>
+
+#define INCREMENTAL_DEFAULT_CACHE ".vypcache"
+
+// Top-level class or function of the source. The interface is what the other units see of it
+// (signature of a function; name, parent, attributes and method signatures of a class), the
+// body hash covers the whole unit.
+//
+// The key of a unit covers its body, the interfaces of every unit and the bodies of the units
+// it can call: the tail call and loop optimizations read the code of the callees. The cache
+// keeps the VYPcode of every function of a unit under the key, before the peephole optimizer,
+// with the hash of that code: a piece that does not match it is compiled again.
+typedef struct {
+    ASTNode* node;                 // ASTClassNode or ASTFunctionNode
+    const char* name;
+    uint64_t interface_hash;
+    uint64_t body_hash;
+    uint64_t key;
+    bool cached;                   // The code of all its functions is in the cache
+    VCProgram** pieces;            // That code, read and checked when the build is opened
+    int piece_count;
+    bool lowered;                  // Goes through the IR: changed, or called by a changed unit
+    char** calls;                  // Functions and methods called by name
+    int call_count;
+} CompilationUnit;
+
+typedef struct {
+    CompilationUnit* units;        // Classes first, then functions, in the order of the source
+    int count;
+    char* directory;
+    int changed;                   // Units not found in the cache
+    int rejected;                  // Pieces of the cache found corrupted, compiled again
+    int cached_functions;          // Functions whose code comes from the cache
+} IncrementalBuild;
+
+// Hash the units of the program and look them up in the cache directory (created if missing);
+// null when the directory cannot be created
+IncrementalBuild* openIncrementalBuild(ASTProgramNode* program, SymbolTable* symbolTable, const char* directory);
+void freeIncrementalBuild(IncrementalBuild* build);
+
+// Whether the units go through the IR, indexed like buildIR expects them
+bool* getLoweredUnits(IncrementalBuild* build);
+
+// Code of the whole program: the functions of the cached units come from the cache, the rest
+// are generated from the IR and stored. Null on error.
+VCProgram* generateIncrementalVYPcode(IncrementalBuild* build, IRProgram* program, CodegenStats* stats);
+
+#endif // INCREMENTAL_H
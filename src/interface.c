@@ -0,0 +1,569 @@
+#include "interface.h"
+#include "alloc.h"
+#include "hash.h"
+#include "buildstamp.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INTERFACE_ALIGNMENT 8
+
+// The code of an interface is only linked by the build of vypcomp that generated it
+#define INTERFACE_COMPILER "vypcomp interface 1"
+
+static uint64_t compilerStamp() {
+    return hashText(hashText(HASH_SEED, INTERFACE_COMPILER), build_stamp);
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + INTERFACE_ALIGNMENT - 1) / INTERFACE_ALIGNMENT * INTERFACE_ALIGNMENT;
+}
+
+//Writing
+
+// Growing array of records or bytes
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static void* reserve(Buffer* buffer, size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        while (capacity < buffer->size + size) capacity *= 2;
+        buffer->data = checkedRealloc(buffer->data, capacity, ALLOC_MODULES);
+        memset(buffer->data + buffer->capacity, 0, capacity - buffer->capacity);
+        buffer->capacity = capacity;
+    }
+    void* record = buffer->data + buffer->size;
+    buffer->size += size;
+    return record;
+}
+
+static uint32_t poolString(Buffer* pool, const char* text) {
+    if (!text) return INTERFACE_NONE;
+    uint32_t offset = pool->size;
+    memcpy(reserve(pool, strlen(text) + 1), text, strlen(text) + 1);
+    return offset;
+}
+
+typedef struct {
+    IRProgram* program;
+    ProgramLayout* layout;
+    CodegenStats* stats;
+    Buffer classes;
+    Buffer functions;
+    Buffer variables;
+    Buffer slots;
+    Buffer pool;
+    int variable_count;
+    bool failed;
+} InterfaceWriter;
+
+static IRFunction* findIRFunction(IRProgram* program, const char* name) {
+    for (IRFunction* function = program->functions; function; function = function->next) {
+        if (strcmp(function->name, name) == 0) return function;
+    }
+    return NULL;
+}
+
+static int addVariable(InterfaceWriter* writer, ASTDeclarationNode* declaration, int offset) {
+    InterfaceVariable* variable = reserve(&writer->variables, sizeof(InterfaceVariable));
+    variable->type = poolString(&writer->pool, declaration->type);
+    variable->name = poolString(&writer->pool, declaration->name);
+    variable->offset = offset;
+    return writer->variable_count++;
+}
+
+// Signature and VYPcode of a function or method (named "Class.method" in the IR)
+static void addFunction(InterfaceWriter* writer, ASTFunctionNode* function, const char* irName) {
+    int first = writer->variable_count;
+    for (ASTNode* parameter = function->parameters; parameter; parameter = parameter->next) {
+        if (parameter->type == AST_DECLARATION) addVariable(writer, (ASTDeclarationNode*)parameter, -1);
+    }
+    uint32_t name = poolString(&writer->pool, function->name);
+    uint32_t returnType = poolString(&writer->pool, function->returnType);
+
+    IRFunction* lowered = findIRFunction(writer->program, irName);
+    VCProgram* code = lowered ? generateFunctionVYPcode(writer->program, lowered, writer->stats) : NULL;
+    char* text = NULL;
+    size_t length = 0;
+    FILE* out = code ? open_memstream(&text, &length) : NULL;
+    if (!out || writeVYPcode(code, out) != 0) writer->failed = true;
+    if (out) fclose(out);
+    freeVCProgram(code);
+
+    InterfaceFunction* record = reserve(&writer->functions, sizeof(InterfaceFunction));
+    record->name = name;
+    record->return_type = returnType;
+    record->first_parameter = first;
+    record->parameter_count = writer->variable_count - first;
+    record->code = poolString(&writer->pool, text ? text : "");
+    compilerFree(text);
+}
+
+static ASTClassNode* findClassUnit(IRProgram* program, const bool* exported, const char* name) {
+    int unit = 0;
+    for (ASTNode* node = program->ast->classes; node; node = node->next, unit++) {
+        if (exported[unit] && strcmp(((ASTClassNode*)node)->name, name) == 0) return (ASTClassNode*)node;
+    }
+    return NULL;
+}
+
+static void addClass(InterfaceWriter* writer, ASTClassNode* classNode, ClassLayout* classLayout) {
+    InterfaceClass record;
+    memset(&record, 0, sizeof(record));
+    record.first_attribute = writer->variable_count;
+    for (ASTNode* member = classNode->members; member; member = member->next) {
+        if (member->type != AST_DECLARATION) continue;
+        ASTDeclarationNode* field = (ASTDeclarationNode*)member;
+        addVariable(writer, field, getFieldOffset(writer->layout, classNode->name, field->name));
+    }
+    record.attribute_count = writer->variable_count - record.first_attribute;
+
+    // The methods go in the functions section, before the top-level functions
+    record.first_method = writer->functions.size / sizeof(InterfaceFunction);
+    char irName[512];
+    for (ASTNode* member = classNode->members; member; member = member->next) {
+        if (member->type != AST_FUNCTION) continue;
+        snprintf(irName, sizeof(irName), "%s.%s", classNode->name, ((ASTFunctionNode*)member)->name);
+        addFunction(writer, (ASTFunctionNode*)member, irName);
+    }
+    record.method_count = writer->functions.size / sizeof(InterfaceFunction) - record.first_method;
+
+    record.first_slot = writer->slots.size / sizeof(InterfaceSlot);
+    for (int m = 0; m < classLayout->method_count; m++) {
+        InterfaceSlot* slot = reserve(&writer->slots, sizeof(InterfaceSlot));
+        slot->name = poolString(&writer->pool, classLayout->methods[m].name);
+        slot->owner = poolString(&writer->pool, classLayout->methods[m].owner);
+    }
+    record.slot_count = classLayout->method_count;
+    record.vtable_address = classLayout->vtable_address;
+    record.size = classLayout->size;
+    record.name = poolString(&writer->pool, classNode->name);
+    record.parent = poolString(&writer->pool, classNode->parent);
+    memcpy(reserve(&writer->classes, sizeof(InterfaceClass)), &record, sizeof(record));
+}
+
+static void writeSection(FILE* out, uint64_t* position, uint64_t offset, Buffer* buffer) {
+    for (; *position < offset; (*position)++) fputc(0, out);
+    if (buffer->size > 0) fwrite(buffer->data, 1, buffer->size, out);
+    *position += buffer->size;
+}
+
+int exportInterface(IRProgram* program, const bool* exported, const char* path, CodegenStats* stats) {
+    if (stats) memset(stats, 0, sizeof(CodegenStats));
+    InterfaceWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.program = program;
+    writer.layout = buildProgramLayout(program);
+    writer.stats = stats;
+
+    int method_count = 0;
+    for (int c = 0; c < writer.layout->class_count; c++) {
+        ClassLayout* classLayout = &writer.layout->classes[c];
+        ASTClassNode* classNode = findClassUnit(program, exported, classLayout->name);
+        if (classNode) addClass(&writer, classNode, classLayout);
+    }
+    method_count = writer.functions.size / sizeof(InterfaceFunction);
+    int unit = 0;
+    for (ASTNode* node = program->ast->classes; node; node = node->next) unit++;
+    for (ASTNode* node = program->ast->functions; node; node = node->next, unit++) {
+        if (exported[unit]) addFunction(&writer, (ASTFunctionNode*)node, ((ASTFunctionNode*)node)->name);
+    }
+
+    InterfaceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INTERFACE_MAGIC, 4);
+    header.version = INTERFACE_VERSION;
+    header.compiler = compilerStamp();
+    header.class_count = writer.classes.size / sizeof(InterfaceClass);
+    header.method_count = method_count;
+    header.function_count = writer.functions.size / sizeof(InterfaceFunction) - method_count;
+    header.variable_count = writer.variable_count;
+    header.slot_count = writer.slots.size / sizeof(InterfaceSlot);
+    header.classes_offset = alignOffset(sizeof(header));
+    header.functions_offset = alignOffset(header.classes_offset + writer.classes.size);
+    header.variables_offset = alignOffset(header.functions_offset + writer.functions.size);
+    header.slots_offset = alignOffset(header.variables_offset + writer.variables.size);
+    header.pool_offset = alignOffset(header.slots_offset + writer.slots.size);
+    header.size = header.pool_offset + writer.pool.size;
+
+    int status = 0;
+    FILE* out = writer.failed ? NULL : fopen(path, "wb");
+    if (writer.failed) {
+        fprintf(stderr, "Error during code generation.\n");
+        status = 15;
+    } else if (!out) {
+        perror("Error opening output file");
+        status = 19;
+    } else {
+        uint64_t position = sizeof(header);
+        fwrite(&header, sizeof(header), 1, out);
+        writeSection(out, &position, header.classes_offset, &writer.classes);
+        writeSection(out, &position, header.functions_offset, &writer.functions);
+        writeSection(out, &position, header.variables_offset, &writer.variables);
+        writeSection(out, &position, header.slots_offset, &writer.slots);
+        writeSection(out, &position, header.pool_offset, &writer.pool);
+        if (fclose(out) != 0) {
+            fprintf(stderr, "Error writing the interface.\n");
+            status = 19;
+        }
+    }
+    if (status == 0) {
+        printf("Interface: %d classes and %d functions exported to %s.\n", header.class_count, header.function_count, path);
+    }
+
+    freeProgramLayout(writer.layout);
+    compilerFree(writer.classes.data);
+    compilerFree(writer.functions.data);
+    compilerFree(writer.variables.data);
+    compilerFree(writer.slots.data);
+    compilerFree(writer.pool.data);
+    return status;
+}
+
+//Reading
+
+static const char* getString(ImportedInterface* interface, uint32_t offset) {
+    if (offset == INTERFACE_NONE) return NULL;
+    return (const char*)interface->mapping + interface->header->pool_offset + offset;
+}
+
+static bool validString(InterfaceHeader* header, const char* base, uint32_t offset, bool nullable) {
+    uint64_t pool_size = header->size - header->pool_offset;
+    if (offset == INTERFACE_NONE) return nullable;
+    if (offset >= pool_size) return false;
+    return memchr(base + header->pool_offset + offset, 0, pool_size - offset) != NULL;
+}
+
+static bool validRange(int32_t first, int32_t count, int32_t total) {
+    return first >= 0 && count >= 0 && first <= total && count <= total - first;
+}
+
+static bool validSection(InterfaceHeader* header, uint64_t offset, int32_t count, size_t record) {
+    return count >= 0 && offset % INTERFACE_ALIGNMENT == 0 && offset <= header->pool_offset &&
+           (uint64_t)count <= (header->pool_offset - offset) / record;
+}
+
+// Every offset, index and string of the file stays inside it
+static const char* checkInterface(InterfaceHeader* header, const char* base, size_t size) {
+    if (memcmp(header->magic, INTERFACE_MAGIC, 4) != 0) return "not an interface file";
+    if (header->version != INTERFACE_VERSION) return "unsupported version";
+    if (header->compiler != compilerStamp()) return "written by another build of vypcomp";
+    if (header->size != size || header->pool_offset > size || header->pool_offset < sizeof(InterfaceHeader)) {
+        return "truncated file";
+    }
+    int32_t function_total = header->method_count + header->function_count;
+    if (header->method_count < 0 || header->function_count < 0 ||
+        !validSection(header, header->classes_offset, header->class_count, sizeof(InterfaceClass)) ||
+        !validSection(header, header->functions_offset, function_total, sizeof(InterfaceFunction)) ||
+        !validSection(header, header->variables_offset, header->variable_count, sizeof(InterfaceVariable)) ||
+        !validSection(header, header->slots_offset, header->slot_count, sizeof(InterfaceSlot))) {
+        return "section out of the file";
+    }
+
+    InterfaceClass* classes = (InterfaceClass*)(base + header->classes_offset);
+    for (int c = 0; c < header->class_count; c++) {
+        InterfaceClass* current = &classes[c];
+        if (!validString(header, base, current->name, false) || !validString(header, base, current->parent, true) ||
+            !validRange(current->first_attribute, current->attribute_count, header->variable_count) ||
+            !validRange(current->first_method, current->method_count, header->method_count) ||
+            !validRange(current->first_slot, current->slot_count, header->slot_count)) {
+            return "invalid class";
+        }
+    }
+    InterfaceFunction* functions = (InterfaceFunction*)(base + header->functions_offset);
+    for (int f = 0; f < function_total; f++) {
+        InterfaceFunction* current = &functions[f];
+        if (!validString(header, base, current->name, false) || !validString(header, base, current->return_type, false) ||
+            current->code >= INTERFACE_NONE || !validString(header, base, (uint32_t)current->code, false) ||
+            !validRange(current->first_parameter, current->parameter_count, header->variable_count)) {
+            return "invalid function";
+        }
+    }
+    InterfaceVariable* variables = (InterfaceVariable*)(base + header->variables_offset);
+    for (int v = 0; v < header->variable_count; v++) {
+        if (!validString(header, base, variables[v].type, false) || !validString(header, base, variables[v].name, false)) {
+            return "invalid variable";
+        }
+    }
+    InterfaceSlot* slots = (InterfaceSlot*)(base + header->slots_offset);
+    for (int s = 0; s < header->slot_count; s++) {
+        if (!validString(header, base, slots[s].name, false) || !validString(header, base, slots[s].owner, false)) {
+            return "invalid vtable slot";
+        }
+    }
+    return NULL;
+}
+
+static InterfaceClass* getClasses(ImportedInterface* interface) {
+    return (InterfaceClass*)((char*)interface->mapping + interface->header->classes_offset);
+}
+
+static InterfaceFunction* getFunctions(ImportedInterface* interface) {
+    return (InterfaceFunction*)((char*)interface->mapping + interface->header->functions_offset);
+}
+
+static InterfaceVariable* getVariables(ImportedInterface* interface) {
+    return (InterfaceVariable*)((char*)interface->mapping + interface->header->variables_offset);
+}
+
+static InterfaceSlot* getSlots(ImportedInterface* interface) {
+    return (InterfaceSlot*)((char*)interface->mapping + interface->header->slots_offset);
+}
+
+static ASTNode* appendSignature(ASTNode* list, ASTNode** last, ASTNode* node) {
+    if (*last) (*last)->next = node;
+    *last = node;
+    return list ? list : node;
+}
+
+// Signature node of a function and its symbols, added like the parser does it: the function
+// (methods too) when the name is free, then the parameters whose names are free
+static ASTFunctionNode* loadFunction(ImportedInterface* interface, InterfaceFunction* record, SymbolTable* symbolTable) {
+    ASTNode* parameters = NULL;
+    ASTNode* last = NULL;
+    InterfaceVariable* variables = getVariables(interface);
+    for (int p = 0; p < record->parameter_count; p++) {
+        InterfaceVariable* parameter = &variables[record->first_parameter + p];
+        ASTNode* declaration = (ASTNode*)createDeclarationNode(getString(interface, parameter->type),
+                                                               getString(interface, parameter->name), NULL);
+        parameters = appendSignature(parameters, &last, declaration);
+    }
+    ASTFunctionNode* function = createFunctionNode(getString(interface, record->name),
+                                                   getString(interface, record->return_type), parameters, NULL);
+    if (find_symbol(symbolTable, function->name) == -1) {
+        add_symbol(symbolTable, function->name, function->returnType, true, false, false,
+                   extractParameterTypes(parameters), function->param_count, NULL, NULL, 0, NULL, 0);
+    }
+    for (ASTNode* parameter = parameters; parameter; parameter = parameter->next) {
+        ASTDeclarationNode* declaration = (ASTDeclarationNode*)parameter;
+        if (find_symbol(symbolTable, declaration->name) == -1) {
+            add_symbol(symbolTable, declaration->name, declaration->type, false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);
+        }
+    }
+    return function;
+}
+
+// Build the signatures of the interface and add its symbols; false when a name is taken
+static bool loadInterface(ImportedInterface* interface, SymbolTable* symbolTable) {
+    InterfaceHeader* header = interface->header;
+    InterfaceClass* classes = getClasses(interface);
+    InterfaceFunction* functions = getFunctions(interface);
+    InterfaceVariable* variables = getVariables(interface);
+    ASTNode* lastClass = NULL;
+    ASTNode* lastFunction = NULL;
+
+    for (int c = 0; c < header->class_count; c++) {
+        InterfaceClass* record = &classes[c];
+        ASTNode* members = NULL;
+        ASTNode* last = NULL;
+        for (int a = 0; a < record->attribute_count; a++) {
+            InterfaceVariable* attribute = &variables[record->first_attribute + a];
+            ASTNode* declaration = (ASTNode*)createDeclarationNode(getString(interface, attribute->type),
+                                                                   getString(interface, attribute->name), NULL);
+            members = appendSignature(members, &last, declaration);
+        }
+        for (int m = 0; m < record->method_count; m++) {
+            ASTFunctionNode* method = loadFunction(interface, &functions[record->first_method + m], symbolTable);
+            members = appendSignature(members, &last, (ASTNode*)method);
+        }
+        ASTClassNode* classNode = createClassNode(getString(interface, record->name), getString(interface, record->parent), members);
+        interface->classes = appendSignature(interface->classes, &lastClass, (ASTNode*)classNode);
+        if (find_symbol(symbolTable, classNode->name) != -1) {
+            fprintf(stderr, "Error: class '%s' of %s is already declared.\n", classNode->name, interface->path);
+            return false;
+        }
+        add_symbol(symbolTable, classNode->name, "class", false, true, false, NULL, 0, classNode->parent,
+                   extractAttributesFromClassBody(members), countAttributes(members),
+                   extractMethodsFromClassBody(members), countMethods(members));
+    }
+
+    for (int f = 0; f < header->function_count; f++) {
+        InterfaceFunction* record = &functions[header->method_count + f];
+        if (find_symbol(symbolTable, getString(interface, record->name)) != -1) {
+            fprintf(stderr, "Error: function '%s' of %s is already declared.\n", getString(interface, record->name), interface->path);
+            return false;
+        }
+        ASTFunctionNode* function = loadFunction(interface, record, symbolTable);
+        interface->functions = appendSignature(interface->functions, &lastFunction, (ASTNode*)function);
+    }
+    return true;
+}
+
+ImportedInterface* importInterface(ImportedInterface** list, const char* path, SymbolTable* symbolTable, int* status) {
+    *status = 19;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening interface");
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (uint64_t)info.st_size < sizeof(InterfaceHeader)) {
+        close(fd);
+        fprintf(stderr, "Error: %s is not an interface file.\n", path);
+        return NULL;
+    }
+    void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Error mapping interface");
+        return NULL;
+    }
+    const char* problem = checkInterface(mapping, mapping, info.st_size);
+    if (problem) {
+        fprintf(stderr, "Error: interface %s: %s.\n", path, problem);
+        munmap(mapping, info.st_size);
+        return NULL;
+    }
+
+    ImportedInterface* interface = checkedCalloc(1, sizeof(ImportedInterface), ALLOC_MODULES);
+    interface->path = compilerStrdup(path, ALLOC_MODULES);
+    interface->mapping = mapping;
+    interface->mapping_size = info.st_size;
+    interface->header = mapping;
+    ImportedInterface** link = list;
+    while (*link) link = &(*link)->next;
+    *link = interface;
+    if (!loadInterface(interface, symbolTable)) {
+        *status = 13;
+        return NULL;
+    }
+    printf("Interface %s: %d classes and %d functions imported.\n", path,
+           interface->header->class_count, interface->header->function_count);
+    *status = 0;
+    return interface;
+}
+
+//Program
+
+static int countList(ASTNode* list) {
+    int count = 0;
+    for (; list; list = list->next) count++;
+    return count;
+}
+
+static ASTNode* prependList(ASTNode* list, ASTNode* rest) {
+    if (!list) return rest;
+    ASTNode* last = list;
+    while (last->next) last = last->next;
+    last->next = rest;
+    return list;
+}
+
+bool* addImportedUnits(ImportedInterface* list, ASTProgramNode* program) {
+    ASTNode* classes = NULL;
+    ASTNode* functions = NULL;
+    for (ImportedInterface* interface = list; interface; interface = interface->next) {
+        classes = prependList(classes, interface->classes);
+        functions = prependList(functions, interface->functions);
+        interface->classes = NULL;
+        interface->functions = NULL;
+    }
+    int importedClasses = countList(classes);
+    int importedFunctions = countList(functions);
+    program->classes = prependList(classes, program->classes);
+    program->functions = prependList(functions, program->functions);
+
+    int classCount = countList(program->classes);
+    int total = classCount + countList(program->functions);
+    bool* own = checkedCalloc(total, sizeof(bool), ALLOC_MODULES);
+    for (int u = 0; u < total; u++) {
+        own[u] = u < classCount ? u >= importedClasses : u - classCount >= importedFunctions;
+    }
+    return own;
+}
+
+bool checkImportedLayout(ImportedInterface* list, ProgramLayout* layout) {
+    for (ImportedInterface* interface = list; interface; interface = interface->next) {
+        InterfaceClass* classes = getClasses(interface);
+        InterfaceVariable* variables = getVariables(interface);
+        InterfaceSlot* slots = getSlots(interface);
+        for (int c = 0; c < interface->header->class_count; c++) {
+            InterfaceClass* record = &classes[c];
+            const char* name = getString(interface, record->name);
+            ClassLayout* current = findClassLayout(layout, name);
+            bool same = current && current->vtable_address == record->vtable_address &&
+                        current->size == record->size && current->method_count == record->slot_count;
+            for (int a = 0; same && a < record->attribute_count; a++) {
+                InterfaceVariable* attribute = &variables[record->first_attribute + a];
+                same = getFieldOffset(layout, name, getString(interface, attribute->name)) == attribute->offset;
+            }
+            for (int s = 0; same && s < record->slot_count; s++) {
+                InterfaceSlot* slot = &slots[record->first_slot + s];
+                same = strcmp(current->methods[s].name, getString(interface, slot->name)) == 0 &&
+                       strcmp(current->methods[s].owner, getString(interface, slot->owner)) == 0;
+            }
+            if (!same) {
+                fprintf(stderr, "Error: class '%s' of %s does not have the layout it was compiled with "
+                        "(import the interfaces in the order they were built).\n", name, interface->path);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static VCProgram* readFunctionCode(ImportedInterface* interface, InterfaceFunction* record) {
+    const char* text = getString(interface, (uint32_t)record->code);
+    FILE* in = fmemopen((void*)text, strlen(text), "r");
+    if (!in) return NULL;
+    VCProgram* code = readVYPcode(in);
+    fclose(in);
+    return code;
+}
+
+VCProgram* linkImportedVYPcode(ImportedInterface* list, IRProgram* program, CodegenStats* stats) {
+    if (stats) memset(stats, 0, sizeof(CodegenStats));
+    int capacity = 0;
+    for (ImportedInterface* interface = list; interface; interface = interface->next) {
+        capacity += interface->header->method_count + interface->header->function_count;
+    }
+    for (IRFunction* function = program->functions; function; function = function->next) capacity++;
+    VCProgram** pieces = checkedCalloc(capacity, sizeof(VCProgram*), ALLOC_MODULES);
+    int count = 0;
+    bool failed = false;
+
+    for (ImportedInterface* interface = list; interface && !failed; interface = interface->next) {
+        InterfaceFunction* functions = getFunctions(interface);
+        int total = interface->header->method_count + interface->header->function_count;
+        for (int f = 0; f < total && !failed; f++) {
+            pieces[count] = readFunctionCode(interface, &functions[f]);
+            if (!pieces[count]) {
+                fprintf(stderr, "Error: interface %s: invalid code for '%s'.\n", interface->path,
+                        getString(interface, functions[f].name));
+                failed = true;
+            } else {
+                count++;
+            }
+        }
+    }
+    for (IRFunction* function = program->functions; function && !failed; function = function->next) {
+        pieces[count] = generateFunctionVYPcode(program, function, stats);
+        if (pieces[count]) count++;
+        else failed = true;
+    }
+
+    VCProgram* code = failed ? NULL : linkVYPcode(program, pieces, count);
+    for (int p = 0; p < count; p++) freeVCProgram(pieces[p]);
+    compilerFree(pieces);
+    return code;
+}
+
+void freeImportedInterfaces(ImportedInterface* list) {
+    while (list) {
+        ImportedInterface* next = list->next;
+        freeAST(list->classes);
+        freeAST(list->functions);
+        munmap(list->mapping, list->mapping_size);
+        compilerFree(list->path);
+        compilerFree(list);
+        list = next;
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef INTERFACE_H
+#define INTERFACE_H
+
+#include "ast.h"
+#include "symbol_table.h"
+#include "ir.h"
+#include "layout.h"
+#include "codegen.h"
+#include <stdint.h>
+
+#define INTERFACE_MAGIC "VYPI"
+#define INTERFACE_VERSION 1
+#define INTERFACE_NONE UINT32_MAX      // Null string (a class without parent)
+#define INTERFACE_MAX_IMPORTS 16
+
+// Binary interface of a module, written by vypcomp --export and mapped by --import. It holds
+// what the programs that use the module see of it, and the code of its functions:
+//
+//   header | classes (InterfaceClass) | functions and methods (InterfaceFunction) |
+//   parameters and attributes (InterfaceVariable) | vtable slots (InterfaceSlot) | pool
+//
+// The strings are offsets in the pool (NUL terminated), the code of every function is VYPcode
+// text in the pool, before the peephole optimizer. The classes are in the order of their layout,
+// so a program that imports the module first gives them the same vtable words.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t compiler;                 // Build of vypcomp that wrote it, the code is only valid for it
+    int32_t class_count;
+    int32_t function_count;            // Top-level functions, after the methods
+    int32_t method_count;
+    int32_t variable_count;
+    int32_t slot_count;
+    int32_t reserved;
+    uint64_t classes_offset;
+    uint64_t functions_offset;
+    uint64_t variables_offset;
+    uint64_t slots_offset;
+    uint64_t pool_offset;
+    uint64_t size;                     // Bytes of the whole file
+} InterfaceHeader;
+
+typedef struct {
+    uint32_t name;
+    uint32_t parent;
+    int32_t first_attribute;           // Attributes declared by the class, in its order
+    int32_t attribute_count;
+    int32_t first_method;              // Methods declared by the class, in its order
+    int32_t method_count;
+    int32_t vtable_address;            // Layout the code was generated for
+    int32_t size;
+    int32_t first_slot;
+    int32_t slot_count;
+} InterfaceClass;
+
+typedef struct {
+    uint32_t name;
+    uint32_t return_type;
+    int32_t first_parameter;
+    int32_t parameter_count;
+    uint64_t code;                     // Offset of the VYPcode in the pool
+} InterfaceFunction;
+
+typedef struct {
+    uint32_t type;
+    uint32_t name;
+    int32_t offset;                    // Word of an attribute in the object chunk, -1 for parameters
+    int32_t reserved;
+} InterfaceVariable;
+
+typedef struct {
+    uint32_t name;
+    uint32_t owner;
+} InterfaceSlot;
+
+// Interface mapped by an importing compilation
+typedef struct ImportedInterface {
+    char* path;
+    void* mapping;
+    size_t mapping_size;
+    InterfaceHeader* header;
+    ASTNode* classes;              // Signatures built from the interface, until they join the program
+    ASTNode* functions;
+    struct ImportedInterface* next;
+} ImportedInterface;
+
+// Write the interface of the units marked in exported (classes first, then functions, like
+// buildIR counts them) of a program lowered with buildLibraryIR; returns the exit status
+int exportInterface(IRProgram* program, const bool* exported, const char* path, CodegenStats* stats);
+
+// Map an interface and add its classes and functions to the symbol table, before the program
+// that uses it is parsed. Null with the exit status when the file is not valid or its names are
+// already declared. The list keeps the interfaces in the order of the command line.
+ImportedInterface* importInterface(ImportedInterface** list, const char* path, SymbolTable* symbolTable, int* status);
+
+// Put the signatures of the interfaces before the classes and functions of the parsed program.
+// Returns the units of the program itself (true) for buildIR and exportInterface, the imported
+// ones are false.
+bool* addImportedUnits(ImportedInterface* list, ASTProgramNode* program);
+
+// Whether the imported classes got the layout their code was generated for
+bool checkImportedLayout(ImportedInterface* list, ProgramLayout* layout);
+
+// Code of the whole program: the functions of the interfaces and then the lowered ones
+VCProgram* linkImportedVYPcode(ImportedInterface* list, IRProgram* program, CodegenStats* stats);
+
+void freeImportedInterfaces(ImportedInterface* list);
+
+#endif // INTERFACE_H
@@ -0,0 +1,912 @@
+#include "interp.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <sys/mman.h>
+
+// The engine uses direct threading: every pre-decoded instruction holds the address of its code
+// in the engine (GCC labels as values) and each handler jumps straight to the next one.
+
+#define VM_PROFILE_RECEIVERS 8         // Targets of a call site the profile keeps
+
+// Targets reached from one call through a string
+typedef struct {
+    int targets[VM_PROFILE_RECEIVERS];
+    long long calls[VM_PROFILE_RECEIVERS];
+    int count;
+} VMReceivers;
+
+typedef struct {
+    VMCode* code;
+    int64_t* regs;                     // General purpose registers, then $SP and the zero register
+    int64_t* stack;
+    long stack_size;
+    VMHeap heap;
+    VMStats* stats;
+    jmp_buf failure;                   // Runtime errors leave the engine through here
+    int status;
+    long long* counts;                 // Profiling: executions of every instruction
+    long long* taken;                  // Profiling: jumps done by every conditional branch
+    VMReceivers* receivers;            // Profiling: one per inline cache
+} VM;
+
+void initVMOptions(VMOptions* options) {
+    options->registers = VM_DEFAULT_REGISTERS;
+    options->stack_size = VM_DEFAULT_STACK;
+    options->verbose = false;
+    options->fuse = true;
+    options->nursery_size = HEAP_DEFAULT_NURSERY;
+    options->heap_limit = 0;
+    options->profile = NULL;
+}
+
+//Strings
+
+// Number of bytes of the UTF-8 sequence at text; an invalid byte is taken as its own code point
+static int decodeUTF8(const unsigned char* text, size_t length, int64_t* codepoint) {
+    int extra = text[0] >= 0xF0 ? 3 : text[0] >= 0xE0 ? 2 : text[0] >= 0xC0 ? 1 : 0;
+    if (text[0] < 0x80 || (size_t)extra >= length) {
+        *codepoint = text[0];
+        return 1;
+    }
+    int64_t value = text[0] & (0x3F >> extra);
+    for (int i = 1; i <= extra; i++) {
+        if ((text[i] & 0xC0) != 0x80) {
+            *codepoint = text[0];
+            return 1;
+        }
+        value = (value << 6) | (text[i] & 0x3F);
+    }
+    *codepoint = value;
+    return extra + 1;
+}
+
+static void writeUTF8(int64_t codepoint, FILE* out) {
+    if (codepoint < 0x80) {
+        fputc((int)codepoint, out);
+    } else if (codepoint < 0x800) {
+        fputc(0xC0 | (int)(codepoint >> 6), out);
+        fputc(0x80 | (int)(codepoint & 0x3F), out);
+    } else if (codepoint < 0x10000) {
+        fputc(0xE0 | (int)(codepoint >> 12), out);
+        fputc(0x80 | (int)((codepoint >> 6) & 0x3F), out);
+        fputc(0x80 | (int)(codepoint & 0x3F), out);
+    } else {
+        fputc(0xF0 | (int)((codepoint >> 18) & 0x07), out);
+        fputc(0x80 | (int)((codepoint >> 12) & 0x3F), out);
+        fputc(0x80 | (int)((codepoint >> 6) & 0x3F), out);
+        fputc(0x80 | (int)(codepoint & 0x3F), out);
+    }
+}
+
+// The literal keeps its escapes in the stream: \n, \t, \\, \" and \xhhhhhh
+static bool unescapeString(const char* text, VMString* string) {
+    size_t length = strlen(text);
+    string->codes = checkedCalloc(length, sizeof(int64_t), ALLOC_VM);
+    string->length = 0;
+    for (size_t i = 0; i < length; ) {
+        int64_t codepoint;
+        if (text[i] != '\\') {
+            i += decodeUTF8((const unsigned char*)text + i, length - i, &codepoint);
+        } else if (text[i + 1] == 'n' || text[i + 1] == 't' || text[i + 1] == '\\' || text[i + 1] == '"') {
+            codepoint = text[i + 1] == 'n' ? '\n' : text[i + 1] == 't' ? '\t' : text[i + 1];
+            i += 2;
+        } else if (text[i + 1] == 'x') {
+            codepoint = 0;
+            for (int digit = 0; digit < 6; digit++) {
+                char c = text[i + 2 + digit];
+                int value = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                            c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+                if (value < 0) return false;
+                codepoint = codepoint * 16 + value;
+            }
+            i += 8;
+        } else {
+            return false;
+        }
+        string->codes[string->length++] = codepoint;
+    }
+    return true;
+}
+
+//Decoding
+
+// How each instruction uses its operands: w = written, r = read, l = label, c = label or read
+static const char* const operandForms[VC_OPCODE_COUNT] = {
+    [VC_CREATE] = "wr", [VC_COPY] = "wr", [VC_GETSIZE] = "wr", [VC_GETWORD] = "wrr",
+    [VC_RESIZE] = "rr", [VC_SETWORD] = "rrr", [VC_DESTROY] = "r", [VC_CALL] = "wc",
+    [VC_RETURN] = "r", [VC_SET] = "wr", [VC_JUMP] = "l", [VC_JUMPZ] = "lr", [VC_JUMPNZ] = "lr",
+    [VC_READS] = "w", [VC_WRITES] = "r", [VC_READI] = "w", [VC_WRITEI] = "r",
+    [VC_ADDI] = "wrr", [VC_SUBI] = "wrr", [VC_MULI] = "wrr", [VC_DIVI] = "wrr",
+    [VC_LTI] = "wrr", [VC_GTI] = "wrr", [VC_EQI] = "wrr", [VC_LTS] = "wrr", [VC_GTS] = "wrr",
+    [VC_EQS] = "wrr", [VC_AND] = "wrr", [VC_OR] = "wrr", [VC_NOT] = "wr", [VC_INT2STRING] = "wr",
+};
+
+static int compareLabels(const void* a, const void* b) {
+    return strcmp(((const VMLabel*)a)->name, ((const VMLabel*)b)->name);
+}
+
+static VMLabel* findLabel(VMCode* code, const char* name) {
+    VMLabel key = {(char*)name, 0};
+    return bsearch(&key, code->labels, code->label_count, sizeof(VMLabel), compareLabels);
+}
+
+static int decodeRegister(int reg, VMOptions* options) {
+    if (reg == VC_REG_SP) return options->registers;
+    if (reg == VC_REG_NONE) return options->registers + 1;
+    return reg >= 0 && reg < options->registers ? reg : -1;
+}
+
+static int decodeOperand(VMCode* code, VCInstr* instr, int o, VMOptions* options, VMOperand* operand) {
+    VCOperand* source = &instr->operands[o];
+    char form = operandForms[instr->op][o];
+    operand->kind = VM_OPERAND_NONE;
+    operand->reg = 0;
+    operand->value = 0;
+    if (source->kind == VC_LABEL_REF) {
+        if (form != 'l' && form != 'c') return VM_ERROR_SYNTAX;
+        VMLabel* label = findLabel(code, source->text);
+        if (!label) {
+            fprintf(stderr, "Error: label '%s' is not defined.\n", source->text);
+            return VM_ERROR_SEMANTIC;
+        }
+        operand->kind = VM_OPERAND_LABEL;
+        operand->value = label->target;
+        return VM_OK;
+    }
+    if (form == 'l') return VM_ERROR_SYNTAX;
+    switch (source->kind) {
+        case VC_REG:
+        case VC_STACK:
+            operand->kind = source->kind == VC_REG ? VM_OPERAND_REG : VM_OPERAND_STACK;
+            operand->reg = decodeRegister(source->reg, options);
+            operand->value = source->kind == VC_STACK ? source->value : 0;
+            if (operand->reg < 0) {
+                fprintf(stderr, "Error: register $%d does not exist.\n", source->reg);
+                return VM_ERROR_SEMANTIC;
+            }
+            return VM_OK;
+        case VC_IMM:
+        case VC_STR:
+            if (form == 'w') return VM_ERROR_SYNTAX;
+            operand->kind = source->kind == VC_IMM ? VM_OPERAND_IMM : VM_OPERAND_STR;
+            operand->value = source->value;
+            if (source->kind == VC_STR) {
+                operand->value = code->string_count;
+                if (!unescapeString(source->text, &code->strings[code->string_count++])) {
+                    fprintf(stderr, "Error: invalid escape sequence in \"%s\".\n", source->text);
+                    return VM_ERROR_SYNTAX;
+                }
+            }
+            return VM_OK;
+        default:
+            return VM_ERROR_SYNTAX;
+    }
+}
+
+VMCode* decodeVYPcode(VCProgram* program, VMOptions* options, int* status) {
+    VMCode* code = checkedCalloc(1, sizeof(VMCode), ALLOC_VM);
+    code->source = program;
+    code->labels = checkedCalloc(program->count, sizeof(VMLabel), ALLOC_VM);
+    code->code = checkedCalloc(program->count + 1, sizeof(VMInstr), ALLOC_VM);
+    *status = VM_OK;
+
+    // A label is the index of the instruction that follows it
+    int strings = 0;
+    int caches = 0;
+    for (int i = 0; i < program->count; i++) {
+        VCInstr* instr = &program->code[i];
+        if (instr->op == VC_CALL && instr->operands[1].kind != VC_LABEL_REF) caches++;
+        if (instr->op == VC_LABEL) {
+            code->labels[code->label_count].name = checkedStrdup(instr->operands[0].text, ALLOC_VM);
+            code->labels[code->label_count++].target = code->count;
+        } else {
+            code->count++;
+        }
+        for (int o = 0; o < instr->operand_count; o++) {
+            if (instr->operands[o].kind == VC_STR) strings++;
+        }
+    }
+    qsort(code->labels, code->label_count, sizeof(VMLabel), compareLabels);
+    for (int l = 1; l < code->label_count; l++) {
+        if (strcmp(code->labels[l - 1].name, code->labels[l].name) == 0) {
+            fprintf(stderr, "Error: label '%s' is defined twice.\n", code->labels[l].name);
+            *status = VM_ERROR_SEMANTIC;
+        }
+    }
+    code->strings = checkedCalloc(strings, sizeof(VMString), ALLOC_VM);
+    code->caches = checkedCalloc(caches, sizeof(VMCallCache), ALLOC_VM);
+
+    int count = 0;
+    for (int i = 0; i < program->count && *status == VM_OK; i++) {
+        VCInstr* instr = &program->code[i];
+        if (instr->op == VC_LABEL) continue;
+        VMInstr* decoded = &code->code[count++];
+        decoded->op = instr->op;
+        decoded->source = i;
+        for (int o = 0; o < instr->operand_count && *status == VM_OK; o++) {
+            *status = decodeOperand(code, instr, o, options, &decoded->operands[o]);
+            if (*status == VM_ERROR_SYNTAX) {
+                fprintf(stderr, "Error: invalid operand %d of %s.\n", o + 1, getVCOpcodeName(instr->op));
+            }
+        }
+        if (*status == VM_OK && instr->op == VC_CALL && decoded->operands[1].kind != VM_OPERAND_LABEL) {
+            decoded->operands[2].kind = VM_OPERAND_CACHE;
+            decoded->operands[2].value = code->cache_count++;
+        }
+    }
+    code->code[code->count].op = VM_HALT;
+    code->code[code->count].source = -1;
+
+    if (*status != VM_OK) {
+        freeVMCode(code);
+        return NULL;
+    }
+    return code;
+}
+
+// Operands of an instruction that was not decoded here (a mapped bytecode container): the engine
+// trusts them, so the registers, targets, strings and caches must be in range
+bool checkVMInstr(VMCode* code, VMInstr* instr, int registers) {
+    if (instr->op == VM_HALT) return instr == &code->code[code->count];
+    if (instr->op <= VC_LABEL || instr->op >= VC_OPCODE_COUNT) return false;
+    int count = getVCOperandCount(instr->op);
+    for (int o = 0; o < 3; o++) {
+        VMOperand* operand = &instr->operands[o];
+        char form = o < count ? operandForms[instr->op][o] : 0;
+        switch (operand->kind) {
+            case VM_OPERAND_NONE: if (form) return false; break;
+            case VM_OPERAND_REG:
+            case VM_OPERAND_STACK:
+                if (!form || form == 'l' || operand->reg < 0 || operand->reg > registers + 1) return false;
+                break;
+            case VM_OPERAND_IMM:
+            case VM_OPERAND_STR:
+                if (form != 'r' && form != 'c') return false;
+                if (operand->kind == VM_OPERAND_STR && (operand->value < 0 || operand->value >= code->string_count)) return false;
+                break;
+            case VM_OPERAND_LABEL:
+                if ((form != 'l' && form != 'c') || operand->value < 0 || operand->value > code->count) return false;
+                break;
+            case VM_OPERAND_CACHE:
+                if (instr->op != VC_CALL || o != 2 || instr->operands[1].kind == VM_OPERAND_LABEL ||
+                    operand->value < 0 || operand->value >= code->cache_count) return false;
+                break;
+            default: return false;
+        }
+    }
+    // A call through a value needs its cache
+    return instr->op != VC_CALL || instr->operands[1].kind == VM_OPERAND_LABEL || instr->operands[2].kind == VM_OPERAND_CACHE;
+}
+
+void freeVMCode(VMCode* code) {
+    if (!code) return;
+    if (code->mapping) {
+        // The instructions, labels and strings are in the mapped container
+        free(code->caches);
+        munmap(code->mapping, code->mapping_size);
+        free(code);
+        return;
+    }
+    for (int l = 0; l < code->label_count; l++) free(code->labels[l].name);
+    for (int s = 0; s < code->string_count; s++) free(code->strings[s].codes);
+    free(code->labels);
+    free(code->strings);
+    free(code->caches);
+    free(code->code);
+    free(code);
+}
+
+//Memory
+
+static void fail(VM* vm, int status, const char* message, long long value) {
+    fflush(stdout);
+    fprintf(stderr, "Error: ");
+    fprintf(stderr, message, value);
+    fprintf(stderr, "\n");
+    vm->status = status;
+    longjmp(vm->failure, 1);
+}
+
+static inline int64_t* stackWord(VM* vm, const VMOperand* operand) {
+    int64_t address = vm->regs[operand->reg] + operand->value;
+    if (address < 0 || address >= vm->stack_size) fail(vm, VM_ERROR_MEMORY, "stack address %lld out of range.", address);
+    return &vm->stack[address];
+}
+
+// A leaf chunk only gets characters; the collector looks for ids in the other ones. Creating a
+// chunk can collect, so chunk pointers taken before are not valid after it.
+static int64_t createChunk(VM* vm, int64_t size, bool leaf) {
+    if (size < 0) fail(vm, VM_ERROR_MEMORY, "chunk of size %lld.", size);
+    int64_t id = allocateChunk(&vm->heap, size, leaf);
+    if (!id) fail(vm, VM_ERROR_INTERNAL, "heap limit of %lld words exceeded.", vm->heap.limit);
+    vm->stats->chunks++;
+    return id;
+}
+
+static inline VMChunk* getChunk(VM* vm, int64_t id) {
+    VMChunk* chunk = findChunk(&vm->heap, id);
+    if (!chunk) fail(vm, VM_ERROR_MEMORY, "invalid chunk %lld.", id);
+    return chunk;
+}
+
+static inline int64_t* chunkWord(VM* vm, int64_t id, int64_t index) {
+    VMChunk* chunk = getChunk(vm, id);
+    if (index < 0 || index >= chunk->size) fail(vm, VM_ERROR_MEMORY, "index %lld out of the chunk.", index);
+    return &chunk->items[index];
+}
+
+static int64_t createString(VM* vm, const int64_t* codes, int64_t length) {
+    int64_t id = createChunk(vm, length, true);
+    memcpy(vm->heap.chunks[id].items, codes, length * sizeof(int64_t));
+    return id;
+}
+
+// Every evaluation of a string literal creates its chunk, the program owns it afterwards
+static inline int64_t load(VM* vm, const VMOperand* operand) {
+    switch (operand->kind) {
+        case VM_OPERAND_REG: return vm->regs[operand->reg];
+        case VM_OPERAND_STACK: return *stackWord(vm, operand);
+        case VM_OPERAND_STR: {
+            VMString* string = &vm->code->strings[operand->value];
+            return createString(vm, string->codes, string->length);
+        }
+        default: return operand->value;
+    }
+}
+
+// The collector scans the stack up to the highest word ever written: the arguments of a call
+// are written above $SP before it moves
+static inline void store(VM* vm, const VMOperand* operand, int64_t value) {
+    if (operand->kind == VM_OPERAND_REG) {
+        vm->regs[operand->reg] = value;
+    } else {
+        int64_t* word = stackWord(vm, operand);
+        *word = value;
+        if (word - vm->stack >= vm->heap.stack_used) vm->heap.stack_used = word - vm->stack + 1;
+    }
+}
+
+static int compareStrings(VM* vm, int64_t a, int64_t b) {
+    VMChunk* first = getChunk(vm, a);
+    VMChunk* second = getChunk(vm, b);
+    for (int64_t i = 0; i < first->size && i < second->size; i++) {
+        if (first->items[i] != second->items[i]) return first->items[i] < second->items[i] ? -1 : 1;
+    }
+    return first->size < second->size ? -1 : first->size > second->size;
+}
+
+//Input and output
+
+// Whole line of stdin without the end of line
+static unsigned char* readLine(size_t* length) {
+    size_t capacity = 64;
+    unsigned char* line = checkedCalloc(capacity, 1, ALLOC_VM);
+    int c;
+    fflush(stdout);
+    *length = 0;
+    while ((c = getchar()) != EOF && c != '\n') {
+        if (*length + 1 == capacity) {
+            capacity *= 2;
+            line = checkedRealloc(line, capacity, ALLOC_VM);
+        }
+        line[(*length)++] = (unsigned char)c;
+    }
+    if (*length > 0 && line[*length - 1] == '\r') (*length)--;
+    line[*length] = '\0';
+    return line;
+}
+
+static int64_t readString(VM* vm) {
+    size_t length;
+    unsigned char* line = readLine(&length);
+    int64_t id = createChunk(vm, length, true);
+    VMChunk* chunk = &vm->heap.chunks[id];
+    chunk->size = 0;
+    for (size_t i = 0; i < length; ) i += decodeUTF8(line + i, length - i, &chunk->items[chunk->size++]);
+    free(line);
+    return id;
+}
+
+// The first value of the line, the rest of it is read away
+static int64_t readInteger() {
+    size_t length;
+    unsigned char* line = readLine(&length);
+    int64_t value = strtoll((char*)line, NULL, 0);
+    free(line);
+    return value;
+}
+
+static void writeString(VM* vm, int64_t id) {
+    VMChunk* chunk = getChunk(vm, id);
+    for (int64_t i = 0; i < chunk->size; i++) writeUTF8(chunk->items[i], stdout);
+}
+
+// Label named by a string chunk, for the calls through a string
+static int findDynamicTarget(VM* vm, int64_t id) {
+    VMChunk* chunk = getChunk(vm, id);
+    char* name = checkedCalloc(chunk->size + 1, 1, ALLOC_VM);
+    for (int64_t i = 0; i < chunk->size; i++) {
+        name[i] = chunk->items[i] > 0 && chunk->items[i] < 0x7F ? (char)chunk->items[i] : '?';
+    }
+    VMLabel* label = findLabel(vm->code, name);
+    free(name);
+    if (!label) fail(vm, VM_ERROR_LABEL, "chunk %lld does not hold a label.", id);
+    chunk->label = true;
+    return label->target;
+}
+
+// Monomorphic while the site sees one label, polymorphic up to VM_CACHE_ENTRIES of them, then
+// megamorphic: the labels that do not fit are looked up on every call
+static int findCachedTarget(VM* vm, VMCallCache* cache, int64_t id) {
+    if (cache->epoch != vm->heap.label_epoch) {
+        cache->count = 0;
+        cache->megamorphic = false;
+        cache->epoch = vm->heap.label_epoch;
+    }
+    for (int e = 0; e < cache->count; e++) {
+        if (cache->keys[e] == id) {
+            vm->stats->cache_hits++;
+            return cache->targets[e];
+        }
+    }
+    vm->stats->cache_misses++;
+    int target = findDynamicTarget(vm, id);
+    if (cache->count < VM_CACHE_ENTRIES) {
+        cache->keys[cache->count] = id;
+        cache->targets[cache->count++] = target;
+    } else {
+        cache->megamorphic = true;
+    }
+    return target;
+}
+
+// Writing into a string that was a call target invalidates every inline cache
+static inline void touchChunk(VM* vm, VMChunk* chunk) {
+    if (chunk->label) {
+        chunk->label = false;
+        vm->heap.label_epoch++;
+    }
+}
+
+// Operand of an instruction without its VYPcode source, as the engine sees it
+static void traceOperand(VMCode* code, VMOperand* operand) {
+    switch (operand->kind) {
+        case VM_OPERAND_REG: fprintf(stderr, "$%d", operand->reg); break;
+        case VM_OPERAND_STACK: fprintf(stderr, "[$%d%+lld]", operand->reg, (long long)operand->value); break;
+        case VM_OPERAND_STR: {
+            VMString* string = &code->strings[operand->value];
+            fprintf(stderr, "\"");
+            for (int64_t i = 0; i < string->length; i++) writeUTF8(string->codes[i], stderr);
+            fprintf(stderr, "\"");
+            break;
+        }
+        case VM_OPERAND_LABEL: fprintf(stderr, "@%lld", (long long)operand->value); break;
+        default: fprintf(stderr, "%lld", (long long)operand->value); break;
+    }
+}
+
+static void traceInstr(VMCode* code, VMInstr* instr) {
+    if (instr->source < 0) return;
+    if (!code->source) {
+        fprintf(stderr, "[%ld] %s", (long)(instr - code->code), getVCOpcodeName(instr->op));
+        for (int o = 0; o < getVCOperandCount(instr->op); o++) {
+            fprintf(stderr, o == 0 ? " " : ", ");
+            traceOperand(code, &instr->operands[o]);
+        }
+        fprintf(stderr, "\n");
+        return;
+    }
+    VCInstr* source = &code->source->code[instr->source];
+    fprintf(stderr, "[%ld] %s", (long)(instr - code->code), getVCOpcodeName(source->op));
+    for (int o = 0; o < source->operand_count; o++) {
+        fprintf(stderr, o == 0 ? " " : ", ");
+        writeVCOperand(source->operands[o], stderr);
+    }
+    fprintf(stderr, "\n");
+}
+
+//Profiling
+
+static void recordReceiver(VMReceivers* receivers, int target) {
+    for (int r = 0; r < receivers->count; r++) {
+        if (receivers->targets[r] == target) {
+            receivers->calls[r]++;
+            return;
+        }
+    }
+    if (receivers->count < VM_PROFILE_RECEIVERS) {
+        receivers->targets[receivers->count] = target;
+        receivers->calls[receivers->count++] = 1;
+    }
+}
+
+// Runs before every instruction; where the previous one went tells whether its branch was taken
+// or which method its call through a vtable reached
+static inline void profileInstr(VM* vm, VMInstr* last, VMInstr* instr) {
+    VMInstr* base = vm->code->code;
+    vm->counts[instr - base]++;
+    if (!last) return;
+    if (last->operands[2].kind == VM_OPERAND_CACHE) {
+        recordReceiver(&vm->receivers[last->operands[2].value], instr - base);
+    } else if ((last->op == VC_JUMPZ || last->op == VC_JUMPNZ) && instr != last + 1) {
+        vm->taken[last - base]++;
+    }
+}
+
+static bool isFunctionLabel(const char* name) {
+    return strncmp(name, "f.", 2) == 0;
+}
+
+// Turn the counters into profile entries keyed by the labels of the program
+static void collectProfile(VM* vm, Profile* profile) {
+    VMCode* code = vm->code;
+    const char** names = checkedCalloc(code->count + 1, sizeof(char*), ALLOC_VM);      // Preferably a local label
+    const char** functions = checkedCalloc(code->count + 1, sizeof(char*), ALLOC_VM);  // Function starting there
+    for (int l = 0; l < code->label_count; l++) {
+        VMLabel* label = &code->labels[l];
+        if (isFunctionLabel(label->name)) functions[label->target] = label->name;
+        if (!names[label->target] || strncmp(label->name, "l.", 2) == 0) names[label->target] = label->name;
+        long long count = vm->counts[label->target];
+        if (count > 0) addProfileEntry(profile, isFunctionLabel(label->name) ? PROFILE_FUNCTION : PROFILE_BLOCK,
+                                       label->name, 0, NULL, count, 0);
+    }
+
+    const char* function = NULL;
+    int site = 0;
+    for (int i = 0; i < code->count; i++) {
+        VMInstr* instr = &code->code[i];
+        if (functions[i]) {
+            function = functions[i];
+            site = 0;
+        }
+        if ((instr->op == VC_JUMPZ || instr->op == VC_JUMPNZ) && vm->counts[i] > 0 && names[instr->operands[0].value]) {
+            addProfileEntry(profile, PROFILE_BRANCH, names[instr->operands[0].value], 0, NULL,
+                            vm->taken[i], vm->counts[i] - vm->taken[i]);
+        }
+        if (instr->operands[2].kind == VM_OPERAND_CACHE) {
+            VMReceivers* receivers = &vm->receivers[instr->operands[2].value];
+            for (int r = 0; r < receivers->count && function; r++) {
+                int target = receivers->targets[r];
+                const char* name = functions[target] ? functions[target] : names[target];
+                if (name) addProfileEntry(profile, PROFILE_RECEIVER, function, site, name, receivers->calls[r], 0);
+            }
+            site++;
+        }
+    }
+    free(names);
+    free(functions);
+}
+
+//Engine
+
+#define A (&instr->operands[0])
+#define B (&instr->operands[1])
+#define C (&instr->operands[2])
+#define DISPATCH() do { instr = pc++; executed++; goto *instr->handler; } while (0)
+#define HANDLER(instr) ((instr)->operands[2].kind == VM_OPERAND_CACHE ? &&op_call_cached : handlers[(instr)->op])
+
+// A superinstruction runs the instructions it fuses one after the other without dispatching
+// between them: STEP moves to the next one like DISPATCH but stays in the same handler
+#define STEP() do { instr = pc++; executed++; fused++; } while (0)
+
+// Bodies of the instructions, shared by their own handlers and the superinstructions
+#define SET_BODY() store(vm, A, load(vm, B))
+#define ADDI_BODY() store(vm, A, (int64_t)((uint64_t)load(vm, B) + (uint64_t)load(vm, C)))
+#define SUBI_BODY() store(vm, A, (int64_t)((uint64_t)load(vm, B) - (uint64_t)load(vm, C)))
+#define LTI_BODY() store(vm, A, load(vm, B) < load(vm, C))
+#define GTI_BODY() store(vm, A, load(vm, B) > load(vm, C))
+#define EQI_BODY() store(vm, A, load(vm, B) == load(vm, C))
+#define GETWORD_BODY() do { int64_t id = load(vm, B); store(vm, A, *chunkWord(vm, id, load(vm, C))); } while (0)
+#define JUMP_BODY() (pc = base + A->value)
+#define JUMPZ_BODY() do { if (load(vm, B) == 0) pc = base + A->value; } while (0)
+#define JUMPNZ_BODY() do { if (load(vm, B) != 0) pc = base + A->value; } while (0)
+#define CALL_BODY() do { store(vm, A, pc - base); pc = base + B->value; vm->stats->calls++; } while (0)
+#define CALL_CACHED_BODY() do { \
+        int target = findCachedTarget(vm, &code->caches[C->value], load(vm, B)); \
+        store(vm, A, pc - base); \
+        pc = base + target; \
+        vm->stats->calls++; \
+    } while (0)
+#define RETURN_BODY() do { \
+        int64_t target = load(vm, A); \
+        if (target < 0 || target > code->count) fail(vm, VM_ERROR_MEMORY, "invalid return address %lld.", target); \
+        pc = base + target; \
+    } while (0)
+#define FUSED(name, first, second) name: first(); STEP(); second(); DISPATCH();
+
+static int execute(VM* vm, bool verbose, bool fuse) {
+    static const void* handlers[VM_HALT + 1] = {
+        [VC_CREATE] = &&op_create, [VC_COPY] = &&op_copy, [VC_GETSIZE] = &&op_getsize,
+        [VC_GETWORD] = &&op_getword, [VC_RESIZE] = &&op_resize, [VC_SETWORD] = &&op_setword,
+        [VC_DESTROY] = &&op_destroy, [VC_CALL] = &&op_call, [VC_RETURN] = &&op_return,
+        [VC_SET] = &&op_set, [VC_JUMP] = &&op_jump, [VC_JUMPZ] = &&op_jumpz,
+        [VC_JUMPNZ] = &&op_jumpnz, [VC_READS] = &&op_reads, [VC_WRITES] = &&op_writes,
+        [VC_READI] = &&op_readi, [VC_WRITEI] = &&op_writei, [VC_ADDI] = &&op_addi,
+        [VC_SUBI] = &&op_subi, [VC_MULI] = &&op_muli, [VC_DIVI] = &&op_divi, [VC_LTI] = &&op_lti,
+        [VC_GTI] = &&op_gti, [VC_EQI] = &&op_eqi, [VC_LTS] = &&op_lts, [VC_GTS] = &&op_gts,
+        [VC_EQS] = &&op_eqs, [VC_AND] = &&op_and, [VC_OR] = &&op_or, [VC_NOT] = &&op_not,
+        [VC_INT2STRING] = &&op_int2string, [VM_HALT] = &&op_halt,
+    };
+    // Pairs of instructions that run one after the other most often in the programs of tests/
+    // compiled by vypcomp: passing the arguments and moving $SP around a call, the vtable lookup
+    // of a method, the compare and branch of the loops and conditions, and the increments
+    static const void* superinstructions[VC_OPCODE_COUNT][VC_OPCODE_COUNT] = {
+        [VC_SET][VC_SET] = &&op_set_set, [VC_SET][VC_ADDI] = &&op_set_addi,
+        [VC_SET][VC_SUBI] = &&op_set_subi, [VC_SET][VC_JUMP] = &&op_set_jump,
+        [VC_ADDI][VC_SET] = &&op_addi_set, [VC_ADDI][VC_ADDI] = &&op_addi_addi,
+        [VC_ADDI][VC_JUMP] = &&op_addi_jump, [VC_ADDI][VC_CALL] = &&op_addi_call,
+        [VC_SUBI][VC_SET] = &&op_subi_set, [VC_SUBI][VC_JUMP] = &&op_subi_jump,
+        [VC_SUBI][VC_RETURN] = &&op_subi_return, [VC_GETWORD][VC_GETWORD] = &&op_getword_getword,
+        [VC_LTI][VC_JUMPZ] = &&op_lti_jumpz, [VC_LTI][VC_JUMPNZ] = &&op_lti_jumpnz,
+        [VC_GTI][VC_JUMPZ] = &&op_gti_jumpz, [VC_GTI][VC_JUMPNZ] = &&op_gti_jumpnz,
+        [VC_EQI][VC_JUMPZ] = &&op_eqi_jumpz, [VC_EQI][VC_JUMPNZ] = &&op_eqi_jumpnz,
+    };
+    VMCode* code = vm->code;
+
+    // With the trace or the profiling every instruction goes through them before its own
+    // handler. Otherwise every instruction that starts a fused pair gets the superinstruction;
+    // the second one keeps its own handler too, so a jump to it still runs it alone.
+    bool observed = verbose || vm->counts;
+    for (int i = 0; i <= code->count; i++) {
+        VMInstr* instr = &code->code[i];
+        instr->handler = observed ? &&trace : HANDLER(instr);
+        if (observed || !fuse || i + 1 >= code->count || instr->op >= VC_OPCODE_COUNT) continue;
+        VMInstr* next = instr + 1;
+        const void* fused = superinstructions[instr->op][next->op];
+        if (fused == &&op_addi_call && next->operands[2].kind == VM_OPERAND_CACHE) fused = &&op_addi_call_cached;
+        if (fused) instr->handler = fused;
+    }
+
+    VMInstr* base = code->code;
+    VMInstr* pc = base;
+    VMInstr* instr;
+    VMInstr* last = NULL;                                   // Previous instruction, for the profiling
+    long long executed = 0;
+    long long fused = 0;
+    if (setjmp(vm->failure)) return vm->status;
+    DISPATCH();
+
+trace:
+    if (verbose) traceInstr(code, instr);
+    if (vm->counts) profileInstr(vm, last, instr);
+    last = instr;
+    goto *HANDLER(instr);
+
+op_create: {
+        int64_t size = load(vm, B);
+        store(vm, A, createChunk(vm, size, false));
+        DISPATCH();
+    }
+op_copy: {
+        int64_t original = load(vm, B);
+        VMChunk* chunk = getChunk(vm, original);
+        int64_t id = createChunk(vm, chunk->size, chunk->leaf);
+        chunk = &vm->heap.chunks[original];
+        memcpy(vm->heap.chunks[id].items, chunk->items, chunk->size * sizeof(int64_t));
+        store(vm, A, id);
+        DISPATCH();
+    }
+op_getsize: {
+        int64_t id = load(vm, B);
+        VMChunk* chunk = findChunk(&vm->heap, id);
+        store(vm, A, chunk ? chunk->size : -1);
+        DISPATCH();
+    }
+op_getword:
+    GETWORD_BODY();
+    DISPATCH();
+op_resize: {
+        int64_t id = load(vm, A);
+        int64_t size = load(vm, B);
+        touchChunk(vm, getChunk(vm, id));
+        if (size < 0) fail(vm, VM_ERROR_MEMORY, "chunk of size %lld.", size);
+        if (!resizeChunk(&vm->heap, id, size)) fail(vm, VM_ERROR_INTERNAL, "heap limit of %lld words exceeded.", vm->heap.limit);
+        DISPATCH();
+    }
+op_setword: {
+        int64_t id = load(vm, A);
+        int64_t index = load(vm, B);
+        int64_t value = load(vm, C);
+        *chunkWord(vm, id, index) = value;
+        touchChunk(vm, &vm->heap.chunks[id]);
+        recordWrite(&vm->heap, &vm->heap.chunks[id], value);
+        DISPATCH();
+    }
+op_destroy: {
+        int64_t id = load(vm, A);
+        destroyChunk(&vm->heap, id);
+        DISPATCH();
+    }
+op_call:
+    CALL_BODY();
+    DISPATCH();
+op_call_cached:
+    CALL_CACHED_BODY();
+    DISPATCH();
+op_return:
+    RETURN_BODY();
+    DISPATCH();
+op_set:
+    SET_BODY();
+    DISPATCH();
+op_jump:
+    JUMP_BODY();
+    DISPATCH();
+op_jumpz:
+    JUMPZ_BODY();
+    DISPATCH();
+op_jumpnz:
+    JUMPNZ_BODY();
+    DISPATCH();
+op_reads:
+    store(vm, A, readString(vm));
+    DISPATCH();
+op_writes:
+    writeString(vm, load(vm, A));
+    DISPATCH();
+op_readi:
+    store(vm, A, readInteger());
+    DISPATCH();
+op_writei:
+    printf("%lld", (long long)load(vm, A));
+    DISPATCH();
+
+    // Integer arithmetic wraps around like the 64-bit words of the reference machine
+op_addi:
+    ADDI_BODY();
+    DISPATCH();
+op_subi:
+    SUBI_BODY();
+    DISPATCH();
+op_muli:
+    store(vm, A, (int64_t)((uint64_t)load(vm, B) * (uint64_t)load(vm, C)));
+    DISPATCH();
+op_divi: {
+        int64_t dividend = load(vm, B);
+        int64_t divisor = load(vm, C);
+        if (divisor == 0) fail(vm, VM_ERROR_DIVISION, "division by zero (%lld / 0).", dividend);
+        store(vm, A, divisor == -1 ? (int64_t)(0 - (uint64_t)dividend) : dividend / divisor);
+        DISPATCH();
+    }
+op_lti:
+    LTI_BODY();
+    DISPATCH();
+op_gti:
+    GTI_BODY();
+    DISPATCH();
+op_eqi:
+    EQI_BODY();
+    DISPATCH();
+op_lts:
+    store(vm, A, compareStrings(vm, load(vm, B), load(vm, C)) < 0);
+    DISPATCH();
+op_gts:
+    store(vm, A, compareStrings(vm, load(vm, B), load(vm, C)) > 0);
+    DISPATCH();
+op_eqs:
+    store(vm, A, compareStrings(vm, load(vm, B), load(vm, C)) == 0);
+    DISPATCH();
+op_and: {
+        bool first = load(vm, B) != 0;
+        bool second = load(vm, C) != 0;
+        store(vm, A, first && second);
+        DISPATCH();
+    }
+op_or: {
+        bool first = load(vm, B) != 0;
+        bool second = load(vm, C) != 0;
+        store(vm, A, first || second);
+        DISPATCH();
+    }
+op_not:
+    store(vm, A, load(vm, B) == 0);
+    DISPATCH();
+op_int2string: {
+        char text[32];
+        int length = snprintf(text, sizeof(text), "%lld", (long long)load(vm, B));
+        int64_t codes[32];
+        for (int i = 0; i < length; i++) codes[i] = text[i];
+        store(vm, A, createString(vm, codes, length));
+        DISPATCH();
+    }
+
+    // Superinstructions
+    FUSED(op_set_set, SET_BODY, SET_BODY)
+    FUSED(op_set_addi, SET_BODY, ADDI_BODY)
+    FUSED(op_set_subi, SET_BODY, SUBI_BODY)
+    FUSED(op_set_jump, SET_BODY, JUMP_BODY)
+    FUSED(op_addi_set, ADDI_BODY, SET_BODY)
+    FUSED(op_addi_addi, ADDI_BODY, ADDI_BODY)
+    FUSED(op_addi_jump, ADDI_BODY, JUMP_BODY)
+    FUSED(op_addi_call, ADDI_BODY, CALL_BODY)
+    FUSED(op_addi_call_cached, ADDI_BODY, CALL_CACHED_BODY)
+    FUSED(op_subi_set, SUBI_BODY, SET_BODY)
+    FUSED(op_subi_jump, SUBI_BODY, JUMP_BODY)
+    FUSED(op_subi_return, SUBI_BODY, RETURN_BODY)
+    FUSED(op_getword_getword, GETWORD_BODY, GETWORD_BODY)
+    FUSED(op_lti_jumpz, LTI_BODY, JUMPZ_BODY)
+    FUSED(op_lti_jumpnz, LTI_BODY, JUMPNZ_BODY)
+    FUSED(op_gti_jumpz, GTI_BODY, JUMPZ_BODY)
+    FUSED(op_gti_jumpnz, GTI_BODY, JUMPNZ_BODY)
+    FUSED(op_eqi_jumpz, EQI_BODY, JUMPZ_BODY)
+    FUSED(op_eqi_jumpnz, EQI_BODY, JUMPNZ_BODY)
+
+op_halt:
+    vm->stats->instructions = executed - 1;                // The halt is not an instruction of the program
+    vm->stats->superinstructions = fused;
+    return VM_OK;
+}
+
+#undef A
+#undef B
+#undef C
+#undef DISPATCH
+#undef HANDLER
+#undef STEP
+#undef SET_BODY
+#undef ADDI_BODY
+#undef SUBI_BODY
+#undef LTI_BODY
+#undef GTI_BODY
+#undef EQI_BODY
+#undef GETWORD_BODY
+#undef JUMP_BODY
+#undef JUMPZ_BODY
+#undef JUMPNZ_BODY
+#undef CALL_BODY
+#undef CALL_CACHED_BODY
+#undef RETURN_BODY
+#undef FUSED
+
+int runVYPcode(VMCode* code, VMOptions* options, VMStats* stats) {
+    VMStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(VMStats));
+
+    VM vm;
+    vm.code = code;
+    vm.regs = checkedCalloc(options->registers + 2, sizeof(int64_t), ALLOC_VM);
+    vm.stack = checkedCalloc(options->stack_size, sizeof(int64_t), ALLOC_VM);
+    vm.stack_size = options->stack_size;
+    initHeap(&vm.heap, options->nursery_size, options->heap_limit);
+    vm.heap.registers = vm.regs;
+    vm.heap.register_count = options->registers + 2;
+    vm.heap.stack = vm.stack;
+    vm.stats = stats;
+    vm.status = VM_OK;
+    vm.counts = NULL;
+    vm.taken = NULL;
+    vm.receivers = NULL;
+    if (options->profile) {
+        vm.counts = checkedCalloc(code->count + 1, sizeof(long long), ALLOC_VM);
+        vm.taken = checkedCalloc(code->count + 1, sizeof(long long), ALLOC_VM);
+        vm.receivers = checkedCalloc(code->cache_count, sizeof(VMReceivers), ALLOC_VM);
+    }
+    memset(code->caches, 0, code->cache_count * sizeof(VMCallCache));
+
+    int status = execute(&vm, options->verbose, options->fuse);
+    fflush(stdout);
+    for (int c = 0; c < code->cache_count; c++) {
+        if (code->caches[c].megamorphic) {
+            stats->megamorphic_sites++;
+        } else if (code->caches[c].count > 1) {
+            stats->polymorphic_sites++;
+        }
+    }
+
+    if (options->profile) {
+        collectProfile(&vm, options->profile);
+        free(vm.counts);
+        free(vm.taken);
+        free(vm.receivers);
+    }
+
+    stats->heap = vm.heap.stats;
+    freeHeap(&vm.heap);
+    free(vm.stack);
+    free(vm.regs);
+    return status;
+}
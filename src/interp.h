@@ -0,0 +1,120 @@
+#ifndef INTERP_H
+#define INTERP_H
+
+#include "vypcode.h"
+#include "heap.h"
+#include "profile.h"
+#include <stdint.h>
+
+// Exit codes of the interpreter, the ones of the reference vypint
+#define VM_OK 0
+#define VM_ERROR_ARGUMENTS 20
+#define VM_ERROR_SYNTAX 21             // Lexical or syntax error of the VYPcode source
+#define VM_ERROR_SEMANTIC 22           // Missing or repeated label, unknown register
+#define VM_ERROR_LABEL 25              // Dynamic call to a string that is not a label
+#define VM_ERROR_DIVISION 27
+#define VM_ERROR_MEMORY 28             // Invalid chunk, index, stack address or return address
+#define VM_ERROR_INTERNAL 30
+
+#define VM_DEFAULT_REGISTERS 8
+#define VM_DEFAULT_STACK 65535         // Words
+
+#define VM_HALT VC_OPCODE_COUNT        // Instruction after the last one, it ends the program
+#define VM_CACHE_ENTRIES 4             // Targets an inline cache keeps before the site is megamorphic
+
+typedef enum {
+    VM_OPERAND_NONE,
+    VM_OPERAND_REG,
+    VM_OPERAND_STACK,
+    VM_OPERAND_IMM,
+    VM_OPERAND_STR,
+    VM_OPERAND_LABEL,
+    VM_OPERAND_CACHE,                  // Third operand of a call through a string: its inline cache
+} VMOperandKind;
+
+// Pre-decoded operand. Registers are indexes in the register file, where $SP and a register
+// that is always 0 (for the absolute stack addresses) follow the general purpose ones.
+typedef struct {
+    int32_t kind;
+    int32_t reg;
+    int64_t value;                     // Immediate, stack offset, string constant or instruction index
+} VMOperand;
+
+typedef struct {
+    const void* handler;               // Code of the instruction in the engine, set before running
+    int32_t op;                        // VCOpcode or VM_HALT
+    int32_t source;                    // Index in the VYPcode stream (-1 for the halt)
+    VMOperand operands[3];
+} VMInstr;
+
+// Label of the program, sorted by name for the dynamic calls
+typedef struct {
+    char* name;
+    int target;
+} VMLabel;
+
+// String literal already unescaped, one code point per word like in its chunks
+typedef struct {
+    int64_t* codes;
+    int64_t length;
+} VMString;
+
+// Inline cache of a call through a string. The vtables are built once, so the chunk id of the
+// label in a vtable slot identifies the class of the receiver at that call site.
+typedef struct {
+    int64_t keys[VM_CACHE_ENTRIES];    // Chunk ids of the label strings seen
+    int targets[VM_CACHE_ENTRIES];
+    int count;                         // 1 while monomorphic, up to VM_CACHE_ENTRIES when polymorphic
+    bool megamorphic;                  // Too many targets, the site always looks the label up
+    long long epoch;                   // Entries are stale when a label string changes
+} VMCallCache;
+
+// Program ready to run: no labels, every jump holds its target instruction
+typedef struct {
+    VMInstr* code;                     // Ends with a VM_HALT
+    int count;
+    VMLabel* labels;
+    int label_count;
+    VMString* strings;
+    int string_count;
+    VMCallCache* caches;               // One per call through a string
+    int cache_count;
+    VCProgram* source;                 // Not owned, printed by the trace; NULL for a container
+    void* mapping;                     // Bytecode container holding the code, labels and strings
+    size_t mapping_size;
+} VMCode;
+
+typedef struct {
+    int registers;
+    long stack_size;
+    bool verbose;                      // Trace every executed instruction into stderr
+    bool fuse;                         // Run frequent pairs of instructions as superinstructions
+    int64_t nursery_size;              // Words
+    int64_t heap_limit;                // Words of chunks, nursery included (0 = no limit)
+    Profile* profile;                  // Gets the counters of the run when it is not NULL
+} VMOptions;
+
+typedef struct {
+    long long instructions;
+    long long superinstructions;       // Executed; each one saves the dispatch of its second instruction
+    long long calls;
+    long long chunks;                  // Chunks created
+    long long cache_hits;              // Calls through a string that found their target in the cache
+    long long cache_misses;            // Calls that had to look the label up
+    int polymorphic_sites;             // Sites that saw more than one target
+    int megamorphic_sites;
+    VMHeapStats heap;
+} VMStats;
+
+void initVMOptions(VMOptions* options);
+
+// Resolve labels, registers and string literals; NULL with the exit code in status on error
+VMCode* decodeVYPcode(VCProgram* program, VMOptions* options, int* status);
+
+// Run the program with stdin and stdout, returns its exit code
+int runVYPcode(VMCode* code, VMOptions* options, VMStats* stats);
+
+bool checkVMInstr(VMCode* code, VMInstr* instr, int registers);
+void freeVMCode(VMCode* code);
+
+#endif // INTERP_H
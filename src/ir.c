@@ -0,0 +1,1044 @@
+#include "ir.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Variable visible in the current block
+typedef struct IRScopeEntry {
+    char* name;                    // Variable name
+    int value;                     // Virtual register that holds it
+    int depth;                     // Block depth where it was declared
+    struct IRScopeEntry* next;
+} IRScopeEntry;
+
+// State of the lowering of one function
+typedef struct {
+    IRProgram* program;
+    IRFunction* function;          // Function being lowered
+    ASTClassNode* currentClass;    // Owner class of a method (null for functions)
+    IRScopeEntry* scope;           // Innermost variables first
+    int depth;                     // Current block depth
+    bool failed;                   // An error was reported
+} IRBuilder;
+
+static int lowerExpression(IRBuilder* builder, ASTNode* node);
+static void lowerStatement(IRBuilder* builder, ASTNode* node);
+
+//Types
+
+static IRType typeFromName(const char* typeName) {
+    if (!typeName || strcmp(typeName, "void") == 0) return IR_TYPE_VOID;
+    if (strcmp(typeName, "int") == 0) return IR_TYPE_INT;
+    if (strcmp(typeName, "string") == 0) return IR_TYPE_STRING;
+    return IR_TYPE_OBJECT; // Any other name is a class
+}
+
+// Remove the quotes around a string literal as it comes from the lexer
+static char* stripQuotes(const char* literal) {
+    size_t length = strlen(literal);
+    if (length >= 2 && literal[0] == '"' && literal[length - 1] == '"') {
+        char* text = checkedMalloc(length - 1, ALLOC_IR);
+        memcpy(text, literal + 1, length - 2);
+        text[length - 2] = '\0';
+        return text;
+    }
+    return compilerStrdup(literal, ALLOC_IR);
+}
+
+//Instruction lists
+
+IRInstr* createIRInstr(IROpcode op, int dst, int src1, int src2) {
+    IRInstr* instr = (IRInstr*)checkedMalloc(sizeof(IRInstr), ALLOC_IR);
+    instr->op = op;
+    instr->dst = dst;
+    instr->src1 = src1;
+    instr->src2 = src2;
+    instr->imm = 0;
+    instr->name = NULL;
+    instr->args = NULL;
+    instr->arg_count = 0;
+    instr->next = NULL;
+    instr->prev = NULL;
+    return instr;
+}
+
+void appendIRInstr(IRFunction* function, IRInstr* instr) {
+    instr->prev = function->last;
+    instr->next = NULL;
+    if (function->last) {
+        function->last->next = instr;
+    } else {
+        function->first = instr;
+    }
+    function->last = instr;
+}
+
+void insertIRInstrBefore(IRFunction* function, IRInstr* position, IRInstr* instr) {
+    if (!position) {
+        appendIRInstr(function, instr);
+        return;
+    }
+    instr->next = position;
+    instr->prev = position->prev;
+    if (position->prev) {
+        position->prev->next = instr;
+    } else {
+        function->first = instr;
+    }
+    position->prev = instr;
+}
+
+void freeIRInstr(IRInstr* instr) {
+    compilerFree(instr->name);
+    compilerFree(instr->args);
+    compilerFree(instr);
+}
+
+void removeIRInstr(IRFunction* function, IRInstr* instr) {
+    if (instr->prev) {
+        instr->prev->next = instr->next;
+    } else {
+        function->first = instr->next;
+    }
+    if (instr->next) {
+        instr->next->prev = instr->prev;
+    } else {
+        function->last = instr->prev;
+    }
+    instr->next = NULL;
+    instr->prev = NULL;
+}
+
+// Collect the virtual registers read by an instruction
+int getIRInstrUses(IRInstr* instr, int* uses, int max_uses) {
+    int count = 0;
+    if (instr->src1 >= 0 && count < max_uses) uses[count++] = instr->src1;
+    if (instr->src2 >= 0 && count < max_uses) uses[count++] = instr->src2;
+    for (int i = 0; i < instr->arg_count && count < max_uses; i++) {
+        uses[count++] = instr->args[i];
+    }
+    return count;
+}
+
+// Instructions that transfer control to other VYPcode routines
+bool isIRCall(IRInstr* instr) {
+    switch (instr->op) {
+        case IR_CALL:
+        case IR_CALL_METHOD:
+        case IR_NEW:
+        case IR_CONCAT:
+        case IR_SUBSTR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int newIRValue(IRFunction* function, IRType type, const char* className, const char* name) {
+    if (function->value_count == function->value_capacity) {
+        function->value_capacity = function->value_capacity ? function->value_capacity * 2 : 16;
+        function->values = checkedRealloc(function->values, function->value_capacity * sizeof(IRValue), ALLOC_IR);
+    }
+    IRValue* value = &function->values[function->value_count];
+    value->type = type;
+    value->className = className ? compilerStrdup(className, ALLOC_IR) : NULL;
+    value->name = name ? compilerStrdup(name, ALLOC_IR) : NULL;
+    value->paramIndex = -1;
+    return function->value_count++;
+}
+
+int newIRLabel(IRFunction* function) {
+    return function->label_count++;
+}
+
+static IRFunction* createIRFunction(const char* name, const char* className, IRType returnType) {
+    IRFunction* function = (IRFunction*)checkedMalloc(sizeof(IRFunction), ALLOC_IR);
+    function->name = compilerStrdup(name, ALLOC_IR);
+    function->className = className ? compilerStrdup(className, ALLOC_IR) : NULL;
+    function->returnType = returnType;
+    function->param_count = 0;
+    function->values = NULL;
+    function->value_count = 0;
+    function->value_capacity = 0;
+    function->label_count = 0;
+    function->first = NULL;
+    function->last = NULL;
+    function->next = NULL;
+    return function;
+}
+
+//Emission helpers
+
+static IRInstr* emit(IRBuilder* builder, IROpcode op, int dst, int src1, int src2) {
+    IRInstr* instr = createIRInstr(op, dst, src1, src2);
+    appendIRInstr(builder->function, instr);
+    return instr;
+}
+
+static int emitTemp(IRBuilder* builder, IROpcode op, IRType type, const char* className, int src1, int src2) {
+    int dst = newIRValue(builder->function, type, className, NULL);
+    emit(builder, op, dst, src1, src2);
+    return dst;
+}
+
+static void emitLabel(IRBuilder* builder, int label) {
+    emit(builder, IR_LABEL, -1, -1, -1)->imm = label;
+}
+
+static void emitJump(IRBuilder* builder, IROpcode op, int condition, int label) {
+    emit(builder, op, -1, condition, -1)->imm = label;
+}
+
+// Default value of a variable of the given type (0, "" or null reference)
+static void emitDefaultValue(IRBuilder* builder, int dst) {
+    if (builder->function->values[dst].type == IR_TYPE_STRING) {
+        emit(builder, IR_CONST_STR, dst, -1, -1)->name = compilerStrdup("", ALLOC_IR);
+    } else {
+        emit(builder, IR_CONST_INT, dst, -1, -1)->imm = 0;
+    }
+}
+
+static void reportError(IRBuilder* builder, const char* message, const char* detail) {
+    fprintf(stderr, "Error: %s '%s'.\n", message, detail ? detail : "?");
+    builder->failed = true;
+}
+
+//Scopes
+
+static void declareVariable(IRBuilder* builder, const char* name, int value) {
+    IRScopeEntry* entry = (IRScopeEntry*)checkedMalloc(sizeof(IRScopeEntry), ALLOC_IR);
+    entry->name = compilerStrdup(name, ALLOC_IR);
+    entry->value = value;
+    entry->depth = builder->depth;
+    entry->next = builder->scope;
+    builder->scope = entry;
+}
+
+static int lookupVariable(IRBuilder* builder, const char* name) {
+    for (IRScopeEntry* entry = builder->scope; entry; entry = entry->next) {
+        if (strcmp(entry->name, name) == 0) {
+            return entry->value;
+        }
+    }
+    return -1;
+}
+
+static void enterBlock(IRBuilder* builder) {
+    builder->depth++;
+}
+
+static void leaveBlock(IRBuilder* builder) {
+    while (builder->scope && builder->scope->depth == builder->depth) {
+        IRScopeEntry* entry = builder->scope;
+        builder->scope = entry->next;
+        compilerFree(entry->name);
+        compilerFree(entry);
+    }
+    builder->depth--;
+}
+
+//Classes
+
+ASTClassNode* findIRClass(IRProgram* program, const char* className) {
+    if (!className) return NULL;
+    for (ASTNode* node = program->ast->classes; node; node = node->next) {
+        ASTClassNode* classNode = (ASTClassNode*)node;
+        if (strcmp(classNode->name, className) == 0) {
+            return classNode;
+        }
+    }
+    return NULL;
+}
+
+static bool isSubclassOf(IRProgram* program, const char* className, const char* ancestor) {
+    for (ASTClassNode* current = findIRClass(program, className); current;
+         current = findIRClass(program, current->parent)) {
+        if (strcmp(current->name, ancestor) == 0) return true;
+    }
+    return false;
+}
+
+// Whether a function can be the target of a call. Virtual calls name the method of the static
+// class, so the overrides in its subclasses are targets too.
+bool isIRCallTarget(IRProgram* program, IRInstr* call, IRFunction* function) {
+    if (strcmp(call->name, function->name) == 0) return true;
+    if (call->op != IR_CALL_METHOD || !function->className) return false;
+
+    const char* method = strchr(call->name, '.');
+    const char* candidate = strchr(function->name, '.');
+    if (!method || !candidate || strcmp(method, candidate) != 0) return false;
+
+    size_t length = method - call->name;
+    char* staticClass = compilerStrndup(call->name, length, ALLOC_IR);
+    bool target = isSubclassOf(program, function->className, staticClass);
+    compilerFree(staticClass);
+    return target;
+}
+
+bool isIRMethodOverridden(IRProgram* program, const char* className, const char* methodName) {
+    if (program->open_classes) return true;
+    for (ASTNode* node = program->ast->classes; node; node = node->next) {
+        ASTClassNode* classNode = (ASTClassNode*)node;
+        if (strcmp(classNode->name, className) == 0 || !isSubclassOf(program, classNode->name, className)) continue;
+        for (ASTNode* member = classNode->members; member; member = member->next) {
+            if (member->type == AST_FUNCTION && strcmp(((ASTFunctionNode*)member)->name, methodName) == 0) return true;
+        }
+    }
+    return false;
+}
+
+// Find a method in a class or its ancestors, also returns the defining class
+static ASTFunctionNode* findMethod(IRProgram* program, const char* className, const char* methodName,
+                                   ASTClassNode** owner) {
+    for (ASTClassNode* classNode = findIRClass(program, className); classNode;
+         classNode = findIRClass(program, classNode->parent)) {
+        for (ASTNode* member = classNode->members; member; member = member->next) {
+            if (member->type == AST_FUNCTION && strcmp(((ASTFunctionNode*)member)->name, methodName) == 0) {
+                if (owner) *owner = classNode;
+                return (ASTFunctionNode*)member;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Find an attribute in a class or its ancestors
+static ASTDeclarationNode* findField(IRProgram* program, const char* className, const char* fieldName) {
+    for (ASTClassNode* classNode = findIRClass(program, className); classNode;
+         classNode = findIRClass(program, classNode->parent)) {
+        for (ASTNode* member = classNode->members; member; member = member->next) {
+            if (member->type == AST_DECLARATION && strcmp(((ASTDeclarationNode*)member)->name, fieldName) == 0) {
+                return (ASTDeclarationNode*)member;
+            }
+        }
+    }
+    return NULL;
+}
+
+static ASTFunctionNode* findFunction(IRProgram* program, const char* name) {
+    for (ASTNode* node = program->ast->functions; node; node = node->next) {
+        if (strcmp(((ASTFunctionNode*)node)->name, name) == 0) {
+            return (ASTFunctionNode*)node;
+        }
+    }
+    return NULL;
+}
+
+// The parser drops a declaration whose name is already in the (global) symbol table,
+// so a variable can be used without a visible declaration. Recreate it at function
+// level with the type recorded in the symbol table.
+static int recoverDroppedVariable(IRBuilder* builder, const char* name) {
+    int index = find_symbol(builder->program->symbolTable, name);
+    if (index == -1) return -1;
+    Symbol* symbol = &builder->program->symbolTable->symbols[index];
+    if (symbol->is_function || symbol->is_class) return -1;
+
+    IRFunction* function = builder->function;
+    int value = newIRValue(function, typeFromName(symbol->type), symbol->type, name);
+    IRInstr* init = createIRInstr(function->values[value].type == IR_TYPE_STRING ? IR_CONST_STR : IR_CONST_INT,
+                                  value, -1, -1);
+    if (init->op == IR_CONST_STR) init->name = compilerStrdup("", ALLOC_IR);
+    insertIRInstrBefore(function, function->first, init);
+
+    IRScopeEntry** tail = &builder->scope;
+    while (*tail) tail = &(*tail)->next;
+    IRScopeEntry* entry = (IRScopeEntry*)checkedMalloc(sizeof(IRScopeEntry), ALLOC_IR);
+    entry->name = compilerStrdup(name, ALLOC_IR);
+    entry->value = value;
+    entry->depth = 1;              // Function level, visible until the end of the body
+    entry->next = NULL;
+    *tail = entry;
+    return value;
+}
+
+static int thisValue(IRBuilder* builder) {
+    return builder->currentClass ? 0 : -1; // 'this' is always the first parameter of a method
+}
+
+//Expressions
+
+static int lowerFieldLoad(IRBuilder* builder, int object, const char* fieldName) {
+    IRValue* objectValue = &builder->function->values[object];
+    ASTDeclarationNode* field = findField(builder->program, objectValue->className, fieldName);
+    if (!field) {
+        reportError(builder, "unknown attribute", fieldName);
+        return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+    }
+    int dst = newIRValue(builder->function, typeFromName(field->type), field->type, NULL);
+    emit(builder, IR_GETFIELD, dst, object, -1)->name = compilerStrdup(fieldName, ALLOC_IR);
+    return dst;
+}
+
+static int* lowerArguments(IRBuilder* builder, int receiver, ASTNode* arguments, int* count) {
+    int total = receiver >= 0 ? 1 : 0;
+    for (ASTNode* arg = arguments; arg; arg = arg->next) total++;
+
+    int* values = checkedMalloc((total + 1) * sizeof(int), ALLOC_IR);
+    int index = 0;
+    if (receiver >= 0) values[index++] = receiver;
+    for (ASTNode* arg = arguments; arg; arg = arg->next) {
+        values[index++] = lowerExpression(builder, arg);
+    }
+    *count = total;
+    return values;
+}
+
+static int lowerCall(IRBuilder* builder, ASTFunctionCallNode* call) {
+    if (!call->functionName) {
+        reportError(builder, "call through an expression is not supported", "(expression)");
+        return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+    }
+
+    const char* name = call->functionName;
+    int count = 0;
+    int* args = NULL;
+
+    // Embedded functions
+    if (strcmp(name, "readInt") == 0) {
+        return emitTemp(builder, IR_READ_INT, IR_TYPE_INT, NULL, -1, -1);
+    }
+    if (strcmp(name, "readString") == 0) {
+        return emitTemp(builder, IR_READ_STR, IR_TYPE_STRING, NULL, -1, -1);
+    }
+    if (strcmp(name, "length") == 0) {
+        args = lowerArguments(builder, -1, call->arguments, &count);
+        int dst = emitTemp(builder, IR_STRLEN, IR_TYPE_INT, NULL, count > 0 ? args[0] : -1, -1);
+        compilerFree(args);
+        return dst;
+    }
+    if (strcmp(name, "subStr") == 0) {
+        args = lowerArguments(builder, -1, call->arguments, &count);
+        if (count != 3) {
+            reportError(builder, "wrong number of arguments for", name);
+        }
+        int dst = newIRValue(builder->function, IR_TYPE_STRING, NULL, NULL);
+        IRInstr* instr = emit(builder, IR_SUBSTR, dst, -1, -1);
+        instr->args = args;
+        instr->arg_count = count;
+        return dst;
+    }
+
+    // User function
+    ASTFunctionNode* function = findFunction(builder->program, name);
+    if (!function) {
+        reportError(builder, "call to an undefined function", name);
+        return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+    }
+    args = lowerArguments(builder, -1, call->arguments, &count);
+    if (count != function->param_count) {
+        reportError(builder, "wrong number of arguments for", name);
+    }
+    IRType type = typeFromName(function->returnType);
+    int dst = type == IR_TYPE_VOID ? -1 : newIRValue(builder->function, type, function->returnType, NULL);
+    IRInstr* instr = emit(builder, IR_CALL, dst, -1, -1);
+    instr->name = compilerStrdup(name, ALLOC_IR);
+    instr->args = args;
+    instr->arg_count = count;
+    return dst;
+}
+
+static int lowerMethodCall(IRBuilder* builder, ASTMethodCallNode* call) {
+    bool isSuper = call->expression && call->expression->type == AST_SUPER;
+    int receiver;
+    const char* staticClass;
+
+    if (isSuper) {
+        receiver = thisValue(builder);
+        staticClass = builder->currentClass ? builder->currentClass->parent : NULL;
+    } else {
+        receiver = lowerExpression(builder, call->expression);
+        staticClass = receiver >= 0 ? builder->function->values[receiver].className : NULL;
+    }
+    if (receiver < 0) {
+        reportError(builder, "method call without an object", call->methodName);
+        return -1;
+    }
+
+    ASTClassNode* owner = NULL;
+    ASTFunctionNode* method = findMethod(builder->program, staticClass, call->methodName, &owner);
+    if (!method) {
+        reportError(builder, "call to an undefined method", call->methodName);
+        return -1;
+    }
+
+    int count = 0;
+    int* args = lowerArguments(builder, receiver, call->arguments, &count);
+    if (count - 1 != method->param_count) {
+        reportError(builder, "wrong number of arguments for", call->methodName);
+    }
+    IRType type = typeFromName(method->returnType);
+    int dst = type == IR_TYPE_VOID ? -1 : newIRValue(builder->function, type, method->returnType, NULL);
+
+    // 'super' calls are never dispatched dynamically
+    IRInstr* instr = emit(builder, isSuper ? IR_CALL : IR_CALL_METHOD, dst, -1, -1);
+    size_t length = strlen(owner->name) + strlen(method->name) + 2;
+    instr->name = checkedMalloc(length, ALLOC_IR);
+    snprintf(instr->name, length, "%s.%s", owner->name, method->name);
+    instr->args = args;
+    instr->arg_count = count;
+    return dst;
+}
+
+// Operands of a fused string concatenation
+typedef struct {
+    int* values;
+    IRInstr** constants;           // Literal that defines the piece (null if it is not one)
+    int count;
+    int capacity;
+} ConcatPieces;
+
+#define CONCAT_PIECES -2           // The result of an addition went to the piece list
+
+static bool isAddition(ASTNode* node) {
+    return node && node->type == AST_BINARY_OP && ((ASTBinaryOpNode*)node)->op == OP_ADD;
+}
+
+static void appendPiece(IRBuilder* builder, ConcatPieces* pieces, int value) {
+    if (pieces->count == pieces->capacity) {
+        pieces->capacity = pieces->capacity ? pieces->capacity * 2 : 8;
+        pieces->values = checkedRealloc(pieces->values, pieces->capacity * sizeof(int), ALLOC_IR);
+        pieces->constants = checkedRealloc(pieces->constants, pieces->capacity * sizeof(IRInstr*), ALLOC_IR);
+    }
+    // A literal is the last instruction emitted and its temporary is not used anywhere else
+    IRInstr* last = builder->function->last;
+    bool literal = last && last->op == IR_CONST_STR && last->dst == value && !builder->function->values[value].name;
+    pieces->values[pieces->count] = value;
+    pieces->constants[pieces->count] = literal ? last : NULL;
+    pieces->count++;
+}
+
+// Lower a tree of '+'. String concatenations are associative, so every string operand of the
+// tree is added to the piece list in evaluation order and CONCAT_PIECES is returned.
+static int lowerAddition(IRBuilder* builder, ASTBinaryOpNode* binary, ConcatPieces* pieces) {
+    int first = pieces->count;
+    int left = isAddition(binary->left) ? lowerAddition(builder, (ASTBinaryOpNode*)binary->left, pieces)
+                                        : lowerExpression(builder, binary->left);
+    if (left >= 0 && builder->function->values[left].type == IR_TYPE_STRING) {
+        appendPiece(builder, pieces, left);
+        left = CONCAT_PIECES;
+    }
+
+    if (left == CONCAT_PIECES) {
+        int right = isAddition(binary->right) ? lowerAddition(builder, (ASTBinaryOpNode*)binary->right, pieces)
+                                              : lowerExpression(builder, binary->right);
+        if (right == CONCAT_PIECES) return CONCAT_PIECES;
+        if (right < 0 || builder->function->values[right].type != IR_TYPE_STRING) {
+            reportError(builder, "concatenation of a value that is not a string in", builder->function->name);
+            pieces->count = first;
+            return emitTemp(builder, IR_CONST_STR, IR_TYPE_STRING, NULL, -1, -1);
+        }
+        appendPiece(builder, pieces, right);
+        return CONCAT_PIECES;
+    }
+
+    int right = lowerExpression(builder, binary->right);
+    if (left < 0 || right < 0) {
+        reportError(builder, "operand without a value in binary operation", "+");
+        return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+    }
+    return emitTemp(builder, IR_ADD, IR_TYPE_INT, NULL, left, right);
+}
+
+// Emit one concatenation of all the pieces, merging neighbour literals at compile time
+static int emitConcat(IRBuilder* builder, ConcatPieces* pieces) {
+    int count = 0;
+    for (int i = 0; i < pieces->count; i++) {
+        IRInstr* constant = pieces->constants[i];
+        if (constant && constant->name[0] == '\0') {
+            removeIRInstr(builder->function, constant); // "" adds nothing
+            compilerFree(constant->name);
+            compilerFree(constant);
+            continue;
+        }
+        IRInstr* previous = count > 0 ? pieces->constants[count - 1] : NULL;
+        if (constant && previous) {
+            size_t length = strlen(previous->name) + strlen(constant->name) + 1;
+            char* merged = checkedMalloc(length, ALLOC_IR);
+            snprintf(merged, length, "%s%s", previous->name, constant->name);
+            compilerFree(previous->name);
+            previous->name = merged;
+            removeIRInstr(builder->function, constant);
+            compilerFree(constant->name);
+            compilerFree(constant);
+            continue;
+        }
+        pieces->values[count] = pieces->values[i];
+        pieces->constants[count] = constant;
+        count++;
+    }
+
+    int result;
+    if (count == 0) {
+        result = emitTemp(builder, IR_CONST_STR, IR_TYPE_STRING, NULL, -1, -1);
+        builder->function->last->name = compilerStrdup("", ALLOC_IR);
+    } else if (count == 1) {
+        result = pieces->values[0]; // Strings are never modified, the piece itself is the result
+    } else {
+        result = emitTemp(builder, IR_CONCAT, IR_TYPE_STRING, NULL, -1, -1);
+        IRInstr* concat = builder->function->last;
+        concat->args = checkedMalloc(count * sizeof(int), ALLOC_IR);
+        memcpy(concat->args, pieces->values, count * sizeof(int));
+        concat->arg_count = count;
+    }
+    compilerFree(pieces->values);
+    compilerFree(pieces->constants);
+    return result;
+}
+
+static int lowerBinary(IRBuilder* builder, ASTBinaryOpNode* binary) {
+    if (binary->op == OP_ADD) {
+        ConcatPieces pieces = {NULL, NULL, 0, 0};
+        int result = lowerAddition(builder, binary, &pieces);
+        if (result != CONCAT_PIECES) {
+            compilerFree(pieces.values);
+            compilerFree(pieces.constants);
+            return result;
+        }
+        return emitConcat(builder, &pieces);
+    }
+
+    int left = lowerExpression(builder, binary->left);
+    int right = lowerExpression(builder, binary->right);
+    if (left < 0 || right < 0) {
+        reportError(builder, "operand without a value in binary operation", "?");
+        return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+    }
+
+    switch (binary->op) {
+        case OP_SUB: return emitTemp(builder, IR_SUB, IR_TYPE_INT, NULL, left, right);
+        case OP_MUL: return emitTemp(builder, IR_MUL, IR_TYPE_INT, NULL, left, right);
+        case OP_DIV: return emitTemp(builder, IR_DIV, IR_TYPE_INT, NULL, left, right);
+        case OP_LT: return emitTemp(builder, IR_LT, IR_TYPE_INT, NULL, left, right);
+        case OP_GT: return emitTemp(builder, IR_GT, IR_TYPE_INT, NULL, left, right);
+        case OP_LE: return emitTemp(builder, IR_LE, IR_TYPE_INT, NULL, left, right);
+        case OP_GE: return emitTemp(builder, IR_GE, IR_TYPE_INT, NULL, left, right);
+        case OP_EQ: return emitTemp(builder, IR_EQ, IR_TYPE_INT, NULL, left, right);
+        case OP_NE: return emitTemp(builder, IR_NE, IR_TYPE_INT, NULL, left, right);
+        default:
+            reportError(builder, "unsupported binary operator in expression", "=");
+            return left;
+    }
+}
+
+static int lowerCast(IRBuilder* builder, ASTTypeCastNode* cast) {
+    // (string) of an integer literal is a string literal
+    ASTLiteralNode* literal = (ASTLiteralNode*)cast->expression;
+    if (typeFromName(cast->typeName) == IR_TYPE_STRING && literal && literal->base.type == AST_LITERAL &&
+        strcmp(literal->literalType, "int") == 0) {
+        int dst = emitTemp(builder, IR_CONST_STR, IR_TYPE_STRING, NULL, -1, -1);
+        size_t length = 24;
+        builder->function->last->name = checkedMalloc(length, ALLOC_IR);
+        snprintf(builder->function->last->name, length, "%ld", strtol(literal->value, NULL, 10));
+        return dst;
+    }
+
+    int operand = lowerExpression(builder, cast->expression);
+    if (operand < 0) {
+        reportError(builder, "cast of an expression without value to", cast->typeName);
+        return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+    }
+    IRType target = typeFromName(cast->typeName);
+    IRType source = builder->function->values[operand].type;
+
+    if (target == IR_TYPE_STRING && source == IR_TYPE_INT) {
+        return emitTemp(builder, IR_INT2STR, IR_TYPE_STRING, NULL, operand, -1);
+    }
+    if (target == source && target != IR_TYPE_OBJECT) {
+        return operand; // Nothing to convert
+    }
+    if (target == IR_TYPE_OBJECT && source == IR_TYPE_OBJECT) {
+        return emitTemp(builder, IR_MOVE, IR_TYPE_OBJECT, cast->typeName, operand, -1);
+    }
+    reportError(builder, "unsupported type cast to", cast->typeName);
+    return operand;
+}
+
+static int lowerExpression(IRBuilder* builder, ASTNode* node) {
+    if (!node) return -1;
+
+    switch (node->type) {
+        case AST_LITERAL: {
+            ASTLiteralNode* literal = (ASTLiteralNode*)node;
+            if (strcmp(literal->literalType, "int") == 0) {
+                int dst = emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+                builder->function->last->imm = strtol(literal->value, NULL, 10);
+                return dst;
+            }
+            int dst = emitTemp(builder, IR_CONST_STR, IR_TYPE_STRING, NULL, -1, -1);
+            builder->function->last->name = stripQuotes(literal->value);
+            return dst;
+        }
+        case AST_STRING_LITERAL: {
+            int dst = emitTemp(builder, IR_CONST_STR, IR_TYPE_STRING, NULL, -1, -1);
+            builder->function->last->name = stripQuotes(((ASTStringLiteralNode*)node)->value);
+            return dst;
+        }
+        case AST_VARIABLE: {
+            const char* name = ((ASTVariableNode*)node)->name;
+            int value = lookupVariable(builder, name);
+            if (value >= 0) return value;
+            if (builder->currentClass && findField(builder->program, builder->currentClass->name, name)) {
+                return lowerFieldLoad(builder, thisValue(builder), name);
+            }
+            value = recoverDroppedVariable(builder, name);
+            if (value >= 0) return value;
+            reportError(builder, "undeclared variable", name);
+            return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+        }
+        case AST_THIS: {
+            if (!builder->currentClass) {
+                reportError(builder, "'this' outside of a method in", builder->function->name);
+                return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+            }
+            return thisValue(builder);
+        }
+        case AST_BINARY_OP:
+            return lowerBinary(builder, (ASTBinaryOpNode*)node);
+        case AST_UNARY_OP: {
+            ASTUnaryOpNode* unary = (ASTUnaryOpNode*)node;
+            int operand = lowerExpression(builder, unary->operand);
+            return emitTemp(builder, unary->op == OP_NOT ? IR_NOT : IR_NEG, IR_TYPE_INT, NULL, operand, -1);
+        }
+        case AST_FUNCTION_CALL:
+            return lowerCall(builder, (ASTFunctionCallNode*)node);
+        case AST_METHOD_CALL:
+            return lowerMethodCall(builder, (ASTMethodCallNode*)node);
+        case AST_MEMBER_ACCESS: {
+            ASTMemberAccessNode* access = (ASTMemberAccessNode*)node;
+            int object = lowerExpression(builder, access->expression);
+            if (object < 0 || builder->function->values[object].type != IR_TYPE_OBJECT) {
+                reportError(builder, "member access on a value that is not an object", access->memberName);
+                return emitTemp(builder, IR_CONST_INT, IR_TYPE_INT, NULL, -1, -1);
+            }
+            return lowerFieldLoad(builder, object, access->memberName);
+        }
+        case AST_NEW: {
+            ASTNewNode* newNode = (ASTNewNode*)node;
+            if (!findIRClass(builder->program, newNode->className)) {
+                reportError(builder, "instance of an undefined class", newNode->className);
+            }
+            int dst = emitTemp(builder, IR_NEW, IR_TYPE_OBJECT, newNode->className, -1, -1);
+            builder->function->last->name = compilerStrdup(newNode->className, ALLOC_IR);
+            return dst;
+        }
+        case AST_TYPE_CAST:
+            return lowerCast(builder, (ASTTypeCastNode*)node);
+        default:
+            reportError(builder, "unsupported expression in", builder->function->name);
+            return -1;
+    }
+}
+
+//Statements
+
+static void lowerAssignment(IRBuilder* builder, ASTBinaryOpNode* assignment) {
+    if (assignment->left->type == AST_MEMBER_ACCESS) {
+        ASTMemberAccessNode* access = (ASTMemberAccessNode*)assignment->left;
+        int object = lowerExpression(builder, access->expression);
+        int value = lowerExpression(builder, assignment->right);
+        if (object < 0 || value < 0) return;
+        if (!findField(builder->program, builder->function->values[object].className, access->memberName)) {
+            reportError(builder, "assignment to an unknown attribute", access->memberName);
+            return;
+        }
+        emit(builder, IR_SETFIELD, -1, object, value)->name = compilerStrdup(access->memberName, ALLOC_IR);
+        return;
+    }
+
+    if (assignment->left->type != AST_VARIABLE) {
+        reportError(builder, "invalid left side of an assignment in", builder->function->name);
+        return;
+    }
+
+    const char* name = ((ASTVariableNode*)assignment->left)->name;
+    int target = lookupVariable(builder, name);
+    int value = lowerExpression(builder, assignment->right);
+    if (value < 0) {
+        reportError(builder, "assignment of an expression without value to", name);
+        return;
+    }
+
+    if (target < 0 && !(builder->currentClass && findField(builder->program, builder->currentClass->name, name))) {
+        target = recoverDroppedVariable(builder, name);
+    }
+    if (target < 0) {
+        // Attribute of the current object used without 'this'
+        if (builder->currentClass && findField(builder->program, builder->currentClass->name, name)) {
+            emit(builder, IR_SETFIELD, -1, thisValue(builder), value)->name = compilerStrdup(name, ALLOC_IR);
+            return;
+        }
+        reportError(builder, "assignment to an undeclared variable", name);
+        return;
+    }
+    emit(builder, IR_MOVE, target, value, -1);
+}
+
+static void lowerDeclaration(IRBuilder* builder, ASTDeclarationNode* declaration) {
+    int init = declaration->init ? lowerExpression(builder, declaration->init) : -1;
+    int value = newIRValue(builder->function, typeFromName(declaration->type), declaration->type, declaration->name);
+    if (init >= 0) {
+        emit(builder, IR_MOVE, value, init, -1);
+    } else {
+        emitDefaultValue(builder, value);
+    }
+    declareVariable(builder, declaration->name, value);
+}
+
+static void lowerStatementList(IRBuilder* builder, ASTNode* statements) {
+    for (ASTNode* statement = statements; statement; statement = statement->next) {
+        lowerStatement(builder, statement);
+    }
+}
+
+static void lowerStatement(IRBuilder* builder, ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case AST_DECLARATION:
+            lowerDeclaration(builder, (ASTDeclarationNode*)node);
+            break;
+        case AST_BLOCK:
+            enterBlock(builder);
+            lowerStatementList(builder, ((ASTBlockNode*)node)->statements);
+            leaveBlock(builder);
+            break;
+        case AST_BINARY_OP:
+            if (((ASTBinaryOpNode*)node)->op == OP_ASSIGN) {
+                lowerAssignment(builder, (ASTBinaryOpNode*)node);
+            } else {
+                lowerExpression(builder, node);
+            }
+            break;
+        case AST_IF: {
+            ASTIfNode* ifNode = (ASTIfNode*)node;
+            int elseLabel = newIRLabel(builder->function);
+            int endLabel = newIRLabel(builder->function);
+            int condition = lowerExpression(builder, ifNode->condition);
+            emitJump(builder, IR_JUMPZ, condition, elseLabel);
+            lowerStatement(builder, ifNode->trueBlock);
+            emitJump(builder, IR_JUMP, -1, endLabel);
+            emitLabel(builder, elseLabel);
+            lowerStatement(builder, ifNode->falseBlock);
+            emitLabel(builder, endLabel);
+            break;
+        }
+        case AST_WHILE: {
+            // Inverted loop: the condition is tested once before entering and again at the bottom,
+            // so the body runs with one jump per iteration and always reaches the exit test
+            ASTWhileNode* whileNode = (ASTWhileNode*)node;
+            int bodyLabel = newIRLabel(builder->function);
+            int endLabel = newIRLabel(builder->function);
+            int condition = lowerExpression(builder, whileNode->condition);
+            emitJump(builder, IR_JUMPZ, condition, endLabel);
+            emitLabel(builder, bodyLabel);
+            lowerStatement(builder, whileNode->body);
+            condition = lowerExpression(builder, whileNode->condition);
+            emitJump(builder, IR_JUMPNZ, condition, bodyLabel);
+            emitLabel(builder, endLabel);
+            break;
+        }
+        case AST_RETURN: {
+            ASTReturnNode* returnNode = (ASTReturnNode*)node;
+            int value = lowerExpression(builder, returnNode->expression);
+            emit(builder, IR_RETURN, -1, value, -1);
+            break;
+        }
+        case AST_PRINT: {
+            for (ASTNode* arg = ((ASTPrintNode*)node)->arguments; arg; arg = arg->next) {
+                int value = lowerExpression(builder, arg);
+                if (value >= 0) {
+                    emit(builder, IR_PRINT, -1, value, -1);
+                }
+            }
+            break;
+        }
+        default:
+            lowerExpression(builder, node); // Expression used as a statement
+            break;
+    }
+}
+
+//Functions
+
+static IRFunction* lowerFunction(IRProgram* program, ASTFunctionNode* node, ASTClassNode* owner, bool* failed) {
+    char* name;
+    if (owner) {
+        size_t length = strlen(owner->name) + strlen(node->name) + 2;
+        name = checkedMalloc(length, ALLOC_IR);
+        snprintf(name, length, "%s.%s", owner->name, node->name);
+    } else {
+        name = compilerStrdup(node->name, ALLOC_IR);
+    }
+
+    IRBuilder builder = {program, NULL, owner, NULL, 0, false};
+    builder.function = createIRFunction(name, owner ? owner->name : NULL, typeFromName(node->returnType));
+    compilerFree(name);
+    IRFunction* function = builder.function;
+
+    enterBlock(&builder);
+    if (owner) {
+        int self = newIRValue(function, IR_TYPE_OBJECT, owner->name, "this");
+        function->values[self].paramIndex = function->param_count++;
+    }
+    for (ASTNode* param = node->parameters; param; param = param->next) {
+        ASTDeclarationNode* declaration = (ASTDeclarationNode*)param;
+        int value = newIRValue(function, typeFromName(declaration->type), declaration->type, declaration->name);
+        function->values[value].paramIndex = function->param_count++;
+        declareVariable(&builder, declaration->name, value);
+    }
+
+    if (node->body) {
+        lowerStatement(&builder, node->body);
+    }
+
+    // Falling off the end returns the default value of the return type
+    if (!function->last || function->last->op != IR_RETURN) {
+        int value = -1;
+        if (function->returnType != IR_TYPE_VOID) {
+            value = newIRValue(function, function->returnType, node->returnType, NULL);
+            emitDefaultValue(&builder, value);
+        }
+        emit(&builder, IR_RETURN, -1, value, -1);
+    }
+    leaveBlock(&builder);
+
+    if (builder.failed) *failed = true;
+    return function;
+}
+
+static void appendIRFunction(IRProgram* program, IRFunction* function) {
+    IRFunction** tail = &program->functions;
+    while (*tail) tail = &(*tail)->next;
+    *tail = function;
+}
+
+void freeIRProgram(IRProgram* program) {
+    if (!program) return;
+    IRFunction* function = program->functions;
+    while (function) {
+        IRFunction* next = function->next;
+        IRInstr* instr = function->first;
+        while (instr) {
+            IRInstr* nextInstr = instr->next;
+            freeIRInstr(instr);
+            instr = nextInstr;
+        }
+        for (int v = 0; v < function->value_count; v++) {
+            compilerFree(function->values[v].className);
+            compilerFree(function->values[v].name);
+        }
+        compilerFree(function->values);
+        compilerFree(function->name);
+        compilerFree(function->className);
+        compilerFree(function);
+        function = next;
+    }
+    compilerFree(program);
+}
+
+static IRProgram* buildProgramIR(ASTNode* root, SymbolTable* symbolTable, const bool* units, bool library) {
+    if (!root || root->type != AST_PROGRAM) return NULL;
+
+    IRProgram* program = (IRProgram*)checkedMalloc(sizeof(IRProgram), ALLOC_IR);
+    program->functions = NULL;
+    program->ast = (ASTProgramNode*)root;
+    program->symbolTable = symbolTable;
+    program->open_classes = library;
+
+    bool failed = false;
+    int unit = 0;
+    for (ASTNode* node = program->ast->classes; node; node = node->next, unit++) {
+        ASTClassNode* classNode = (ASTClassNode*)node;
+        for (ASTNode* member = classNode->members; member && (!units || units[unit]); member = member->next) {
+            if (member->type == AST_FUNCTION) {
+                appendIRFunction(program, lowerFunction(program, (ASTFunctionNode*)member, classNode, &failed));
+            }
+        }
+    }
+    for (ASTNode* node = program->ast->functions; node; node = node->next, unit++) {
+        if (units && !units[unit]) continue;
+        appendIRFunction(program, lowerFunction(program, (ASTFunctionNode*)node, NULL, &failed));
+    }
+
+    if (!library && !findFunction(program, "main")) {
+        fprintf(stderr, "Error: the program has no 'main' function.\n");
+        failed = true;
+    }
+    return failed ? NULL : program;
+}
+
+IRProgram* buildIR(ASTNode* root, SymbolTable* symbolTable, const bool* units) {
+    return buildProgramIR(root, symbolTable, units, false);
+}
+
+IRProgram* buildLibraryIR(ASTNode* root, SymbolTable* symbolTable, const bool* units) {
+    return buildProgramIR(root, symbolTable, units, true);
+}
+
+//Debug output
+
+const char* getIROpcodeName(IROpcode op) {
+    switch (op) {
+        case IR_CONST_INT: return "const";
+        case IR_CONST_STR: return "conststr";
+        case IR_MOVE: return "move";
+        case IR_ADD: return "add";
+        case IR_SUB: return "sub";
+        case IR_MUL: return "mul";
+        case IR_DIV: return "div";
+        case IR_LT: return "lt";
+        case IR_GT: return "gt";
+        case IR_LE: return "le";
+        case IR_GE: return "ge";
+        case IR_EQ: return "eq";
+        case IR_NE: return "ne";
+        case IR_NOT: return "not";
+        case IR_NEG: return "neg";
+        case IR_CONCAT: return "concat";
+        case IR_INT2STR: return "int2str";
+        case IR_STRLEN: return "strlen";
+        case IR_SUBSTR: return "substr";
+        case IR_READ_INT: return "readint";
+        case IR_READ_STR: return "readstr";
+        case IR_PRINT: return "print";
+        case IR_NEW: return "new";
+        case IR_GETFIELD: return "getfield";
+        case IR_SETFIELD: return "setfield";
+        case IR_CALL: return "call";
+        case IR_CALL_METHOD: return "callmethod";
+        case IR_LABEL: return "label";
+        case IR_JUMP: return "jump";
+        case IR_JUMPZ: return "jumpz";
+        case IR_JUMPNZ: return "jumpnz";
+        case IR_RETURN: return "return";
+        default: return "unknown";
+    }
+}
+
+void printIR(IRProgram* program, FILE* out) {
+    for (IRFunction* function = program->functions; function; function = function->next) {
+        fprintf(out, "function %s (%d params, %d values)\n", function->name, function->param_count,
+                function->value_count);
+        for (IRInstr* instr = function->first; instr; instr = instr->next) {
+            if (instr->op == IR_LABEL) {
+                fprintf(out, "  L%ld:\n", instr->imm);
+                continue;
+            }
+            fprintf(out, "    ");
+            if (instr->dst >= 0) fprintf(out, "v%d = ", instr->dst);
+            fprintf(out, "%s", getIROpcodeName(instr->op));
+            if (instr->src1 >= 0) fprintf(out, " v%d", instr->src1);
+            if (instr->src2 >= 0) fprintf(out, " v%d", instr->src2);
+            for (int i = 0; i < instr->arg_count; i++) fprintf(out, " v%d", instr->args[i]);
+            if (instr->op == IR_CONST_INT) fprintf(out, " %ld", instr->imm);
+            if (instr->op == IR_JUMP || instr->op == IR_JUMPZ || instr->op == IR_JUMPNZ) {
+                fprintf(out, " L%ld", instr->imm);
+            }
+            if (instr->name) {
+                fprintf(out, instr->op == IR_CONST_STR ? " \"%s\"" : " %s", instr->name);
+            }
+            fprintf(out, "\n");
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef IR_H
+#define IR_H
+
+#include "ast.h"
+#include "symbol_table.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Type of a virtual register
+typedef enum {
+    IR_TYPE_VOID,
+    IR_TYPE_INT,
+    IR_TYPE_STRING,
+    IR_TYPE_OBJECT,
+} IRType;
+
+// IR operation codes (three-address code)
+typedef enum {
+    IR_CONST_INT,   // dst = imm
+    IR_CONST_STR,   // dst = "name"
+    IR_MOVE,        // dst = src1
+    IR_ADD,         // dst = src1 + src2
+    IR_SUB,         // dst = src1 - src2
+    IR_MUL,         // dst = src1 * src2
+    IR_DIV,         // dst = src1 / src2
+    IR_LT,          // dst = src1 < src2 (int or string)
+    IR_GT,          // dst = src1 > src2
+    IR_LE,          // dst = src1 <= src2
+    IR_GE,          // dst = src1 >= src2
+    IR_EQ,          // dst = src1 == src2
+    IR_NE,          // dst = src1 != src2
+    IR_NOT,         // dst = !src1
+    IR_NEG,         // dst = -src1
+    IR_CONCAT,      // dst = args[0] + ... + args[n-1] (strings)
+    IR_INT2STR,     // dst = (string)src1
+    IR_STRLEN,      // dst = length(src1)
+    IR_SUBSTR,      // dst = subStr(args[0], args[1], args[2])
+    IR_READ_INT,    // dst = readInt()
+    IR_READ_STR,    // dst = readString()
+    IR_PRINT,       // print(src1), int or string depending on its type
+    IR_NEW,         // dst = new name
+    IR_GETFIELD,    // dst = src1.name
+    IR_SETFIELD,    // src1.name = src2
+    IR_CALL,        // dst = name(args)
+    IR_CALL_METHOD, // dst = args[0].name(args[1..]), name is "Class.method"
+    IR_LABEL,       // label imm
+    IR_JUMP,        // goto imm
+    IR_JUMPZ,       // if (!src1) goto imm
+    IR_JUMPNZ,      // if (src1) goto imm
+    IR_RETURN,      // return src1 (src1 can be -1)
+} IROpcode;
+
+// One IR instruction
+typedef struct IRInstr {
+    IROpcode op;
+    int dst;                       // Virtual register written (-1 if none)
+    int src1;                      // First virtual register read (-1 if none)
+    int src2;                      // Second virtual register read (-1 if none)
+    long imm;                      // Integer constant or label number
+    char* name;                    // Function, method, field, class or string literal
+    int* args;                     // Call arguments (virtual registers)
+    int arg_count;
+    struct IRInstr* next;          // Next instruction in the function
+    struct IRInstr* prev;          // Previous instruction in the function
+} IRInstr;
+
+// Information about one virtual register
+typedef struct {
+    IRType type;
+    char* className;               // Class of an object value (can be null)
+    char* name;                    // Source variable name (null for temporaries)
+    int paramIndex;                // Position in the parameter list, -1 for the rest
+} IRValue;
+
+// One function or method
+typedef struct IRFunction {
+    char* name;                    // "main" or "Class.method"
+    char* className;               // Owner class of a method (null for functions)
+    IRType returnType;
+    int param_count;               // Includes 'this' for methods
+    IRValue* values;               // Virtual registers
+    int value_count;
+    int value_capacity;
+    int label_count;               // Labels used inside the function
+    IRInstr* first;                // Instruction list
+    IRInstr* last;
+    struct IRFunction* next;       // Next function in the program
+} IRFunction;
+
+// Whole program
+typedef struct {
+    IRFunction* functions;         // Functions and methods
+    ASTProgramNode* ast;           // Source program (classes are still read from it)
+    SymbolTable* symbolTable;
+    bool open_classes;             // Other programs can add subclasses (code of an interface)
+} IRProgram;
+
+// Lowering from the checked AST. units (can be NULL for all of them) selects the top-level
+// classes and functions that are lowered, indexed classes first and then functions.
+IRProgram* buildIR(ASTNode* root, SymbolTable* symbolTable, const bool* units);
+
+// The same for a module compiled into an interface: it needs no main, and since the programs that
+// import it can override any method, no method call has a single known target
+IRProgram* buildLibraryIR(ASTNode* root, SymbolTable* symbolTable, const bool* units);
+
+// Functions of the program and the program itself; the AST and the symbol table stay
+void freeIRProgram(IRProgram* program);
+
+// Class of the source program with the given name (null if it does not exist)
+ASTClassNode* findIRClass(IRProgram* program, const char* className);
+bool isIRCallTarget(IRProgram* program, IRInstr* call, IRFunction* function);
+
+// Whether a subclass declares the method again. Read from the classes of the source, so it
+// also sees the overrides that are not lowered. Always true for the classes of an interface.
+bool isIRMethodOverridden(IRProgram* program, const char* className, const char* methodName);
+
+// Helpers to build and edit instruction lists
+int newIRValue(IRFunction* function, IRType type, const char* className, const char* name);
+int newIRLabel(IRFunction* function);
+IRInstr* createIRInstr(IROpcode op, int dst, int src1, int src2);
+void appendIRInstr(IRFunction* function, IRInstr* instr);
+void insertIRInstrBefore(IRFunction* function, IRInstr* position, IRInstr* instr);
+void removeIRInstr(IRFunction* function, IRInstr* instr);
+void freeIRInstr(IRInstr* instr);
+int getIRInstrUses(IRInstr* instr, int* uses, int max_uses);
+bool isIRCall(IRInstr* instr);
+
+// Debug output
+const char* getIROpcodeName(IROpcode op);
+void printIR(IRProgram* program, FILE* out);
+
+#endif // IR_H
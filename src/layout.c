@@ -0,0 +1,169 @@
+#include "layout.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static int countClasses(IRProgram* program) {
+    int count = 0;
+    for (ASTNode* node = program->ast->classes; node; node = node->next) count++;
+    return count;
+}
+
+static int findField(ClassLayout* layout, const char* name) {
+    for (int f = 0; f < layout->field_count; f++) {
+        if (strcmp(layout->fields[f].name, name) == 0) return f;
+    }
+    return -1;
+}
+
+static int findMethod(ClassLayout* layout, const char* name) {
+    for (int m = 0; m < layout->method_count; m++) {
+        if (strcmp(layout->methods[m].name, name) == 0) return m;
+    }
+    return -1;
+}
+
+// The layout of a class starts as a copy of the one of its parent: an attribute declared again
+// keeps the inherited word and an override takes the slot of the method it replaces
+static void layoutClass(ProgramLayout* layout, ASTClassNode* classNode, int parent, int capacity) {
+    ClassLayout* current = &layout->classes[layout->class_count];
+    current->name = compilerStrdup(classNode->name, ALLOC_ANALYSIS);
+    current->parent = parent;
+    current->fields = checkedCalloc(capacity, sizeof(FieldLayout), ALLOC_ANALYSIS);
+    current->methods = checkedCalloc(capacity, sizeof(MethodLayout), ALLOC_ANALYSIS);
+    current->size = 1;
+    current->vtable_address = layout->class_count + 1;
+
+    if (parent >= 0) {
+        ClassLayout* inherited = &layout->classes[parent];
+        for (int f = 0; f < inherited->field_count; f++) {
+            current->fields[f].name = compilerStrdup(inherited->fields[f].name, ALLOC_ANALYSIS);
+            current->fields[f].type = compilerStrdup(inherited->fields[f].type, ALLOC_ANALYSIS);
+            current->fields[f].offset = inherited->fields[f].offset;
+        }
+        for (int m = 0; m < inherited->method_count; m++) {
+            current->methods[m].name = compilerStrdup(inherited->methods[m].name, ALLOC_ANALYSIS);
+            current->methods[m].owner = compilerStrdup(inherited->methods[m].owner, ALLOC_ANALYSIS);
+        }
+        current->field_count = inherited->field_count;
+        current->method_count = inherited->method_count;
+        current->size = inherited->size;
+    }
+
+    for (ASTNode* member = classNode->members; member; member = member->next) {
+        if (member->type == AST_DECLARATION) {
+            ASTDeclarationNode* field = (ASTDeclarationNode*)member;
+            if (findField(current, field->name) >= 0) continue;
+            FieldLayout* slot = &current->fields[current->field_count++];
+            slot->name = compilerStrdup(field->name, ALLOC_ANALYSIS);
+            slot->type = compilerStrdup(field->type, ALLOC_ANALYSIS);
+            slot->offset = current->size++;
+        } else if (member->type == AST_FUNCTION) {
+            ASTFunctionNode* method = (ASTFunctionNode*)member;
+            if (strcmp(method->name, classNode->name) == 0) continue;   // Constructors are not virtual
+            int slot = findMethod(current, method->name);
+            if (slot < 0) {
+                slot = current->method_count++;
+                current->methods[slot].name = compilerStrdup(method->name, ALLOC_ANALYSIS);
+            } else {
+                compilerFree(current->methods[slot].owner);
+            }
+            current->methods[slot].owner = compilerStrdup(classNode->name, ALLOC_ANALYSIS);
+        }
+    }
+    layout->class_count++;
+}
+
+// Room for the members of a class and all its ancestors
+static int countMembers(IRProgram* program, ASTClassNode* classNode) {
+    int count = 0;
+    int depth = 0;
+    for (ASTClassNode* current = classNode; current && depth < MAX_SYMBOLS;
+         current = findIRClass(program, current->parent), depth++) {
+        for (ASTNode* member = current->members; member; member = member->next) count++;
+    }
+    return count;
+}
+
+ProgramLayout* buildProgramLayout(IRProgram* program) {
+    ProgramLayout* layout = checkedCalloc(1, sizeof(ProgramLayout), ALLOC_ANALYSIS);
+    int total = countClasses(program);
+    layout->classes = checkedCalloc(total, sizeof(ClassLayout), ALLOC_ANALYSIS);
+
+    // The classes can be declared in any order, a class is laid out once its parent is
+    bool progress = true;
+    while (layout->class_count < total && progress) {
+        progress = false;
+        for (ASTNode* node = program->ast->classes; node; node = node->next) {
+            ASTClassNode* classNode = (ASTClassNode*)node;
+            if (findClassLayout(layout, classNode->name)) continue;
+            int parent = -1;
+            if (findIRClass(program, classNode->parent)) {
+                ClassLayout* parentLayout = findClassLayout(layout, classNode->parent);
+                if (!parentLayout) continue;
+                parent = parentLayout - layout->classes;
+            }
+            layoutClass(layout, classNode, parent, countMembers(program, classNode));
+            progress = true;
+        }
+    }
+    return layout;
+}
+
+void freeProgramLayout(ProgramLayout* layout) {
+    if (!layout) return;
+    for (int c = 0; c < layout->class_count; c++) {
+        ClassLayout* current = &layout->classes[c];
+        for (int f = 0; f < current->field_count; f++) {
+            compilerFree(current->fields[f].name);
+            compilerFree(current->fields[f].type);
+        }
+        for (int m = 0; m < current->method_count; m++) {
+            compilerFree(current->methods[m].name);
+            compilerFree(current->methods[m].owner);
+        }
+        compilerFree(current->fields);
+        compilerFree(current->methods);
+        compilerFree(current->name);
+    }
+    compilerFree(layout->classes);
+    compilerFree(layout);
+}
+
+ClassLayout* findClassLayout(ProgramLayout* layout, const char* className) {
+    if (!className) return NULL;
+    for (int c = 0; c < layout->class_count; c++) {
+        if (strcmp(layout->classes[c].name, className) == 0) return &layout->classes[c];
+    }
+    return NULL;
+}
+
+int getFieldOffset(ProgramLayout* layout, const char* className, const char* fieldName) {
+    ClassLayout* current = findClassLayout(layout, className);
+    int field = current ? findField(current, fieldName) : -1;
+    return field >= 0 ? current->fields[field].offset : -1;
+}
+
+int getMethodSlot(ProgramLayout* layout, const char* className, const char* methodName) {
+    ClassLayout* current = findClassLayout(layout, className);
+    return current ? findMethod(current, methodName) : -1;
+}
+
+static bool isSubclass(ProgramLayout* layout, int candidate, int ancestor) {
+    for (int c = candidate; c >= 0; c = layout->classes[c].parent) {
+        if (c == ancestor) return true;
+    }
+    return false;
+}
+
+bool isMethodOverridden(ProgramLayout* layout, const char* className, int slot) {
+    ClassLayout* base = findClassLayout(layout, className);
+    if (!base || slot < 0 || slot >= base->method_count) return false;
+    int index = base - layout->classes;
+    for (int c = 0; c < layout->class_count; c++) {
+        if (c == index || !isSubclass(layout, c, index)) continue;
+        if (strcmp(layout->classes[c].methods[slot].owner, base->methods[slot].owner) != 0) return true;
+    }
+    return false;
+}
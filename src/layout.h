@@ -0,0 +1,49 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "ir.h"
+
+#define VTABLE_CLASS_NAME 0        // Word of a vtable with the name of the class
+#define VTABLE_FIRST_METHOD 1      // Word of the label of the method in slot 0
+
+// Attribute kept in a fixed word of the object chunk
+typedef struct {
+    char* name;
+    char* type;
+    int offset;
+} FieldLayout;
+
+// Method in a vtable slot and the class whose code runs for it
+typedef struct {
+    char* name;
+    char* owner;
+} MethodLayout;
+
+// Chunk of the objects of one class; word 0 is the chunk id of the vtable of the class
+typedef struct {
+    char* name;
+    int parent;                    // Index of the parent layout (-1 when the parent is Object)
+    FieldLayout* fields;           // Inherited first, at the offsets they have in the parent
+    int field_count;
+    int size;                      // Words of the chunk
+    MethodLayout* methods;         // Indexed by slot, the slots of the parent keep their index
+    int method_count;
+    int vtable_address;            // Stack word (absolute) that holds the chunk id of the vtable
+} ClassLayout;
+
+typedef struct {
+    ClassLayout* classes;          // Parents before their subclasses
+    int class_count;
+} ProgramLayout;
+
+ProgramLayout* buildProgramLayout(IRProgram* program);
+void freeProgramLayout(ProgramLayout* layout);
+
+ClassLayout* findClassLayout(ProgramLayout* layout, const char* className);
+int getFieldOffset(ProgramLayout* layout, const char* className, const char* fieldName);
+int getMethodSlot(ProgramLayout* layout, const char* className, const char* methodName);
+
+// Whether a subclass of the class runs other code for the slot
+bool isMethodOverridden(ProgramLayout* layout, const char* className, int slot);
+
+#endif // LAYOUT_H
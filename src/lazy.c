@@ -0,0 +1,194 @@
+#include "lazy.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Names reached so far; the strings belong to the AST
+typedef struct {
+    const char** names;
+    int count;
+    int capacity;
+} NameSet;
+
+typedef struct {
+    ASTProgramNode* program;
+    NameSet functions;             // Functions called by name
+    NameSet methods;               // Methods called on any object, constructors and called names
+} Reachability;
+
+static bool hasName(NameSet* set, const char* name) {
+    for (int n = 0; n < set->count; n++) {
+        if (strcmp(set->names[n], name) == 0) return true;
+    }
+    return false;
+}
+
+static void addName(NameSet* set, const char* name) {
+    if (!name || hasName(set, name)) return;
+    if (set->count == set->capacity) {
+        set->capacity = set->capacity ? set->capacity * 2 : 16;
+        set->names = checkedRealloc(set->names, set->capacity * sizeof(char*), ALLOC_ANALYSIS);
+    }
+    set->names[set->count++] = name;
+}
+
+static ASTClassNode* findClass(ASTProgramNode* program, const char* name) {
+    for (ASTNode* node = program->classes; node && name; node = node->next) {
+        if (strcmp(((ASTClassNode*)node)->name, name) == 0) return (ASTClassNode*)node;
+    }
+    return NULL;
+}
+
+//Calls
+
+static void collectCalls(Reachability* reach, ASTNode* node);
+
+static void collectCall(Reachability* reach, ASTNode* node) {
+    switch (node->type) {
+        case AST_FUNCTION_CALL: {
+            ASTFunctionCallNode* call = (ASTFunctionCallNode*)node;
+            addName(&reach->functions, call->functionName);
+            addName(&reach->methods, call->functionName);
+            if (call->context && call->context->type == AST_VARIABLE) {
+                addName(&reach->functions, ((ASTVariableNode*)call->context)->name);
+            } else if (call->context && call->context->type == AST_MEMBER_ACCESS) {
+                addName(&reach->methods, ((ASTMemberAccessNode*)call->context)->memberName);
+            }
+            collectCalls(reach, call->context);
+            collectCalls(reach, call->arguments);
+            break;
+        }
+        case AST_METHOD_CALL:
+            addName(&reach->methods, ((ASTMethodCallNode*)node)->methodName);
+            collectCalls(reach, ((ASTMethodCallNode*)node)->expression);
+            collectCalls(reach, ((ASTMethodCallNode*)node)->arguments);
+            break;
+        case AST_NEW:
+            // The routine of the class runs the constructors of its ancestors too
+            for (ASTClassNode* classNode = findClass(reach->program, ((ASTNewNode*)node)->className); classNode;
+                 classNode = findClass(reach->program, classNode->parent)) {
+                addName(&reach->methods, classNode->name);
+            }
+            collectCalls(reach, ((ASTNewNode*)node)->arguments);
+            break;
+        case AST_DECLARATION:
+            collectCalls(reach, ((ASTDeclarationNode*)node)->init);
+            break;
+        case AST_BLOCK:
+            collectCalls(reach, ((ASTBlockNode*)node)->statements);
+            break;
+        case AST_IF:
+            collectCalls(reach, ((ASTIfNode*)node)->condition);
+            collectCalls(reach, ((ASTIfNode*)node)->trueBlock);
+            collectCalls(reach, ((ASTIfNode*)node)->falseBlock);
+            break;
+        case AST_WHILE:
+            collectCalls(reach, ((ASTWhileNode*)node)->condition);
+            collectCalls(reach, ((ASTWhileNode*)node)->body);
+            break;
+        case AST_RETURN:
+            collectCalls(reach, ((ASTReturnNode*)node)->expression);
+            break;
+        case AST_PRINT:
+            collectCalls(reach, ((ASTPrintNode*)node)->arguments);
+            break;
+        case AST_BINARY_OP:
+            collectCalls(reach, ((ASTBinaryOpNode*)node)->left);
+            collectCalls(reach, ((ASTBinaryOpNode*)node)->right);
+            break;
+        case AST_UNARY_OP:
+            collectCalls(reach, ((ASTUnaryOpNode*)node)->operand);
+            break;
+        case AST_MEMBER_ACCESS:
+            collectCalls(reach, ((ASTMemberAccessNode*)node)->expression);
+            break;
+        case AST_TYPE_CAST:
+            collectCalls(reach, ((ASTTypeCastNode*)node)->expression);
+            break;
+        default:
+            break;
+    }
+}
+
+static void collectCalls(Reachability* reach, ASTNode* node) {
+    for (; node; node = node->next) collectCall(reach, node);
+}
+
+//Bodies
+
+// Parse the body of the function when it is still in tokens and can run; -1 on a syntax error
+static int parseBody(Reachability* reach, ASTFunctionNode* function, bool reached, LazyStats* stats) {
+    if (!function->body || function->body->type != AST_LAZY_BODY || !reached) return 0;
+    ASTNode* block = parseLazyBody((ASTLazyBodyNode*)function->body);
+    if (!block) return -1;
+    freeAST(function->body);
+    function->body = block;
+    collectCalls(reach, block);
+    stats->parsed++;
+    return 1;
+}
+
+static bool isLazy(ASTFunctionNode* function) {
+    return function->body && function->body->type == AST_LAZY_BODY;
+}
+
+int parseReachableBodies(ASTProgramNode* program, LazyStats* stats) {
+    memset(stats, 0, sizeof(LazyStats));
+    Reachability reach = {program, {NULL, 0, 0}, {NULL, 0, 0}};
+    for (ASTNode* node = program->classes; node; node = node->next) {
+        for (ASTNode* member = ((ASTClassNode*)node)->members; member; member = member->next) {
+            if (member->type == AST_FUNCTION && isLazy((ASTFunctionNode*)member)) stats->bodies++;
+        }
+    }
+    for (ASTNode* node = program->functions; node; node = node->next) {
+        if (isLazy((ASTFunctionNode*)node)) stats->bodies++;
+    }
+    addName(&reach.functions, "main");
+
+    // Sweep the source until a sweep parses nothing new
+    int result = 1;
+    while (result > 0) {
+        result = 0;
+        for (ASTNode* node = program->classes; node && result >= 0; node = node->next) {
+            for (ASTNode* member = ((ASTClassNode*)node)->members; member && result >= 0; member = member->next) {
+                if (member->type != AST_FUNCTION) continue;
+                ASTFunctionNode* method = (ASTFunctionNode*)member;
+                int parsed = parseBody(&reach, method, hasName(&reach.methods, method->name), stats);
+                result = parsed < 0 ? -1 : result + parsed;
+            }
+        }
+        for (ASTNode* node = program->functions; node && result >= 0; node = node->next) {
+            ASTFunctionNode* function = (ASTFunctionNode*)node;
+            int parsed = parseBody(&reach, function, hasName(&reach.functions, function->name), stats);
+            result = parsed < 0 ? -1 : result + parsed;
+        }
+    }
+    compilerFree(reach.functions.names);
+    compilerFree(reach.methods.names);
+    if (result < 0) {
+        fprintf(stderr, "Error during syntactic analysis.\n");
+        return 12;
+    }
+
+    // What is still in tokens never runs
+    for (ASTNode* node = program->classes; node; node = node->next) {
+        for (ASTNode* member = ((ASTClassNode*)node)->members; member; member = member->next) {
+            if (member->type != AST_FUNCTION || !isLazy((ASTFunctionNode*)member)) continue;
+            freeAST(((ASTFunctionNode*)member)->body);
+            ((ASTFunctionNode*)member)->body = NULL;
+        }
+    }
+    ASTNode** link = &program->functions;
+    while (*link) {
+        ASTNode* node = *link;
+        if (!isLazy((ASTFunctionNode*)node)) {
+            link = &node->next;
+            continue;
+        }
+        *link = node->next;
+        node->next = NULL;
+        freeAST(node);
+        stats->dropped++;
+    }
+    return 0;
+}
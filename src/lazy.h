@@ -0,0 +1,21 @@
+#ifndef LAZY_H
+#define LAZY_H
+
+#include "ast.h"
+
+// Totals of the lazy parsing of one file
+typedef struct {
+    int bodies;                    // Bodies the parser kept in tokens
+    int parsed;                    // Bodies that can run and were parsed
+    int dropped;                   // Functions removed because nothing calls them
+} LazyStats;
+
+// Parse the bodies kept by the lazy parser that can run, starting from main: the functions called
+// by name, every method with the name of a called method and the constructors of the created
+// classes and of their ancestors. Bodies are parsed in the order of the source, so the symbol
+// table fills like with the parse of the whole file. The functions that cannot run are removed;
+// the methods keep an empty body, since the vtables still name them. Returns 0, or the exit
+// status of vypcomp when a body has a syntax error.
+int parseReachableBodies(ASTProgramNode* program, LazyStats* stats);
+
+#endif // LAZY_H
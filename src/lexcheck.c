@@ -0,0 +1,156 @@
+#include "scanner.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Differential check of the hand-written scanner against the flex one: both read every file
+// given on the command line, and their tokens and values have to be the same. It reports the
+// tokens per second of each one too.
+//
+//   lexcheck [--repeat=N] file...
+
+extern FILE* yyin;
+extern int yy_flex_debug;
+extern int yylex();
+extern void yyrestart(FILE* file);
+
+YYSTYPE yylval;                    // The parser defines it in vypcomp
+
+typedef struct {
+    int token;
+    int ival;
+    char* sval;
+} CheckedToken;
+
+typedef struct {
+    CheckedToken* tokens;
+    int count;
+    int capacity;
+} TokenList;
+
+static void addToken(TokenList* list, int token, YYSTYPE* value) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->tokens = checkedRealloc(list->tokens, list->capacity * sizeof(CheckedToken), ALLOC_TOKEN);
+    }
+    bool text = token == INT || token == STRING || token == VOID || token == IDENTIFIER || token == STRING_LITERAL;
+    list->tokens[list->count++] = (CheckedToken){token, token == INTEGER_LITERAL ? value->ival : 0, text ? value->sval : NULL};
+}
+
+static void freeTokens(TokenList* list) {
+    for (int t = 0; t < list->count; t++) free(list->tokens[t].sval);
+    list->count = 0;
+}
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Tokens of the file with flex; returns the seconds it took
+static double lexWithFlex(FILE* file, TokenList* list) {
+    rewind(file);
+    yyin = file;
+    yyrestart(file);
+    double start = now();
+    int token;
+    while ((token = yylex()) != 0) addToken(list, token, &yylval);
+    return now() - start;
+}
+
+static double lexWithScanner(FILE* file, TokenList* list) {
+    rewind(file);
+    double start = now();
+    Scanner scanner;
+    if (!openScanner(&scanner, file)) return -1;
+    YYSTYPE value;
+    int token;
+    while ((token = scanToken(&scanner, &value)) != 0) addToken(list, token, &value);
+    closeScanner(&scanner);
+    return now() - start;
+}
+
+static bool sameToken(CheckedToken* a, CheckedToken* b) {
+    if (a->token != b->token || a->ival != b->ival) return false;
+    if (!a->sval || !b->sval) return a->sval == b->sval;
+    return strcmp(a->sval, b->sval) == 0;
+}
+
+static void printToken(const char* lexer, CheckedToken* token) {
+    fprintf(stderr, "  %-8s token %d", lexer, token->token);
+    if (token->sval) fprintf(stderr, " \"%s\"", token->sval);
+    if (token->token == INTEGER_LITERAL) fprintf(stderr, " %d", token->ival);
+    fprintf(stderr, "\n");
+}
+
+// Number of differences of the file, after the first one it stops
+static int checkFile(const char* path, int repeat, double* flexTime, double* scannerTime, long* tokens) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: could not open %s.\n", path);
+        return 1;
+    }
+    TokenList expected = {NULL, 0, 0};
+    TokenList actual = {NULL, 0, 0};
+    for (int r = 0; r < repeat; r++) {
+        freeTokens(&expected);
+        freeTokens(&actual);
+        *flexTime += lexWithFlex(file, &expected);
+        double time = lexWithScanner(file, &actual);
+        if (time < 0) {
+            fprintf(stderr, "Error: could not read %s.\n", path);
+            fclose(file);
+            return 1;
+        }
+        *scannerTime += time;
+        *tokens += expected.count;
+    }
+    fclose(file);
+
+    int differences = 0;
+    int count = expected.count > actual.count ? expected.count : actual.count;
+    for (int t = 0; t < count && !differences; t++) {
+        if (t < expected.count && t < actual.count && sameToken(&expected.tokens[t], &actual.tokens[t])) continue;
+        fprintf(stderr, "%s: token %d differs\n", path, t);
+        if (t < expected.count) printToken("flex", &expected.tokens[t]);
+        else fprintf(stderr, "  %-8s end of the input\n", "flex");
+        if (t < actual.count) printToken("scanner", &actual.tokens[t]);
+        else fprintf(stderr, "  %-8s end of the input\n", "scanner");
+        differences++;
+    }
+    freeTokens(&expected);
+    freeTokens(&actual);
+    free(expected.tokens);
+    free(actual.tokens);
+    return differences;
+}
+
+int main(int argc, char** argv) {
+    int repeat = 1;
+    int first = 1;
+    if (argc > 1 && strncmp(argv[1], "--repeat=", 9) == 0) {
+        repeat = atoi(argv[1] + 9);
+        first = 2;
+    }
+    if (first >= argc || repeat < 1) {
+        fprintf(stderr, "Usage: %s [--repeat=N] file...\n", argv[0]);
+        return 19;
+    }
+    yy_flex_debug = 0;
+
+    int failed = 0;
+    double flexTime = 0;
+    double scannerTime = 0;
+    long tokens = 0;
+    for (int a = first; a < argc; a++) {
+        if (checkFile(argv[a], repeat, &flexTime, &scannerTime, &tokens)) failed++;
+    }
+    printf("Lexer check: %d of %d files differ, %ld tokens.\n", failed, argc - first, tokens);
+    if (flexTime > 0 && scannerTime > 0) {
+        printf("flex: %.1f Mtokens/s, scanner (%s): %.1f Mtokens/s, %.2fx.\n", tokens / flexTime / 1e6,
+               getScannerKind(), tokens / scannerTime / 1e6, flexTime / scannerTime);
+    }
+    return failed ? 1 : 0;
+}
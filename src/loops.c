@@ -0,0 +1,482 @@
+#include "loops.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_USES 64
+
+// What a function can do besides computing its result
+typedef struct {
+    IRFunction* function;
+    bool pure;                     // No side effects, result only depends on arguments and attributes
+    bool writesFields;             // Can change an attribute of an object that already exists
+} FunctionEffects;
+
+typedef struct {
+    IRProgram* program;
+    FunctionEffects* effects;
+    int function_count;
+    LoopStats* stats;
+} LoopOptimizer;
+
+// Instruction of the loop being optimized
+typedef struct {
+    IRInstr* instr;
+    int block;
+    bool hoisted;
+} LoopInstr;
+
+// Basic induction variable: one update i = i +/- step per iteration
+typedef struct {
+    int value;
+    int step;
+    bool subtract;
+    IRInstr* update;               // Instruction after which i has its new value
+} InductionVariable;
+
+//Effects of the calls
+
+// Whether every possible target of a call is pure, or only that none of them writes attributes
+static bool callIsPure(LoopOptimizer* opt, IRInstr* call, bool onlyFields) {
+    if (call->op == IR_CALL_METHOD && opt->program->open_classes) return false;   // Overrides of other programs
+    bool found = false;
+    for (int f = 0; f < opt->function_count; f++) {
+        if (!isIRCallTarget(opt->program, call, opt->effects[f].function)) continue;
+        found = true;
+        if (onlyFields ? opt->effects[f].writesFields : !opt->effects[f].pure) return false;
+    }
+    return found;
+}
+
+// Start from "every function is pure" and remove it from the ones that are not until nothing changes
+static void computeEffects(LoopOptimizer* opt) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int f = 0; f < opt->function_count; f++) {
+            FunctionEffects* effects = &opt->effects[f];
+            bool pure = effects->pure;
+            bool writesFields = effects->writesFields;
+            for (IRInstr* instr = effects->function->first; instr; instr = instr->next) {
+                switch (instr->op) {
+                    case IR_SETFIELD:
+                        pure = false;
+                        writesFields = true;
+                        break;
+                    case IR_PRINT:
+                    case IR_READ_INT:
+                    case IR_READ_STR:
+                    case IR_NEW:               // A new object each time; constructors only reach the new object
+                        pure = false;
+                        break;
+                    case IR_CALL:
+                    case IR_CALL_METHOD:
+                        if (!callIsPure(opt, instr, false)) pure = false;
+                        if (!callIsPure(opt, instr, true)) writesFields = true;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            if (pure != effects->pure || writesFields != effects->writesFields) {
+                effects->pure = pure;
+                effects->writesFields = writesFields;
+                changed = true;
+            }
+        }
+    }
+}
+
+//Loops
+
+// Blocks of the natural loop of a header: the ones that reach a back edge without passing the header
+static bool* findLoopBlocks(ControlFlowGraph* cfg, int header) {
+    bool* inLoop = checkedCalloc(cfg->block_count, sizeof(bool), ALLOC_ANALYSIS);
+    int* worklist = checkedCalloc(cfg->block_count, sizeof(int), ALLOC_ANALYSIS);
+    int pending = 0;
+    inLoop[header] = true;
+
+    for (int p = 0; p < cfg->blocks[header].predecessor_count; p++) {
+        int latch = cfg->blocks[header].predecessors[p];
+        if (dominates(cfg, header, latch) && !inLoop[latch]) {
+            inLoop[latch] = true;
+            worklist[pending++] = latch;
+        }
+    }
+    while (pending > 0) {
+        BasicBlock* block = &cfg->blocks[worklist[--pending]];
+        for (int p = 0; p < block->predecessor_count; p++) {
+            if (!inLoop[block->predecessors[p]]) {
+                inLoop[block->predecessors[p]] = true;
+                worklist[pending++] = block->predecessors[p];
+            }
+        }
+    }
+    compilerFree(worklist);
+    return inLoop;
+}
+
+static bool isLoopHeader(ControlFlowGraph* cfg, int block) {
+    for (int p = 0; p < cfg->blocks[block].predecessor_count; p++) {
+        if (dominates(cfg, block, cfg->blocks[block].predecessors[p])) return true;
+    }
+    return false;
+}
+
+// Code placed right before the header label only runs when entering the loop if the loop is
+// entered just by falling through from the previous block
+static bool hasPreheaderSlot(ControlFlowGraph* cfg, int header, bool* inLoop) {
+    if (header == 0 || cfg->blocks[header].first->op != IR_LABEL) return false;
+    for (int p = 0; p < cfg->blocks[header].predecessor_count; p++) {
+        int predecessor = cfg->blocks[header].predecessors[p];
+        if (!inLoop[predecessor] && predecessor != header - 1) return false;
+    }
+    IRInstr* previous = cfg->blocks[header - 1].last;
+    bool jumpsToHeader = (previous->op == IR_JUMP || previous->op == IR_JUMPZ || previous->op == IR_JUMPNZ) &&
+                         previous->imm == cfg->blocks[header].first->imm;
+    return !inLoop[header - 1] && !jumpsToHeader && previous->op != IR_JUMP && previous->op != IR_RETURN;
+}
+
+//Invariant code motion
+
+typedef struct {
+    ControlFlowGraph* cfg;
+    bool* inLoop;
+    IRInstr* header;               // Label of the header, hoisted code goes right before it
+    LoopInstr* instrs;
+    int instr_count;
+    int* defsInLoop;               // Definitions of each virtual register inside the loop
+    int* defsInFunction;
+    int value_count;               // Registers counted, the ones created later are never invariant
+    bool writesFields;             // Some instruction of the loop can change attributes
+    bool* exits;                   // Blocks that can leave the loop
+} LoopInfo;
+
+static bool fieldWrittenInLoop(LoopInfo* loop, const char* field) {
+    for (int i = 0; i < loop->instr_count; i++) {
+        IRInstr* instr = loop->instrs[i].instr;
+        if (!loop->instrs[i].hoisted && instr->op == IR_SETFIELD && strcmp(instr->name, field) == 0) return true;
+    }
+    return false;
+}
+
+static IRInstr* findDefinitionInLoop(LoopInfo* loop, int value) {
+    for (int i = 0; i < loop->instr_count; i++) {
+        if (!loop->instrs[i].hoisted && loop->instrs[i].instr->dst == value) return loop->instrs[i].instr;
+    }
+    return NULL;
+}
+
+// Integer constant of the loop body, they are not hoisted but their value is the same in every iteration
+static IRInstr* findLoopConstant(LoopInfo* loop, int value) {
+    if (value >= loop->value_count || loop->defsInLoop[value] != 1 || loop->defsInFunction[value] != 1) return NULL;
+    IRInstr* definition = findDefinitionInLoop(loop, value);
+    return definition && definition->op == IR_CONST_INT ? definition : NULL;
+}
+
+static bool isInvariant(LoopInfo* loop, int value) {
+    if (value >= loop->value_count) return false;
+    return loop->defsInLoop[value] == 0 || findLoopConstant(loop, value);
+}
+
+// Value usable in the preheader: loop constants get a copy there
+static int preheaderValue(IRFunction* function, LoopInfo* loop, int value) {
+    IRInstr* constant = findLoopConstant(loop, value);
+    if (!constant) return value;
+    int copy = newIRValue(function, IR_TYPE_INT, NULL, NULL);
+    IRInstr* instr = createIRInstr(IR_CONST_INT, copy, -1, -1);
+    instr->imm = constant->imm;
+    insertIRInstrBefore(function, loop->header, instr);
+    return copy;
+}
+
+// The block runs in every iteration that completes, so moving it before the loop can not
+// run something the loop would not have run
+static bool alwaysExecuted(LoopInfo* loop, int block) {
+    for (int b = 0; b < loop->cfg->block_count; b++) {
+        if (loop->exits[b] && !dominates(loop->cfg, block, b)) return false;
+    }
+    return true;
+}
+
+static bool canHoist(LoopOptimizer* opt, IRFunction* function, LoopInfo* loop, LoopInstr* candidate) {
+    IRInstr* instr = candidate->instr;
+    if (instr->dst < 0 || function->values[instr->dst].name || function->values[instr->dst].paramIndex >= 0) {
+        return false; // Only temporaries with their single definition
+    }
+    if (loop->defsInFunction[instr->dst] != 1) return false;
+
+    int uses[MAX_USES];
+    int count = getIRInstrUses(instr, uses, MAX_USES);
+    for (int i = 0; i < count; i++) {
+        if (!isInvariant(loop, uses[i])) return false;
+    }
+
+    switch (instr->op) {
+        // Integer constants are immediate operands in VYPcode, keeping them in a register
+        // across the loop would only add register pressure
+        case IR_CONST_INT:
+            return false;
+        case IR_CONST_STR:           // Each evaluation creates a new chunk, strings are never modified
+        case IR_MOVE:
+        case IR_ADD: case IR_SUB: case IR_MUL:
+        case IR_LT: case IR_GT: case IR_LE: case IR_GE: case IR_EQ: case IR_NE:
+        case IR_NOT: case IR_NEG:
+        case IR_INT2STR: case IR_STRLEN: case IR_CONCAT: case IR_SUBSTR:
+            return true;
+        case IR_DIV:
+            return alwaysExecuted(loop, candidate->block);
+        case IR_GETFIELD:
+            return !loop->writesFields && !fieldWrittenInLoop(loop, instr->name) &&
+                   alwaysExecuted(loop, candidate->block);
+        case IR_CALL:
+        case IR_CALL_METHOD:
+            for (int i = 0; i < loop->instr_count; i++) {
+                if (!loop->instrs[i].hoisted && loop->instrs[i].instr->op == IR_SETFIELD) return false;
+            }
+            return !loop->writesFields && callIsPure(opt, instr, false) && alwaysExecuted(loop, candidate->block);
+        default:
+            return false;
+    }
+}
+
+static void hoistInvariants(LoopOptimizer* opt, IRFunction* function, LoopInfo* loop) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < loop->instr_count; i++) {
+            LoopInstr* candidate = &loop->instrs[i];
+            if (candidate->hoisted || !canHoist(opt, function, loop, candidate)) continue;
+
+            IRInstr* instr = candidate->instr;
+            if (instr->src1 >= 0) instr->src1 = preheaderValue(function, loop, instr->src1);
+            if (instr->src2 >= 0) instr->src2 = preheaderValue(function, loop, instr->src2);
+            for (int a = 0; a < instr->arg_count; a++) {
+                instr->args[a] = preheaderValue(function, loop, instr->args[a]);
+            }
+            removeIRInstr(function, instr);
+            insertIRInstrBefore(function, loop->header, instr);
+            candidate->hoisted = true;
+            loop->defsInLoop[candidate->instr->dst]--;
+            opt->stats->hoisted++;
+            changed = true;
+        }
+    }
+}
+
+//Strength reduction
+
+// i = i + c, i = c + i or i = i - c, directly or through a temporary, with c invariant
+static bool findInductionVariable(LoopInfo* loop, int value, InductionVariable* iv) {
+    if (value >= loop->value_count || loop->defsInLoop[value] != 1) return false;
+    IRInstr* update = findDefinitionInLoop(loop, value);
+    IRInstr* step = update;
+    if (update->op == IR_MOVE && update->src1 < loop->value_count && loop->defsInLoop[update->src1] == 1) {
+        step = findDefinitionInLoop(loop, update->src1);
+    }
+    if (step->op == IR_ADD && step->src1 == value && isInvariant(loop, step->src2)) {
+        iv->step = step->src2;
+    } else if (step->op == IR_ADD && step->src2 == value && isInvariant(loop, step->src1)) {
+        iv->step = step->src1;
+    } else if (step->op == IR_SUB && step->src1 == value && isInvariant(loop, step->src2)) {
+        iv->step = step->src2;
+    } else {
+        return false;
+    }
+    iv->value = value;
+    iv->subtract = step->op == IR_SUB;
+    iv->update = update;
+    return true;
+}
+
+// Value j = i * k kept up to date inside a loop
+typedef struct {
+    int inductionValue;
+    int factor;
+    int reduced;
+} ReducedProduct;
+
+// m = i * k with k invariant becomes m = j, where j = i * k is kept up to date with j += step * k
+static void reduceMultiplications(LoopOptimizer* opt, IRFunction* function, LoopInfo* loop) {
+    ReducedProduct* products = checkedCalloc(loop->instr_count, sizeof(ReducedProduct), ALLOC_ANALYSIS);
+    int product_count = 0;
+
+    for (int i = 0; i < loop->instr_count; i++) {
+        IRInstr* multiply = loop->instrs[i].instr;
+        if (loop->instrs[i].hoisted || multiply->op != IR_MUL) continue;
+
+        InductionVariable iv;
+        int factor;
+        if (findInductionVariable(loop, multiply->src1, &iv) && isInvariant(loop, multiply->src2)) {
+            factor = multiply->src2;
+        } else if (findInductionVariable(loop, multiply->src2, &iv) && isInvariant(loop, multiply->src1)) {
+            factor = multiply->src1;
+        } else {
+            continue;
+        }
+
+        // Several multiplications by the same factor share the reduced value
+        int reduced = -1;
+        for (int p = 0; p < product_count; p++) {
+            if (products[p].inductionValue == iv.value && products[p].factor == factor) {
+                reduced = products[p].reduced;
+            }
+        }
+        if (reduced < 0) {
+            reduced = newIRValue(function, IR_TYPE_INT, NULL, NULL);
+            int increment = newIRValue(function, IR_TYPE_INT, NULL, NULL);
+            int preheaderFactor = preheaderValue(function, loop, factor);
+            insertIRInstrBefore(function, loop->header, createIRInstr(IR_MUL, reduced, iv.value, preheaderFactor));
+            IRInstr* constantStep = findLoopConstant(loop, iv.step);
+            IRInstr* constantFactor = findLoopConstant(loop, factor);
+            if (constantStep && constantFactor) {
+                IRInstr* product = createIRInstr(IR_CONST_INT, increment, -1, -1);
+                product->imm = constantStep->imm * constantFactor->imm;
+                insertIRInstrBefore(function, loop->header, product);
+            } else {
+                int preheaderStep = preheaderValue(function, loop, iv.step);
+                insertIRInstrBefore(function, loop->header, createIRInstr(IR_MUL, increment, preheaderStep, preheaderFactor));
+            }
+            IRInstr* update = createIRInstr(iv.subtract ? IR_SUB : IR_ADD, reduced, reduced, increment);
+            insertIRInstrBefore(function, iv.update->next, update);
+            products[product_count].inductionValue = iv.value;
+            products[product_count].factor = factor;
+            products[product_count].reduced = reduced;
+            product_count++;
+        }
+
+        multiply->op = IR_MOVE;
+        multiply->src1 = reduced;
+        multiply->src2 = -1;
+        opt->stats->reduced++;
+    }
+    compilerFree(products);
+}
+
+//Driver
+
+static void optimizeLoop(LoopOptimizer* opt, IRFunction* function, ControlFlowGraph* cfg, int header, bool* inLoop) {
+    LoopInfo loop;
+    loop.cfg = cfg;
+    loop.inLoop = inLoop;
+    loop.header = cfg->blocks[header].first;
+    loop.defsInLoop = checkedCalloc(function->value_count, sizeof(int), ALLOC_ANALYSIS);
+    loop.defsInFunction = checkedCalloc(function->value_count, sizeof(int), ALLOC_ANALYSIS);
+    loop.value_count = function->value_count;
+    loop.exits = checkedCalloc(cfg->block_count, sizeof(bool), ALLOC_ANALYSIS);
+    loop.writesFields = false;
+
+    int instr_count = 0;
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        instr_count++;
+        if (instr->dst >= 0) loop.defsInFunction[instr->dst]++;
+    }
+    loop.instrs = checkedCalloc(instr_count, sizeof(LoopInstr), ALLOC_ANALYSIS);
+    loop.instr_count = 0;
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        if (!inLoop[b]) continue;
+        BasicBlock* block = &cfg->blocks[b];
+        for (IRInstr* instr = block->first; ; instr = instr->next) {
+            LoopInstr* entry = &loop.instrs[loop.instr_count++];
+            entry->instr = instr;
+            entry->block = b;
+            entry->hoisted = false;
+            if (instr->dst >= 0) loop.defsInLoop[instr->dst]++;
+            if ((instr->op == IR_CALL || instr->op == IR_CALL_METHOD) && !callIsPure(opt, instr, true)) {
+                loop.writesFields = true;
+            }
+            if (instr == block->last) break;
+        }
+
+        if (block->last->op == IR_RETURN) loop.exits[b] = true;
+        for (int s = 0; s < block->successor_count; s++) {
+            if (!inLoop[block->successors[s]]) loop.exits[b] = true;
+        }
+    }
+
+    hoistInvariants(opt, function, &loop);
+    reduceMultiplications(opt, function, &loop);
+
+    compilerFree(loop.instrs);
+    compilerFree(loop.defsInLoop);
+    compilerFree(loop.defsInFunction);
+    compilerFree(loop.exits);
+}
+
+static void optimizeFunctionLoops(LoopOptimizer* opt, IRFunction* function) {
+    // Headers already optimized, identified by their label
+    long* done = NULL;
+    int done_count = 0;
+
+    // Innermost (smallest) loop first; the CFG is rebuilt after every loop because the
+    // preheader code changes the blocks of the enclosing loops
+    while (true) {
+        ControlFlowGraph* cfg = buildCFG(function);
+        computeDominators(cfg);
+
+        int best = -1;
+        int bestSize = 0;
+        bool* bestBlocks = NULL;
+        for (int h = 0; h < cfg->block_count; h++) {
+            if (!isLoopHeader(cfg, h) || cfg->blocks[h].first->op != IR_LABEL) continue;
+            bool processed = false;
+            for (int d = 0; d < done_count; d++) {
+                if (done[d] == cfg->blocks[h].first->imm) processed = true;
+            }
+            if (processed) continue;
+
+            bool* inLoop = findLoopBlocks(cfg, h);
+            int size = 0;
+            for (int b = 0; b < cfg->block_count; b++) size += inLoop[b];
+            if (best < 0 || size < bestSize) {
+                compilerFree(bestBlocks);
+                best = h;
+                bestSize = size;
+                bestBlocks = inLoop;
+            } else {
+                compilerFree(inLoop);
+            }
+        }
+
+        if (best < 0) {
+            freeCFG(cfg);
+            break;
+        }
+
+        done = checkedRealloc(done, (done_count + 1) * sizeof(long), ALLOC_ANALYSIS);
+        done[done_count++] = cfg->blocks[best].first->imm;
+        opt->stats->loop_count++;
+        if (hasPreheaderSlot(cfg, best, bestBlocks)) {
+            optimizeLoop(opt, function, cfg, best, bestBlocks);
+        }
+        compilerFree(bestBlocks);
+        freeCFG(cfg);
+    }
+    compilerFree(done);
+}
+
+void optimizeLoops(IRProgram* program, LoopStats* stats) {
+    LoopStats local;
+    LoopOptimizer opt;
+    opt.program = program;
+    opt.stats = stats ? stats : &local;
+    memset(opt.stats, 0, sizeof(LoopStats));
+
+    opt.function_count = 0;
+    for (IRFunction* function = program->functions; function; function = function->next) opt.function_count++;
+    opt.effects = checkedCalloc(opt.function_count, sizeof(FunctionEffects), ALLOC_ANALYSIS);
+    int f = 0;
+    for (IRFunction* function = program->functions; function; function = function->next, f++) {
+        opt.effects[f].function = function;
+        opt.effects[f].pure = true;
+        opt.effects[f].writesFields = false;
+    }
+    computeEffects(&opt);
+
+    for (IRFunction* function = program->functions; function; function = function->next) {
+        optimizeFunctionLoops(&opt, function);
+    }
+    compilerFree(opt.effects);
+}
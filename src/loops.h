@@ -0,0 +1,17 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include "ir.h"
+#include "cfg.h"
+
+// Totals of the loop optimizations over the whole program
+typedef struct {
+    int loop_count;                // Natural loops found
+    int hoisted;                   // Instructions moved to a preheader
+    int reduced;                   // Multiplications replaced by additions
+} LoopStats;
+
+// Loop-invariant code motion and strength reduction of induction variables
+void optimizeLoops(IRProgram* program, LoopStats* stats);
+
+#endif // LOOPS_H
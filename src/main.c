@@ -1,9 +1,33 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "symbol_table.h"
 #include "ast.h"
 #include "semantic_analysis.h"
+#include "ir.h"
+#include "escape.h"
+#include "tailcalls.h"
+#include "loops.h"
+#include "codegen.h"
+#include "peephole.h"
+#include "interp.h"
+#include "bytecode.h"
+#include "x86.h"
+#include "batch.h"
+#include "incremental.h"
+#include "server.h"
+#include "stream.h"
+#include "lazy.h"
+#include "pipeline.h"
+#include "astcache.h"
+#include "dump.h"
+#include "alloc.h"
+#include "interface.h"
 #include "parser.h"
 #include "string.h"
 
@@ -204,25 +228,80 @@ void printAST(ASTNode* node, int indent) {
     }
 }
 
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
+// Options of one compilation, the same for every file of a batch
+typedef struct {
+    int peepholeWindow;
+    bool peepholeStats;
+    bool binary;
+    bool native;
+    const char* profileName;
+    const char* cacheName;         // Directory of the incremental builds (null without them)
+    bool stream;                   // One top-level class or function in memory at a time
+    bool lazy;                     // Bodies parsed only when they can run
+    bool pipeline;                 // Lexer on its own thread, ahead of the parser
+    const char* astCacheName;      // Directory of the parsed programs (null without it)
+    DumpFormat dump;               // Listing of the AST and the symbol table, none by default
+    const char* dumpName;          // File of a JSON Lines or binary dump (null for the standard output)
+    FILE* dumpStream;              // The standard output when the dump goes there
+    bool dumpIR;                   // Listing of the optimized IR before the code generation
+    bool exportInterface;          // Write the interface of the module instead of a program
+    const char* imports[INTERFACE_MAX_IMPORTS];   // Interfaces of the modules the program uses
+    int import_count;
+} CompilerOptions;
+
+// --stream: the file goes through the pipeline one unit at a time and only VYPcode text comes out
+static int compileFileStreaming(const char* inputName, const char* outputName, const CompilerOptions* options) {
+    if (options->native || options->binary || options->profileName || options->cacheName || options->lazy ||
+        options->pipeline || options->astCacheName || options->dump != DUMP_NONE || options->dumpIR || options->exportInterface ||
+        options->import_count > 0) {
+        fprintf(stderr, "Error: --stream only writes VYPcode text, without --x86, --binary, --profile-use, --incremental, --lazy, --pipeline, --ast-cache, --dump, --dump-ir, --export or --import.\n");
         return 19;
     }
-
-    init_symbol_table(&symbol_table);
-
-//    yydebug = 1; 
-
-    FILE* inputFile = fopen(argv[1], "r");
+    FILE* inputFile = fopen(inputName, "r");
     if (!inputFile) {
         perror("Error opening file");
         return 19;
     }
+    FILE* outputFile = fopen(outputName, "w");
+    if (!outputFile) {
+        perror("Error opening output file");
+        fclose(inputFile);
+        return 19;
+    }
 
+    StreamStats stats;
+    int streamResult = compileStreaming(inputFile, outputFile, options->peepholeWindow, &stats);
+    fclose(inputFile);
+    fclose(outputFile);
+    if (streamResult != 0) return streamResult;
+
+    printf("Streaming: %d units compiled one at a time, %d functions.\n", stats.units, stats.functions);
+    printf("Escape analysis: %d of %d allocations replaced by %d values.\n",
+           stats.escape.replaced, stats.escape.allocations, stats.escape.scalars);
+    printf("Tail calls: %d recursive calls turned into jumps, %d accumulators, %d calls reusing the frame.\n",
+           stats.tails.self_calls, stats.tails.accumulators, stats.tails.tail_calls);
+    printf("Loop optimization: %d loops, %d invariant instructions hoisted, %d multiplications reduced.\n",
+           stats.loops.loop_count, stats.loops.hoisted, stats.loops.reduced);
+    printf("Register allocation: %d functions, %d values in registers, %d spilled, %d frame slots.\n",
+           stats.codegen.function_count, stats.codegen.register_values, stats.codegen.spilled_values,
+           stats.codegen.frame_slots);
+    if (options->peepholeStats) {
+        printPeepholeStats(&stats.peephole, stdout);
+    }
+    printf("Code generated in %s.\n", outputName);
+    return 0;
+}
+
+// Lex and parse the file into root and the symbol table, returns the exit status
+static int parseFile(FILE* inputFile, const CompilerOptions* options) {
     yyin = inputFile;
+    lazy_bodies = options->lazy;
 
+    // With --pipeline the lexer runs ahead of the parser on its own thread
+    if (options->pipeline && !startPipeline(inputFile)) return 19;
     int parseResult = yyparse();
+    PipelineStats pipelineStats;
+    if (options->pipeline) finishPipeline(&pipelineStats);
     printf("LEXICAL_ERRORS %i\n", lexical_error);  // Asegúrate de que este mensaje siempre se ejecute
 
     if (lexical_error) {
@@ -231,13 +310,156 @@ int main(int argc, char** argv) {
     }
 
     if (parseResult != 0) {
+        if (options->pipeline) {
+            uint32_t offset, length;
+            getPipelineSpan(&offset, &length);
+            fprintf(stderr, "Error: the parser stopped at the token of bytes %u to %u.\n", offset, offset + length);
+        }
         fprintf(stderr, "Error during syntactic analysis.\n");
         return 12;
     }else{
         printf("Parsing completed successfully.\n");
     }
+    if (options->pipeline) {
+        printf("Pipelined lexer: %d tokens, %d distinct strings, the lexer waited %ld times and the parser %ld times.\n",
+               pipelineStats.tokens, pipelineStats.strings, pipelineStats.lexer_waits, pipelineStats.parser_waits);
+    }
+    return 0;
+}
+
+// Parsed programs the server keeps between requests, by the hash of their source. The child of
+// a request that parses a new source stores it in the AST cache of the server directory, with
+// what the parse printed; before the next request the server maps the files new there, and
+// every child forked after that prints the same and starts from the tree instead of parsing.
+#define WARM_MAX_PROGRAMS 256
+
+typedef struct {
+    ASTCacheKey key;
+    ASTNode* root;
+    SymbolTable table;
+    char* printed;                     // Standard output of the parse, then its standard error
+    size_t out_length;
+    size_t err_length;
+} WarmProgram;
+
+typedef struct {
+    char directory[PATH_MAX];
+    WarmProgram programs[WARM_MAX_PROGRAMS];
+    int count;
+    struct timespec modified;          // Of the directory when it was last read
+} WarmPrograms;
+
+static WarmPrograms* warmPrograms = NULL;  // Only in the server and in the children of its requests
 
+static WarmProgram* findWarmProgram(WarmPrograms* warm, const ASTCacheKey* key) {
+    for (int p = 0; p < warm->count; p++) {
+        if (warm->programs[p].key.hash == key->hash && warm->programs[p].key.size == key->size) return &warm->programs[p];
+    }
+    return NULL;
+}
+
+static void warmLogPath(WarmPrograms* warm, const ASTCacheKey* key, char* path, size_t size) {
+    snprintf(path, size, "%s/%016llx.log", warm->directory, (unsigned long long)key->hash);
+}
+
+// Offsets of stdout and stderr; in a request they are the files the server reads the answer from
+static void getOutputOffsets(off_t* out, off_t* err) {
+    fflush(stdout);
+    fflush(stderr);
+    *out = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+    *err = lseek(STDERR_FILENO, 0, SEEK_CUR);
+}
+
+// Store the tree just parsed for the server: first what was printed since the offsets, read
+// back from stdout and stderr, then the tree, whose file the server looks for
+static void saveWarmProgram(const ASTCacheKey* key, off_t outStart, off_t errStart) {
+    off_t outEnd, errEnd;
+    getOutputOffsets(&outEnd, &errEnd);
+    if (outStart < 0 || errStart < 0 || outEnd < outStart || errEnd < errStart) return;
+    size_t outLength = outEnd - outStart;
+    size_t errLength = errEnd - errStart;
+    char* printed = checkedMalloc(outLength + errLength + 1, ALLOC_MODULES);
+    bool read = pread(STDOUT_FILENO, printed, outLength, outStart) == (ssize_t)outLength &&
+                pread(STDERR_FILENO, printed + outLength, errLength, errStart) == (ssize_t)errLength;
+
+    char path[PATH_MAX + 32];
+    char temporary[PATH_MAX + 64];
+    warmLogPath(warmPrograms, key, path, sizeof(path));
+    snprintf(temporary, sizeof(temporary), "%s.%ld.tmp", path, (long)getpid());
+    FILE* log = read ? fopen(temporary, "wb") : NULL;
+    bool saved = false;
+    if (log) {
+        saved = fprintf(log, "%zu %zu\n", outLength, errLength) > 0 && fwrite(printed, 1, outLength + errLength, log) == outLength + errLength;
+        saved = fclose(log) == 0 && saved && rename(temporary, path) == 0;
+        if (!saved) remove(temporary);
+    }
+    free(printed);
+    ASTCacheStats cacheStats;
+    if (saved) saveASTCache(warmPrograms->directory, key, root, &symbol_table, &cacheStats);
+}
+
+// Whole pipeline for one file, returns the exit status of vypcomp
+static int compileFile(const char* inputName, const char* outputName, const CompilerOptions* options) {
+    if (options->stream) return compileFileStreaming(inputName, outputName, options);
+    if ((options->exportInterface || options->import_count > 0) && (options->native || options->profileName || options->cacheName)) {
+        fprintf(stderr, "Error: --export and --import link VYPcode, without --x86, --profile-use or --incremental.\n");
+        return 19;
+    }
+    if (options->astCacheName && (options->lazy || options->import_count > 0)) {
+        fprintf(stderr, "Error: --ast-cache keeps whole programs, without --lazy or --import.\n");
+        return 19;
+    }
+    setAllocPhase(ALLOC_PHASE_PARSE);
+    init_symbol_table(&symbol_table);
+
+    // The imported classes and functions are declared before the program is parsed
+    ImportedInterface* imports = NULL;
+    for (int i = 0; i < options->import_count; i++) {
+        int importResult;
+        if (!importInterface(&imports, options->imports[i], &symbol_table, &importResult)) return importResult;
+    }
+
+//    yydebug = 1; 
+
+    FILE* inputFile = fopen(inputName, "r");
+    if (!inputFile) {
+        perror("Error opening file");
+        return 19;
+    }
+
+    // With --ast-cache a source parsed before is mapped from the cache instead, and in the server
+    // it is the tree the server keeps for it
+    ASTCacheKey cacheKey;
+    ASTCacheStats cacheStats;
+    bool cacheHit = false;
+    bool warm = warmPrograms && !options->astCacheName && !options->lazy && !options->pipeline && options->import_count == 0;
+    WarmProgram* warmProgram = NULL;
+    off_t outStart, errStart;
+    if (options->astCacheName || warm) {
+        if (!hashSource(inputFile, &cacheKey)) {
+            perror("Error reading file");
+            fclose(inputFile);
+            return 19;
+        }
+    }
+    if (options->astCacheName) {
+        cacheHit = loadASTCache(options->astCacheName, &cacheKey, &root, &symbol_table, &cacheStats);
+    } else if (warm && (warmProgram = findWarmProgram(warmPrograms, &cacheKey))) {
+        root = warmProgram->root;
+        symbol_table = warmProgram->table;
+        cacheHit = true;
+        fwrite(warmProgram->printed, 1, warmProgram->out_length, stdout);
+        fwrite(warmProgram->printed + warmProgram->out_length, 1, warmProgram->err_length, stderr);
+    } else if (warm) {
+        getOutputOffsets(&outStart, &errStart);
+    }
+    int parseResult = cacheHit ? 0 : parseFile(inputFile, options);
     fclose(inputFile);
+    if (parseResult != 0) return parseResult;
+    if (cacheHit && !warmProgram) {
+        printf("AST cache: %d nodes and %d symbols mapped from %s with %ld relocations, parsing skipped.\n",
+               cacheStats.nodes, cacheStats.symbols, options->astCacheName, cacheStats.relocations);
+    }
 
     // Check if the AST was constructed
     if (!root) {
@@ -245,21 +467,464 @@ int main(int argc, char** argv) {
         return 19;
     }
 
-    // Print the AST
-    printf("Abstract Syntax Tree (AST):\n");
-    printAST(root, 0);  // Assuming printAST takes the root and an indent level
+    // A cache that cannot be written only costs the next compilation a parse
+    if (options->astCacheName && !cacheHit) {
+        if (saveASTCache(options->astCacheName, &cacheKey, root, &symbol_table, &cacheStats)) {
+            printf("AST cache: %d nodes, %d symbols and %d strings stored in %ld bytes.\n",
+                   cacheStats.nodes, cacheStats.symbols, cacheStats.strings, cacheStats.bytes);
+        } else {
+            fprintf(stderr, "Warning: the AST could not be stored in %s.\n", options->astCacheName);
+        }
+    } else if (warm && !cacheHit && warmPrograms->count < WARM_MAX_PROGRAMS) {
+        saveWarmProgram(&cacheKey, outStart, errStart);
+    }
+
+    // With --lazy the bodies are still tokens; parse the ones that can run
+    if (options->lazy) {
+        LazyStats lazyStats;
+        int lazyResult = parseReachableBodies((ASTProgramNode*)root, &lazyStats);
+        if (lazyResult != 0) return lazyResult;
+        printf("Lazy parsing: %d of %d bodies parsed, %d unreachable functions dropped.\n",
+               lazyStats.parsed, lazyStats.bodies, lazyStats.dropped);
+    }
 
-    // Shows the content of the symbols table
-    printf("\nSymbol Table:\n");
-    print_symbol_table(&symbol_table);  // Function that will print the symbols table
+    // The signatures of the imported modules join the program, only its own units are lowered
+    bool* ownUnits = imports || options->exportInterface ? addImportedUnits(imports, (ASTProgramNode*)root) : NULL;
+
+    // The AST and the symbol table are only listed when asked for: --dump=text prints them like
+    // before, the formats for tools go through the buffered writer of dump.c
+    if (options->dump == DUMP_TEXT) {
+        printf("Abstract Syntax Tree (AST):\n");
+        printAST(root, 0);  // Assuming printAST takes the root and an indent level
+
+        // Shows the content of the symbols table
+        printf("\nSymbol Table:\n");
+        print_symbol_table(&symbol_table);  // Function that will print the symbols table
+    } else if (options->dump != DUMP_NONE) {
+        FILE* dumpFile = options->dumpName ? fopen(options->dumpName, options->dump == DUMP_BINARY ? "wb" : "w") : options->dumpStream;
+        if (!dumpFile) {
+            perror("Error opening dump file");
+            return 19;
+        }
+        DumpStats dumpStats;
+        bool dumped = dumpProgram(root, &symbol_table, options->dump, dumpFile, &dumpStats);
+        if (dumpFile == options->dumpStream ? fflush(dumpFile) != 0 : fclose(dumpFile) != 0) dumped = false;
+        if (!dumped) {
+            fprintf(stderr, "Error writing the dump.\n");
+            return 19;
+        }
+        if (options->dumpName) {
+            printf("Dump: %ld nodes and %ld symbols written to %s in %ld bytes.\n",
+                   dumpStats.nodes, dumpStats.symbols, options->dumpName, dumpStats.bytes);
+        }
+    }
+
+    // With --incremental the units whose code is in the cache skip the analysis and the IR.
+    // The cache holds VYPcode, so it is not used for --x86, and a profile changes the code.
+    IncrementalBuild* build = NULL;
+    if (options->cacheName && !options->native && !options->profileName) {
+        build = openIncrementalBuild((ASTProgramNode*)root, &symbol_table, options->cacheName);
+        if (!build) return 19;
+        printf("Incremental build: %d of %d units changed.\n", build->changed, build->count);
+        if (build->rejected) printf("Incremental build: %d corrupted pieces of the cache compiled again.\n", build->rejected);
+    }
 
     // Perform semantic analysis
+    setAllocPhase(ALLOC_PHASE_SEMANTIC);
     printf("\nPerforming semantic analysis...\n");
-    if (performSemanticAnalysis(root, &symbol_table) != 0) {
+    int semanticResult = 0;
+    if (build) {
+        for (int u = 0; u < build->count && semanticResult == 0; u++) {
+            if (!build->units[u].cached) semanticResult = performSemanticAnalysis(build->units[u].node, &symbol_table);
+        }
+    } else {
+        semanticResult = performSemanticAnalysis(root, &symbol_table);
+    }
+    if (semanticResult != 0) {
         fprintf(stderr, "Semantic analysis failed.\n");
         return 13;
     }
     printf("Semantic analysis completed successfully.\n");
 
+    // Generate the target code
+    printf("\nGenerating code...\n");
+    setAllocPhase(ALLOC_PHASE_IR);
+    bool* loweredUnits = build ? getLoweredUnits(build) : NULL;
+    IRProgram* ir = options->exportInterface ? buildLibraryIR(root, &symbol_table, ownUnits)
+                                             : buildIR(root, &symbol_table, build ? loweredUnits : ownUnits);
+    compilerFree(loweredUnits);
+    if (!ir) {
+        fprintf(stderr, "Error during code generation.\n");
+        return 15;
+    }
+
+    // Objects that stay in their function become one value per attribute
+    setAllocPhase(ALLOC_PHASE_OPTIMIZE);
+    EscapeStats escape;
+    replaceLocalObjects(ir, &escape);
+    printf("Escape analysis: %d of %d allocations replaced by %d values.\n",
+           escape.replaced, escape.allocations, escape.scalars);
+
+    // Tail recursion becomes loops before the loops are optimized
+    TailCallStats tails;
+    optimizeTailCalls(ir, &tails);
+    printf("Tail calls: %d recursive calls turned into jumps, %d accumulators, %d calls reusing the frame.\n",
+           tails.self_calls, tails.accumulators, tails.tail_calls);
+
+    LoopStats loops;
+    optimizeLoops(ir, &loops);
+    printf("Loop optimization: %d loops, %d invariant instructions hoisted, %d multiplications reduced.\n",
+           loops.loop_count, loops.hoisted, loops.reduced);
+    if (options->dumpIR) printIR(ir, stdout);
+    setAllocPhase(ALLOC_PHASE_CODEGEN);
+
+    // The code of the imported modules was generated for the vtable words it finds here
+    if (imports) {
+        ProgramLayout* layout = buildProgramLayout(ir);
+        bool sameLayout = checkImportedLayout(imports, layout);
+        freeProgramLayout(layout);
+        if (!sameLayout) return 19;
+    }
+
+    // --export: the code of the functions goes into the interface with the signatures
+    if (options->exportInterface) {
+        CodegenStats stats;
+        int exportResult = exportInterface(ir, ownUnits, outputName, &stats);
+        compilerFree(ownUnits);
+        freeImportedInterfaces(imports);
+        if (exportResult != 0) return exportResult;
+        printf("Register allocation: %d functions, %d values in registers, %d spilled, %d frame slots.\n",
+               stats.function_count, stats.register_values, stats.spilled_values, stats.frame_slots);
+        return 0;
+    }
+    compilerFree(ownUnits);
+
+    if (options->native) {
+        FILE* outputFile = fopen(outputName, "w");
+        if (!outputFile) {
+            perror("Error opening output file");
+            return 19;
+        }
+        X86Stats native_stats;
+        int nativeResult = generateX86(ir, outputFile, &native_stats);
+        fclose(outputFile);
+        if (nativeResult != 0) {
+            fprintf(stderr, "Error during code generation.\n");
+            return 15;
+        }
+        printf("Native code: %d functions, %d values in registers, %d spilled, %d strings.\n",
+               native_stats.function_count, native_stats.register_values, native_stats.spilled_values,
+               native_stats.string_count);
+        printf("Code generated in %s.\n", outputName);
+        return 0;
+    }
+
+    // The profile is keyed by the labels of the generated code, so it only guides the code generator
+    Profile* profile = NULL;
+    if (options->profileName) {
+        FILE* profileFile = fopen(options->profileName, "r");
+        if (!profileFile) {
+            perror("Error opening profile");
+            return 19;
+        }
+        profile = readProfile(profileFile);
+        fclose(profileFile);
+        if (!profile) return 19;
+    }
+
+    CodegenStats stats;
+    VCProgram* code = build     ? generateIncrementalVYPcode(build, ir, &stats)
+                      : imports ? linkImportedVYPcode(imports, ir, &stats)
+                                : generateVYPcode(ir, profile, &stats);
+    freeProfile(profile);
+    freeImportedInterfaces(imports);
+    if (!code) {
+        fprintf(stderr, "Error during code generation.\n");
+        return 15;
+    }
+    if (build) {
+        printf("Incremental build: %d functions taken from %s.\n", build->cached_functions, build->directory);
+        freeIncrementalBuild(build);
+    }
+    printf("Register allocation: %d functions, %d values in registers, %d spilled, %d frame slots.\n",
+           stats.function_count, stats.register_values, stats.spilled_values, stats.frame_slots);
+    if (profile) printf("Profile: %d functions allocated with the counts of %s.\n", stats.profiled_functions, options->profileName);
+
+    PeepholeStats peephole;
+    runPeephole(code, options->peepholeWindow, &peephole);
+    if (options->peepholeStats) {
+        printPeepholeStats(&peephole, stdout);
+    }
+
+    FILE* outputFile = fopen(outputName, options->binary ? "wb" : "w");
+    if (!outputFile) {
+        perror("Error opening output file");
+        return 19;
+    }
+    int writeResult;
+    if (options->binary) {
+        // Decoded like vypint does it, for its default register count
+        VMOptions vmOptions;
+        initVMOptions(&vmOptions);
+        VMCode* decoded = decodeVYPcode(code, &vmOptions, &writeResult);
+        writeResult = decoded ? writeBytecode(decoded, vmOptions.registers, outputFile) : 1;
+        freeVMCode(decoded);
+    } else {
+        writeResult = writeVYPcode(code, outputFile);
+    }
+    fclose(outputFile);
+    freeVCProgram(code);
+    if (writeResult != 0) {
+        fprintf(stderr, "Error writing the target code.\n");
+        return 19;
+    }
+    printf("Code generated in %s.\n", outputName);
+
     return 0;
 }
+
+static int compileBatchJob(const BatchJob* job, void* context) {
+    return compileFile(job->input, job->output, (const CompilerOptions*)context);
+}
+
+// Number of an option, the whole text in decimal from min to max; false for anything else
+static bool parseNumber(const char* text, long min, long max, int* value) {
+    char* end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || number < min || number > max) return false;
+    *value = (int)number;
+    return true;
+}
+
+// Command line of one run of vypcomp, in its own process or in a child of the server
+static int runCompiler(int argc, char** argv) {
+    // Options go before the files: --peephole-window=N (0 disables it), --peephole-stats,
+    // --binary (a bytecode container for vypint instead of VYPcode text), --profile-use=FILE
+    // (counters of vypint --profile=FILE that guide the optimizations), --x86 (assembly for the
+    // native runtime instead of VYPcode), --incremental[=DIR] (reuse the code of the unchanged
+    // classes and functions, cached in DIR), --stream (compile and free one class or function at a
+    // time), --lazy (parse only the bodies of the functions and methods that can run), --pipeline
+    // (lex on another thread, ahead of the parser), --ast-cache[=DIR] (map the AST of a source
+    // parsed before instead of parsing it, cached in DIR), --dump=FORMAT (list the AST and the
+    // symbol table: text, jsonl or binary), --dump-file=FILE (where jsonl and binary go instead of
+    // the standard output), --dump-ir (list the optimized IR), --export (write the interface of a
+    // module, with the code of its functions, instead of a program),
+    // --import=FILE (use the classes and functions of an interface, up to 16 times), --jobs=N and --manifest=FILE (batch mode)
+    CompilerOptions options = {PEEPHOLE_DEFAULT_WINDOW, false, false, false, NULL, NULL, false, false, false, NULL, DUMP_NONE, NULL, NULL, false, false, {NULL}, 0};
+    bool batchMode = false;
+    int jobs = 0;
+    const char* manifestName = NULL;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strncmp(argv[argi], "--peephole-window=", 18) == 0) {
+            if (!parseNumber(argv[argi] + 18, 0, PEEPHOLE_MAX_WINDOW, &options.peepholeWindow)) {
+                fprintf(stderr, "Error: --peephole-window takes a number from 0 to %d, not %s.\n", PEEPHOLE_MAX_WINDOW, argv[argi] + 18);
+                return 19;
+            }
+        } else if (strcmp(argv[argi], "--peephole-stats") == 0) {
+            options.peepholeStats = true;
+        } else if (strcmp(argv[argi], "--binary") == 0) {
+            options.binary = true;
+        } else if (strcmp(argv[argi], "--x86") == 0) {
+            options.native = true;
+        } else if (strncmp(argv[argi], "--profile-use=", 14) == 0) {
+            options.profileName = argv[argi] + 14;
+        } else if (strcmp(argv[argi], "--incremental") == 0) {
+            options.cacheName = INCREMENTAL_DEFAULT_CACHE;
+        } else if (strncmp(argv[argi], "--incremental=", 14) == 0) {
+            options.cacheName = argv[argi] + 14;
+        } else if (strcmp(argv[argi], "--stream") == 0) {
+            options.stream = true;
+        } else if (strcmp(argv[argi], "--lazy") == 0) {
+            options.lazy = true;
+        } else if (strcmp(argv[argi], "--pipeline") == 0) {
+            options.pipeline = true;
+        } else if (strcmp(argv[argi], "--ast-cache") == 0) {
+            options.astCacheName = ASTCACHE_DEFAULT_DIR;
+        } else if (strncmp(argv[argi], "--ast-cache=", 12) == 0) {
+            options.astCacheName = argv[argi] + 12;
+        } else if (strncmp(argv[argi], "--dump=", 7) == 0) {
+            if (!parseDumpFormat(argv[argi] + 7, &options.dump)) {
+                fprintf(stderr, "Error: unknown dump format %s (text, jsonl or binary).\n", argv[argi] + 7);
+                return 19;
+            }
+        } else if (strncmp(argv[argi], "--dump-file=", 12) == 0) {
+            options.dumpName = argv[argi] + 12;
+        } else if (strcmp(argv[argi], "--dump-ir") == 0) {
+            options.dumpIR = true;
+        } else if (strcmp(argv[argi], "--export") == 0) {
+            options.exportInterface = true;
+        } else if (strncmp(argv[argi], "--import=", 9) == 0) {
+            if (options.import_count == INTERFACE_MAX_IMPORTS) {
+                fprintf(stderr, "Error: at most %d interfaces can be imported.\n", INTERFACE_MAX_IMPORTS);
+                return 19;
+            }
+            options.imports[options.import_count++] = argv[argi] + 9;
+        } else if (strncmp(argv[argi], "--jobs=", 7) == 0) {
+            if (!parseNumber(argv[argi] + 7, 0, BATCH_MAX_WORKERS, &jobs)) {       // 0 = one per processor
+                fprintf(stderr, "Error: --jobs takes a number from 0 to %d, not %s.\n", BATCH_MAX_WORKERS, argv[argi] + 7);
+                return 19;
+            }
+            batchMode = true;
+        } else if (strncmp(argv[argi], "--manifest=", 11) == 0) {
+            manifestName = argv[argi] + 11;
+            batchMode = true;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[argi]);
+            return 19;
+        }
+    }
+
+    // A JSON Lines or binary dump without --dump-file owns the standard output: everything else
+    // vypcomp prints there goes into stderr. The jobs of a batch would mix their dumps.
+    if ((options.dump == DUMP_JSONL || options.dump == DUMP_BINARY) && !options.dumpName) {
+        if (batchMode) {
+            fprintf(stderr, "Error: --dump=jsonl and --dump=binary go to the standard output only for one file, not in a batch.\n");
+            return 19;
+        }
+        fflush(stdout);
+        int dumpFd = dup(STDOUT_FILENO);
+        options.dumpStream = dumpFd >= 0 && dup2(STDERR_FILENO, STDOUT_FILENO) >= 0 ? fdopen(dumpFd, "w") : NULL;
+        if (!options.dumpStream) {
+            perror("Error opening the standard output for the dump");
+            return 19;
+        }
+    }
+
+    if (!batchMode) {
+        if (argi >= argc) {
+            fprintf(stderr, "Usage: %s [options] <input_file> [output_file]\n", argv[0]);
+            fprintf(stderr, "       %s [options] --jobs=N [--manifest=FILE] <input_file>...\n", argv[0]);
+            fprintf(stderr, "       %s --server[=SOCKET]\n", argv[0]);
+            return 19;
+        }
+        return compileFile(argv[argi], argi + 1 < argc ? argv[argi + 1] : "out.vc", &options);
+    }
+
+    // Batch: every file is an input, its code goes next to it unless the manifest names the output
+    const char* extension = options.native ? ".s" : ".vc";
+    Batch* batch = createBatch();
+    if (manifestName) {
+        FILE* manifestFile = fopen(manifestName, "r");
+        if (!manifestFile) {
+            perror("Error opening manifest");
+            freeBatch(batch);
+            return 19;
+        }
+        bool manifestRead = readManifest(batch, manifestFile, extension);
+        fclose(manifestFile);
+        if (!manifestRead) {
+            freeBatch(batch);
+            return 19;
+        }
+    }
+    for (; argi < argc; argi++) addBatchJob(batch, argv[argi], NULL, extension);
+
+    BatchStats batchStats;
+    int batchResult = runBatch(batch, jobs, compileBatchJob, &options, &batchStats);
+    printf("Batch: %d files, %d failed, %d workers.\n", batchStats.files, batchStats.failed, batchStats.workers);
+    freeBatch(batch);
+    return batchResult;
+}
+
+//Server
+
+// Trees of the server in the directory of the server; the files of an earlier server are removed
+static WarmPrograms* openWarmPrograms(const char* serverDirectory) {
+    WarmPrograms* warm = checkedCalloc(1, sizeof(WarmPrograms), ALLOC_MODULES);
+    snprintf(warm->directory, sizeof(warm->directory), "%s/ast", serverDirectory);
+    if (mkdir(warm->directory, 0700) != 0 && errno != EEXIST) {
+        perror("Error creating the AST directory of the server");
+        free(warm);
+        return NULL;
+    }
+    DIR* directory = opendir(warm->directory);
+    for (struct dirent* entry; directory && (entry = readdir(directory));) {
+        if (entry->d_name[0] == '.') continue;
+        char path[PATH_MAX + 256];
+        snprintf(path, sizeof(path), "%s/%s", warm->directory, entry->d_name);
+        unlink(path);
+    }
+    if (directory) closedir(directory);
+    return warm;
+}
+
+// What the parse of the source printed, stored next to its tree
+static bool readWarmLog(WarmPrograms* warm, const ASTCacheKey* key, WarmProgram* program) {
+    char path[PATH_MAX + 32];
+    warmLogPath(warm, key, path, sizeof(path));
+    FILE* log = fopen(path, "rb");
+    if (!log) return false;
+    bool read = fscanf(log, "%zu %zu", &program->out_length, &program->err_length) == 2 && fgetc(log) == '\n' &&
+                program->out_length + program->err_length < (size_t)1 << 30;
+    program->printed = read ? checkedMalloc(program->out_length + program->err_length + 1, ALLOC_MODULES) : NULL;
+    read = program->printed && fread(program->printed, 1, program->out_length + program->err_length, log) ==
+                                   program->out_length + program->err_length;
+    fclose(log);
+    if (!read) {
+        free(program->printed);
+        program->printed = NULL;
+    }
+    return read;
+}
+
+// Map the trees the children stored since the last request; the server calls it before each
+// one. True when there are new ones.
+static bool loadWarmPrograms(void* context) {
+    WarmPrograms* warm = context;
+    int loaded = warm->count;
+    struct stat status;
+    if (stat(warm->directory, &status) != 0 ||
+        (status.st_mtim.tv_sec == warm->modified.tv_sec && status.st_mtim.tv_nsec == warm->modified.tv_nsec)) {
+        return false;
+    }
+    warm->modified = status.st_mtim;          // Before the listing: a file stored during it changes it again
+    DIR* directory = opendir(warm->directory);
+    if (!directory) return false;
+    for (struct dirent* entry; warm->count < WARM_MAX_PROGRAMS && (entry = readdir(directory));) {
+        size_t length = strlen(entry->d_name);
+        if (length <= 4 || strcmp(entry->d_name + length - 4, ".ast") != 0) continue;
+        char path[PATH_MAX + 256];
+        snprintf(path, sizeof(path), "%s/%s", warm->directory, entry->d_name);
+        ASTCacheKey key;
+        if (!readASTCacheKey(path, &key) || findWarmProgram(warm, &key)) continue;
+        WarmProgram* program = &warm->programs[warm->count];
+        if (!readWarmLog(warm, &key, program)) continue;
+        ASTCacheStats stats;
+        init_symbol_table(&program->table);
+        if (loadASTCache(warm->directory, &key, &program->root, &program->table, &stats)) {
+            program->key = key;
+            warm->count++;
+        } else {
+            free(program->printed);
+        }
+    }
+    closedir(directory);
+    return warm->count > loaded;
+}
+
+static int compileRequest(int argc, char** argv, void* context) {
+    warmPrograms = context;
+    return runCompiler(argc, argv);
+}
+
+int main(int argc, char** argv) {
+    // --server[=SOCKET] keeps vypcomp running for the requests of vypclient, with the programs it
+    // parsed for them
+    if (argc > 1 && (strcmp(argv[1], "--server") == 0 || strncmp(argv[1], "--server=", 9) == 0)) {
+        char serverDirectory[PATH_MAX];
+        char socketName[PATH_MAX + 32];
+        if (!getServerDirectory(serverDirectory, sizeof(serverDirectory))) return 19;
+        if (argv[1][8] == '=') snprintf(socketName, sizeof(socketName), "%s", argv[1] + 9);
+        else if (!getServerSocket(socketName, sizeof(socketName))) return 19;
+        WarmPrograms* warm = openWarmPrograms(serverDirectory);
+        if (!warm) return 19;
+        ServerStats serverStats;
+        int serverResult = runServer(socketName, compileRequest, loadWarmPrograms, warm, &serverStats);
+        printf("Server: %d requests, %d failed, %d connections of other users refused, %d programs kept.\n",
+               serverStats.requests, serverStats.failed, serverStats.rejected, warm->count);
+        return serverResult;
+    }
+    return runCompiler(argc, argv);
+}
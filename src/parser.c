@@ -0,0 +1,2496 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison implementation for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* C LALR(1) parser skeleton written by Richard Stallman, by
+   simplifying the original so-called "semantic" parser.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+/* All symbols defined below should begin with yy or YY, to avoid
+   infringing on user name space.  This should be done even for local
+   variables, as they might otherwise be expanded by user macros.
+   There are some unavoidable exceptions within include files to
+   define necessary library symbols; they are noted "INFRINGES ON
+   USER NAME SPACE" below.  */
+
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
+
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
+
+/* Skeleton name.  */
+#define YYSKELETON_NAME "yacc.c"
+
+/* Pure parsers.  */
+#define YYPURE 0
+
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
+
+
+
+/* First part of user prologue.  */
+#line 1 "src/parser.y"
+
+#include "semantic_analysis.h"
+#include "symbol_table.h"
+#include "ast.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define YYDEBUG 1
+
+extern int yydebug;
+extern int yylex();
+extern char* yytext;
+
+// The parser reads its tokens through readToken, which skips the bodies in lazy mode
+static int readToken();
+#define yylex readToken
+
+void yyerror(const char* msg);
+
+extern SymbolTable symbol_table;
+extern ASTNode* root;
+
+ASTNode* root = NULL;
+bool (*unit_parsed)(ASTNode* unit) = NULL;
+bool lazy_bodies = false;
+int (*token_reader)() = NULL;
+
+// Block parsed by parseLazyBody
+static ASTNode* lazy_block = NULL;
+
+// Set while the members of a class are parsed: a method can override one of its parent
+static bool in_class_body = false;
+
+// Whether unit_parsed took a complete class or function, so it stays out of the lists of root
+static bool takeUnit(ASTNode* unit) {
+    return unit && unit_parsed && unit_parsed(unit);
+}
+
+
+#line 112 "src/parser.c"
+
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
+
+#include "parser.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
+{
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_YYLEX_ERROR = 3,                /* YYLEX_ERROR  */
+  YYSYMBOL_CLASS = 4,                      /* CLASS  */
+  YYSYMBOL_INT = 5,                        /* INT  */
+  YYSYMBOL_STRING = 6,                     /* STRING  */
+  YYSYMBOL_VOID = 7,                       /* VOID  */
+  YYSYMBOL_IDENTIFIER = 8,                 /* IDENTIFIER  */
+  YYSYMBOL_STRING_LITERAL = 9,             /* STRING_LITERAL  */
+  YYSYMBOL_INTEGER_LITERAL = 10,           /* INTEGER_LITERAL  */
+  YYSYMBOL_IF = 11,                        /* IF  */
+  YYSYMBOL_WHILE = 12,                     /* WHILE  */
+  YYSYMBOL_ELSE = 13,                      /* ELSE  */
+  YYSYMBOL_RETURN = 14,                    /* RETURN  */
+  YYSYMBOL_PRINT = 15,                     /* PRINT  */
+  YYSYMBOL_READ_INT = 16,                  /* READ_INT  */
+  YYSYMBOL_READ_STRING = 17,               /* READ_STRING  */
+  YYSYMBOL_LE = 18,                        /* LE  */
+  YYSYMBOL_GE = 19,                        /* GE  */
+  YYSYMBOL_EQ = 20,                        /* EQ  */
+  YYSYMBOL_NE = 21,                        /* NE  */
+  YYSYMBOL_SUPER = 22,                     /* SUPER  */
+  YYSYMBOL_NEW = 23,                       /* NEW  */
+  YYSYMBOL_THIS = 24,                      /* THIS  */
+  YYSYMBOL_LAZY_BODY = 25,                 /* LAZY_BODY  */
+  YYSYMBOL_BODY_START = 26,                /* BODY_START  */
+  YYSYMBOL_27_ = 27,                       /* '.'  */
+  YYSYMBOL_28_ = 28,                       /* '+'  */
+  YYSYMBOL_29_ = 29,                       /* '-'  */
+  YYSYMBOL_30_ = 30,                       /* '*'  */
+  YYSYMBOL_31_ = 31,                       /* '/'  */
+  YYSYMBOL_CAST = 32,                      /* CAST  */
+  YYSYMBOL_33_ = 33,                       /* '<'  */
+  YYSYMBOL_34_ = 34,                       /* '>'  */
+  YYSYMBOL_35_ = 35,                       /* ':'  */
+  YYSYMBOL_36_ = 36,                       /* '}'  */
+  YYSYMBOL_37_ = 37,                       /* '{'  */
+  YYSYMBOL_38_ = 38,                       /* '('  */
+  YYSYMBOL_39_ = 39,                       /* ')'  */
+  YYSYMBOL_40_ = 40,                       /* ','  */
+  YYSYMBOL_41_ = 41,                       /* ';'  */
+  YYSYMBOL_42_ = 42,                       /* '='  */
+  YYSYMBOL_YYACCEPT = 43,                  /* $accept  */
+  YYSYMBOL_input = 44,                     /* input  */
+  YYSYMBOL_program = 45,                   /* program  */
+  YYSYMBOL_class_definitions = 46,         /* class_definitions  */
+  YYSYMBOL_class_definition = 47,          /* class_definition  */
+  YYSYMBOL_class_open = 48,                /* class_open  */
+  YYSYMBOL_class_body = 49,                /* class_body  */
+  YYSYMBOL_class_member = 50,              /* class_member  */
+  YYSYMBOL_function_definitions = 51,      /* function_definitions  */
+  YYSYMBOL_function_definition = 52,       /* function_definition  */
+  YYSYMBOL_function_body = 53,             /* function_body  */
+  YYSYMBOL_parameter_list = 54,            /* parameter_list  */
+  YYSYMBOL_parameter_declaration_list = 55, /* parameter_declaration_list  */
+  YYSYMBOL_parameter_declaration = 56,     /* parameter_declaration  */
+  YYSYMBOL_declaration = 57,               /* declaration  */
+  YYSYMBOL_IDENTIFIER_LIST = 58,           /* IDENTIFIER_LIST  */
+  YYSYMBOL_type = 59,                      /* type  */
+  YYSYMBOL_simple_type = 60,               /* simple_type  */
+  YYSYMBOL_user_type = 61,                 /* user_type  */
+  YYSYMBOL_block = 62,                     /* block  */
+  YYSYMBOL_declaration_or_statement_list = 63, /* declaration_or_statement_list  */
+  YYSYMBOL_declaration_or_statement = 64,  /* declaration_or_statement  */
+  YYSYMBOL_statement = 65,                 /* statement  */
+  YYSYMBOL_print_arguments = 66,           /* print_arguments  */
+  YYSYMBOL_expression = 67,                /* expression  */
+  YYSYMBOL_argument_list = 68              /* argument_list  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
+
+
+
+
+#ifdef short
+# undef short
+#endif
+
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
+#endif
+
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
+typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
+#else
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
+#else
+typedef short yytype_uint8;
+#endif
+
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
+#else
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
+#endif
+
+#ifndef YYSIZE_T
+# ifdef __SIZE_TYPE__
+#  define YYSIZE_T __SIZE_TYPE__
+# elif defined size_t
+#  define YYSIZE_T size_t
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYSIZE_T size_t
+# else
+#  define YYSIZE_T unsigned
+# endif
+#endif
+
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_uint8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
+
+#ifndef YY_
+# if defined YYENABLE_NLS && YYENABLE_NLS
+#  if ENABLE_NLS
+#   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
+#  endif
+# endif
+# ifndef YY_
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
+# endif
+#endif
+
+/* Suppress unused-variable warnings by "using" E.  */
+#if ! defined lint || defined __GNUC__
+# define YY_USE(E) ((void) (E))
+#else
+# define YY_USE(E) /* empty */
+#endif
+
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
+#else
+# define YY_INITIAL_VALUE(Value) Value
+#endif
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
+#endif
+
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
+#endif
+
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
+
+/* The parser invokes alloca or malloc; define the necessary symbols.  */
+
+# ifdef YYSTACK_USE_ALLOCA
+#  if YYSTACK_USE_ALLOCA
+#   ifdef __GNUC__
+#    define YYSTACK_ALLOC __builtin_alloca
+#   elif defined __BUILTIN_VA_ARG_INCR
+#    include <alloca.h> /* INFRINGES ON USER NAME SPACE */
+#   elif defined _AIX
+#    define YYSTACK_ALLOC __alloca
+#   elif defined _MSC_VER
+#    include <malloc.h> /* INFRINGES ON USER NAME SPACE */
+#    define alloca _alloca
+#   else
+#    define YYSTACK_ALLOC alloca
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
+#     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
+#     endif
+#    endif
+#   endif
+#  endif
+# endif
+
+# ifdef YYSTACK_ALLOC
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+    /* The OS might guarantee only one guard page at the bottom of the stack,
+       and a page size can be as small as 4096 bytes.  So we cannot safely
+       invoke alloca (N) if N exceeds 4096.  Use a slightly smaller number
+       to allow for a few compiler-allocated temporary stack slots.  */
+#   define YYSTACK_ALLOC_MAXIMUM 4032 /* reasonable circa 2006 */
+#  endif
+# else
+#  define YYSTACK_ALLOC YYMALLOC
+#  define YYSTACK_FREE YYFREE
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+#   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
+#  endif
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
+       && ! ((defined YYMALLOC || defined malloc) \
+             && (defined YYFREE || defined free)))
+#   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
+#   endif
+#  endif
+#  ifndef YYMALLOC
+#   define YYMALLOC malloc
+#   if ! defined malloc && ! defined EXIT_SUCCESS
+void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+#  ifndef YYFREE
+#   define YYFREE free
+#   if ! defined free && ! defined EXIT_SUCCESS
+void free (void *); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+# endif
+#endif /* !defined yyoverflow */
+
+#if (! defined yyoverflow \
+     && (! defined __cplusplus \
+         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+
+/* A type that is properly aligned for any stack member.  */
+union yyalloc
+{
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+};
+
+/* The size of the maximum gap between one aligned stack and the next.  */
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
+
+/* The size of an array large to enough to hold all stacks, each with
+   N elements.  */
+# define YYSTACK_BYTES(N) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
+      + YYSTACK_GAP_MAXIMUM)
+
+# define YYCOPY_NEEDED 1
+
+/* Relocate STACK from its old location to the new one.  The
+   local variables YYSIZE and YYSTACKSIZE give the old and new number of
+   elements in the stack, and YYPTR gives the new location of the
+   stack.  Advance YYPTR to a properly aligned location for the next
+   stack.  */
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
+
+#endif
+
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
+/* YYFINAL -- State number of the termination state.  */
+#define YYFINAL  20
+/* YYLAST -- Last index in YYTABLE.  */
+#define YYLAST   440
+
+/* YYNTOKENS -- Number of terminals.  */
+#define YYNTOKENS  43
+/* YYNNTS -- Number of nonterminals.  */
+#define YYNNTS  26
+/* YYNRULES -- Number of rules.  */
+#define YYNRULES  92
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  183
+
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   282
+
+
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
+
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
+{
+       0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+      38,    39,    30,    28,    40,    29,    27,    31,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,    35,    41,
+      33,    42,    34,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,    37,     2,    36,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
+       5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
+      15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
+      25,    26,    32
+};
+
+#if YYDEBUG
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
+{
+       0,    93,    93,    94,   101,   104,   107,   110,   114,   117,
+     123,   146,   165,   171,   174,   177,   183,   186,   192,   204,
+     220,   248,   251,   258,   261,   264,   270,   273,   290,   304,
+     307,   323,   338,   360,   364,   371,   375,   382,   385,   388,
+     394,   402,   408,   411,   414,   421,   424,   432,   436,   439,
+     442,   445,   448,   451,   454,   457,   460,   469,   472,   475,
+     478,   485,   491,   495,   499,   503,   506,   511,   515,   519,
+     523,   526,   529,   532,   535,   538,   547,   553,   556,   559,
+     563,   566,   569,   572,   575,   578,   581,   584,   587,   590,
+     599,   600,   601
+};
+#endif
+
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
+/* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
+   First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
+static const char *const yytname[] =
+{
+  "\"end of file\"", "error", "\"invalid token\"", "YYLEX_ERROR", "CLASS",
+  "INT", "STRING", "VOID", "IDENTIFIER", "STRING_LITERAL",
+  "INTEGER_LITERAL", "IF", "WHILE", "ELSE", "RETURN", "PRINT", "READ_INT",
+  "READ_STRING", "LE", "GE", "EQ", "NE", "SUPER", "NEW", "THIS",
+  "LAZY_BODY", "BODY_START", "'.'", "'+'", "'-'", "'*'", "'/'", "CAST",
+  "'<'", "'>'", "':'", "'}'", "'{'", "'('", "')'", "','", "';'", "'='",
+  "$accept", "input", "program", "class_definitions", "class_definition",
+  "class_open", "class_body", "class_member", "function_definitions",
+  "function_definition", "function_body", "parameter_list",
+  "parameter_declaration_list", "parameter_declaration", "declaration",
+  "IDENTIFIER_LIST", "type", "simple_type", "user_type", "block",
+  "declaration_or_statement_list", "declaration_or_statement", "statement",
+  "print_arguments", "expression", "argument_list", YY_NULLPTR
+};
+
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
+{
+  return yytname[yysymbol];
+}
+#endif
+
+#define YYPACT_NINF (-73)
+
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
+
+#define YYTABLE_NINF (-60)
+
+#define yytable_value_is_error(Yyn) \
+  ((Yyn) == YYTABLE_NINF)
+
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
+static const yytype_int16 yypact[] =
+{
+     109,   -73,    14,   -73,   -73,   -73,   -73,     8,     7,   -73,
+     177,   -73,   139,   -73,    28,   -73,   -73,    51,   122,   -73,
+     -73,   -73,   139,   -73,    20,    62,   -73,   139,   -73,   -26,
+      40,    43,    25,    55,   -73,   -73,    81,   -73,     3,   -73,
+     -73,   146,    59,    48,   -73,   -73,   -73,    94,   113,    25,
+      25,    25,   -15,   -73,   -73,    85,    88,    73,   154,   173,
+     133,   168,    82,   127,   -73,   -73,   197,   169,   167,   -73,
+     207,   139,   -73,   -73,   176,   182,   192,   288,   310,   221,
+      25,   193,   201,   223,   203,   234,    -1,   209,   332,    25,
+      25,    25,    25,   243,    25,    25,    25,    25,    25,    25,
+      25,   -73,    12,    72,   354,   244,   -73,    25,     6,   139,
+     -73,    67,    25,   -73,     8,     8,    38,   354,    79,   -73,
+     -73,   215,    25,   217,    25,   -73,   381,   381,   381,   381,
+     218,   375,   375,   402,   402,   381,   381,    92,   222,   156,
+     -73,   134,   216,   -73,   -73,   -73,   -73,   -73,   240,   249,
+     -73,    25,    25,   -73,    25,    25,   137,    25,   402,    25,
+     -73,   -73,   151,   354,   256,   -73,   -73,   -73,     8,   153,
+     264,   354,   164,   -73,   188,   199,   -73,   -73,   -73,   -73,
+     -73,   -73,   -73
+};
+
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
+{
+       0,     7,     0,    37,    38,    39,    40,     0,     0,     2,
+       4,     9,     5,    19,     0,    35,    36,     0,    29,     3,
+       1,     8,     6,    18,     0,     0,    12,    13,    47,    40,
+       0,     0,     0,     0,    55,    45,     0,    54,     0,    43,
+      46,    23,     0,     0,    15,    17,    16,     0,     0,     0,
+       0,     0,    63,    62,    61,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,    41,    44,    24,     0,    25,    26,
+       0,    13,    11,    14,     0,     0,     0,     0,     0,     0,
+      90,     0,     0,     0,    71,     0,    63,     0,     0,     0,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+      90,    51,    62,     0,    58,     0,    30,     0,     0,     0,
+      28,     0,     0,    53,     0,     0,    67,    91,     0,    76,
+      77,     0,    90,    72,     0,    78,    86,    87,    88,    89,
+      64,    80,    81,    82,    83,    84,    85,     0,     0,     0,
+      33,     0,     0,    22,    20,    21,    27,    10,     0,    49,
+      50,    90,     0,    75,     0,    90,     0,    90,    79,    90,
+      74,    52,    62,    60,     0,    32,    31,    56,     0,     0,
+       0,    92,     0,    70,     0,     0,    34,    48,    68,    66,
+      69,    73,    65
+};
+
+/* YYPGOTO[NTERM-NUM].  */
+static const yytype_int16 yypgoto[] =
+{
+     -73,   -73,   -73,   -73,   255,   224,   204,   -40,   262,   148,
+     -73,   -73,   -73,   170,   -13,   -73,   -14,   -73,   -73,    -7,
+     -73,   238,   -73,   -73,   -30,   -72
+};
+
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_uint8 yydefgoto[] =
+{
+       0,     8,     9,    10,    11,    27,    43,    44,    12,    45,
+     144,    67,    68,    69,    46,   141,    14,    15,    16,    37,
+      38,    39,    40,   103,   117,   118
+};
+
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int16 yytable[] =
+{
+      19,    48,    61,    73,    36,    35,    28,    20,     3,     4,
+       5,    29,    79,    47,    30,    31,    49,    32,    33,    76,
+      77,    78,    17,    80,    36,    35,    79,    70,   137,    47,
+      88,   143,   104,    52,    53,    54,    24,    80,   -40,    64,
+      18,    55,    56,    18,    34,    18,    87,    57,    58,    59,
+     156,   -57,   -57,     3,     4,     5,     6,    47,    41,   126,
+     127,   128,   129,    60,   131,   132,   133,   134,   135,   136,
+      42,    73,     3,     4,     5,     6,   151,   142,    50,   169,
+     152,    51,   148,   172,    72,   174,    25,   175,    26,    63,
+      52,   102,    54,    62,   158,    70,    26,    47,    55,    56,
+      83,   145,    74,   147,    57,    58,    59,   149,   150,   163,
+       1,   138,   139,     2,     3,     4,     5,     6,   153,   154,
+      60,    75,   170,    81,   171,    28,    82,     3,     4,     5,
+      29,   160,   154,    30,    31,     7,    32,    33,     3,     4,
+       5,    86,    53,    54,     3,     4,     5,     6,    13,    55,
+      56,     3,     4,    66,     6,    57,    58,    59,    13,    18,
+      23,   177,    84,    34,    52,   162,    54,   105,   106,   107,
+      23,    60,    55,    56,   164,   165,   173,   154,    57,    58,
+      59,     2,     3,     4,     5,     6,    89,    90,    91,    92,
+     -59,   -59,   178,   154,    60,    93,    94,    95,    96,    97,
+      85,    98,    99,   180,   154,   -39,   100,   109,   108,   101,
+      89,    90,    91,    92,    41,   110,   105,   106,   107,    93,
+      94,    95,    96,    97,   112,    98,    99,   181,   154,   116,
+     100,   121,   119,   113,    89,    90,    91,    92,   182,   154,
+     120,   122,   123,    93,    94,    95,    96,    97,   124,    98,
+      99,   130,   140,   155,   100,   157,   159,   166,    89,    90,
+      91,    92,   168,   161,   176,    21,    71,    93,    94,    95,
+      96,    97,    22,    98,    99,   111,    65,     0,   100,   146,
+       0,   167,    89,    90,    91,    92,     0,     0,     0,     0,
+       0,    93,    94,    95,    96,    97,     0,    98,    99,     0,
+       0,     0,   100,     0,     0,   179,    89,    90,    91,    92,
+       0,     0,     0,     0,     0,    93,    94,    95,    96,    97,
+       0,    98,    99,     0,     0,     0,   100,   114,    89,    90,
+      91,    92,     0,     0,     0,     0,     0,    93,    94,    95,
+      96,    97,     0,    98,    99,     0,     0,     0,   100,   115,
+      89,    90,    91,    92,     0,     0,     0,     0,     0,    93,
+      94,    95,    96,    97,     0,    98,    99,     0,     0,     0,
+     100,   125,    89,    90,    91,    92,     0,     0,     0,     0,
+       0,    93,    94,    95,    96,    97,     0,    98,    99,     0,
+       0,     0,   100,    89,    90,    91,    92,     0,     0,   -60,
+     -60,   -60,   -60,     0,     0,    96,    97,     0,    98,    99,
+       0,     0,     0,   100,   -60,   -60,     0,     0,     0,   100,
+      89,    90,    91,    92,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,    98,    99,     0,     0,     0,
+     100
+};
+
+static const yytype_int16 yycheck[] =
+{
+       7,    27,    32,    43,    18,    18,     3,     0,     5,     6,
+       7,     8,    27,    27,    11,    12,    42,    14,    15,    49,
+      50,    51,     8,    38,    38,    38,    27,    41,   100,    43,
+      60,    25,    62,     8,     9,    10,     8,    38,    39,    36,
+      37,    16,    17,    37,    41,    37,    60,    22,    23,    24,
+     122,    39,    40,     5,     6,     7,     8,    71,    38,    89,
+      90,    91,    92,    38,    94,    95,    96,    97,    98,    99,
+       8,   111,     5,     6,     7,     8,    38,   107,    38,   151,
+      42,    38,   112,   155,    36,   157,    35,   159,    37,     8,
+       8,     9,    10,    38,   124,   109,    37,   111,    16,    17,
+      27,   108,     8,    36,    22,    23,    24,   114,   115,   139,
+       1,    39,    40,     4,     5,     6,     7,     8,    39,    40,
+      38,     8,   152,    38,   154,     3,    38,     5,     6,     7,
+       8,    39,    40,    11,    12,    26,    14,    15,     5,     6,
+       7,     8,     9,    10,     5,     6,     7,     8,     0,    16,
+      17,     5,     6,     7,     8,    22,    23,    24,    10,    37,
+      12,   168,     8,    41,     8,     9,    10,    40,    41,    42,
+      22,    38,    16,    17,    40,    41,    39,    40,    22,    23,
+      24,     4,     5,     6,     7,     8,    18,    19,    20,    21,
+      39,    40,    39,    40,    38,    27,    28,    29,    30,    31,
+      27,    33,    34,    39,    40,     8,    38,    40,    39,    41,
+      18,    19,    20,    21,    38,     8,    40,    41,    42,    27,
+      28,    29,    30,    31,    42,    33,    34,    39,    40,     8,
+      38,     8,    39,    41,    18,    19,    20,    21,    39,    40,
+      39,    38,     8,    27,    28,    29,    30,    31,    39,    33,
+      34,     8,     8,    38,    38,    38,    38,    41,    18,    19,
+      20,    21,    13,    41,     8,    10,    42,    27,    28,    29,
+      30,    31,    10,    33,    34,    71,    38,    -1,    38,   109,
+      -1,    41,    18,    19,    20,    21,    -1,    -1,    -1,    -1,
+      -1,    27,    28,    29,    30,    31,    -1,    33,    34,    -1,
+      -1,    -1,    38,    -1,    -1,    41,    18,    19,    20,    21,
+      -1,    -1,    -1,    -1,    -1,    27,    28,    29,    30,    31,
+      -1,    33,    34,    -1,    -1,    -1,    38,    39,    18,    19,
+      20,    21,    -1,    -1,    -1,    -1,    -1,    27,    28,    29,
+      30,    31,    -1,    33,    34,    -1,    -1,    -1,    38,    39,
+      18,    19,    20,    21,    -1,    -1,    -1,    -1,    -1,    27,
+      28,    29,    30,    31,    -1,    33,    34,    -1,    -1,    -1,
+      38,    39,    18,    19,    20,    21,    -1,    -1,    -1,    -1,
+      -1,    27,    28,    29,    30,    31,    -1,    33,    34,    -1,
+      -1,    -1,    38,    18,    19,    20,    21,    -1,    -1,    18,
+      19,    20,    21,    -1,    -1,    30,    31,    -1,    33,    34,
+      -1,    -1,    -1,    38,    33,    34,    -1,    -1,    -1,    38,
+      18,    19,    20,    21,    -1,    -1,    -1,    -1,    -1,    -1,
+      -1,    -1,    -1,    -1,    -1,    33,    34,    -1,    -1,    -1,
+      38
+};
+
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
+{
+       0,     1,     4,     5,     6,     7,     8,    26,    44,    45,
+      46,    47,    51,    52,    59,    60,    61,     8,    37,    62,
+       0,    47,    51,    52,     8,    35,    37,    48,     3,     8,
+      11,    12,    14,    15,    41,    57,    59,    62,    63,    64,
+      65,    38,     8,    49,    50,    52,    57,    59,    27,    42,
+      38,    38,     8,     9,    10,    16,    17,    22,    23,    24,
+      38,    67,    38,     8,    36,    64,     7,    54,    55,    56,
+      59,    48,    36,    50,     8,     8,    67,    67,    67,    27,
+      38,    38,    38,    27,     8,    27,     8,    59,    67,    18,
+      19,    20,    21,    27,    28,    29,    30,    31,    33,    34,
+      38,    41,     9,    66,    67,    40,    41,    42,    39,    40,
+       8,    49,    42,    41,    39,    39,     8,    67,    68,    39,
+      39,     8,    38,     8,    39,    39,    67,    67,    67,    67,
+       8,    67,    67,    67,    67,    67,    67,    68,    39,    40,
+       8,    58,    67,    25,    53,    62,    56,    36,    67,    62,
+      62,    38,    42,    39,    40,    38,    68,    38,    67,    38,
+      39,    41,     9,    67,    40,    41,    41,    41,    13,    68,
+      67,    67,    68,    39,    68,    68,     8,    62,    39,    41,
+      39,    39,    39
+};
+
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
+{
+       0,    43,    44,    44,    45,    45,    45,    45,    46,    46,
+      47,    47,    48,    49,    49,    49,    50,    50,    51,    51,
+      52,    53,    53,    54,    54,    54,    55,    55,    56,    57,
+      57,    57,    57,    58,    58,    59,    59,    60,    60,    60,
+      61,    62,    63,    63,    63,    64,    64,    65,    65,    65,
+      65,    65,    65,    65,    65,    65,    65,    66,    66,    66,
+      66,    67,    67,    67,    67,    67,    67,    67,    67,    67,
+      67,    67,    67,    67,    67,    67,    67,    67,    67,    67,
+      67,    67,    67,    67,    67,    67,    67,    67,    67,    67,
+      68,    68,    68
+};
+
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
+{
+       0,     2,     1,     2,     1,     1,     2,     1,     2,     1,
+       7,     5,     1,     0,     2,     1,     1,     1,     2,     1,
+       6,     1,     1,     0,     1,     1,     1,     3,     2,     0,
+       3,     5,     5,     1,     3,     1,     1,     1,     1,     1,
+       1,     3,     0,     1,     2,     1,     1,     1,     7,     5,
+       5,     3,     5,     4,     1,     1,     6,     1,     1,     3,
+       3,     1,     1,     1,     3,     6,     6,     3,     6,     6,
+       5,     2,     3,     6,     4,     4,     3,     3,     3,     4,
+       3,     3,     3,     3,     3,     3,     3,     3,     3,     3,
+       0,     1,     3
+};
+
+
+enum { YYENOMEM = -2 };
+
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
+
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
+
+
+#define YYRECOVERING()  (!!yyerrstatus)
+
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
+
+
+/* Enable debugging if requested.  */
+#if YYDEBUG
+
+# ifndef YYFPRINTF
+#  include <stdio.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYFPRINTF fprintf
+# endif
+
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
+static void
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
+{
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  if (!yyvaluep)
+    return;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
+
+static void
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
+{
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
+
+  yy_symbol_value_print (yyo, yykind, yyvaluep);
+  YYFPRINTF (yyo, ")");
+}
+
+/*------------------------------------------------------------------.
+| yy_stack_print -- Print the state stack from its BOTTOM up to its |
+| TOP (included).                                                   |
+`------------------------------------------------------------------*/
+
+static void
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
+{
+  YYFPRINTF (stderr, "Stack now");
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
+  YYFPRINTF (stderr, "\n");
+}
+
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
+
+
+/*------------------------------------------------.
+| Report that the YYRULE is going to be reduced.  |
+`------------------------------------------------*/
+
+static void
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule)
+{
+  int yylno = yyrline[yyrule];
+  int yynrhs = yyr2[yyrule];
+  int yyi;
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
+  /* The symbols being reduced.  */
+  for (yyi = 0; yyi < yynrhs; yyi++)
+    {
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)]);
+      YYFPRINTF (stderr, "\n");
+    }
+}
+
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule); \
+} while (0)
+
+/* Nonzero means print parse trace.  It is left uninitialized so that
+   multiple parsers can coexist.  */
+int yydebug;
+#else /* !YYDEBUG */
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
+# define YY_STACK_PRINT(Bottom, Top)
+# define YY_REDUCE_PRINT(Rule)
+#endif /* !YYDEBUG */
+
+
+/* YYINITDEPTH -- initial size of the parser's stacks.  */
+#ifndef YYINITDEPTH
+# define YYINITDEPTH 200
+#endif
+
+/* YYMAXDEPTH -- maximum size the stacks can grow to (effective only
+   if the built-in stack extension method is used).
+
+   Do not make this value too large; the results are undefined if
+   YYSTACK_ALLOC_MAXIMUM < YYSTACK_BYTES (YYMAXDEPTH)
+   evaluated with infinite-precision integer arithmetic.  */
+
+#ifndef YYMAXDEPTH
+# define YYMAXDEPTH 10000
+#endif
+
+
+
+
+
+
+/*-----------------------------------------------.
+| Release the memory associated to this symbol.  |
+`-----------------------------------------------*/
+
+static void
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep)
+{
+  YY_USE (yyvaluep);
+  if (!yymsg)
+    yymsg = "Deleting";
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+/* Lookahead token kind.  */
+int yychar;
+
+/* The semantic value of the lookahead symbol.  */
+YYSTYPE yylval;
+/* Number of syntax errors so far.  */
+int yynerrs;
+
+
+
+
+/*----------.
+| yyparse.  |
+`----------*/
+
+int
+yyparse (void)
+{
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
+
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
+
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
+
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
+
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
+
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
+  /* The variables used to return semantic value and location from the
+     action routines.  */
+  YYSTYPE yyval;
+
+
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+
+  /* The number of symbols on the RHS of the reduced rule.
+     Keep to zero when no symbol should be popped.  */
+  int yylen = 0;
+
+  YYDPRINTF ((stderr, "Starting parse\n"));
+
+  yychar = YYEMPTY; /* Cause a token to be read.  */
+
+  goto yysetstate;
+
+
+/*------------------------------------------------------------.
+| yynewstate -- push a new state, which is found in yystate.  |
+`------------------------------------------------------------*/
+yynewstate:
+  /* In all cases, when you get here, the value and location stacks
+     have just been pushed.  So pushing a state here evens the stacks.  */
+  yyssp++;
+
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
+
+  if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
+    {
+      /* Get the current used size of the three stacks, in elements.  */
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
+
+# if defined yyoverflow
+      {
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
+      }
+# else /* defined YYSTACK_RELOCATE */
+      /* Extend the stack our own way.  */
+      if (YYMAXDEPTH <= yystacksize)
+        YYNOMEM;
+      yystacksize *= 2;
+      if (YYMAXDEPTH < yystacksize)
+        yystacksize = YYMAXDEPTH;
+
+      {
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
+#  undef YYSTACK_RELOCATE
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
+      }
+# endif
+
+      yyssp = yyss + yysize - 1;
+      yyvsp = yyvs + yysize - 1;
+
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
+
+      if (yyss + yystacksize - 1 <= yyssp)
+        YYABORT;
+    }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
+
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
+
+  goto yybackup;
+
+
+/*-----------.
+| yybackup.  |
+`-----------*/
+yybackup:
+  /* Do appropriate processing given the current state.  Read a
+     lookahead token if we need one and don't already have one.  */
+
+  /* First try to decide what to do without reference to lookahead token.  */
+  yyn = yypact[yystate];
+  if (yypact_value_is_default (yyn))
+    goto yydefault;
+
+  /* Not known => get a lookahead token if don't already have one.  */
+
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
+  if (yychar == YYEMPTY)
+    {
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex ();
+    }
+
+  if (yychar <= YYEOF)
+    {
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
+      YYDPRINTF ((stderr, "Now at end of input.\n"));
+    }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
+  else
+    {
+      yytoken = YYTRANSLATE (yychar);
+      YY_SYMBOL_PRINT ("Next token is", yytoken, &yylval, &yylloc);
+    }
+
+  /* If the proper action on seeing token YYTOKEN is to reduce or to
+     detect an error, take that action.  */
+  yyn += yytoken;
+  if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken)
+    goto yydefault;
+  yyn = yytable[yyn];
+  if (yyn <= 0)
+    {
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
+      yyn = -yyn;
+      goto yyreduce;
+    }
+
+  /* Count tokens shifted since error; after three, turn off error
+     status.  */
+  if (yyerrstatus)
+    yyerrstatus--;
+
+  /* Shift the lookahead token.  */
+  YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
+  yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
+  goto yynewstate;
+
+
+/*-----------------------------------------------------------.
+| yydefault -- do the default action for the current state.  |
+`-----------------------------------------------------------*/
+yydefault:
+  yyn = yydefact[yystate];
+  if (yyn == 0)
+    goto yyerrlab;
+  goto yyreduce;
+
+
+/*-----------------------------.
+| yyreduce -- do a reduction.  |
+`-----------------------------*/
+yyreduce:
+  /* yyn is the number of a rule to reduce with.  */
+  yylen = yyr2[yyn];
+
+  /* If YYLEN is nonzero, implement the default value of the action:
+     '$$ = $1'.
+
+     Otherwise, the following line sets YYVAL to garbage.
+     This behavior is undocumented and Bison
+     users should not rely upon it.  Assigning to YYVAL
+     unconditionally makes the parser a bit smaller, and it avoids a
+     GCC warning that YYVAL may be used uninitialized.  */
+  yyval = yyvsp[1-yylen];
+
+
+  YY_REDUCE_PRINT (yyn);
+  switch (yyn)
+    {
+  case 3: /* input: BODY_START block  */
+#line 94 "src/parser.y"
+                       {
+        lazy_block = (yyvsp[0].astNode);
+    }
+#line 1342 "src/parser.c"
+    break;
+
+  case 4: /* program: class_definitions  */
+#line 101 "src/parser.y"
+                      {
+        root = (ASTNode*)createProgramNode((yyvsp[0].astNode), NULL);
+    }
+#line 1350 "src/parser.c"
+    break;
+
+  case 5: /* program: function_definitions  */
+#line 104 "src/parser.y"
+                           {
+        root = (ASTNode*)createProgramNode(NULL, (yyvsp[0].astNode));
+    }
+#line 1358 "src/parser.c"
+    break;
+
+  case 6: /* program: class_definitions function_definitions  */
+#line 107 "src/parser.y"
+                                             {
+        root = (ASTNode*)createProgramNode((yyvsp[-1].astNode), (yyvsp[0].astNode));
+    }
+#line 1366 "src/parser.c"
+    break;
+
+  case 7: /* program: error  */
+#line 110 "src/parser.y"
+           { YYABORT; }
+#line 1372 "src/parser.c"
+    break;
+
+  case 8: /* class_definitions: class_definitions class_definition  */
+#line 114 "src/parser.y"
+                                       {
+        (yyval.astNode) = takeUnit((yyvsp[0].astNode)) ? (yyvsp[-1].astNode) : (ASTNode*)appendNode((yyvsp[-1].astNode), (yyvsp[0].astNode));  // Agrega la clase actual a la lista
+    }
+#line 1380 "src/parser.c"
+    break;
+
+  case 9: /* class_definitions: class_definition  */
+#line 117 "src/parser.y"
+                       {
+        (yyval.astNode) = takeUnit((yyvsp[0].astNode)) ? NULL : (yyvsp[0].astNode);  // Primera clase en la lista
+    }
+#line 1388 "src/parser.c"
+    break;
+
+  case 10: /* class_definition: CLASS IDENTIFIER ':' IDENTIFIER class_open class_body '}'  */
+#line 123 "src/parser.y"
+                                                              {
+        in_class_body = false;
+        // Añadir la clase a la tabla de símbolos
+        if (find_symbol(&symbol_table, (yyvsp[-5].sval)) == -1) {
+	    printf("Processing class_body for class '%s': initial node type=%d\n", (yyvsp[-5].sval), (yyvsp[-1].astNode)->type);
+
+	    //Crear la clase y registrar en la tabla de símbolos
+            char** attributes = extractAttributesFromClassBody((yyvsp[-1].astNode)); // Extrae atributos del cuerpo
+            char** methods = extractMethodsFromClassBody((yyvsp[-1].astNode));       // Extrae métodos del cuerpo
+
+            int attr_count = countAttributes((yyvsp[-1].astNode)); // Cuenta atributos
+            int method_count = countMethods((yyvsp[-1].astNode));  // Cuenta métodos
+
+            // Indicamos que este es un símbolo de tipo "clase"
+            add_symbol(&symbol_table, (yyvsp[-5].sval), "class", false, true, false, NULL, 0, (yyvsp[-3].sval), attributes, attr_count, methods, method_count);  // $2 es el nombre de la clase
+            // Now we process class members (attributes and methods)
+            (yyval.astNode) = (ASTNode*)createClassNode((yyvsp[-5].sval), (yyvsp[-3].sval), (yyvsp[-1].astNode));  // Crear nodo de clase con herencia
+//	    program.classes = appendNode(program.classes, $$);  // Agrega la clase al programa
+        } else {
+            yyerror("Class already declared");  // Error si la clase ya está declarada
+            (yyval.astNode) = NULL;
+        }
+    }
+#line 1416 "src/parser.c"
+    break;
+
+  case 11: /* class_definition: CLASS IDENTIFIER class_open class_body '}'  */
+#line 146 "src/parser.y"
+                                                 {
+        in_class_body = false;
+        // Add the class to the symbols table without inheritance
+        if (find_symbol(&symbol_table, (yyvsp[-3].sval)) == -1) {
+	    char** attributes = extractAttributesFromClassBody((yyvsp[-1].astNode));
+            char** methods = extractMethodsFromClassBody((yyvsp[-1].astNode));
+            int attr_count = countAttributes((yyvsp[-1].astNode));
+            int method_count = countMethods((yyvsp[-1].astNode));
+
+            add_symbol(&symbol_table, (yyvsp[-3].sval), "class", false, true, false, NULL, 0, NULL, attributes, attr_count, methods, method_count);  // $2 es el nombre de la clase
+            (yyval.astNode) = (ASTNode*)createClassNode((yyvsp[-3].sval), NULL, (yyvsp[-1].astNode));  // Crear nodo de clase sin clase base
+        } else {
+            yyerror("Class already declared");
+            (yyval.astNode) = NULL;
+        }
+    }
+#line 1437 "src/parser.c"
+    break;
+
+  case 12: /* class_open: '{'  */
+#line 165 "src/parser.y"
+        {
+        in_class_body = true;
+    }
+#line 1445 "src/parser.c"
+    break;
+
+  case 13: /* class_body: %empty  */
+#line 171 "src/parser.y"
+                {
+	(yyval.astNode) = NULL;
+    }
+#line 1453 "src/parser.c"
+    break;
+
+  case 14: /* class_body: class_body class_member  */
+#line 174 "src/parser.y"
+                              {
+        (yyval.astNode) = (ASTNode*)appendNode((yyvsp[-1].astNode), (yyvsp[0].astNode));  // Agregar el nuevo miembro al cuerpo de la clase
+    }
+#line 1461 "src/parser.c"
+    break;
+
+  case 15: /* class_body: class_member  */
+#line 177 "src/parser.y"
+                 {
+	(yyval.astNode) = (yyvsp[0].astNode); // Primera declaración o método en la lista
+    }
+#line 1469 "src/parser.c"
+    break;
+
+  case 16: /* class_member: declaration  */
+#line 183 "src/parser.y"
+                {
+        (yyval.astNode) = (yyvsp[0].astNode);  // El miembro es una declaración
+    }
+#line 1477 "src/parser.c"
+    break;
+
+  case 17: /* class_member: function_definition  */
+#line 186 "src/parser.y"
+                          {
+        (yyval.astNode) = (yyvsp[0].astNode);  // El miembro es una función
+    }
+#line 1485 "src/parser.c"
+    break;
+
+  case 18: /* function_definitions: function_definitions function_definition  */
+#line 192 "src/parser.y"
+                                             {
+        // Verify if the function is already in the symbols table
+        ASTFunctionNode* funcNode = (ASTFunctionNode*)(yyvsp[0].astNode);
+        if (find_symbol(&symbol_table, funcNode->name) == -1) {
+            printf("Adding function: %s\n", funcNode->name);
+	            // Agregar la función a la tabla de símbolos
+            add_symbol(&symbol_table, funcNode->name, funcNode->returnType, true, false, false, extractParameterTypes(funcNode->parameters), funcNode->param_count, NULL, NULL, 0, NULL, 0);  // Parámetros NULL por ahora
+        } else {
+            yyerror("Function already declared");
+        }
+        (yyval.astNode) = takeUnit((yyvsp[0].astNode)) ? (yyvsp[-1].astNode) : (ASTNode*)appendNode((yyvsp[-1].astNode), (yyvsp[0].astNode));  // Combina la lista de funciones con una nueva función
+    }
+#line 1502 "src/parser.c"
+    break;
+
+  case 19: /* function_definitions: function_definition  */
+#line 204 "src/parser.y"
+                          {
+        (yyval.astNode) = (yyvsp[0].astNode);  // The initial list is simply the first node
+        ASTFunctionNode* funcNode = (ASTFunctionNode*)(yyvsp[0].astNode);
+        if (find_symbol(&symbol_table, funcNode->name) == -1) {
+            printf("Adding function: %s\n", funcNode->name);
+            // Add the function to the symbols table
+            add_symbol(&symbol_table, funcNode->name, funcNode->returnType, true, false, false, extractParameterTypes(funcNode->parameters), funcNode->param_count, NULL, NULL, 0, NULL, 0);
+        } else {
+            yyerror("Function already declared");
+        }
+        if (takeUnit((yyvsp[0].astNode))) (yyval.astNode) = NULL;
+    }
+#line 1519 "src/parser.c"
+    break;
+
+  case 20: /* function_definition: type IDENTIFIER '(' parameter_list ')' function_body  */
+#line 220 "src/parser.y"
+                                                         {
+        // Create the function node
+        (yyval.astNode) = (ASTNode*)createFunctionNode((yyvsp[-4].sval), (yyvsp[-5].sval), (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Crear nodo de función
+        // Count the parameter number
+	printf("Parameters: ");
+        int param_count = 0;
+        ASTNode* param_node = (yyvsp[-2].astNode);
+        while (param_node) {
+            param_count++;
+            param_node = param_node->next;
+        }
+
+        // Verificar si la función ya está en la tabla de símbolos
+        int found = find_symbol(&symbol_table, (yyvsp[-4].sval));  // Buscar la función por su nombre
+        if (found == -1) {
+            // If the function is not declared, add it to the symbols table
+            printf("Adding function: %s with %d parameters\n", (yyvsp[-4].sval), param_count);
+            add_symbol(&symbol_table, (yyvsp[-4].sval), (yyvsp[-5].sval), true, false, false, extractParameterTypes((yyvsp[-2].astNode)), param_count, NULL, NULL, 0, NULL, 0);  // Agregar función a la tabla de símbolos
+        } else if (!in_class_body) {
+            // If the function is already declared, report an error
+            yyerror("Function already declared");
+            (yyval.astNode) = NULL;  // Indicate that the function should not be added to the tree
+        }
+    }
+#line 1548 "src/parser.c"
+    break;
+
+  case 21: /* function_body: block  */
+#line 248 "src/parser.y"
+          {
+        (yyval.astNode) = (yyvsp[0].astNode);
+    }
+#line 1556 "src/parser.c"
+    break;
+
+  case 22: /* function_body: LAZY_BODY  */
+#line 251 "src/parser.y"
+                {
+        (yyval.astNode) = (yyvsp[0].astNode);  // Tokens of the body, parsed later by parseLazyBody
+    }
+#line 1564 "src/parser.c"
+    break;
+
+  case 23: /* parameter_list: %empty  */
+#line 258 "src/parser.y"
+                 {
+        (yyval.astNode) = NULL; // No parameters, the list will be null
+    }
+#line 1572 "src/parser.c"
+    break;
+
+  case 24: /* parameter_list: VOID  */
+#line 261 "src/parser.y"
+          {
+        (yyval.astNode) = NULL; // 'void' means an empty parameter list
+    }
+#line 1580 "src/parser.c"
+    break;
+
+  case 25: /* parameter_list: parameter_declaration_list  */
+#line 264 "src/parser.y"
+                                 {
+        (yyval.astNode) = (yyvsp[0].astNode); // Parameter list
+    }
+#line 1588 "src/parser.c"
+    break;
+
+  case 26: /* parameter_declaration_list: parameter_declaration  */
+#line 270 "src/parser.y"
+                          {
+        (yyval.astNode) = (yyvsp[0].astNode); // A single parameter
+    }
+#line 1596 "src/parser.c"
+    break;
+
+  case 27: /* parameter_declaration_list: parameter_declaration_list ',' parameter_declaration  */
+#line 273 "src/parser.y"
+                                                           {
+        // A name is declared once per function; other functions can reuse it
+        bool repeated = false;
+        for (ASTNode* param = (yyvsp[-2].astNode); param; param = param->next) {
+            if (strcmp(((ASTDeclarationNode*)param)->name, ((ASTDeclarationNode*)(yyvsp[0].astNode))->name) == 0) repeated = true;
+        }
+        if (repeated) {
+            yyerror("Parameter already declared");
+            freeAST((yyvsp[0].astNode));
+            (yyval.astNode) = (yyvsp[-2].astNode);
+        } else {
+            (yyval.astNode) = (ASTNode*)appendNode((yyvsp[-2].astNode), (yyvsp[0].astNode)); // Combined parameter list
+        }
+    }
+#line 1615 "src/parser.c"
+    break;
+
+  case 28: /* parameter_declaration: type IDENTIFIER  */
+#line 290 "src/parser.y"
+                    {
+        printf("Creating parameter: type=%s, name=%s\n", (yyvsp[-1].sval), (yyvsp[0].sval));
+        // The parameter belongs to its function: it is always kept, the symbols table only gets
+        // the first parameter of each name
+        if (find_symbol(&symbol_table, (yyvsp[0].sval)) == -1) {
+            add_symbol(&symbol_table, (yyvsp[0].sval), (yyvsp[-1].sval), false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);  // Añadir parámetro a la tabla
+        }
+        (yyval.astNode) = (ASTNode*)createDeclarationNode((yyvsp[-1].sval), (yyvsp[0].sval), NULL);  // Crear nodo de parámetro sin inicialización
+    }
+#line 1629 "src/parser.c"
+    break;
+
+  case 29: /* declaration: %empty  */
+#line 304 "src/parser.y"
+                {
+        (yyval.astNode) = NULL;  // Empty blocks like 'else {}' end up here
+    }
+#line 1637 "src/parser.c"
+    break;
+
+  case 30: /* declaration: type IDENTIFIER ';'  */
+#line 307 "src/parser.y"
+                         {
+        printf("Creating declaration: type=%s, name=%s\n", (yyvsp[-2].sval), (yyvsp[-1].sval));
+
+        // Verify if the variable is already declared
+        int found = find_symbol(&symbol_table, (yyvsp[-1].sval));
+        if (found == -1) {
+            printf("Symbol not found, adding: %s\n", (yyvsp[-1].sval));
+            // If the variable is not declared, add it to the symbols table
+            add_symbol(&symbol_table, (yyvsp[-1].sval), (yyvsp[-2].sval), false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);  // Agregar variable
+            (yyval.astNode) = (ASTNode*)createDeclarationNode((yyvsp[-2].sval), (yyvsp[-1].sval), NULL);  // Crear nodo de declaración sin inicialización
+        } else {
+            // If the variable is already declared, report an error
+            yyerror("Variable already declared");
+            (yyval.astNode) = NULL;
+        }
+    }
+#line 1658 "src/parser.c"
+    break;
+
+  case 31: /* declaration: type IDENTIFIER '=' expression ';'  */
+#line 323 "src/parser.y"
+                                         {
+	printf("Creating declaration with initialization: type=%s, name=%s\n", (yyvsp[-4].sval), (yyvsp[-3].sval));
+        // Verify if the variable is already declared
+        int found = find_symbol(&symbol_table, (yyvsp[-3].sval));
+        if (found == -1) {
+            printf("Symbol not found, adding: %s\n", (yyvsp[-3].sval));
+            // If the variable is not declared, add it to the symbols table
+            add_symbol(&symbol_table, (yyvsp[-3].sval), (yyvsp[-4].sval), false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);  // Agregar variable
+            (yyval.astNode) = (ASTNode*)createDeclarationNode((yyvsp[-4].sval), (yyvsp[-3].sval), (yyvsp[-1].astNode));  // Crear nodo de declaración con inicialización
+        } else {
+            // If the variable is already declared, report an error
+            yyerror("Variable already declared");
+            (yyval.astNode) = NULL;
+        }
+    }
+#line 1678 "src/parser.c"
+    break;
+
+  case 32: /* declaration: type IDENTIFIER ',' IDENTIFIER_LIST ';'  */
+#line 338 "src/parser.y"
+                                             {
+	printf("Creating declaration list: type=%s, name=%s\n", (yyvsp[-4].sval), (yyvsp[-3].sval));
+        // Expand 'type a, b, c;' into one declaration node per identifier
+        ASTNode* declarations = (ASTNode*)createDeclarationNode((yyvsp[-4].sval), (yyvsp[-3].sval), NULL);
+        if (find_symbol(&symbol_table, (yyvsp[-3].sval)) == -1) {
+            add_symbol(&symbol_table, (yyvsp[-3].sval), (yyvsp[-4].sval), false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);
+        }
+        ASTNode* identifier = (yyvsp[-1].astNode);
+        while (identifier) {
+            ASTNode* nextIdentifier = identifier->next;
+            const char* name = ((ASTVariableNode*)identifier)->name;
+            if (find_symbol(&symbol_table, name) == -1) {
+                add_symbol(&symbol_table, name, (yyvsp[-4].sval), false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);
+            }
+            declarations = appendNode(declarations, (ASTNode*)createDeclarationNode((yyvsp[-4].sval), name, NULL));
+            identifier = nextIdentifier;
+        }
+        (yyval.astNode) = declarations;  // Múltiples declaraciones
+    }
+#line 1702 "src/parser.c"
+    break;
+
+  case 33: /* IDENTIFIER_LIST: IDENTIFIER  */
+#line 360 "src/parser.y"
+               {
+        // Create a node for the identifier and assign it to $$.
+        (yyval.astNode) = (ASTNode*)createVariableNode((yyvsp[0].sval));
+    }
+#line 1711 "src/parser.c"
+    break;
+
+  case 34: /* IDENTIFIER_LIST: IDENTIFIER_LIST ',' IDENTIFIER  */
+#line 364 "src/parser.y"
+                                     {
+        // Append the new identifier to the flat list of variable nodes.
+        (yyval.astNode) = appendNode((yyvsp[-2].astNode), (ASTNode*)createVariableNode((yyvsp[0].sval)));
+    }
+#line 1720 "src/parser.c"
+    break;
+
+  case 35: /* type: simple_type  */
+#line 371 "src/parser.y"
+                {
+	printf("Parsed simple_type: %s\n", (yyvsp[0].sval));
+        (yyval.sval) = (yyvsp[0].sval); // Pass the type value directly
+    }
+#line 1729 "src/parser.c"
+    break;
+
+  case 36: /* type: user_type  */
+#line 375 "src/parser.y"
+                {
+	printf("Parsed user_type: %s\n", (yyvsp[0].sval));
+        (yyval.sval) = (yyvsp[0].sval); // Pass the name of the user type
+    }
+#line 1738 "src/parser.c"
+    break;
+
+  case 37: /* simple_type: INT  */
+#line 382 "src/parser.y"
+        {
+        (yyval.sval) = (yyvsp[0].sval); // "int", "string" or "void" are already defined in the lexer
+    }
+#line 1746 "src/parser.c"
+    break;
+
+  case 38: /* simple_type: STRING  */
+#line 385 "src/parser.y"
+             {
+        (yyval.sval) = (yyvsp[0].sval);
+    }
+#line 1754 "src/parser.c"
+    break;
+
+  case 39: /* simple_type: VOID  */
+#line 388 "src/parser.y"
+           {
+        (yyval.sval) = (yyvsp[0].sval);
+    }
+#line 1762 "src/parser.c"
+    break;
+
+  case 40: /* user_type: IDENTIFIER  */
+#line 394 "src/parser.y"
+               {
+        (yyval.sval) = (yyvsp[0].sval); // User -defined class or type identifier
+    }
+#line 1770 "src/parser.c"
+    break;
+
+  case 41: /* block: '{' declaration_or_statement_list '}'  */
+#line 402 "src/parser.y"
+                                          {
+        (yyval.astNode) = (ASTNode*)createBlockNode((yyvsp[-1].astNode)); // Create a block node with the list of statements or sentences
+    }
+#line 1778 "src/parser.c"
+    break;
+
+  case 42: /* declaration_or_statement_list: %empty  */
+#line 408 "src/parser.y"
+                 {
+        (yyval.astNode) = NULL;  // If the list is empty, the $$ value is null
+    }
+#line 1786 "src/parser.c"
+    break;
+
+  case 43: /* declaration_or_statement_list: declaration_or_statement  */
+#line 411 "src/parser.y"
+                               {
+        (yyval.astNode) = (yyvsp[0].astNode);  // If there is only one statement or sentence, that node simply passes
+    }
+#line 1794 "src/parser.c"
+    break;
+
+  case 44: /* declaration_or_statement_list: declaration_or_statement_list declaration_or_statement  */
+#line 414 "src/parser.y"
+                                                             {
+        (yyval.astNode) = (ASTNode*)appendNode((yyvsp[-1].astNode), (yyvsp[0].astNode));  // If there are multiple statements or sentences, we add them
+    }
+#line 1802 "src/parser.c"
+    break;
+
+  case 45: /* declaration_or_statement: declaration  */
+#line 421 "src/parser.y"
+                {
+        (yyval.astNode) = (yyvsp[0].astNode);  // If it is a statement, we assign the declaration node
+    }
+#line 1810 "src/parser.c"
+    break;
+
+  case 46: /* declaration_or_statement: statement  */
+#line 424 "src/parser.y"
+                {
+        (yyval.astNode) = (yyvsp[0].astNode);  // If it is a sentence, we assign the node of the sentence
+    }
+#line 1818 "src/parser.c"
+    break;
+
+  case 47: /* statement: YYLEX_ERROR  */
+#line 432 "src/parser.y"
+                {
+        fprintf(stderr, "Lexical error detected in parser.\n");
+        YYABORT;
+    }
+#line 1827 "src/parser.c"
+    break;
+
+  case 48: /* statement: IF '(' expression ')' block ELSE block  */
+#line 436 "src/parser.y"
+                                            {
+        (yyval.astNode) = (ASTNode*)createIfNode((yyvsp[-4].astNode), (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Create 'if' node with the condition and blocks
+    }
+#line 1835 "src/parser.c"
+    break;
+
+  case 49: /* statement: IF '(' expression ')' block  */
+#line 439 "src/parser.y"
+                                  {
+        (yyval.astNode) = (ASTNode*)createIfNode((yyvsp[-2].astNode), (yyvsp[0].astNode), NULL);  // Create 'if' node without block 'else'
+    }
+#line 1843 "src/parser.c"
+    break;
+
+  case 50: /* statement: WHILE '(' expression ')' block  */
+#line 442 "src/parser.y"
+                                     {
+        (yyval.astNode) = (ASTNode*)createWhileNode((yyvsp[-2].astNode), (yyvsp[0].astNode));  // Create 'While' node with the condition and block
+    }
+#line 1851 "src/parser.c"
+    break;
+
+  case 51: /* statement: RETURN expression ';'  */
+#line 445 "src/parser.y"
+                            {
+        (yyval.astNode) = (ASTNode*)createReturnNode((yyvsp[-1].astNode));  // Create 'return' node with expression
+    }
+#line 1859 "src/parser.c"
+    break;
+
+  case 52: /* statement: PRINT '(' print_arguments ')' ';'  */
+#line 448 "src/parser.y"
+                                        {
+        (yyval.astNode) = (ASTNode*)createPrintNode((yyvsp[-2].astNode));  // Create 'print' node with arguments
+    }
+#line 1867 "src/parser.c"
+    break;
+
+  case 53: /* statement: IDENTIFIER '=' expression ';'  */
+#line 451 "src/parser.y"
+                                    {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_ASSIGN,createVariableNode((yyvsp[-3].sval)), (yyvsp[-1].astNode));  // Create allocation node
+    }
+#line 1875 "src/parser.c"
+    break;
+
+  case 54: /* statement: block  */
+#line 454 "src/parser.y"
+            {
+	(yyval.astNode) = (yyvsp[0].astNode);  // The block is a list of sentences
+    }
+#line 1883 "src/parser.c"
+    break;
+
+  case 55: /* statement: ';'  */
+#line 457 "src/parser.y"
+          {
+        (yyval.astNode) = NULL; // Empty sentence
+    }
+#line 1891 "src/parser.c"
+    break;
+
+  case 56: /* statement: IDENTIFIER '.' IDENTIFIER '=' expression ';'  */
+#line 460 "src/parser.y"
+                                                  {
+        printf("Parsing: %s.%s = ...\n", (yyvsp[-5].sval), (yyvsp[-3].sval));  // Depuración
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_ASSIGN,
+                                           (ASTNode*)createMemberAccessNode(createVariableNode((yyvsp[-5].sval)), (yyvsp[-3].sval)),
+                                           (yyvsp[-1].astNode));
+    }
+#line 1902 "src/parser.c"
+    break;
+
+  case 57: /* print_arguments: STRING_LITERAL  */
+#line 469 "src/parser.y"
+                   { 
+        (yyval.astNode) = (ASTNode*)createLiteralNode((yyvsp[0].sval), "string");  // Create chain literal node
+    }
+#line 1910 "src/parser.c"
+    break;
+
+  case 58: /* print_arguments: expression  */
+#line 472 "src/parser.y"
+                 { 
+        (yyval.astNode) = (yyvsp[0].astNode);  // The argument is an expression
+    }
+#line 1918 "src/parser.c"
+    break;
+
+  case 59: /* print_arguments: print_arguments ',' STRING_LITERAL  */
+#line 475 "src/parser.y"
+                                         {
+        (yyval.astNode) = (ASTNode*)appendNode((yyvsp[-2].astNode), (ASTNode*)createLiteralNode((yyvsp[0].sval), "string"));  // Add literal to the list of arguments
+    }
+#line 1926 "src/parser.c"
+    break;
+
+  case 60: /* print_arguments: print_arguments ',' expression  */
+#line 478 "src/parser.y"
+                                     {
+        (yyval.astNode) = (ASTNode*)appendNode((yyvsp[-2].astNode), (yyvsp[0].astNode));  // Add expression to the list of arguments
+    }
+#line 1934 "src/parser.c"
+    break;
+
+  case 61: /* expression: INTEGER_LITERAL  */
+#line 485 "src/parser.y"
+                 {
+	printf("Creating literal: %d\n", (yyvsp[0].ival));
+        char buffer[20];
+        snprintf(buffer, sizeof(buffer), "%d", (yyvsp[0].ival));  // Convierte el entero a cadena
+        (yyval.astNode) = (ASTNode*)createLiteralNode(buffer, "int");
+  }
+#line 1945 "src/parser.c"
+    break;
+
+  case 62: /* expression: STRING_LITERAL  */
+#line 491 "src/parser.y"
+                   {
+        printf("Creating string literal: %s\n", (yyvsp[0].sval));
+        (yyval.astNode) = (ASTNode*)createStringLiteralNode((yyvsp[0].sval));
+  }
+#line 1954 "src/parser.c"
+    break;
+
+  case 63: /* expression: IDENTIFIER  */
+#line 495 "src/parser.y"
+               {
+        printf("Creating variable node: %s\n", (yyvsp[0].sval));
+        (yyval.astNode) = (ASTNode*)createVariableNode((yyvsp[0].sval));
+  }
+#line 1963 "src/parser.c"
+    break;
+
+  case 64: /* expression: expression '.' IDENTIFIER  */
+#line 499 "src/parser.y"
+                              {
+        // Access to attribute or method
+        (yyval.astNode) = (ASTNode*)createMemberAccessNode((yyvsp[-2].astNode), (yyvsp[0].sval));
+  }
+#line 1972 "src/parser.c"
+    break;
+
+  case 65: /* expression: expression '.' IDENTIFIER '(' argument_list ')'  */
+#line 503 "src/parser.y"
+                                                   {
+        (yyval.astNode) = (ASTNode*)createMethodCallNode((yyvsp[-5].astNode), (yyvsp[-3].sval), (yyvsp[-1].astNode));
+  }
+#line 1980 "src/parser.c"
+    break;
+
+  case 66: /* expression: IDENTIFIER '.' IDENTIFIER '=' expression ';'  */
+#line 506 "src/parser.y"
+                                                 {
+    (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_ASSIGN,
+                                       (ASTNode*)createMemberAccessNode(createVariableNode((yyvsp[-5].sval)), (yyvsp[-3].sval)),
+                                       (yyvsp[-1].astNode));
+  }
+#line 1990 "src/parser.c"
+    break;
+
+  case 67: /* expression: IDENTIFIER '.' IDENTIFIER  */
+#line 511 "src/parser.y"
+                             {
+        // Access to attribute
+        (yyval.astNode) = (ASTNode*)createMemberAccessNode(createVariableNode((yyvsp[-2].sval)), (yyvsp[0].sval));
+  }
+#line 1999 "src/parser.c"
+    break;
+
+  case 68: /* expression: IDENTIFIER '.' IDENTIFIER '(' argument_list ')'  */
+#line 515 "src/parser.y"
+                                                                       {
+        // Llamada a método
+        (yyval.astNode) = (ASTNode*)createMethodCallNode(createVariableNode((yyvsp[-5].sval)), (yyvsp[-3].sval), (yyvsp[-1].astNode));
+  }
+#line 2008 "src/parser.c"
+    break;
+
+  case 69: /* expression: SUPER '.' IDENTIFIER '(' argument_list ')'  */
+#line 519 "src/parser.y"
+                                              {
+        // Method call from Super
+        (yyval.astNode) = (ASTNode*)createMethodCallNode(createSuperNode(), (yyvsp[-3].sval), (yyvsp[-1].astNode));
+  }
+#line 2017 "src/parser.c"
+    break;
+
+  case 70: /* expression: NEW IDENTIFIER '(' argument_list ')'  */
+#line 523 "src/parser.y"
+                                                            {
+        (yyval.astNode) = (ASTNode*)createNewNode((yyvsp[-3].sval), (yyvsp[-1].astNode)); // Node for 'new IDENTIFIER()'
+  }
+#line 2025 "src/parser.c"
+    break;
+
+  case 71: /* expression: NEW IDENTIFIER  */
+#line 526 "src/parser.y"
+                                                   {
+        (yyval.astNode) = (ASTNode*)createNewNode((yyvsp[0].sval), NULL); // Node for 'new IDENTIFIER'
+  }
+#line 2033 "src/parser.c"
+    break;
+
+  case 72: /* expression: THIS '.' IDENTIFIER  */
+#line 529 "src/parser.y"
+                                                                     {
+    (yyval.astNode) = (ASTNode*)createMemberAccessNode(createThisNode(), (yyvsp[0].sval));  // Node for access to attribute/method from 'this'
+  }
+#line 2041 "src/parser.c"
+    break;
+
+  case 73: /* expression: THIS '.' IDENTIFIER '(' argument_list ')'  */
+#line 532 "src/parser.y"
+                                              {
+    (yyval.astNode) = (ASTNode*)createMethodCallNode(createThisNode(), (yyvsp[-3].sval), (yyvsp[-1].astNode));  // Node for call to method from 'this'
+  }
+#line 2049 "src/parser.c"
+    break;
+
+  case 74: /* expression: expression '(' argument_list ')'  */
+#line 535 "src/parser.y"
+                                                               {
+      (yyval.astNode) = (ASTNode*)createFunctionCallWithContextNode((yyvsp[-3].astNode), (yyvsp[-1].astNode));  // Node with context
+  }
+#line 2057 "src/parser.c"
+    break;
+
+  case 75: /* expression: IDENTIFIER '(' argument_list ')'  */
+#line 538 "src/parser.y"
+                                                               {
+	if (strcmp((yyvsp[-3].sval), "subStr") == 0) {
+		printf("Creating subStr function call\n");
+        	(yyval.astNode) = createFunctionCallNode((yyvsp[-3].sval), (yyvsp[-1].astNode));  // Subr call with your arguments
+        } else {
+		printf("Creating general function call\n");
+        	(yyval.astNode) = (ASTNode*)createFunctionCallNode((yyvsp[-3].sval), (yyvsp[-1].astNode));  // CALL TO GENERAL FUNCTION
+        }
+  }
+#line 2071 "src/parser.c"
+    break;
+
+  case 76: /* expression: READ_INT '(' ')'  */
+#line 547 "src/parser.y"
+                                       {
+	printf("Adding predefined function: readInt\n");
+        char* readIntParams[] = {NULL};  // No parameters
+        add_symbol(&symbol_table, "readInt", "int", true, false, false, readIntParams, 0, NULL, NULL, 0, NULL, 0);
+        (yyval.astNode) = (ASTNode*)createFunctionCallNode("readInt", NULL);  // Create node for call to readInt()
+  }
+#line 2082 "src/parser.c"
+    break;
+
+  case 77: /* expression: READ_STRING '(' ')'  */
+#line 553 "src/parser.y"
+                                           {
+        (yyval.astNode) = createFunctionCallNode("readString", NULL); // Call to Readstring function without arguments
+  }
+#line 2090 "src/parser.c"
+    break;
+
+  case 78: /* expression: '(' expression ')'  */
+#line 556 "src/parser.y"
+                                                        {
+        (yyval.astNode) = (yyvsp[-1].astNode);  // Simply return the expression within parentheses
+  }
+#line 2098 "src/parser.c"
+    break;
+
+  case 79: /* expression: '(' type ')' expression  */
+#line 559 "src/parser.y"
+                                                                                        {
+      printf("Creating type cast: (%s)\n", (yyvsp[-2].sval));
+        (yyval.astNode) = (ASTNode*)createTypeCastNode((yyvsp[-2].sval), (yyvsp[0].astNode));
+  }
+#line 2107 "src/parser.c"
+    break;
+
+  case 80: /* expression: expression '+' expression  */
+#line 563 "src/parser.y"
+                               {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_ADD, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Addition
+  }
+#line 2115 "src/parser.c"
+    break;
+
+  case 81: /* expression: expression '-' expression  */
+#line 566 "src/parser.y"
+                               {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_SUB, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Subtraction
+  }
+#line 2123 "src/parser.c"
+    break;
+
+  case 82: /* expression: expression '*' expression  */
+#line 569 "src/parser.y"
+                               {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_MUL, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Multiplication
+  }
+#line 2131 "src/parser.c"
+    break;
+
+  case 83: /* expression: expression '/' expression  */
+#line 572 "src/parser.y"
+                               {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_DIV, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Division
+  }
+#line 2139 "src/parser.c"
+    break;
+
+  case 84: /* expression: expression '<' expression  */
+#line 575 "src/parser.y"
+                              {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_LT, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Minor than
+  }
+#line 2147 "src/parser.c"
+    break;
+
+  case 85: /* expression: expression '>' expression  */
+#line 578 "src/parser.y"
+                              {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_GT, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Greater than
+  }
+#line 2155 "src/parser.c"
+    break;
+
+  case 86: /* expression: expression LE expression  */
+#line 581 "src/parser.y"
+                             {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_LE, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Smaller the equal
+  }
+#line 2163 "src/parser.c"
+    break;
+
+  case 87: /* expression: expression GE expression  */
+#line 584 "src/parser.y"
+                             {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_GE, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Greater than or equal
+  }
+#line 2171 "src/parser.c"
+    break;
+
+  case 88: /* expression: expression EQ expression  */
+#line 587 "src/parser.y"
+                             {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_EQ, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Just like
+  }
+#line 2179 "src/parser.c"
+    break;
+
+  case 89: /* expression: expression NE expression  */
+#line 590 "src/parser.y"
+                             {
+        (yyval.astNode) = (ASTNode*)createBinaryOpNode(OP_NE, (yyvsp[-2].astNode), (yyvsp[0].astNode));  // Unlike
+  }
+#line 2187 "src/parser.c"
+    break;
+
+  case 90: /* argument_list: %empty  */
+#line 599 "src/parser.y"
+                 { (yyval.astNode) = NULL; }
+#line 2193 "src/parser.c"
+    break;
+
+  case 91: /* argument_list: expression  */
+#line 600 "src/parser.y"
+                 { (yyval.astNode) = (yyvsp[0].astNode); }
+#line 2199 "src/parser.c"
+    break;
+
+  case 92: /* argument_list: argument_list ',' expression  */
+#line 601 "src/parser.y"
+                                   { (yyval.astNode) = appendNode((yyvsp[-2].astNode), (yyvsp[0].astNode)); }
+#line 2205 "src/parser.c"
+    break;
+
+
+#line 2209 "src/parser.c"
+
+      default: break;
+    }
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
+
+  YYPOPSTACK (yylen);
+  yylen = 0;
+
+  *++yyvsp = yyval;
+
+  /* Now 'shift' the result of the reduction.  Determine what state
+     that goes to, based on the state we popped back to and the rule
+     number reduced by.  */
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
+
+  goto yynewstate;
+
+
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
+yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
+  /* If not already recovering from an error, report this error.  */
+  if (!yyerrstatus)
+    {
+      ++yynerrs;
+      yyerror (YY_("syntax error"));
+    }
+
+  if (yyerrstatus == 3)
+    {
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
+
+      if (yychar <= YYEOF)
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
+      else
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval);
+          yychar = YYEMPTY;
+        }
+    }
+
+  /* Else will try to reuse lookahead token after shifting the error
+     token.  */
+  goto yyerrlab1;
+
+
+/*---------------------------------------------------.
+| yyerrorlab -- error raised explicitly by YYERROR.  |
+`---------------------------------------------------*/
+yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
+
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYERROR.  */
+  YYPOPSTACK (yylen);
+  yylen = 0;
+  YY_STACK_PRINT (yyss, yyssp);
+  yystate = *yyssp;
+  goto yyerrlab1;
+
+
+/*-------------------------------------------------------------.
+| yyerrlab1 -- common code for both syntax error and YYERROR.  |
+`-------------------------------------------------------------*/
+yyerrlab1:
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
+
+  /* Pop stack until we find a state that shifts the error token.  */
+  for (;;)
+    {
+      yyn = yypact[yystate];
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
+
+      /* Pop the current state because it cannot handle the error token.  */
+      if (yyssp == yyss)
+        YYABORT;
+
+
+      yydestruct ("Error: popping",
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp);
+      YYPOPSTACK (1);
+      yystate = *yyssp;
+      YY_STACK_PRINT (yyss, yyssp);
+    }
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+
+  /* Shift the error token.  */
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
+
+  yystate = yyn;
+  goto yynewstate;
+
+
+/*-------------------------------------.
+| yyacceptlab -- YYACCEPT comes here.  |
+`-------------------------------------*/
+yyacceptlab:
+  yyresult = 0;
+  goto yyreturnlab;
+
+
+/*-----------------------------------.
+| yyabortlab -- YYABORT comes here.  |
+`-----------------------------------*/
+yyabortlab:
+  yyresult = 1;
+  goto yyreturnlab;
+
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
+yyexhaustedlab:
+  yyerror (YY_("memory exhausted"));
+  yyresult = 2;
+  goto yyreturnlab;
+
+
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYABORT or YYACCEPT.  */
+  YYPOPSTACK (yylen);
+  YY_STACK_PRINT (yyss, yyssp);
+  while (yyssp != yyss)
+    {
+      yydestruct ("Cleanup: popping",
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp);
+      YYPOPSTACK (1);
+    }
+#ifndef yyoverflow
+  if (yyss != yyssa)
+    YYSTACK_FREE (yyss);
+#endif
+
+  return yyresult;
+}
+
+#line 605 "src/parser.y"
+
+
+// Function to handle errors
+void yyerror(const char* msg) {
+    fprintf(stderr, "Error: %s\n", msg);
+}
+
+//Lazy parsing
+
+#undef yylex
+
+static LazyToken* replay_tokens = NULL;    // Body given to parseLazyBody
+static int replay_count = 0;
+static int replay_next = 0;                 // -1 before BODY_START
+static int brace_depth = 0;                 // Braces open outside the skipped bodies
+static int previous_token = 0;
+
+static bool hasStringValue(int token) {
+    return token == INT || token == STRING || token == VOID || token == IDENTIFIER || token == STRING_LITERAL;
+}
+
+// Tokens from the '{' just read to the '}' that closes it. A body that is not closed becomes a
+// lexical error token, so the parse of the file fails like it does without lazy parsing.
+static int skipBody() {
+    int capacity = 64;
+    int count = 0;
+    int depth = 0;
+    LazyToken* tokens = compilerMalloc(capacity * sizeof(LazyToken), AST_LAZY_BODY);
+    int token = '{';
+    while (tokens) {
+        if (count == capacity) {
+            capacity *= 2;
+            tokens = compilerRealloc(tokens, capacity * sizeof(LazyToken), AST_LAZY_BODY);
+            if (!tokens) break;
+        }
+        tokens[count].token = token;
+        tokens[count].ival = token == INTEGER_LITERAL ? yylval.ival : 0;
+        tokens[count].sval = hasStringValue(token) ? yylval.sval : NULL;
+        count++;
+        if (token == '{') depth++;
+        if (token == '}' && --depth == 0) {
+            yylval.astNode = (ASTNode*)createLazyBodyNode(tokens, count);
+            return LAZY_BODY;
+        }
+        token = token_reader ? token_reader() : yylex();
+        if (token == 0) {
+            for (int t = 0; t < count; t++) compilerFree(tokens[t].sval);
+            compilerFree(tokens);
+            return YYLEX_ERROR;
+        }
+    }
+    fprintf(stderr, "Error: could not assign memory for the lazy parser.\n");
+    exit(EXIT_FAILURE);
+}
+
+static int readToken() {
+    if (replay_tokens) {
+        if (replay_next < 0) {
+            replay_next = 0;
+            return BODY_START;
+        }
+        if (replay_next == replay_count) return 0;
+        LazyToken* token = &replay_tokens[replay_next++];
+        if (token->token == INTEGER_LITERAL) yylval.ival = token->ival;
+        else yylval.sval = token->sval;
+        return token->token;
+    }
+
+    int token = token_reader ? token_reader() : yylex();
+    // A '{' right after the ')' of a header, at the top level or in a class body, opens a body
+    if (lazy_bodies && token == '{' && previous_token == ')' && brace_depth <= 1) {
+        token = skipBody();
+    } else if (token == '{') {
+        brace_depth++;
+    } else if (token == '}') {
+        brace_depth--;
+    } else if (token == 0) {
+        brace_depth = 0;
+    }
+    previous_token = token;
+    return token;
+}
+
+ASTNode* parseLazyBody(ASTLazyBodyNode* body) {
+    replay_tokens = body->tokens;
+    replay_count = body->count;
+    replay_next = -1;
+    lazy_block = NULL;
+    int result = yyparse();
+    replay_tokens = NULL;
+
+    // The actions keep the strings of the tokens they got, like in the parse of the file
+    for (int t = 0; t < body->count; t++) body->tokens[t].sval = NULL;
+    return result == 0 ? lazy_block : NULL;
+}
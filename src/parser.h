@@ -0,0 +1,111 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison interface for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_YY_SRC_PARSER_H_INCLUDED
+# define YY_YY_SRC_PARSER_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 0
+#endif
+#if YYDEBUG
+extern int yydebug;
+#endif
+
+/* Token kinds.  */
+#ifndef YYTOKENTYPE
+# define YYTOKENTYPE
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    YYLEX_ERROR = 258,             /* YYLEX_ERROR  */
+    CLASS = 259,                   /* CLASS  */
+    INT = 260,                     /* INT  */
+    STRING = 261,                  /* STRING  */
+    VOID = 262,                    /* VOID  */
+    IDENTIFIER = 263,              /* IDENTIFIER  */
+    STRING_LITERAL = 264,          /* STRING_LITERAL  */
+    INTEGER_LITERAL = 265,         /* INTEGER_LITERAL  */
+    IF = 266,                      /* IF  */
+    WHILE = 267,                   /* WHILE  */
+    ELSE = 268,                    /* ELSE  */
+    RETURN = 269,                  /* RETURN  */
+    PRINT = 270,                   /* PRINT  */
+    READ_INT = 271,                /* READ_INT  */
+    READ_STRING = 272,             /* READ_STRING  */
+    LE = 273,                      /* LE  */
+    GE = 274,                      /* GE  */
+    EQ = 275,                      /* EQ  */
+    NE = 276,                      /* NE  */
+    SUPER = 277,                   /* SUPER  */
+    NEW = 278,                     /* NEW  */
+    THIS = 279,                    /* THIS  */
+    LAZY_BODY = 280,               /* LAZY_BODY  */
+    BODY_START = 281,              /* BODY_START  */
+    CAST = 282                     /* CAST  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
+#endif
+
+/* Value type.  */
+#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
+union YYSTYPE
+{
+#line 42 "src/parser.y"
+
+    int ival;
+    char* sval;
+    ASTNode* astNode;
+
+#line 97 "src/parser.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
+# define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
+#endif
+
+
+extern YYSTYPE yylval;
+
+
+int yyparse (void);
+
+
+#endif /* !YY_YY_SRC_PARSER_H_INCLUDED  */
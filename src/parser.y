@@ -2,20 +2,40 @@
 #include "semantic_analysis.h"
 #include "symbol_table.h"
 #include "ast.h"
+#include "alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #define YYDEBUG 1
 
 extern int yydebug;
 extern int yylex();
 extern char* yytext;
 
+// The parser reads its tokens through readToken, which skips the bodies in lazy mode
+static int readToken();
+#define yylex readToken
+
 void yyerror(const char* msg);
 
 extern SymbolTable symbol_table;
 extern ASTNode* root;
 
 ASTNode* root = NULL;
+bool (*unit_parsed)(ASTNode* unit) = NULL;
+bool lazy_bodies = false;
+int (*token_reader)() = NULL;
+
+// Block parsed by parseLazyBody
+static ASTNode* lazy_block = NULL;
+
+// Set while the members of a class are parsed: a method can override one of its parent
+static bool in_class_body = false;
+
+// Whether unit_parsed took a complete class or function, so it stays out of the lists of root
+static bool takeUnit(ASTNode* unit) {
+    return unit && unit_parsed && unit_parsed(unit);
+}
 
 %}
 
@@ -31,6 +51,8 @@ ASTNode* root = NULL;
 %token IF WHILE ELSE RETURN PRINT READ_INT READ_STRING
 %token LE GE EQ NE
 %token SUPER NEW THIS
+%token <astNode> LAZY_BODY
+%token BODY_START
 %token '.'
 
 %type <sval> type simple_type user_type
@@ -38,6 +60,7 @@ ASTNode* root = NULL;
 %left '.'
 %left '+' '-'
 %left '*' '/'
+%right CAST
 %nonassoc '<' '>' LE GE EQ NE
 
 %type <astNode> program
@@ -53,6 +76,7 @@ ASTNode* root = NULL;
 %type <astNode> statement
 %type <astNode> IDENTIFIER_LIST
 %type <astNode> block
+%type <astNode> function_body
 %type <astNode> declaration_or_statement_list
 %type <astNode> declaration_or_statement
 %type <astNode> parameter_declaration_list
@@ -60,8 +84,18 @@ ASTNode* root = NULL;
 %type <astNode> argument_list
 %type <astNode> print_arguments
 
+%start input
+
 %%
 
+// A file, or the tokens of one body after BODY_START (parseLazyBody)
+input:
+    program
+    | BODY_START block {
+        lazy_block = $2;
+    }
+;
+
 // Gramática principal
 program:
     class_definitions {
@@ -78,15 +112,16 @@ program:
 
 class_definitions:
     class_definitions class_definition {
-        $$ = (ASTNode*)appendNode($1, $2);  // Agrega la clase actual a la lista
+        $$ = takeUnit($2) ? $1 : (ASTNode*)appendNode($1, $2);  // Agrega la clase actual a la lista
     }
     | class_definition {
-        $$ = $1;  // Primera clase en la lista
+        $$ = takeUnit($1) ? NULL : $1;  // Primera clase en la lista
     }
 ;
 
 class_definition:
-    CLASS IDENTIFIER ':' IDENTIFIER '{' class_body '}' {
+    CLASS IDENTIFIER ':' IDENTIFIER class_open class_body '}' {
+        in_class_body = false;
         // Añadir la clase a la tabla de símbolos
         if (find_symbol(&symbol_table, $2) == -1) {
 	    printf("Processing class_body for class '%s': initial node type=%d\n", $2, $6->type);
@@ -108,7 +143,8 @@ class_definition:
             $$ = NULL;
         }
     }
-    | CLASS IDENTIFIER '{' class_body '}' {
+    | CLASS IDENTIFIER class_open class_body '}' {
+        in_class_body = false;
         // Add the class to the symbols table without inheritance
         if (find_symbol(&symbol_table, $2) == -1) {
 	    char** attributes = extractAttributesFromClassBody($4);
@@ -125,6 +161,12 @@ class_definition:
     }
 ;
 
+class_open:
+    '{' {
+        in_class_body = true;
+    }
+;
+
 class_body:
     /* vacío */{
 	$$ = NULL;
@@ -148,17 +190,16 @@ class_member:
 
 function_definitions:
     function_definitions function_definition {
-        $$ = (ASTNode*)appendNode($1, $2);  // Combina la lista de funciones con una nueva función
-
         // Verify if the function is already in the symbols table
         ASTFunctionNode* funcNode = (ASTFunctionNode*)$2;
         if (find_symbol(&symbol_table, funcNode->name) == -1) {
             printf("Adding function: %s\n", funcNode->name);
 	            // Agregar la función a la tabla de símbolos
-            add_symbol(&symbol_table, funcNode->name, funcNode->returnType, true, false, false, funcNode->parameters, funcNode->param_count, NULL, NULL, 0, NULL, 0);  // Parámetros NULL por ahora
+            add_symbol(&symbol_table, funcNode->name, funcNode->returnType, true, false, false, extractParameterTypes(funcNode->parameters), funcNode->param_count, NULL, NULL, 0, NULL, 0);  // Parámetros NULL por ahora
         } else {
             yyerror("Function already declared");
         }
+        $$ = takeUnit($2) ? $1 : (ASTNode*)appendNode($1, $2);  // Combina la lista de funciones con una nueva función
     }
     | function_definition {
         $$ = $1;  // The initial list is simply the first node
@@ -166,16 +207,17 @@ function_definitions:
         if (find_symbol(&symbol_table, funcNode->name) == -1) {
             printf("Adding function: %s\n", funcNode->name);
             // Add the function to the symbols table
-            add_symbol(&symbol_table, funcNode->name, funcNode->returnType, true, false, false, funcNode->parameters, funcNode->param_count, NULL, NULL, 0, NULL, 0);
+            add_symbol(&symbol_table, funcNode->name, funcNode->returnType, true, false, false, extractParameterTypes(funcNode->parameters), funcNode->param_count, NULL, NULL, 0, NULL, 0);
         } else {
             yyerror("Function already declared");
         }
+        if (takeUnit($1)) $$ = NULL;
     }
 ;
 
 
 function_definition:
-    type IDENTIFIER '(' parameter_list ')' block {
+    type IDENTIFIER '(' parameter_list ')' function_body {
         // Create the function node
         $$ = (ASTNode*)createFunctionNode($2, $1, $4, $6);  // Crear nodo de función
         // Count the parameter number
@@ -192,8 +234,8 @@ function_definition:
         if (found == -1) {
             // If the function is not declared, add it to the symbols table
             printf("Adding function: %s with %d parameters\n", $2, param_count);
-            add_symbol(&symbol_table, $2, $1, true, false, false, $4, param_count, NULL, NULL, 0, NULL, 0);  // Agregar función a la tabla de símbolos
-        } else {
+            add_symbol(&symbol_table, $2, $1, true, false, false, extractParameterTypes($4), param_count, NULL, NULL, 0, NULL, 0);  // Agregar función a la tabla de símbolos
+        } else if (!in_class_body) {
             // If the function is already declared, report an error
             yyerror("Function already declared");
             $$ = NULL;  // Indicate that the function should not be added to the tree
@@ -202,12 +244,22 @@ function_definition:
 ;
 
 
+function_body:
+    block {
+        $$ = $1;
+    }
+    | LAZY_BODY {
+        $$ = $1;  // Tokens of the body, parsed later by parseLazyBody
+    }
+;
+
+
 parameter_list:
     /* vacío */ {
         $$ = NULL; // No parameters, the list will be null
     }
     |VOID {
-        $$ = $1; // Parameter list
+        $$ = NULL; // 'void' means an empty parameter list
     }
     | parameter_declaration_list {
         $$ = $1; // Parameter list
@@ -219,27 +271,39 @@ parameter_declaration_list:
         $$ = $1; // A single parameter
     }
     | parameter_declaration_list ',' parameter_declaration {
-        $$ = (ASTNode*)appendNode($1, $3); // Combined parameter list
+        // A name is declared once per function; other functions can reuse it
+        bool repeated = false;
+        for (ASTNode* param = $1; param; param = param->next) {
+            if (strcmp(((ASTDeclarationNode*)param)->name, ((ASTDeclarationNode*)$3)->name) == 0) repeated = true;
+        }
+        if (repeated) {
+            yyerror("Parameter already declared");
+            freeAST($3);
+            $$ = $1;
+        } else {
+            $$ = (ASTNode*)appendNode($1, $3); // Combined parameter list
+        }
     }
 ;
 
 parameter_declaration:
     type IDENTIFIER {
         printf("Creating parameter: type=%s, name=%s\n", $1, $2);
-        // Add the parameter to the symbols table
+        // The parameter belongs to its function: it is always kept, the symbols table only gets
+        // the first parameter of each name
         if (find_symbol(&symbol_table, $2) == -1) {
             add_symbol(&symbol_table, $2, $1, false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);  // Añadir parámetro a la tabla
-            $$ = (ASTNode*)createDeclarationNode($1, $2, NULL);  // Crear nodo de parámetro sin inicialización
-        } else {
-            yyerror("Parameter already declared");
-            $$ = NULL;  // Indicate that the parameter should not be added
         }
+        $$ = (ASTNode*)createDeclarationNode($1, $2, NULL);  // Crear nodo de parámetro sin inicialización
     }
 ;
 
 
 // Statements
 declaration:
+    /* empty */ {
+        $$ = NULL;  // Empty blocks like 'else {}' end up here
+    }
     |type IDENTIFIER ';' {
         printf("Creating declaration: type=%s, name=%s\n", $1, $2);
 
@@ -273,7 +337,22 @@ declaration:
     }
     |type IDENTIFIER ',' IDENTIFIER_LIST ';' {
 	printf("Creating declaration list: type=%s, name=%s\n", $1, $2);
-        $$ = (ASTNode*)createDeclarationListNode($2, $4);  // Múltiples declaraciones
+        // Expand 'type a, b, c;' into one declaration node per identifier
+        ASTNode* declarations = (ASTNode*)createDeclarationNode($1, $2, NULL);
+        if (find_symbol(&symbol_table, $2) == -1) {
+            add_symbol(&symbol_table, $2, $1, false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);
+        }
+        ASTNode* identifier = $4;
+        while (identifier) {
+            ASTNode* nextIdentifier = identifier->next;
+            const char* name = ((ASTVariableNode*)identifier)->name;
+            if (find_symbol(&symbol_table, name) == -1) {
+                add_symbol(&symbol_table, name, $1, false, false, false, NULL, 0, NULL, NULL, 0, NULL, 0);
+            }
+            declarations = appendNode(declarations, (ASTNode*)createDeclarationNode($1, name, NULL));
+            identifier = nextIdentifier;
+        }
+        $$ = declarations;  // Múltiples declaraciones
     }
 ;
 
@@ -283,8 +362,8 @@ IDENTIFIER_LIST:
         $$ = (ASTNode*)createVariableNode($1);
     }
     | IDENTIFIER_LIST ',' IDENTIFIER {
-        // Create a node for the list and add the new identifier.
-        $$ = (ASTNode*)createIdentifierListNode($1, (ASTNode*)createVariableNode($3));
+        // Append the new identifier to the flat list of variable nodes.
+        $$ = appendNode($1, (ASTNode*)createVariableNode($3));
     }
 ;
 
@@ -477,7 +556,7 @@ expression:
   | '(' expression ')'  /* Expression in parentheses */ {
         $$ = $2;  // Simply return the expression within parentheses
   }
-  | '(' type ')' expression  /* Type conversion */ {
+  | '(' type ')' expression %prec CAST /* Type conversion binds tighter than + - * / */ {
       printf("Creating type cast: (%s)\n", $2);
         $$ = (ASTNode*)createTypeCastNode($2, $4);
   }
@@ -529,3 +608,92 @@ argument_list:
 void yyerror(const char* msg) {
     fprintf(stderr, "Error: %s\n", msg);
 }
+
+//Lazy parsing
+
+#undef yylex
+
+static LazyToken* replay_tokens = NULL;    // Body given to parseLazyBody
+static int replay_count = 0;
+static int replay_next = 0;                 // -1 before BODY_START
+static int brace_depth = 0;                 // Braces open outside the skipped bodies
+static int previous_token = 0;
+
+static bool hasStringValue(int token) {
+    return token == INT || token == STRING || token == VOID || token == IDENTIFIER || token == STRING_LITERAL;
+}
+
+// Tokens from the '{' just read to the '}' that closes it. A body that is not closed becomes a
+// lexical error token, so the parse of the file fails like it does without lazy parsing.
+static int skipBody() {
+    int capacity = 64;
+    int count = 0;
+    int depth = 0;
+    LazyToken* tokens = compilerMalloc(capacity * sizeof(LazyToken), AST_LAZY_BODY);
+    int token = '{';
+    while (tokens) {
+        if (count == capacity) {
+            capacity *= 2;
+            tokens = compilerRealloc(tokens, capacity * sizeof(LazyToken), AST_LAZY_BODY);
+            if (!tokens) break;
+        }
+        tokens[count].token = token;
+        tokens[count].ival = token == INTEGER_LITERAL ? yylval.ival : 0;
+        tokens[count].sval = hasStringValue(token) ? yylval.sval : NULL;
+        count++;
+        if (token == '{') depth++;
+        if (token == '}' && --depth == 0) {
+            yylval.astNode = (ASTNode*)createLazyBodyNode(tokens, count);
+            return LAZY_BODY;
+        }
+        token = token_reader ? token_reader() : yylex();
+        if (token == 0) {
+            for (int t = 0; t < count; t++) compilerFree(tokens[t].sval);
+            compilerFree(tokens);
+            return YYLEX_ERROR;
+        }
+    }
+    fprintf(stderr, "Error: could not assign memory for the lazy parser.\n");
+    exit(EXIT_FAILURE);
+}
+
+static int readToken() {
+    if (replay_tokens) {
+        if (replay_next < 0) {
+            replay_next = 0;
+            return BODY_START;
+        }
+        if (replay_next == replay_count) return 0;
+        LazyToken* token = &replay_tokens[replay_next++];
+        if (token->token == INTEGER_LITERAL) yylval.ival = token->ival;
+        else yylval.sval = token->sval;
+        return token->token;
+    }
+
+    int token = token_reader ? token_reader() : yylex();
+    // A '{' right after the ')' of a header, at the top level or in a class body, opens a body
+    if (lazy_bodies && token == '{' && previous_token == ')' && brace_depth <= 1) {
+        token = skipBody();
+    } else if (token == '{') {
+        brace_depth++;
+    } else if (token == '}') {
+        brace_depth--;
+    } else if (token == 0) {
+        brace_depth = 0;
+    }
+    previous_token = token;
+    return token;
+}
+
+ASTNode* parseLazyBody(ASTLazyBodyNode* body) {
+    replay_tokens = body->tokens;
+    replay_count = body->count;
+    replay_next = -1;
+    lazy_block = NULL;
+    int result = yyparse();
+    replay_tokens = NULL;
+
+    // The actions keep the strings of the tokens they got, like in the parse of the file
+    for (int t = 0; t < body->count; t++) body->tokens[t].sval = NULL;
+    return result == 0 ? lazy_block : NULL;
+}
@@ -0,0 +1,521 @@
+#include "peephole.h"
+#include "alloc.h"
+#include "regalloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// How an instruction uses each of its operands
+typedef enum {
+    ROLE_NONE,                     // Label name
+    ROLE_READ,
+    ROLE_WRITE,
+} OperandRole;
+
+static const OperandRole roles[VC_OPCODE_COUNT][3] = {
+    [VC_LABEL] = {ROLE_NONE},
+    [VC_CREATE] = {ROLE_WRITE, ROLE_READ},
+    [VC_COPY] = {ROLE_WRITE, ROLE_READ},
+    [VC_GETSIZE] = {ROLE_WRITE, ROLE_READ},
+    [VC_GETWORD] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_RESIZE] = {ROLE_READ, ROLE_READ},
+    [VC_SETWORD] = {ROLE_READ, ROLE_READ, ROLE_READ},
+    [VC_DESTROY] = {ROLE_READ},
+    [VC_CALL] = {ROLE_WRITE, ROLE_READ},     // A label, or the chunk of a string with one
+    [VC_RETURN] = {ROLE_READ},
+    [VC_SET] = {ROLE_WRITE, ROLE_READ},
+    [VC_JUMP] = {ROLE_NONE},
+    [VC_JUMPZ] = {ROLE_NONE, ROLE_READ},
+    [VC_JUMPNZ] = {ROLE_NONE, ROLE_READ},
+    [VC_READS] = {ROLE_WRITE},
+    [VC_WRITES] = {ROLE_READ},
+    [VC_READI] = {ROLE_WRITE},
+    [VC_WRITEI] = {ROLE_READ},
+    [VC_ADDI] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_SUBI] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_MULI] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_DIVI] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_LTI] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_GTI] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_EQI] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_LTS] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_GTS] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_EQS] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_AND] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_OR] = {ROLE_WRITE, ROLE_READ, ROLE_READ},
+    [VC_NOT] = {ROLE_WRITE, ROLE_READ},
+    [VC_INT2STRING] = {ROLE_WRITE, ROLE_READ},
+};
+
+// Label of the original stream
+typedef struct {
+    char* name;
+    int index;                     // Position in the original stream
+    char* jump;                    // Target when the label is followed by a JUMP (can be null)
+} LabelEntry;
+
+// State of the pass: the optimized prefix and the rest of the original stream
+typedef struct {
+    VCInstr* out;
+    int count;
+    VCInstr* input;
+    int input_count;
+    int next;                      // First instruction of the input not moved to out yet
+    int window;
+    LabelEntry* labels;
+    int label_count;
+} Peephole;
+
+//Helpers
+
+static VCInstr* tail(Peephole* ph, int back) {
+    return ph->count > back ? &ph->out[ph->count - 1 - back] : NULL;
+}
+
+static void freeInstrOperands(VCInstr* instr) {
+    for (int o = 0; o < instr->operand_count; o++) {
+        compilerFree(instr->operands[o].text);
+        instr->operands[o].text = NULL;
+    }
+}
+
+static void dropInstr(Peephole* ph, int index) {
+    freeInstrOperands(&ph->out[index]);
+    memmove(&ph->out[index], &ph->out[index + 1], (ph->count - index - 1) * sizeof(VCInstr));
+    ph->count--;
+}
+
+static bool isRegister(VCOperand operand, int reg) {
+    return operand.kind == VC_REG && operand.reg == reg;
+}
+
+static bool isSP(VCOperand operand) {
+    return isRegister(operand, VC_REG_SP);
+}
+
+static bool readsRegister(VCInstr* instr, int reg) {
+    for (int o = 0; o < instr->operand_count; o++) {
+        VCOperand operand = instr->operands[o];
+        if (operand.kind == VC_STACK && operand.reg == reg) return true; // Address of a stack operand
+        if (roles[instr->op][o] == ROLE_READ && isRegister(operand, reg)) return true;
+    }
+    return false;
+}
+
+static bool writesRegister(VCInstr* instr, int reg) {
+    return instr->operand_count > 0 && roles[instr->op][0] == ROLE_WRITE && isRegister(instr->operands[0], reg);
+}
+
+static bool writesStack(VCInstr* instr) {
+    return instr->operand_count > 0 && roles[instr->op][0] == ROLE_WRITE && instr->operands[0].kind == VC_STACK;
+}
+
+static bool isJump(VCInstr* instr) {
+    return instr->op == VC_JUMP || instr->op == VC_JUMPZ || instr->op == VC_JUMPNZ;
+}
+
+static VCOperand* jumpTarget(VCInstr* instr) {
+    return &instr->operands[0];
+}
+
+static int compareLabels(const void* a, const void* b) {
+    return strcmp(((const LabelEntry*)a)->name, ((const LabelEntry*)b)->name);
+}
+
+static LabelEntry* findLabel(Peephole* ph, const char* name) {
+    LabelEntry key = {(char*)name, 0, NULL};
+    return bsearch(&key, ph->labels, ph->label_count, sizeof(LabelEntry), compareLabels);
+}
+
+// Label followed by an unconditional jump, null if the label jumps nowhere else
+static const char* findLabelJump(Peephole* ph, const char* name) {
+    LabelEntry* entry = findLabel(ph, name);
+    return entry ? entry->jump : NULL;
+}
+
+typedef enum {
+    REGISTER_LIVE,
+    REGISTER_DEAD,
+    REGISTER_UNKNOWN,              // Keep looking at the next instruction
+} RegisterState;
+
+static bool isDeadInInput(Peephole* ph, int position, int reg, int budget);
+
+static RegisterState scanInstr(Peephole* ph, VCInstr* instr, int reg, int budget) {
+    if (readsRegister(instr, reg)) return REGISTER_LIVE;
+    if (writesRegister(instr, reg)) return REGISTER_DEAD;
+
+    LabelEntry* target;
+    switch (instr->op) {
+        case VC_CALL:
+            return REGISTER_DEAD;                           // The callee clobbers every register
+        case VC_RETURN:
+            return reg == SCRATCH_REGISTER ? REGISTER_LIVE : REGISTER_DEAD; // Only the return value survives
+        case VC_JUMP:
+            target = findLabel(ph, jumpTarget(instr)->text);
+            return target && isDeadInInput(ph, target->index, reg, budget) ? REGISTER_DEAD : REGISTER_LIVE;
+        case VC_JUMPZ:
+        case VC_JUMPNZ:
+            target = findLabel(ph, jumpTarget(instr)->text);
+            return target && isDeadInInput(ph, target->index, reg, budget) ? REGISTER_UNKNOWN : REGISTER_LIVE;
+        default:
+            return REGISTER_UNKNOWN;
+    }
+}
+
+// Code already moved to the output is followed in its original form: the rewrites never add
+// reads of a register that the original code did not have live at a label
+static bool isDeadInInput(Peephole* ph, int position, int reg, int budget) {
+    for (; budget > 0; position++, budget--) {
+        if (position >= ph->input_count) return true;       // End of the program
+        RegisterState state = scanInstr(ph, &ph->input[position], reg, budget - 1);
+        if (state != REGISTER_UNKNOWN) return state == REGISTER_DEAD;
+    }
+    return false;
+}
+
+// Whether the value of a register after out[index] is never read, looking at most a window ahead
+static bool isDeadAfter(Peephole* ph, int index, int reg) {
+    if (reg < 0 || reg > SCRATCH_REGISTER) return false;   // $SP and the frame pointer are always live
+
+    int budget = ph->window;
+    for (int position = index + 1; position < ph->count; position++, budget--) {
+        if (budget == 0) return false;
+        RegisterState state = scanInstr(ph, &ph->out[position], reg, budget - 1);
+        if (state != REGISTER_UNKNOWN) return state == REGISTER_DEAD;
+    }
+    return isDeadInInput(ph, ph->next, reg, budget);
+}
+
+//Patterns
+
+// SET a, a
+static bool selfMove(Peephole* ph) {
+    VCInstr* last = tail(ph, 0);
+    if (last->op != VC_SET || !sameVCOperand(last->operands[0], last->operands[1])) return false;
+    dropInstr(ph, ph->count - 1);
+    return true;
+}
+
+// JUMP L; LABEL L
+static bool jumpToNext(Peephole* ph) {
+    VCInstr* jump = tail(ph, 1);
+    VCInstr* label = tail(ph, 0);
+    if (label->op != VC_LABEL || !isJump(jump)) return false;
+    if (strcmp(jumpTarget(jump)->text, label->operands[0].text) != 0) return false;
+    dropInstr(ph, ph->count - 2);
+    return true;
+}
+
+// Code after an unconditional jump or a return that no label makes reachable
+static bool unreachable(Peephole* ph) {
+    VCInstr* previous = tail(ph, 1);
+    VCInstr* last = tail(ph, 0);
+    if (previous->op != VC_JUMP && previous->op != VC_RETURN) return false;
+    if (last->op == VC_LABEL) return false;
+    dropInstr(ph, ph->count - 1);
+    return true;
+}
+
+// JUMPZ L1, c; JUMP L2; LABEL L1 -> JUMPNZ L2, c; LABEL L1
+static bool branchOverJump(Peephole* ph) {
+    VCInstr* branch = tail(ph, 2);
+    VCInstr* jump = tail(ph, 1);
+    VCInstr* label = tail(ph, 0);
+    if ((branch->op != VC_JUMPZ && branch->op != VC_JUMPNZ) || jump->op != VC_JUMP || label->op != VC_LABEL) {
+        return false;
+    }
+    if (strcmp(jumpTarget(branch)->text, label->operands[0].text) != 0) return false;
+
+    branch->op = branch->op == VC_JUMPZ ? VC_JUMPNZ : VC_JUMPZ;
+    compilerFree(jumpTarget(branch)->text);
+    jumpTarget(branch)->text = jumpTarget(jump)->text;
+    jumpTarget(jump)->text = NULL;
+    dropInstr(ph, ph->count - 2);
+    return true;
+}
+
+// Jump to a label followed by a JUMP M -> jump straight to M
+static bool jumpThreading(Peephole* ph) {
+    VCInstr* jump = tail(ph, 0);
+    if (!isJump(jump)) return false;
+
+    const char* target = jumpTarget(jump)->text;
+    for (int hop = 0; hop < ph->window; hop++) {
+        const char* next = findLabelJump(ph, target);
+        if (!next) break;
+        target = next;
+        if (strcmp(target, jumpTarget(jump)->text) == 0) return false; // Endless loop, keep it
+    }
+
+    // Only thread when the chain ends in a real instruction, so the rewrite is done once
+    if (findLabelJump(ph, target) || strcmp(target, jumpTarget(jump)->text) == 0) return false;
+
+    char* name = compilerStrdup(target, ALLOC_CODE);
+    compilerFree(jumpTarget(jump)->text);
+    jumpTarget(jump)->text = name;
+    return true;
+}
+
+// ADDI a, b, 0 / SUBI a, b, 0 / MULI a, b, 1 / DIVI a, b, 1 -> SET a, b
+static bool identityArithmetic(Peephole* ph) {
+    VCInstr* last = tail(ph, 0);
+    if (last->operand_count != 3 || last->operands[2].kind != VC_IMM) return false;
+    VCOperand neutral = last->operands[2];
+    bool additive = (last->op == VC_ADDI || last->op == VC_SUBI) && neutral.value == 0;
+    bool multiplicative = (last->op == VC_MULI || last->op == VC_DIVI) && neutral.value == 1;
+    if (!additive && !multiplicative) return false;
+
+    last->op = VC_SET;
+    last->operand_count = 2;
+    return true;
+}
+
+// Two adjustments of $SP in a row, or an adjustment overwritten by SET $SP
+static bool stackAdjustment(Peephole* ph) {
+    VCInstr* first = tail(ph, 1);
+    VCInstr* second = tail(ph, 0);
+    if ((first->op != VC_ADDI && first->op != VC_SUBI) || !isSP(first->operands[0]) ||
+        !isSP(first->operands[1]) || first->operands[2].kind != VC_IMM) {
+        return false;
+    }
+
+    if (second->op == VC_SET && isSP(second->operands[0]) && !readsRegister(second, VC_REG_SP)) {
+        dropInstr(ph, ph->count - 2);
+        return true;
+    }
+
+    if ((second->op != VC_ADDI && second->op != VC_SUBI) || !isSP(second->operands[0]) ||
+        !isSP(second->operands[1]) || second->operands[2].kind != VC_IMM) {
+        return false;
+    }
+    long total = (first->op == VC_ADDI ? 1 : -1) * first->operands[2].value +
+                 (second->op == VC_ADDI ? 1 : -1) * second->operands[2].value;
+    dropInstr(ph, ph->count - 1);
+    if (total == 0) {
+        dropInstr(ph, ph->count - 1);
+    } else {
+        first->op = total > 0 ? VC_ADDI : VC_SUBI;
+        first->operands[2].value = total > 0 ? total : -total;
+    }
+    return true;
+}
+
+// SET $r, x; OP ..., $r, ... -> OP ..., x, ... when $r is not needed afterwards
+static bool forwardMove(Peephole* ph) {
+    VCInstr* move = tail(ph, 1);
+    VCInstr* use = tail(ph, 0);
+    if (move->op != VC_SET || move->operands[0].kind != VC_REG) return false;
+    int reg = move->operands[0].reg;
+    VCOperand source = move->operands[1];
+    if (use->op == VC_RETURN || use->op == VC_CALL) return false;
+    if (source.kind == VC_STR && use->op != VC_SET && use->op != VC_SETWORD) return false;
+
+    int replaced = 0;
+    for (int o = 0; o < use->operand_count; o++) {
+        VCOperand operand = use->operands[o];
+        if (operand.kind == VC_STACK && operand.reg == reg) return false;
+        if (roles[use->op][o] == ROLE_READ && isRegister(operand, reg)) replaced++;
+    }
+    if (replaced == 0) return false;
+    if (!writesRegister(use, reg) && !isDeadAfter(ph, ph->count - 1, reg)) return false;
+
+    for (int o = 0; o < use->operand_count; o++) {
+        if (roles[use->op][o] == ROLE_READ && isRegister(use->operands[o], reg)) {
+            use->operands[o] = source;
+            if (source.text) use->operands[o].text = compilerStrdup(source.text, ALLOC_CODE);
+        }
+    }
+    dropInstr(ph, ph->count - 2);
+    return true;
+}
+
+// OP $r, ...; SET d, $r -> OP d, ... when $r is not needed afterwards
+static bool backwardDestination(Peephole* ph) {
+    VCInstr* producer = tail(ph, 1);
+    VCInstr* move = tail(ph, 0);
+    if (move->op != VC_SET || move->operands[1].kind != VC_REG) return false;
+    int reg = move->operands[1].reg;
+    if (producer->operand_count == 0 || roles[producer->op][0] != ROLE_WRITE ||
+        !isRegister(producer->operands[0], reg)) {
+        return false;
+    }
+
+    VCOperand target = move->operands[0];
+    if (target.kind != VC_REG && !(target.kind == VC_STACK && producer->op == VC_SET)) return false;
+    if (target.kind == VC_REG && target.reg == VC_REG_SP) return false;
+    if (!isDeadAfter(ph, ph->count - 1, reg)) return false;
+
+    producer->operands[0] = target;
+    move->operands[0].text = NULL;
+    dropInstr(ph, ph->count - 1);
+    return true;
+}
+
+static bool usesRegister(VCOperand operand, int reg) {
+    return (operand.kind == VC_REG || operand.kind == VC_STACK) && operand.reg == reg;
+}
+
+// Write to a register nobody reads, done by an instruction that cannot fail
+static bool deadWrite(Peephole* ph) {
+    VCInstr* instr = tail(ph, 1);
+    switch (instr->op) {
+        case VC_SET: case VC_ADDI: case VC_SUBI: case VC_MULI:
+        case VC_LTI: case VC_GTI: case VC_EQI: case VC_LTS: case VC_GTS: case VC_EQS:
+        case VC_AND: case VC_OR: case VC_NOT: case VC_INT2STRING:
+            break;
+        default:
+            return false;
+    }
+    if (instr->operands[0].kind != VC_REG || !isDeadAfter(ph, ph->count - 2, instr->operands[0].reg)) return false;
+    dropInstr(ph, ph->count - 2);
+    return true;
+}
+
+// GETWORD $a, x, i; ...; GETWORD $b, x, i -> the second one becomes SET $b, $a
+static bool repeatedLoad(Peephole* ph) {
+    VCInstr* last = tail(ph, 0);
+    if (last->op != VC_GETWORD) return false;
+    VCOperand chunk = last->operands[1];
+    VCOperand index = last->operands[2];
+
+    int back = 1;
+    for (; back < ph->window && back < ph->count; back++) {
+        VCInstr* instr = tail(ph, back);
+        if (instr->op == VC_GETWORD && instr->operands[0].kind == VC_REG &&
+            sameVCOperand(instr->operands[1], chunk) && sameVCOperand(instr->operands[2], index)) {
+            break;
+        }
+        // Anything that can change the loaded word, the chunk or the index stops the search
+        if (instr->op == VC_LABEL || instr->op == VC_CALL || instr->op == VC_SETWORD ||
+            instr->op == VC_RESIZE || instr->op == VC_DESTROY || isJump(instr) || writesStack(instr)) {
+            return false;
+        }
+        if (instr->operand_count > 0 && roles[instr->op][0] == ROLE_WRITE && instr->operands[0].kind == VC_REG &&
+            (usesRegister(chunk, instr->operands[0].reg) || usesRegister(index, instr->operands[0].reg))) {
+            return false;
+        }
+    }
+    if (back >= ph->window || back >= ph->count) return false;
+
+    // The first result must still be in its register
+    int reg = tail(ph, back)->operands[0].reg;
+    if (usesRegister(chunk, reg) || usesRegister(index, reg)) return false;
+    for (int b = 1; b < back; b++) {
+        if (writesRegister(tail(ph, b), reg)) return false;
+    }
+
+    last->op = VC_SET;
+    last->operand_count = 2;
+    last->operands[1] = vcReg(reg);
+    return true;
+}
+
+typedef struct {
+    const char* name;
+    int length;                    // Instructions at the end of the output it needs
+    bool (*apply)(Peephole* ph);
+} PeepholePattern;
+
+static const PeepholePattern patterns[] = {
+    {"self-move", 1, selfMove},
+    {"jump-to-next", 2, jumpToNext},
+    {"unreachable", 2, unreachable},
+    {"branch-over-jump", 3, branchOverJump},
+    {"jump-threading", 1, jumpThreading},
+    {"identity-arithmetic", 1, identityArithmetic},
+    {"stack-adjustment", 2, stackAdjustment},
+    {"forward-move", 2, forwardMove},
+    {"backward-destination", 2, backwardDestination},
+    {"repeated-load", 2, repeatedLoad},
+    {"dead-write", 2, deadWrite},
+};
+
+#define PATTERN_COUNT ((int)(sizeof(patterns) / sizeof(patterns[0])))
+
+int getPeepholePatternCount() {
+    return PATTERN_COUNT;
+}
+
+const char* getPeepholePatternName(int pattern) {
+    return pattern >= 0 && pattern < PATTERN_COUNT ? patterns[pattern].name : "unknown";
+}
+
+//Pass
+
+void runPeephole(VCProgram* program, int window, PeepholeStats* stats) {
+    if (stats) {
+        memset(stats, 0, sizeof(PeepholeStats));
+        stats->window = window;
+        stats->instructions_before = program->count;
+        stats->instructions_after = program->count;
+    }
+    if (window <= 0 || program->count == 0) return;
+
+    Peephole ph;
+    ph.out = checkedMalloc(program->count * sizeof(VCInstr), ALLOC_CODE);
+    ph.labels = checkedMalloc(program->count * sizeof(LabelEntry), ALLOC_CODE);
+    ph.count = 0;
+    ph.input = program->code;
+    ph.input_count = program->count;
+    ph.next = 0;
+    ph.window = window;
+    ph.label_count = 0;
+    for (int i = 0; i < program->count; i++) {
+        if (program->code[i].op != VC_LABEL) continue;
+        int position = i;
+        while (position < program->count && program->code[position].op == VC_LABEL) position++;
+        bool jumps = position < program->count && program->code[position].op == VC_JUMP;
+        ph.labels[ph.label_count].name = compilerStrdup(program->code[i].operands[0].text, ALLOC_CODE);
+        ph.labels[ph.label_count].index = i;
+        ph.labels[ph.label_count].jump = jumps ? compilerStrdup(program->code[position].operands[0].text, ALLOC_CODE) : NULL;
+        ph.label_count++;
+    }
+    qsort(ph.labels, ph.label_count, sizeof(LabelEntry), compareLabels);
+
+    // Move one instruction at a time and rewrite the end of the output until nothing matches.
+    // Every rewrite removes instructions or is applied once, so the pass stays linear.
+    while (ph.next < ph.input_count) {
+        ph.out[ph.count++] = ph.input[ph.next++];
+
+        bool changed = true;
+        while (changed && ph.count > 0) {
+            changed = false;
+            for (int p = 0; p < PATTERN_COUNT; p++) {
+                if (patterns[p].length > window || patterns[p].length > ph.count) continue;
+                if (patterns[p].apply(&ph)) {
+                    if (stats) stats->fired[p]++;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // The old array only holds moved or freed operands now
+    for (int i = 0; i < ph.label_count; i++) {
+        compilerFree(ph.labels[i].name);
+        compilerFree(ph.labels[i].jump);
+    }
+    compilerFree(ph.labels);
+    compilerFree(program->code);
+    program->code = ph.out;
+    program->count = ph.count;
+    program->capacity = ph.input_count;
+    if (stats) stats->instructions_after = ph.count;
+}
+
+void printPeepholeStats(PeepholeStats* stats, FILE* out) {
+    fprintf(out, "Peephole optimization (window %d): %d -> %d instructions\n",
+            stats->window, stats->instructions_before, stats->instructions_after);
+    for (int p = 0; p < PATTERN_COUNT; p++) {
+        fprintf(out, "    %-22s %d\n", patterns[p].name, stats->fired[p]);
+    }
+}
+
+void addPeepholeStats(PeepholeStats* total, const PeepholeStats* stats) {
+    total->window = stats->window;
+    total->instructions_before += stats->instructions_before;
+    total->instructions_after += stats->instructions_after;
+    for (int p = 0; p < PEEPHOLE_MAX_PATTERNS; p++) total->fired[p] += stats->fired[p];
+}
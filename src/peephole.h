@@ -0,0 +1,28 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "vypcode.h"
+
+#define PEEPHOLE_DEFAULT_WINDOW 16 // Instructions a pattern can look at
+#define PEEPHOLE_MAX_WINDOW 4096
+#define PEEPHOLE_MAX_PATTERNS 16
+
+// Counters of one run of the optimizer
+typedef struct {
+    int window;
+    int instructions_before;
+    int instructions_after;
+    int fired[PEEPHOLE_MAX_PATTERNS]; // Indexed like the pattern table
+} PeepholeStats;
+
+// Rewrite the instruction stream in place; a window of 0 disables the pass
+void runPeephole(VCProgram* program, int window, PeepholeStats* stats);
+
+int getPeepholePatternCount();
+const char* getPeepholePatternName(int pattern);
+void printPeepholeStats(PeepholeStats* stats, FILE* out);
+
+// Totals of a program optimized in pieces, the total starts zeroed
+void addPeepholeStats(PeepholeStats* total, const PeepholeStats* stats);
+
+#endif // PEEPHOLE_H
@@ -0,0 +1,214 @@
+#include "pipeline.h"
+#include "alloc.h"
+#include "hash.h"
+#include "symbol_table.h"
+#include "ast.h"
+#include "parser.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+// Lexer state (flex or the hand-written scanner)
+extern FILE* yyin;
+extern int yylex();
+extern void yyrestart(FILE* file);
+extern int token_offset;
+extern int token_length;
+extern YYSTYPE* token_value;
+
+#define CACHE_LINE 64
+#define STRING_CHUNK 1024              // Handles per chunk of the string table
+#define STRING_CHUNKS 16384            // Chunks never move, the parser reads them while the lexer adds more
+#define SPINS_BEFORE_YIELD 128
+
+// Strings of the tokens, each one once. Only the lexer hashes and adds; the parser reads the
+// string of a handle after the token that carries it is published.
+typedef struct {
+    char** chunks[STRING_CHUNKS];
+    int count;
+    int32_t* buckets;              // Handle + 1 of every string by hash, 0 when empty
+    int bucket_count;              // A power of two, at most half used
+} StringTable;
+
+typedef struct {
+    // Written by the lexer
+    _Alignas(CACHE_LINE) atomic_size_t head;
+    size_t cached_tail;
+    long lexer_waits;
+    // Written by the parser
+    _Alignas(CACHE_LINE) atomic_size_t tail;
+    size_t cached_head;
+    long parser_waits;
+    _Alignas(CACHE_LINE) atomic_bool stop;
+    _Alignas(CACHE_LINE) PipelineToken tokens[PIPELINE_RING_SIZE];
+} TokenRing;
+
+static TokenRing ring_storage;              // Static, so the lines are aligned
+static TokenRing* ring = NULL;
+static StringTable strings;
+static pthread_t lexer_thread;
+static int token_count = 0;
+static PipelineToken last_token;
+static YYSTYPE lexer_value;                 // Values of the lexer thread, yylval is the parser's
+
+//Strings
+
+static char* getString(int handle) {
+    return strings.chunks[handle / STRING_CHUNK][handle % STRING_CHUNK];
+}
+
+static void growBuckets() {
+    int count = strings.bucket_count ? strings.bucket_count * 2 : 1024;
+    int32_t* buckets = checkedCalloc(count, sizeof(int32_t), ALLOC_MODULES);
+    for (int handle = 0; handle < strings.count; handle++) {
+        uint32_t b = hashText(HASH_SEED, getString(handle)) & (count - 1);
+        while (buckets[b]) b = (b + 1) & (count - 1);
+        buckets[b] = handle + 1;
+    }
+    compilerFree(strings.buckets);
+    strings.buckets = buckets;
+    strings.bucket_count = count;
+}
+
+// Handle of the string, which the table takes (a copy already in it frees this one)
+static int32_t internString(char* text) {
+    if (2 * (strings.count + 1) > strings.bucket_count) growBuckets();
+    uint32_t b = hashText(HASH_SEED, text) & (strings.bucket_count - 1);
+    while (strings.buckets[b]) {
+        int32_t handle = strings.buckets[b] - 1;
+        if (strcmp(getString(handle), text) == 0) {
+            compilerFree(text);
+            return handle;
+        }
+        b = (b + 1) & (strings.bucket_count - 1);
+    }
+    int handle = strings.count;
+    if (handle / STRING_CHUNK == STRING_CHUNKS) {
+        fprintf(stderr, "Error: could not assign memory for the pipelined lexer.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (handle % STRING_CHUNK == 0) strings.chunks[handle / STRING_CHUNK] = checkedCalloc(STRING_CHUNK, sizeof(char*), ALLOC_MODULES);
+    strings.chunks[handle / STRING_CHUNK][handle % STRING_CHUNK] = text;
+    strings.buckets[b] = handle + 1;
+    strings.count++;
+    return handle;
+}
+
+static void freeStrings() {
+    for (int handle = 0; handle < strings.count; handle++) compilerFree(getString(handle));
+    for (int chunk = 0; chunk * STRING_CHUNK < strings.count; chunk++) compilerFree(strings.chunks[chunk]);
+    compilerFree(strings.buckets);
+    memset(&strings, 0, sizeof(StringTable));
+}
+
+//Ring
+
+static bool hasStringValue(int kind) {
+    return kind == INT || kind == STRING || kind == VOID || kind == IDENTIFIER || kind == STRING_LITERAL;
+}
+
+// Spin a little while the other side catches up, then give up the processor
+static void waitTurn(int* spins) {
+    if (++*spins >= SPINS_BEFORE_YIELD) {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+static bool pushToken(PipelineToken token) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    int spins = 0;
+    bool waited = false;
+    while (head - ring->cached_tail == PIPELINE_RING_SIZE) {
+        if (atomic_load_explicit(&ring->stop, memory_order_relaxed)) return false;
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail < PIPELINE_RING_SIZE) break;
+        if (!waited) ring->lexer_waits++;
+        waited = true;
+        waitTurn(&spins);
+    }
+    ring->tokens[head & (PIPELINE_RING_SIZE - 1)] = token;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+static void* runLexer(void* argument) {
+    (void)argument;
+    for (;;) {
+        int kind = yylex();
+        PipelineToken token = {kind, 0, (uint32_t)token_offset, (uint32_t)token_length};
+        if (kind == INTEGER_LITERAL) token.value = lexer_value.ival;
+        else if (hasStringValue(kind)) token.value = internString(lexer_value.sval);
+        if (!pushToken(token) || kind == 0) break;
+    }
+    return NULL;
+}
+
+// yylex of the parser while the pipeline runs
+static int readPipelinedToken() {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    int spins = 0;
+    bool waited = false;
+    while (tail == ring->cached_head) {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail != ring->cached_head) break;
+        if (!waited) ring->parser_waits++;
+        waited = true;
+        waitTurn(&spins);
+    }
+    PipelineToken token = ring->tokens[tail & (PIPELINE_RING_SIZE - 1)];
+    last_token = token;
+    // The end stays in the ring, like yylex keeps returning 0
+    if (token.kind == 0) return 0;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    token_count++;
+    if (token.kind == INTEGER_LITERAL) {
+        yylval.ival = token.value;
+    } else if (hasStringValue(token.kind)) {
+        // The lazy parser keeps the strings of the bodies and frees them with the AST
+        yylval.sval = lazy_bodies ? compilerStrdup(getString(token.value), ALLOC_TOKEN) : getString(token.value);
+    }
+    return token.kind;
+}
+
+//Pipeline
+
+bool startPipeline(FILE* input) {
+    ring = &ring_storage;
+    memset(ring, 0, sizeof(TokenRing));
+    token_count = 0;
+    memset(&last_token, 0, sizeof(PipelineToken));
+    yyin = input;
+    yyrestart(input);
+    token_offset = 0;
+    token_length = 0;
+    token_value = &lexer_value;
+    if (pthread_create(&lexer_thread, NULL, runLexer, NULL) != 0) {
+        fprintf(stderr, "Error: could not start the lexer thread.\n");
+        token_value = &yylval;
+        ring = NULL;
+        return false;
+    }
+    token_reader = readPipelinedToken;
+    return true;
+}
+
+void finishPipeline(PipelineStats* stats) {
+    atomic_store_explicit(&ring->stop, true, memory_order_relaxed);
+    pthread_join(lexer_thread, NULL);
+    token_reader = NULL;
+    token_value = &yylval;
+    stats->tokens = token_count;
+    stats->strings = strings.count;
+    stats->lexer_waits = ring->lexer_waits;
+    stats->parser_waits = ring->parser_waits;
+    ring = NULL;
+    freeStrings();
+}
+
+void getPipelineSpan(uint32_t* offset, uint32_t* length) {
+    *offset = last_token.offset;
+    *length = last_token.length;
+}
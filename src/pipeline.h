@@ -0,0 +1,39 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PIPELINE_RING_SIZE 4096        // Tokens between the lexer and the parser, a power of two
+
+// Token in the ring: the string of names, types and literals is a handle in the table of
+// interned strings, so every token has the same small size
+typedef struct {
+    int32_t kind;
+    int32_t value;                 // Handle of the string, or the integer of a literal
+    uint32_t offset;               // Span of the token in the input
+    uint32_t length;
+} PipelineToken;
+
+// Totals of a pipelined parse
+typedef struct {
+    int tokens;
+    int strings;                   // Distinct strings interned
+    long lexer_waits;              // Times the lexer found the ring full
+    long parser_waits;             // Times the parser found it empty
+} PipelineStats;
+
+// Run the lexer on its own thread over the input: it fills a single-producer, single-consumer
+// ring without locks and the parser reads from it instead of calling yylex, until
+// finishPipeline. False when the thread cannot start.
+bool startPipeline(FILE* input);
+
+// Stop the lexer (a parse that fails ends before the input does), wait for it and free the
+// strings. The parser copies the strings it keeps, so they are not needed after the parse.
+void finishPipeline(PipelineStats* stats);
+
+// Span of the last token the parser read, for the messages of a syntax error
+void getPipelineSpan(uint32_t* offset, uint32_t* length);
+
+#endif // PIPELINE_H
@@ -0,0 +1,184 @@
+#include "profile.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const kindNames[PROFILE_KIND_COUNT] = {
+    [PROFILE_FUNCTION] = "function", [PROFILE_BLOCK] = "block", [PROFILE_BRANCH] = "branch",
+    [PROFILE_RECEIVER] = "receiver",
+};
+
+static char* copyString(const char* text) {
+    char* copy = checkedCalloc(strlen(text) + 1, 1, ALLOC_ANALYSIS);
+    strcpy(copy, text);
+    return copy;
+}
+
+Profile* createProfile() {
+    Profile* profile = checkedCalloc(1, sizeof(Profile), ALLOC_ANALYSIS);
+    profile->sorted = true;
+    return profile;
+}
+
+void freeProfile(Profile* profile) {
+    if (!profile) return;
+    for (int e = 0; e < profile->count; e++) {
+        free(profile->entries[e].name);
+        free(profile->entries[e].target);
+    }
+    free(profile->entries);
+    free(profile);
+}
+
+void addProfileEntry(Profile* profile, ProfileKind kind, const char* name, int site, const char* target,
+                     long long count, long long other) {
+    if (profile->count == profile->capacity) {
+        profile->capacity = profile->capacity ? profile->capacity * 2 : 64;
+        profile->entries = checkedRealloc(profile->entries, profile->capacity * sizeof(ProfileEntry), ALLOC_ANALYSIS);
+    }
+    ProfileEntry* entry = &profile->entries[profile->count++];
+    entry->kind = kind;
+    entry->name = copyString(name);
+    entry->site = site;
+    entry->target = target ? copyString(target) : NULL;
+    entry->count = count;
+    entry->other = other;
+    profile->sorted = false;
+}
+
+//Lookup
+
+static int compareKeys(const ProfileEntry* a, const ProfileEntry* b) {
+    if (a->kind != b->kind) return a->kind < b->kind ? -1 : 1;
+    int order = strcmp(a->name, b->name);
+    if (order != 0) return order;
+    if (a->site != b->site) return a->site < b->site ? -1 : 1;
+    return strcmp(a->target ? a->target : "", b->target ? b->target : "");
+}
+
+static int compareEntries(const void* a, const void* b) {
+    return compareKeys((const ProfileEntry*)a, (const ProfileEntry*)b);
+}
+
+// Sort by key and merge the entries of the same key, like the branches of one label
+static void sortProfile(Profile* profile) {
+    if (profile->sorted) return;
+    qsort(profile->entries, profile->count, sizeof(ProfileEntry), compareEntries);
+    int kept = 0;
+    for (int e = 0; e < profile->count; e++) {
+        ProfileEntry* entry = &profile->entries[e];
+        if (kept > 0 && compareKeys(&profile->entries[kept - 1], entry) == 0) {
+            profile->entries[kept - 1].count += entry->count;
+            profile->entries[kept - 1].other += entry->other;
+            free(entry->name);
+            free(entry->target);
+        } else {
+            profile->entries[kept++] = *entry;
+        }
+    }
+    profile->count = kept;
+    profile->sorted = true;
+}
+
+// First entry of the kind and name (the receivers of a function follow it)
+ProfileEntry* findProfileEntry(Profile* profile, ProfileKind kind, const char* name) {
+    sortProfile(profile);
+    int low = 0;
+    int high = profile->count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        ProfileEntry* entry = &profile->entries[middle];
+        int order = entry->kind != kind ? (entry->kind < kind ? -1 : 1) : strcmp(entry->name, name);
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < profile->count && profile->entries[low].kind == kind && strcmp(profile->entries[low].name, name) == 0) {
+        return &profile->entries[low];
+    }
+    return NULL;
+}
+
+long long getProfileCount(Profile* profile, ProfileKind kind, const char* name) {
+    ProfileEntry* entry = findProfileEntry(profile, kind, name);
+    return entry ? entry->count : 0;
+}
+
+//Text form
+
+int writeProfile(Profile* profile, FILE* out) {
+    sortProfile(profile);
+    fprintf(out, "%s\n", PROFILE_HEADER);
+    for (int e = 0; e < profile->count; e++) {
+        ProfileEntry* entry = &profile->entries[e];
+        fprintf(out, "%s %s", kindNames[entry->kind], entry->name);
+        switch (entry->kind) {
+            case PROFILE_BRANCH: fprintf(out, " %lld %lld\n", entry->count, entry->other); break;
+            case PROFILE_RECEIVER: fprintf(out, " %d %s %lld\n", entry->site, entry->target, entry->count); break;
+            default: fprintf(out, " %lld\n", entry->count); break;
+        }
+    }
+    return ferror(out) ? 1 : 0;
+}
+
+static bool parseCount(const char* text, long long* value) {
+    char* end;
+    if (!text) return false;
+    *value = strtoll(text, &end, 10);
+    return *end == '\0' && *value >= 0;
+}
+
+Profile* readProfile(FILE* in) {
+    Profile* profile = createProfile();
+    char* line = NULL;
+    size_t capacity = 0;
+    int number = 0;
+    bool ok = true;
+    while (ok && getline(&line, &capacity, in) >= 0) {
+        number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (number == 1) {
+            ok = strcmp(line, PROFILE_HEADER) == 0;
+            continue;
+        }
+        char* words[5] = {NULL, NULL, NULL, NULL, NULL};
+        int count = 0;
+        for (char* word = strtok(line, " \t"); word && count < 6; word = strtok(NULL, " \t")) {
+            if (count < 5) words[count] = word;
+            count++;
+        }
+        if (count == 0 || words[0][0] == '#') continue;
+
+        int kind = 0;
+        while (kind < PROFILE_KIND_COUNT && strcmp(words[0], kindNames[kind]) != 0) kind++;
+        long long first = 0;
+        long long second = 0;
+        switch (kind) {
+            case PROFILE_FUNCTION:
+            case PROFILE_BLOCK:
+                ok = count == 3 && parseCount(words[2], &first);
+                if (ok) addProfileEntry(profile, kind, words[1], 0, NULL, first, 0);
+                break;
+            case PROFILE_BRANCH:
+                ok = count == 4 && parseCount(words[2], &first) && parseCount(words[3], &second);
+                if (ok) addProfileEntry(profile, kind, words[1], 0, NULL, first, second);
+                break;
+            case PROFILE_RECEIVER:
+                ok = count == 5 && parseCount(words[2], &second) && second <= 1000000000 && parseCount(words[4], &first);
+                if (ok) addProfileEntry(profile, kind, words[1], (int)second, words[3], first, 0);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+    }
+    free(line);
+    if (!ok || number == 0) {
+        fprintf(stderr, "Error: line %d of the profile is not valid.\n", number);
+        freeProfile(profile);
+        return NULL;
+    }
+    return profile;
+}
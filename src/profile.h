@@ -0,0 +1,57 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#define PROFILE_HEADER "# vypint profile 1"
+
+// Counters of an instrumented run (vypint --profile=FILE), read back by vypcomp --profile-use=FILE.
+// Everything is keyed by the labels vypcomp generates, one entry per line:
+//
+//   function f.name count                  calls that entered the function
+//   block l.function.N count               times the code at the label ran
+//   branch l.function.N taken not_taken    conditional jumps to the label
+//   receiver f.name site f.Class.method count
+//                                          targets of the site-th call through a vtable in the function
+typedef enum {
+    PROFILE_FUNCTION,
+    PROFILE_BLOCK,
+    PROFILE_BRANCH,
+    PROFILE_RECEIVER,
+    PROFILE_KIND_COUNT
+} ProfileKind;
+
+typedef struct {
+    ProfileKind kind;
+    char* name;                    // Label of the function, block or branch target
+    int site;                      // Receivers: call through a vtable, in order in the function
+    char* target;                  // Receivers: label of the method that ran
+    long long count;               // Entries, executions, taken branches or calls
+    long long other;               // Branches not taken
+} ProfileEntry;
+
+typedef struct {
+    ProfileEntry* entries;
+    int count;
+    int capacity;
+    bool sorted;
+} Profile;
+
+Profile* createProfile();
+void freeProfile(Profile* profile);
+
+// Entries with the same key add their counts
+void addProfileEntry(Profile* profile, ProfileKind kind, const char* name, int site, const char* target,
+                     long long count, long long other);
+ProfileEntry* findProfileEntry(Profile* profile, ProfileKind kind, const char* name);
+
+// Count of an entry, 0 when the run never got there
+long long getProfileCount(Profile* profile, ProfileKind kind, const char* name);
+
+int writeProfile(Profile* profile, FILE* out);
+
+// NULL with the line printed into stderr when the file is not a profile
+Profile* readProfile(FILE* in);
+
+#endif // PROFILE_H
@@ -0,0 +1,318 @@
+#include "regalloc.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_USES 64
+
+// Set of virtual registers
+typedef struct {
+    unsigned long* words;
+    int word_count;
+} ValueSet;
+
+#define BITS_PER_WORD (8 * sizeof(unsigned long))
+
+static ValueSet createSet(int value_count) {
+    ValueSet set;
+    set.word_count = (value_count + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    set.words = checkedCalloc(set.word_count, sizeof(unsigned long), ALLOC_ANALYSIS);
+    return set;
+}
+
+static void addToSet(ValueSet* set, int value) {
+    set->words[value / BITS_PER_WORD] |= 1UL << (value % BITS_PER_WORD);
+}
+
+static bool isInSet(ValueSet* set, int value) {
+    return (set->words[value / BITS_PER_WORD] >> (value % BITS_PER_WORD)) & 1UL;
+}
+
+//Liveness
+
+// Per-block sets of the liveness analysis
+typedef struct {
+    ValueSet use;                  // Read before written in the block
+    ValueSet def;                  // Written in the block
+    ValueSet liveIn;
+    ValueSet liveOut;
+    int start;                     // Position of the first instruction
+    int end;                       // Position of the last instruction
+} BlockLiveness;
+
+static void computeLocalSets(ControlFlowGraph* cfg, BlockLiveness* liveness, int value_count) {
+    int position = 0;
+    for (int b = 0; b < cfg->block_count; b++) {
+        BlockLiveness* block = &liveness[b];
+        block->use = createSet(value_count);
+        block->def = createSet(value_count);
+        block->liveIn = createSet(value_count);
+        block->liveOut = createSet(value_count);
+        block->start = position;
+
+        for (IRInstr* instr = cfg->blocks[b].first; ; instr = instr->next) {
+            int uses[MAX_USES];
+            int count = getIRInstrUses(instr, uses, MAX_USES);
+            for (int i = 0; i < count; i++) {
+                if (!isInSet(&block->def, uses[i])) addToSet(&block->use, uses[i]);
+            }
+            if (instr->dst >= 0) addToSet(&block->def, instr->dst);
+            position++;
+            if (instr == cfg->blocks[b].last) break;
+        }
+        block->end = position - 1;
+    }
+}
+
+// Iterate live_in = use + (live_out - def) until nothing changes
+static void computeLiveSets(ControlFlowGraph* cfg, BlockLiveness* liveness) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = cfg->block_count - 1; b >= 0; b--) {
+            BlockLiveness* block = &liveness[b];
+            for (int w = 0; w < block->liveOut.word_count; w++) {
+                unsigned long out = 0;
+                for (int s = 0; s < cfg->blocks[b].successor_count; s++) {
+                    out |= liveness[cfg->blocks[b].successors[s]].liveIn.words[w];
+                }
+                unsigned long in = block->use.words[w] | (out & ~block->def.words[w]);
+                if (out != block->liveOut.words[w] || in != block->liveIn.words[w]) {
+                    block->liveOut.words[w] = out;
+                    block->liveIn.words[w] = in;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+//Intervals
+
+static void extendInterval(LiveInterval* intervals, int value, int position) {
+    LiveInterval* interval = &intervals[value];
+    if (interval->value < 0) {
+        interval->value = value;
+        interval->start = position;
+        interval->end = position;
+        return;
+    }
+    if (position < interval->start) interval->start = position;
+    if (position > interval->end) interval->end = position;
+}
+
+static int compareByStart(const void* a, const void* b) {
+    const LiveInterval* first = (const LiveInterval*)a;
+    const LiveInterval* second = (const LiveInterval*)b;
+    if (first->start != second->start) return first->start - second->start;
+    return first->value - second->value;
+}
+
+static LiveInterval* buildIntervals(IRFunction* function, ControlFlowGraph* cfg, BlockLiveness* liveness,
+                                    int* interval_count) {
+    int value_count = function->value_count;
+    LiveInterval* byValue = checkedCalloc(value_count, sizeof(LiveInterval), ALLOC_ANALYSIS);
+    for (int v = 0; v < value_count; v++) {
+        byValue[v].value = -1;
+        byValue[v].start = -1;
+        byValue[v].end = -1;
+    }
+
+    // Calls clobber every register, remember where they are
+    int instr_count = 0;
+    for (IRInstr* instr = function->first; instr; instr = instr->next) instr_count++;
+    int* calls = checkedCalloc(instr_count, sizeof(int), ALLOC_ANALYSIS);
+    int call_count = 0;
+
+    int position = 0;
+    for (IRInstr* instr = function->first; instr; instr = instr->next, position++) {
+        int uses[MAX_USES];
+        int count = getIRInstrUses(instr, uses, MAX_USES);
+        for (int i = 0; i < count; i++) extendInterval(byValue, uses[i], position);
+        if (instr->dst >= 0) extendInterval(byValue, instr->dst, position);
+        if (isIRCall(instr)) calls[call_count++] = position;
+    }
+
+    // Values live across block boundaries cover the whole block
+    for (int b = 0; b < cfg->block_count; b++) {
+        for (int v = 0; v < value_count; v++) {
+            if (isInSet(&liveness[b].liveIn, v)) extendInterval(byValue, v, liveness[b].start);
+            if (isInSet(&liveness[b].liveOut, v)) extendInterval(byValue, v, liveness[b].end);
+        }
+    }
+
+    // Parameters are defined before the first instruction
+    for (int v = 0; v < value_count; v++) {
+        if (function->values[v].paramIndex >= 0 && byValue[v].value >= 0) {
+            byValue[v].start = -1;
+        }
+    }
+
+    LiveInterval* intervals = checkedCalloc(value_count, sizeof(LiveInterval), ALLOC_ANALYSIS);
+    int count = 0;
+    for (int v = 0; v < value_count; v++) {
+        if (byValue[v].value < 0) continue;
+        LiveInterval interval = byValue[v];
+        interval.crossesCall = false;
+        for (int c = 0; c < call_count; c++) {
+            if (interval.start < calls[c] && calls[c] < interval.end) {
+                interval.crossesCall = true;
+                break;
+            }
+        }
+        intervals[count++] = interval;
+    }
+    qsort(intervals, count, sizeof(LiveInterval), compareByStart);
+
+    compilerFree(calls);
+    compilerFree(byValue);
+    *interval_count = count;
+    return intervals;
+}
+
+//Linear scan
+
+static void spillValue(IRFunction* function, RegisterAllocation* allocation, int value) {
+    if (function->values[value].paramIndex >= 0) {
+        // Parameters already have a home in the caller's frame
+        allocation->locations[value].kind = LOCATION_PARAM;
+        allocation->locations[value].index = function->values[value].paramIndex;
+    } else {
+        allocation->locations[value].kind = LOCATION_STACK;
+        allocation->locations[value].index = -1; // Slot chosen by assignStackSlots
+    }
+}
+
+// Give stack slots to spilled values, reusing the slots of values that are no longer live
+static void assignStackSlots(RegisterAllocation* allocation) {
+    int* slotEnd = checkedCalloc(allocation->interval_count, sizeof(int), ALLOC_ANALYSIS);
+    int slot_count = 0;
+
+    for (int i = 0; i < allocation->interval_count; i++) {
+        LiveInterval* interval = &allocation->intervals[i];
+        ValueLocation* location = &allocation->locations[interval->value];
+        if (location->kind != LOCATION_STACK) continue;
+
+        int slot = -1;
+        for (int s = 0; s < slot_count; s++) {
+            if (slotEnd[s] < interval->start) {
+                slot = s;
+                break;
+            }
+        }
+        if (slot < 0) slot = slot_count++;
+        slotEnd[slot] = interval->end;
+        location->index = slot + 1; // [$7+1] is the first slot above the saved frame pointer
+    }
+
+    allocation->frame_size = slot_count;
+    compilerFree(slotEnd);
+}
+
+RegisterAllocation* allocateRegisters(IRFunction* function, int register_count, const long long* weights) {
+    RegisterAllocation* allocation = checkedCalloc(1, sizeof(RegisterAllocation), ALLOC_ANALYSIS);
+    allocation->value_count = function->value_count;
+    allocation->locations = checkedCalloc(function->value_count, sizeof(ValueLocation), ALLOC_ANALYSIS);
+    if (!function->first) return allocation;
+
+    ControlFlowGraph* cfg = buildCFG(function);
+    BlockLiveness* liveness = checkedCalloc(cfg->block_count, sizeof(BlockLiveness), ALLOC_ANALYSIS);
+    computeLocalSets(cfg, liveness, function->value_count);
+    computeLiveSets(cfg, liveness);
+    allocation->intervals = buildIntervals(function, cfg, liveness, &allocation->interval_count);
+
+    // Active intervals sorted by increasing end
+    LiveInterval** active = checkedCalloc(allocation->interval_count, sizeof(LiveInterval*), ALLOC_ANALYSIS);
+    int active_count = 0;
+    bool* freeRegisters = checkedCalloc(register_count, sizeof(bool), ALLOC_ANALYSIS);
+    for (int r = 0; r < register_count; r++) freeRegisters[r] = true;
+
+    for (int i = 0; i < allocation->interval_count; i++) {
+        LiveInterval* current = &allocation->intervals[i];
+
+        // Expire the intervals that ended before this one starts
+        int kept = 0;
+        for (int a = 0; a < active_count; a++) {
+            if (active[a]->end < current->start) {
+                freeRegisters[allocation->locations[active[a]->value].index] = true;
+            } else {
+                active[kept++] = active[a];
+            }
+        }
+        active_count = kept;
+
+        if (current->crossesCall) {
+            spillValue(function, allocation, current->value);
+            continue;
+        }
+
+        int reg = -1;
+        for (int r = 0; r < register_count; r++) {
+            if (freeRegisters[r]) {
+                reg = r;
+                break;
+            }
+        }
+
+        if (reg < 0) {
+            // No register left: spill the interval that ends last, or with a profile the one whose
+            // uses ran the least (the one that ends last among equals)
+            int victimIndex = active_count - 1;
+            for (int a = active_count - 2; weights && a >= 0; a--) {
+                if (weights[active[a]->value] < weights[active[victimIndex]->value]) victimIndex = a;
+            }
+            LiveInterval* victim = active_count > 0 ? active[victimIndex] : NULL;
+            bool replace = victim && victim->end > current->end;
+            if (victim && weights && weights[victim->value] != weights[current->value]) {
+                replace = weights[victim->value] < weights[current->value];
+            }
+            if (replace) {
+                reg = allocation->locations[victim->value].index;
+                spillValue(function, allocation, victim->value);
+                for (int a = victimIndex; a + 1 < active_count; a++) active[a] = active[a + 1];
+                active_count--;
+            } else {
+                spillValue(function, allocation, current->value);
+                continue;
+            }
+        }
+
+        freeRegisters[reg] = false;
+        allocation->locations[current->value].kind = LOCATION_REGISTER;
+        allocation->locations[current->value].index = reg;
+
+        int position = active_count;
+        while (position > 0 && active[position - 1]->end > current->end) {
+            active[position] = active[position - 1];
+            position--;
+        }
+        active[position] = current;
+        active_count++;
+    }
+
+    assignStackSlots(allocation);
+    for (int v = 0; v < function->value_count; v++) {
+        if (allocation->locations[v].kind == LOCATION_REGISTER) allocation->register_count++;
+        if (allocation->locations[v].kind == LOCATION_STACK) allocation->spilled_count++;
+    }
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        compilerFree(liveness[b].use.words);
+        compilerFree(liveness[b].def.words);
+        compilerFree(liveness[b].liveIn.words);
+        compilerFree(liveness[b].liveOut.words);
+    }
+    compilerFree(liveness);
+    compilerFree(active);
+    compilerFree(freeRegisters);
+    freeCFG(cfg);
+    return allocation;
+}
+
+void freeRegisterAllocation(RegisterAllocation* allocation) {
+    if (!allocation) return;
+    compilerFree(allocation->locations);
+    compilerFree(allocation->intervals);
+    compilerFree(allocation);
+}
@@ -0,0 +1,50 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "ir.h"
+#include "cfg.h"
+
+// VYPcode registers used by the generated code
+#define VYP_REGISTER_COUNT 8       // $0 - $7, default of the interpreter
+#define ALLOCATABLE_REGISTERS 6    // $0 - $5 hold virtual registers
+#define SCRATCH_REGISTER 6         // $6 temporary and return value
+#define FRAME_REGISTER 7           // $7 frame pointer
+
+// Where a virtual register lives during the whole function
+typedef enum {
+    LOCATION_NONE,                 // Never used
+    LOCATION_REGISTER,             // index = VYPcode register
+    LOCATION_STACK,                // index = slot in the frame, [$7+index]
+    LOCATION_PARAM,                // index = parameter position, slot written by the caller
+} LocationKind;
+
+typedef struct {
+    LocationKind kind;
+    int index;
+} ValueLocation;
+
+// Live range of a virtual register over the numbered instructions
+typedef struct {
+    int value;
+    int start;
+    int end;
+    bool crossesCall;              // Live across a call, registers do not survive it
+} LiveInterval;
+
+// Result of the allocation of one function
+typedef struct {
+    ValueLocation* locations;      // Indexed by virtual register
+    int value_count;
+    int frame_size;                // Stack slots for spilled values
+    int spilled_count;             // Values kept in the stack
+    int register_count;            // Values kept in registers
+    LiveInterval* intervals;
+    int interval_count;
+} RegisterAllocation;
+
+// Linear scan; weights (by virtual register, can be NULL) are the profiled executions of the
+// instructions that use each value and decide which one is spilled
+RegisterAllocation* allocateRegisters(IRFunction* function, int register_count, const long long* weights);
+void freeRegisterAllocation(RegisterAllocation* allocation);
+
+#endif // REGALLOC_H
@@ -0,0 +1,189 @@
+#include "runtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_WORDS (1 << 20)          // Words of every block the allocator takes from malloc
+
+// Nothing is freed: the words come from big blocks that live until the program ends
+static int64_t* arena;
+static int64_t arena_left;
+
+static void* checkedCalloc(size_t count, size_t size) {
+    void* memory = calloc(count ? count : 1, size);
+    if (!memory) {
+        fprintf(stderr, "Error: could not assign memory for the program.\n");
+        exit(RUNTIME_ERROR_MEMORY);
+    }
+    return memory;
+}
+
+static int64_t* allocateWords(int64_t words) {
+    if (words > ARENA_WORDS / 8) return checkedCalloc(words, sizeof(int64_t));
+    if (words > arena_left) {
+        arena = checkedCalloc(ARENA_WORDS, sizeof(int64_t));
+        arena_left = ARENA_WORDS;
+    }
+    int64_t* memory = arena;
+    arena += words;
+    arena_left -= words;
+    return memory;
+}
+
+static VypString* createString(int64_t length) {
+    VypString* string = (VypString*)allocateWords(length + 1);
+    string->length = length;
+    return string;
+}
+
+int64_t* vyp_new_object(int64_t words) {
+    return allocateWords(words);
+}
+
+//Strings
+
+VypString* vyp_concat(int64_t count, VypString** pieces) {
+    int64_t length = 0;
+    for (int64_t p = 0; p < count; p++) length += pieces[p]->length;
+    VypString* result = createString(length);
+    int64_t position = 0;
+    for (int64_t p = 0; p < count; p++) {
+        memcpy(result->codes + position, pieces[p]->codes, pieces[p]->length * sizeof(int64_t));
+        position += pieces[p]->length;
+    }
+    return result;
+}
+
+int64_t vyp_compare_strings(VypString* a, VypString* b) {
+    for (int64_t i = 0; i < a->length && i < b->length; i++) {
+        if (a->codes[i] != b->codes[i]) return a->codes[i] < b->codes[i] ? -1 : 1;
+    }
+    return a->length < b->length ? -1 : a->length > b->length;
+}
+
+VypString* vyp_int2string(int64_t value) {
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%lld", (long long)value);
+    VypString* string = createString(length);
+    for (int i = 0; i < length; i++) string->codes[i] = text[i];
+    return string;
+}
+
+// Like the subStr of the VYPcode runtime: empty when the start or the count are out of the
+// string, cut at its end
+VypString* vyp_substr(VypString* string, int64_t start, int64_t count) {
+    if (start < 0 || start > string->length || count < 0) return createString(0);
+    if (count > string->length - start) count = string->length - start;
+    VypString* result = createString(count);
+    memcpy(result->codes, string->codes + start, count * sizeof(int64_t));
+    return result;
+}
+
+//Input and output
+
+// Number of bytes of the UTF-8 sequence at text; an invalid byte is taken as its own code point
+static int decodeUTF8(const unsigned char* text, size_t length, int64_t* codepoint) {
+    int extra = text[0] >= 0xF0 ? 3 : text[0] >= 0xE0 ? 2 : text[0] >= 0xC0 ? 1 : 0;
+    if (text[0] < 0x80 || (size_t)extra >= length) {
+        *codepoint = text[0];
+        return 1;
+    }
+    int64_t value = text[0] & (0x3F >> extra);
+    for (int i = 1; i <= extra; i++) {
+        if ((text[i] & 0xC0) != 0x80) {
+            *codepoint = text[0];
+            return 1;
+        }
+        value = (value << 6) | (text[i] & 0x3F);
+    }
+    *codepoint = value;
+    return extra + 1;
+}
+
+// Whole line of stdin without the end of line
+static unsigned char* readLine(size_t* length) {
+    size_t capacity = 64;
+    unsigned char* line = checkedCalloc(capacity, 1);
+    int c;
+    fflush(stdout);
+    *length = 0;
+    while ((c = getchar()) != EOF && c != '\n') {
+        if (*length + 1 == capacity) {
+            capacity *= 2;
+            line = realloc(line, capacity);
+            if (!line) {
+                fprintf(stderr, "Error: could not assign memory for a line of input.\n");
+                exit(RUNTIME_ERROR_MEMORY);
+            }
+        }
+        line[(*length)++] = (unsigned char)c;
+    }
+    if (*length > 0 && line[*length - 1] == '\r') (*length)--;
+    line[*length] = '\0';
+    return line;
+}
+
+int64_t vyp_read_int(void) {
+    size_t length;
+    unsigned char* line = readLine(&length);
+    int64_t value = strtoll((char*)line, NULL, 0);
+    free(line);
+    return value;
+}
+
+VypString* vyp_read_string(void) {
+    size_t length;
+    unsigned char* line = readLine(&length);
+    VypString* string = createString(length);
+    string->length = 0;
+    for (size_t i = 0; i < length; ) i += decodeUTF8(line + i, length - i, &string->codes[string->length++]);
+    free(line);
+    return string;
+}
+
+void vyp_print_int(int64_t value) {
+    printf("%lld", (long long)value);
+}
+
+void vyp_print_string(VypString* string) {
+    for (int64_t i = 0; i < string->length; i++) {
+        int64_t codepoint = string->codes[i];
+        if (codepoint < 0x80) {
+            putchar((int)codepoint);
+        } else if (codepoint < 0x800) {
+            putchar(0xC0 | (int)(codepoint >> 6));
+            putchar(0x80 | (int)(codepoint & 0x3F));
+        } else if (codepoint < 0x10000) {
+            putchar(0xE0 | (int)(codepoint >> 12));
+            putchar(0x80 | (int)((codepoint >> 6) & 0x3F));
+            putchar(0x80 | (int)(codepoint & 0x3F));
+        } else {
+            putchar(0xF0 | (int)((codepoint >> 18) & 0x07));
+            putchar(0x80 | (int)((codepoint >> 12) & 0x3F));
+            putchar(0x80 | (int)((codepoint >> 6) & 0x3F));
+            putchar(0x80 | (int)(codepoint & 0x3F));
+        }
+    }
+}
+
+//Errors
+
+void vyp_division_error(int64_t dividend) {
+    fflush(stdout);
+    fprintf(stderr, "Error: division by zero (%lld / 0).\n", (long long)dividend);
+    exit(RUNTIME_ERROR_DIVISION);
+}
+
+void vyp_null_error(void) {
+    fflush(stdout);
+    fprintf(stderr, "Error: invalid chunk 0.\n");      // What vypint says for a null object
+    exit(RUNTIME_ERROR_MEMORY);
+}
+
+int main(void) {
+    static char outputBuffer[1 << 16];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+    vyp_main();
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <stdint.h>
+
+// Runtime of the native code of x86.c. The generated code keeps every value in one 64-bit
+// word: integers as they are, strings and objects as pointers.
+
+#define RUNTIME_ERROR_DIVISION 27      // Exit codes of vypint for the same errors
+#define RUNTIME_ERROR_MEMORY 28
+
+// Immutable string, one code point per word like the chunks of vypint
+typedef struct {
+    int64_t length;
+    int64_t codes[];
+} VypString;
+
+// Object: word 0 points to the vtable of its class, the attributes follow at the offsets of
+// layout.c. A vtable holds the name of the class and then the code of every method slot.
+
+int64_t* vyp_new_object(int64_t words);
+VypString* vyp_concat(int64_t count, VypString** pieces);
+int64_t vyp_compare_strings(VypString* a, VypString* b);
+VypString* vyp_int2string(int64_t value);
+VypString* vyp_substr(VypString* string, int64_t start, int64_t count);
+int64_t vyp_read_int(void);
+VypString* vyp_read_string(void);
+void vyp_print_int(int64_t value);
+void vyp_print_string(VypString* string);
+void vyp_division_error(int64_t dividend);
+void vyp_null_error(void);
+
+// Entry point generated by vypcomp --x86
+void vyp_main(void);
+
+#endif // RUNTIME_H
@@ -0,0 +1,37 @@
+#include "scanner.h"
+
+// The interface of the flex scanner that the parser and the drivers use, on top of the
+// hand-written one (make LEXER=scanner links it instead of lexer.o)
+FILE* yyin = NULL;
+int lexical_error = 0;
+int token_offset = 0;
+int token_length = 0;
+YYSTYPE* token_value = &yylval;
+
+static Scanner scanner;
+static FILE* loaded = NULL;        // File in scanner, null when it has to be read again
+
+void yyrestart(FILE* file) {
+    yyin = file;
+    loaded = NULL;
+}
+
+int yylex() {
+    if (!yyin) yyin = stdin;
+    if (loaded != yyin) {
+        closeScanner(&scanner);
+        if (!openScanner(&scanner, yyin)) {
+            fprintf(stderr, "Error: could not read the input.\n");
+            lexical_error = 1;
+            return 0;
+        }
+        loaded = yyin;
+    }
+    int token = scanToken(&scanner, token_value);
+    token_offset = scanner.start;
+    token_length = scanner.position - scanner.start;
+    if (scanner.errors) lexical_error = 1;
+    // Like flex, the next call after the end starts from whatever the file has then
+    if (token == 0) loaded = NULL;
+    return token;
+}
@@ -0,0 +1,367 @@
+#include "scanner.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCANNER_X86 1
+#endif
+
+//Runs
+
+// Bytes a run is made of (SKIP_*) or the ones it stops at (FIND_*)
+typedef enum {
+    SKIP_SPACE,                    // [ \t\n]
+    SKIP_WORD,                     // [a-zA-Z0-9_]
+    SKIP_DIGITS,                   // [0-9]
+    FIND_NEWLINE,                  // End of a line comment
+    FIND_QUOTE,                    // '"' or '\\' in a string
+    FIND_STAR,                     // '*' in a block comment
+} RunClass;
+
+// Position where the run that starts at p ends, end at the latest. The text has
+// SCANNER_PADDING readable bytes after end.
+typedef const char* (*RunScanner)(const char* p, const char* end, RunClass run);
+
+// Classes of the bytes, for the first bytes of a run and the tokens they start
+#define CHAR_SPACE 1
+#define CHAR_DIGIT 2
+#define CHAR_WORD_START 4
+
+static unsigned char char_classes[256];
+
+static bool isSpace(unsigned char c) {
+    return char_classes[c] & CHAR_SPACE;
+}
+
+static bool isDigit(unsigned char c) {
+    return char_classes[c] & CHAR_DIGIT;
+}
+
+static bool isWordStart(unsigned char c) {
+    return char_classes[c] & CHAR_WORD_START;
+}
+
+static bool isWord(unsigned char c) {
+    return char_classes[c] & (CHAR_DIGIT | CHAR_WORD_START);
+}
+
+static bool stopsRun(unsigned char c, RunClass run) {
+    switch (run) {
+        case SKIP_SPACE: return !isSpace(c);
+        case SKIP_WORD: return !isWord(c);
+        case SKIP_DIGITS: return !isDigit(c);
+        case FIND_NEWLINE: return c == '\n';
+        case FIND_QUOTE: return c == '"' || c == '\\';
+        case FIND_STAR: return c == '*';
+    }
+    return true;
+}
+
+static const char* scanRunScalar(const char* p, const char* end, RunClass run) {
+    while (p < end && !stopsRun(*p, run)) p++;
+    return p;
+}
+
+#ifdef SCANNER_X86
+
+// Unsigned x - low < count for every byte
+#define IN_RANGE_128(x, low, count) \
+    _mm_cmpeq_epi8(_mm_min_epu8(_mm_sub_epi8(x, _mm_set1_epi8(low)), _mm_set1_epi8((count) - 1)), \
+                   _mm_sub_epi8(x, _mm_set1_epi8(low)))
+#define IN_RANGE_256(x, low, count) \
+    _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_sub_epi8(x, _mm256_set1_epi8(low)), _mm256_set1_epi8((count) - 1)), \
+                      _mm256_sub_epi8(x, _mm256_set1_epi8(low)))
+
+__attribute__((target("sse2")))
+static unsigned stopMask128(__m128i chunk, RunClass run) {
+    __m128i match;
+    switch (run) {
+        case SKIP_SPACE:
+            match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                                              _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+                                 _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+            return ~_mm_movemask_epi8(match) & 0xFFFF;
+        case SKIP_WORD: {
+            __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+            match = _mm_or_si128(_mm_or_si128(IN_RANGE_128(lower, 'a', 26), IN_RANGE_128(chunk, '0', 10)),
+                                 _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+            return ~_mm_movemask_epi8(match) & 0xFFFF;
+        }
+        case SKIP_DIGITS:
+            return ~_mm_movemask_epi8(IN_RANGE_128(chunk, '0', 10)) & 0xFFFF;
+        case FIND_NEWLINE:
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+        case FIND_QUOTE:
+            match = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+            return _mm_movemask_epi8(match);
+        case FIND_STAR:
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('*')));
+    }
+    return 1;
+}
+
+__attribute__((target("sse2")))
+static const char* scanRunSSE2(const char* p, const char* end, RunClass run) {
+    for (; p < end; p += 16) {
+        unsigned mask = stopMask128(_mm_loadu_si128((const __m128i*)p), run);
+        if (mask) {
+            p += __builtin_ctz(mask);
+            return p < end ? p : end;
+        }
+    }
+    return end;
+}
+
+__attribute__((target("avx2")))
+static unsigned stopMask256(__m256i chunk, RunClass run) {
+    __m256i match;
+    switch (run) {
+        case SKIP_SPACE:
+            match = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+                                                    _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+                                    _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+            return ~(unsigned)_mm256_movemask_epi8(match);
+        case SKIP_WORD: {
+            __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+            match = _mm256_or_si256(_mm256_or_si256(IN_RANGE_256(lower, 'a', 26), IN_RANGE_256(chunk, '0', 10)),
+                                    _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')));
+            return ~(unsigned)_mm256_movemask_epi8(match);
+        }
+        case SKIP_DIGITS:
+            return ~(unsigned)_mm256_movemask_epi8(IN_RANGE_256(chunk, '0', 10));
+        case FIND_NEWLINE:
+            return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+        case FIND_QUOTE:
+            match = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+                                    _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')));
+            return (unsigned)_mm256_movemask_epi8(match);
+        case FIND_STAR:
+            return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('*')));
+    }
+    return 1;
+}
+
+__attribute__((target("avx2")))
+static const char* scanRunAVX2(const char* p, const char* end, RunClass run) {
+    for (; p < end; p += 32) {
+        unsigned mask = stopMask256(_mm256_loadu_si256((const __m256i*)p), run);
+        if (mask) {
+            p += __builtin_ctz(mask);
+            return p < end ? p : end;
+        }
+    }
+    return end;
+}
+
+#endif // SCANNER_X86
+
+static RunScanner scanRun = NULL;
+static const char* scanner_kind = "scalar";
+
+static void chooseRunScanner() {
+    if (scanRun) return;
+    for (int c = 0; c < 256; c++) {
+        if (c == ' ' || c == '\t' || c == '\n') char_classes[c] |= CHAR_SPACE;
+        if (c >= '0' && c <= '9') char_classes[c] |= CHAR_DIGIT;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') char_classes[c] |= CHAR_WORD_START;
+    }
+    const char* wanted = getenv("VYPCOMP_SCANNER");
+    scanRun = scanRunScalar;
+#ifdef SCANNER_X86
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+    if (wanted && strcmp(wanted, "scalar") == 0) return;
+    if (avx2 && (!wanted || strcmp(wanted, "avx2") == 0)) {
+        scanRun = scanRunAVX2;
+        scanner_kind = "avx2";
+    } else if (sse2) {
+        scanRun = scanRunSSE2;
+        scanner_kind = "sse2";
+    }
+#else
+    (void)wanted;
+#endif
+}
+
+// Most runs are a few bytes long (a blank between two tokens, a short name), they end before
+// it pays to load a vector
+static inline const char* skipRun(const char* p, const char* end, RunClass run) {
+    for (int n = 0; n < 8; n++, p++) {
+        if (p >= end || stopsRun(*p, run)) return p;
+    }
+    return scanRun(p, end, run);
+}
+
+const char* getScannerKind() {
+    chooseRunScanner();
+    return scanner_kind;
+}
+
+//Keywords
+
+typedef struct {
+    const char* name;
+    int length;
+    int token;
+    bool value;                    // The token carries its text, like the types do in lexer.l
+} Keyword;
+
+// Indexed by keywordHash, which gives every keyword another slot
+static const Keyword keywords[32] = {
+    [1] = {"int", 3, INT, true},
+    [2] = {"class", 5, CLASS, false},
+    [4] = {"print", 5, PRINT, false},
+    [6] = {"string", 6, STRING, true},
+    [8] = {"return", 6, RETURN, false},
+    [14] = {"readInt", 7, READ_INT, false},
+    [17] = {"super", 5, SUPER, false},
+    [18] = {"void", 4, VOID, true},
+    [19] = {"if", 2, IF, false},
+    [23] = {"this", 4, THIS, false},
+    [24] = {"while", 5, WHILE, false},
+    [29] = {"new", 3, NEW, false},
+    [30] = {"else", 4, ELSE, false},
+};
+
+static unsigned keywordHash(const char* word, size_t length) {
+    return ((unsigned char)word[0] * 5 + (unsigned char)word[length - 1]) & 31;
+}
+
+static const Keyword* findKeyword(const char* word, size_t length) {
+    const Keyword* keyword = &keywords[keywordHash(word, length)];
+    if (keyword->name && (size_t)keyword->length == length && memcmp(keyword->name, word, length) == 0) return keyword;
+    return NULL;
+}
+
+//Scanner
+
+bool openScanner(Scanner* scanner, FILE* input) {
+    chooseRunScanner();
+    memset(scanner, 0, sizeof(Scanner));
+    size_t capacity = 1 << 16;
+    scanner->text = checkedRealloc(NULL, capacity + SCANNER_PADDING, ALLOC_TOKEN);
+    size_t count;
+    while ((count = fread(scanner->text + scanner->length, 1, capacity - scanner->length, input)) > 0) {
+        scanner->length += count;
+        if (scanner->length == capacity) {
+            capacity *= 2;
+            scanner->text = checkedRealloc(scanner->text, capacity + SCANNER_PADDING, ALLOC_TOKEN);
+        }
+    }
+    memset(scanner->text + scanner->length, 0, SCANNER_PADDING);
+    return !ferror(input);
+}
+
+void closeScanner(Scanner* scanner) {
+    compilerFree(scanner->text);
+    memset(scanner, 0, sizeof(Scanner));
+}
+
+// End of the block comment that starts at p ("/*"), or null when lexer.l would not take it as
+// one: its pattern needs a character other than '*' and '/' after every run of stars but the
+// last one, which is a single star before the '/'
+static const char* skipBlockComment(const char* p, const char* end) {
+    p += 2;
+    for (;;) {
+        const char* star = skipRun(p, end, FIND_STAR);
+        const char* after = star;
+        while (after < end && *after == '*') after++;
+        if (after >= end) return NULL;
+        if (*after == '/') return after - star == 1 ? after + 1 : NULL;
+        p = after + 1;
+    }
+}
+
+// End of the string literal that starts at p, or null when it is not closed or has an escape
+// other than \" \n \t and \\ (lexer.l then rejects the quote alone)
+static const char* skipString(const char* p, const char* end) {
+    p++;
+    for (;;) {
+        const char* stop = skipRun(p, end, FIND_QUOTE);
+        if (stop >= end) return NULL;
+        if (*stop == '"') return stop + 1;
+        if (stop + 1 >= end || !strchr("\"nt\\", stop[1]) || stop[1] == '\0') return NULL;
+        p = stop + 2;
+    }
+}
+
+static int scanNumber(const char* p, size_t length) {
+    char digits[32];
+    if (length < sizeof(digits)) {
+        memcpy(digits, p, length);
+        digits[length] = '\0';
+        return atoi(digits);
+    }
+    char* copy = compilerStrndup(p, length, ALLOC_TOKEN);
+    int number = atoi(copy);
+    compilerFree(copy);
+    return number;
+}
+
+int scanToken(Scanner* scanner, YYSTYPE* value) {
+    const char* end = scanner->text + scanner->length;
+    const char* p = scanner->text + scanner->position;
+    for (;;) {
+        p = skipRun(p, end, SKIP_SPACE);
+        if (p >= end) {
+            scanner->start = scanner->position = scanner->length;
+            return 0;
+        }
+        if (p[0] == '/' && p[1] == '/' && p + 1 < end) {
+            p = skipRun(p + 2, end, FIND_NEWLINE);
+            continue;
+        }
+        if (p[0] == '/' && p[1] == '*' && p + 1 < end) {
+            const char* after = skipBlockComment(p, end);
+            if (after) {
+                p = after;
+                continue;
+            }
+        }
+        break;
+    }
+
+    const char* start = p;
+    int token;
+    unsigned char c = *p;
+    if (isWordStart(c)) {
+        p = skipRun(p + 1, end, SKIP_WORD);
+        const Keyword* keyword = findKeyword(start, p - start);
+        token = keyword ? keyword->token : IDENTIFIER;
+        if (!keyword || keyword->value) value->sval = compilerStrndup(start, p - start, ALLOC_TOKEN);
+    } else if (isDigit(c)) {
+        p = skipRun(p + 1, end, SKIP_DIGITS);
+        value->ival = scanNumber(start, p - start);
+        token = INTEGER_LITERAL;
+    } else if (c == '"' && (p = skipString(start, end)) != NULL) {
+        value->sval = compilerStrndup(start, p - start, ALLOC_TOKEN);
+        token = STRING_LITERAL;
+    } else {
+        p = start + 1;
+        bool equals = p < end && *p == '=';
+        switch (c) {
+            case '<': token = equals ? LE : '<'; break;
+            case '>': token = equals ? GE : '>'; break;
+            case '=': token = equals ? EQ : '='; break;
+            case '!': token = equals ? NE : YYLEX_ERROR; break;
+            case ':': case '.': case '+': case '-': case '*': case '/':
+            case '(': case ')': case '{': case '}': case ';': case ',':
+                token = c;
+                break;
+            default:
+                token = YYLEX_ERROR;
+                break;
+        }
+        if (token == LE || token == GE || token == EQ || token == NE) p++;
+        if (token == YYLEX_ERROR) {
+            fprintf(stderr, "Lexical Error: '%.1s'\n", start);
+            scanner->errors++;
+        }
+    }
+    scanner->start = start - scanner->text;
+    scanner->position = p - scanner->text;
+    return token;
+}
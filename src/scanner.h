@@ -0,0 +1,36 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "symbol_table.h"
+#include "ast.h"
+#include "parser.h"
+
+#define SCANNER_PADDING 64             // Zero bytes after the text, the vector loads can read them
+
+// Hand-written replacement of the flex scanner of lexer.l, with the same tokens and values.
+// The whole input is read at once; the runs of blanks, comments, names, numbers and strings are
+// found 32 bytes at a time with AVX2 or 16 at a time with SSE2 (VYPCOMP_SCANNER=avx2, sse2 or
+// scalar picks one, the best one the processor has is the default), and the keywords are
+// recognized with a perfect hash of their first and last letters.
+typedef struct {
+    char* text;
+    size_t length;
+    size_t position;
+    size_t start;                  // Offset of the last token
+    int errors;                    // Characters that start no token
+} Scanner;
+
+// Read the rest of the file; false when it cannot be read
+bool openScanner(Scanner* scanner, FILE* input);
+void closeScanner(Scanner* scanner);
+
+// Next token and its value, like yylex does it (names, types and strings are strdup'ed);
+// 0 at the end of the input
+int scanToken(Scanner* scanner, YYSTYPE* value);
+
+// Name of the implementation that scans the runs
+const char* getScannerKind();
+
+#endif // SCANNER_H
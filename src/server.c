@@ -0,0 +1,438 @@
+#define _GNU_SOURCE                    // struct ucred of SO_PEERCRED
+#include "server.h"
+#include "alloc.h"
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+
+#define SERVER_ERROR 19                // Status when the server cannot be used
+#define REQUEST_HEADER "vypcomp"
+#define REQUEST_MAX_LENGTH (16 << 20)  // Bytes of a request: its directory and arguments
+#define REQUEST_MAX_ARGUMENTS 65536
+#define REQUEST_TIMEOUT 30             // Seconds a child waits for the rest of its request
+
+// A request is "vypcomp <argc>\n", the directory of the client and its arguments, each one
+// ended by a zero byte; no arguments stop the server. The answer is "<status> <stdout length>
+// <stderr length>\n" and the bytes of both streams.
+
+bool getServerDirectory(char* name, size_t size) {
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+    if (runtime && runtime[0] == '/') {
+        snprintf(name, size, "%s/" SERVER_DIRECTORY, runtime);
+    } else {
+        snprintf(name, size, SERVER_FALLBACK_DIRECTORY, (unsigned)getuid());
+    }
+    if (mkdir(name, 0700) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: could not create the server directory %s: %s.\n", name, strerror(errno));
+        return false;
+    }
+    // Anyone can create a name in /tmp first: it has to be a real directory of the user, closed to others
+    struct stat status;
+    if (lstat(name, &status) != 0 || !S_ISDIR(status.st_mode) || status.st_uid != getuid() || (status.st_mode & 077) != 0) {
+        fprintf(stderr, "Error: %s is not a directory that only this user can open.\n", name);
+        return false;
+    }
+    return true;
+}
+
+bool getServerSocket(char* name, size_t size) {
+    const char* environment = getenv(SERVER_ENVIRONMENT);
+    if (environment && environment[0]) {
+        snprintf(name, size, "%s", environment);
+        return true;
+    }
+    char directory[PATH_MAX];
+    if (!getServerDirectory(directory, sizeof(directory))) return false;
+    snprintf(name, size, "%s/" SERVER_SOCKET, directory);
+    return true;
+}
+
+static bool socketAddress(const char* socketName, struct sockaddr_un* address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(socketName) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "Error: the socket name %s is too long.\n", socketName);
+        return false;
+    }
+    strcpy(address->sun_path, socketName);
+    return true;
+}
+
+// Connected socket, -1 when no server listens on it
+static int connectServer(const char* socketName) {
+    struct sockaddr_un address;
+    if (!socketAddress(socketName, &address)) return -1;
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0) return -1;
+    if (connect(connection, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(connection);
+        return -1;
+    }
+    return connection;
+}
+
+static bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+// Everything the other side sends until it shuts its end down, zero terminated; null when it
+// sends more than limit bytes or the read fails (a timeout of the socket too)
+static char* readAll(int fd, size_t limit, size_t* length) {
+    size_t capacity = 4096;
+    char* data = checkedCalloc(capacity, 1, ALLOC_MODULES);
+    *length = 0;
+    for (;;) {
+        if (*length + 1 == capacity) {
+            capacity *= 2;
+            data = checkedRealloc(data, capacity, ALLOC_MODULES);
+        }
+        ssize_t got = read(fd, data + *length, capacity - *length - 1);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 || *length + got > limit) {
+            free(data);
+            return NULL;
+        }
+        if (got == 0) break;
+        *length += got;
+    }
+    data[*length] = '\0';
+    return data;
+}
+
+//Server
+
+// Arguments of a request, pointing into its bytes; null when they are not well formed
+static char** decodeRequest(char* request, size_t length, char** directory, int* argc) {
+    char* end = request + length;
+    char* text = memchr(request, '\n', length);
+    if (!text || sscanf(request, REQUEST_HEADER " %d", argc) != 1 || *argc < 0 || *argc > REQUEST_MAX_ARGUMENTS) {
+        return NULL;
+    }
+    text++;
+
+    char** argv = checkedCalloc(*argc + 2, sizeof(char*), ALLOC_MODULES);
+    for (int a = -1; a < *argc; a++) {
+        char* zero = text < end ? memchr(text, '\0', end - text) : NULL;
+        if (!zero) {
+            free(argv);
+            return NULL;
+        }
+        if (a < 0) *directory = text;
+        else argv[a] = text;
+        text = zero + 1;
+    }
+    return argv;
+}
+
+static void copyStream(FILE* from, FILE* to, long length) {
+    char buffer[4096];
+    while (length > 0) {
+        size_t chunk = length < (long)sizeof(buffer) ? (size_t)length : sizeof(buffer);
+        size_t read = fread(buffer, 1, chunk, from);
+        if (read == 0) break;
+        fwrite(buffer, 1, read, to);
+        length -= read;
+    }
+}
+
+static long streamLength(FILE* stream) {
+    if (!stream) return 0;
+    fflush(stream);
+    fseek(stream, 0, SEEK_END);
+    long length = ftell(stream);
+    rewind(stream);
+    return length;
+}
+
+static void sendAnswer(int connection, int status, FILE* out, FILE* err) {
+    long outLength = streamLength(out);
+    long errLength = streamLength(err);
+    FILE* stream = fdopen(dup(connection), "w");
+    if (!stream) return;
+    fprintf(stream, "%d %ld %ld\n", status, outLength, errLength);
+    if (out) copyStream(out, stream, outLength);
+    if (err) copyStream(err, stream, errLength);
+    fclose(stream);
+}
+
+// Where a request prints, read back for the answer: in memory where the system allows it
+static FILE* openCapture(const char* name) {
+#ifdef MFD_CLOEXEC
+    int fd = memfd_create(name, MFD_CLOEXEC);
+    FILE* capture = fd >= 0 ? fdopen(fd, "w+") : NULL;
+    if (capture) return capture;
+    if (fd >= 0) close(fd);
+#else
+    (void)name;
+#endif
+    return tmpfile();
+}
+
+// Whether the client runs as the user of the server
+static bool samePeer(int connection) {
+#ifdef SO_PEERCRED
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    return getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 && credentials.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(connection, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+// Compile a request in the directory of its client and answer the client
+static void compileRequest(int connection, const char* directory, int argc, char** argv, ServerCompiler compile, void* context) {
+    signal(SIGCHLD, SIG_DFL);              // Batch requests wait for their own workers
+    FILE* out = openCapture("vypcomp-stdout");
+    FILE* err = openCapture("vypcomp-stderr");
+    int status = SERVER_ERROR;
+    if (out && err && directory[0] == '/' && chdir(directory) == 0) {
+        dup2(fileno(out), STDOUT_FILENO);
+        dup2(fileno(err), STDERR_FILENO);
+        setvbuf(stdout, NULL, _IOFBF, 0);
+        status = compile(argc, argv, context);
+        fflush(stdout);
+        fflush(stderr);
+    } else if (err) {
+        fprintf(err, "Error: could not compile in %s.\n", directory);
+    }
+    sendAnswer(connection, status, out, err);
+}
+
+// A child forked before its request arrives, so the fork is not part of the time of a request.
+// It waits on its channel for the connection (passed as SCM_RIGHTS) and reads the request
+// itself, so a slow client only holds its own child; the server closes the channel when the
+// spare has to go. A request to stop is answered by the child, which tells the server through
+// the write end of its stop pipe.
+typedef struct {
+    int channel;                           // -1 without a spare
+} Spare;
+
+static void runSpare(int channel, int stopper, ServerCompiler compile, void* context) {
+    char mark;
+    int connection = -1;
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec vector = {&mark, sizeof(mark)};
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t got;
+    do got = recvmsg(channel, &message, 0);
+    while (got < 0 && errno == EINTR);
+    struct cmsghdr* header = got == sizeof(mark) ? CMSG_FIRSTHDR(&message) : NULL;
+    if (!header || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) _exit(0);
+    memcpy(&connection, CMSG_DATA(header), sizeof(int));
+    close(channel);
+
+    struct timeval timeout = {REQUEST_TIMEOUT, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    size_t length;
+    char* request = readAll(connection, REQUEST_MAX_LENGTH, &length);
+    char* directory = NULL;
+    int argc = 0;
+    char** argv = request ? decodeRequest(request, length, &directory, &argc) : NULL;
+    if (argv && argc == 0) {
+        writeAll(stopper, "", 1);
+        sendAnswer(connection, 0, NULL, NULL);
+    } else if (argv) {
+        compileRequest(connection, directory, argc, argv, compile, context);
+    }
+    _exit(0);
+}
+
+static bool startSpare(Spare* spare, int listener, int stop[2], ServerCompiler compile, void* context) {
+    int channels[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, channels) != 0) return false;
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(listener);
+        close(stop[0]);
+        close(channels[0]);
+        runSpare(channels[1], stop[1], compile, context);
+    }
+    close(channels[1]);
+    if (pid < 0) {
+        close(channels[0]);
+        return false;
+    }
+    spare->channel = channels[0];
+    return true;
+}
+
+// The spare exits when its channel closes without a request
+static void stopSpare(Spare* spare) {
+    if (spare->channel >= 0) close(spare->channel);
+    spare->channel = -1;
+}
+
+// Give the connection to the spare, which reads and answers the request; one per spare
+static bool handConnection(Spare* spare, int connection) {
+    char mark = 0;
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct iovec vector = {&mark, sizeof(mark)};
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &connection, sizeof(int));
+    bool handed = sendmsg(spare->channel, &message, 0) == sizeof(mark);
+    stopSpare(spare);
+    return handed;
+}
+
+// Remove the socket a server left; any other kind of file under its name is not touched
+static bool removeSocket(const char* socketName) {
+    struct stat status;
+    if (lstat(socketName, &status) != 0) return errno == ENOENT;
+    if (!S_ISSOCK(status.st_mode)) {
+        fprintf(stderr, "Error: %s exists and is not a socket.\n", socketName);
+        return false;
+    }
+    return unlink(socketName) == 0 || errno == ENOENT;
+}
+
+int runServer(const char* socketName, ServerCompiler compile, ServerPreparer prepare, void* context, ServerStats* stats) {
+    memset(stats, 0, sizeof(ServerStats));
+    struct sockaddr_un address;
+    if (!socketAddress(socketName, &address)) return SERVER_ERROR;
+
+    int running = connectServer(socketName);
+    if (running >= 0) {
+        close(running);
+        fprintf(stderr, "Error: a server already listens on %s.\n", socketName);
+        return SERVER_ERROR;
+    }
+    if (!removeSocket(socketName)) return SERVER_ERROR;  // Left by a server that did not stop
+
+    int stop[2];
+    if (pipe(stop) != 0) {
+        perror("Error opening the server socket");
+        return SERVER_ERROR;
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        perror("Error opening the server socket");
+        if (listener >= 0) close(listener);
+        close(stop[0]);
+        close(stop[1]);
+        return SERVER_ERROR;
+    }
+    signal(SIGCHLD, SIG_IGN);              // The requests are not waited for
+    signal(SIGPIPE, SIG_IGN);              // A spare that is gone fails its request, not the server
+    printf("Server listening on %s.\n", socketName);
+    fflush(stdout);
+
+    Spare spare = {-1};
+    if (prepare) prepare(context);
+    startSpare(&spare, listener, stop, compile, context);
+    bool stopped = false;
+    while (!stopped) {
+        struct pollfd waiting[2] = {{listener, POLLIN, 0}, {stop[0], POLLIN, 0}};
+        if (poll(waiting, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("Error accepting a request");
+            break;
+        }
+        if (waiting[1].revents) {
+            stopped = true;                // A child answered a request to stop
+            continue;
+        }
+        int connection = accept(listener, NULL, NULL);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("Error accepting a request");
+            break;
+        }
+
+        if (!samePeer(connection)) {
+            fprintf(stderr, "Warning: a connection of another user was refused.\n");
+            stats->rejected++;
+            close(connection);
+            continue;
+        }
+
+        // A spare forked before prepare loaded something would start without it
+        if (prepare && prepare(context)) stopSpare(&spare);
+        if (spare.channel < 0) startSpare(&spare, listener, stop, compile, context);
+        if (spare.channel >= 0 && handConnection(&spare, connection)) stats->requests++;
+        else stats->failed++;
+        close(connection);
+
+        // Without the connection: the client waits for every copy of it to close
+        if (spare.channel < 0) startSpare(&spare, listener, stop, compile, context);
+    }
+
+    stopSpare(&spare);
+    close(listener);
+    close(stop[0]);
+    close(stop[1]);
+    removeSocket(socketName);
+    return stopped ? 0 : SERVER_ERROR;
+}
+
+//Client
+
+int requestCompilation(const char* socketName, int argc, char** argv) {
+    int connection = connectServer(socketName);
+    if (connection < 0) {
+        fprintf(stderr, "Error: no vypcomp server listens on %s.\n", socketName);
+        return SERVER_ERROR;
+    }
+
+    char directory[PATH_MAX];
+    char header[32];
+    bool sent = getcwd(directory, sizeof(directory)) != NULL;
+    snprintf(header, sizeof(header), REQUEST_HEADER " %d\n", argc);
+    sent = sent && writeAll(connection, header, strlen(header));
+    sent = sent && writeAll(connection, directory, strlen(directory) + 1);
+    for (int a = 0; sent && a < argc; a++) sent = writeAll(connection, argv[a], strlen(argv[a]) + 1);
+    shutdown(connection, SHUT_WR);
+
+    FILE* answer = fdopen(connection, "r");
+    int status;
+    long outLength, errLength;
+    if (!sent || !answer || fscanf(answer, "%d %ld %ld", &status, &outLength, &errLength) != 3 ||
+        fgetc(answer) != '\n') {
+        fprintf(stderr, "Error: the server at %s did not answer.\n", socketName);
+        if (answer) fclose(answer);
+        else close(connection);
+        return SERVER_ERROR;
+    }
+    copyStream(answer, stdout, outLength);
+    copyStream(answer, stderr, errLength);
+    fclose(answer);
+    return status;
+}
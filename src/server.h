@@ -0,0 +1,49 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// The server and its socket live in a directory only the user can open: vypcomp in
+// $XDG_RUNTIME_DIR, or /tmp/vypcomp-<uid> without one. VYPCOMP_SERVER names another socket.
+#define SERVER_DIRECTORY "vypcomp"
+#define SERVER_FALLBACK_DIRECTORY "/tmp/vypcomp-%u"
+#define SERVER_SOCKET "server.sock"
+#define SERVER_ENVIRONMENT "VYPCOMP_SERVER"
+
+// Totals of a server run
+typedef struct {
+    int requests;                  // Connections handed to a child
+    int failed;                    // Connections that could not be handed to a child
+    int rejected;                  // Connections of other users
+} ServerStats;
+
+// Run one request, with the arguments of vypcomp, and return its exit status
+typedef int (*ServerCompiler)(int argc, char** argv, void* context);
+
+// Run in the server before each request is handed to a child, so what it loads is kept by the
+// server and inherited by the child of every request after it; true when it loaded something
+typedef bool (*ServerPreparer)(void* context);
+
+// Directory of the server of the user, created if missing; false, with the problem in stderr,
+// when it is not a directory of the user that only they can use
+bool getServerDirectory(char* name, size_t size);
+
+// Socket of VYPCOMP_SERVER, or the one of the directory of the server; false when there is none
+bool getServerSocket(char* name, size_t size);
+
+// Listen on the socket until a client stops the server. Only clients of the user of the server
+// are answered. The child of a connection reads its request, so the server never waits for a
+// client. Every request runs in a child of the server in the directory of its client, so
+// it starts with the compiler and whatever prepare loaded, and with the front end clean; what it
+// prints into stdout and stderr goes back to the client with its status. The child of the next
+// request is forked while the current one runs. Returns 0 when stopped, 19 when the socket
+// cannot be opened or its name is taken by a file that is not a socket.
+int runServer(const char* socketName, ServerCompiler compile, ServerPreparer prepare, void* context, ServerStats* stats);
+
+// Client side: run the arguments of vypcomp on the server, with the output of the compilation
+// in stdout and stderr. Without arguments the server stops. Returns the exit status of the
+// compilation, 19 when the server cannot be reached.
+int requestCompilation(const char* socketName, int argc, char** argv);
+
+#endif // SERVER_H
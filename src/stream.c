@@ -0,0 +1,230 @@
+#include "stream.h"
+#include "alloc.h"
+#include "semantic_analysis.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Parser and lexer state (the parser has no context, so the units come in through a hook)
+extern int yyparse();
+extern FILE* yyin;
+extern int lexical_error;
+extern SymbolTable symbol_table;
+extern void yyrestart(FILE* file);
+
+typedef struct {
+    ASTProgramNode* program;       // Signatures of the first parse
+    SymbolTable signatures;        // Symbols of the whole file, from the first parse
+    ASTNode** units;               // Classes and then functions of program
+    int unit_count;
+    int class_count;
+    int next_class;                // Units the second parse completed so far
+    int next_function;
+    bool* lowered;                 // Units for buildIR, only the one being compiled is set
+    IRProgram* frame;              // Program without functions, for the code around them
+    FILE* out;
+    int peepholeWindow;
+    StreamStats* stats;
+    int status;                    // First error of the second parse
+} StreamCompiler;
+
+static StreamCompiler* active;
+
+static int parseInput(FILE* input) {
+    yyin = input;
+    yyrestart(input);
+    lexical_error = 0;
+    root = NULL;
+    init_symbol_table(&symbol_table);
+
+    int parseResult = yyparse();
+    if (lexical_error) {
+        fprintf(stderr, "Error during lexical analysis.\n");
+        return 11;
+    }
+    if (parseResult != 0) {
+        fprintf(stderr, "Error during syntactic analysis.\n");
+        return 12;
+    }
+    if (!root) {
+        fprintf(stderr, "Error: AST root is NULL.\n");
+        return 19;
+    }
+    return 0;
+}
+
+//Pieces of code
+
+// Optimize and write one piece; the first one starts the file with the header
+static int writePiece(StreamCompiler* stream, VCProgram* code, bool first) {
+    PeepholeStats peephole;
+    runPeephole(code, stream->peepholeWindow, &peephole);
+    addPeepholeStats(&stream->stats->peephole, &peephole);
+    int writeResult = first ? writeVYPcode(code, stream->out) : writeVYPcodeInstructions(code, stream->out);
+    freeVCProgram(code);
+    if (writeResult != 0) {
+        fprintf(stderr, "Error writing the target code.\n");
+        return 19;
+    }
+    return 0;
+}
+
+static void addPassStats(StreamStats* stats, EscapeStats* escape, TailCallStats* tails, LoopStats* loops) {
+    stats->escape.allocations += escape->allocations;
+    stats->escape.replaced += escape->replaced;
+    stats->escape.scalars += escape->scalars;
+    stats->tails.tail_calls += tails->tail_calls;
+    stats->tails.self_calls += tails->self_calls;
+    stats->tails.accumulators += tails->accumulators;
+    stats->loops.loop_count += loops->loop_count;
+    stats->loops.hoisted += loops->hoisted;
+    stats->loops.reduced += loops->reduced;
+}
+
+// The unit is in the program in the place of its signature
+static int compileUnitCode(StreamCompiler* stream, int index) {
+    setAllocPhase(ALLOC_PHASE_IR);
+    stream->lowered[index] = true;
+    IRProgram* ir = buildIR((ASTNode*)stream->program, &stream->signatures, stream->lowered);
+    stream->lowered[index] = false;
+    if (!ir) {
+        fprintf(stderr, "Error during code generation.\n");
+        return 15;
+    }
+
+    EscapeStats escape;
+    TailCallStats tails;
+    LoopStats loops;
+    setAllocPhase(ALLOC_PHASE_OPTIMIZE);
+    replaceLocalObjects(ir, &escape);
+    optimizeTailCalls(ir, &tails);
+    optimizeLoops(ir, &loops);
+    addPassStats(stream->stats, &escape, &tails, &loops);
+
+    setAllocPhase(ALLOC_PHASE_CODEGEN);
+    int status = 0;
+    for (IRFunction* function = ir->functions; function && status == 0; function = function->next) {
+        VCProgram* code = generateFunctionVYPcode(ir, function, &stream->stats->codegen);
+        if (!code) {
+            fprintf(stderr, "Error during code generation.\n");
+            status = 15;
+        } else {
+            status = writePiece(stream, code, false);
+            stream->stats->functions++;
+        }
+    }
+    freeIRProgram(ir);
+    setAllocPhase(ALLOC_PHASE_PARSE);
+    return status;
+}
+
+//Parser hooks
+
+// First parse: only the signatures stay
+static bool keepSignature(ASTNode* unit) {
+    if (unit->type == AST_FUNCTION) {
+        freeAST(((ASTFunctionNode*)unit)->body);
+        ((ASTFunctionNode*)unit)->body = NULL;
+    } else if (unit->type == AST_CLASS) {
+        for (ASTNode* member = ((ASTClassNode*)unit)->members; member; member = member->next) {
+            if (member->type != AST_FUNCTION) continue;
+            freeAST(((ASTFunctionNode*)member)->body);
+            ((ASTFunctionNode*)member)->body = NULL;
+        }
+    }
+    return false;
+}
+
+// Link of the program that points at the signature of a unit
+static ASTNode** unitLink(StreamCompiler* stream, int index) {
+    if (index == 0 && stream->class_count > 0) return &stream->program->classes;
+    if (index == stream->class_count) return &stream->program->functions;
+    return &stream->units[index - 1]->next;
+}
+
+// Second parse: compile the unit and free it
+static bool compileUnit(ASTNode* unit) {
+    StreamCompiler* stream = active;
+    int index = unit->type == AST_CLASS ? stream->next_class++ : stream->class_count + stream->next_function++;
+    if (stream->status == 0 && index < stream->unit_count) {
+        setAllocPhase(ALLOC_PHASE_SEMANTIC);
+        if (performSemanticAnalysis(unit, &stream->signatures) != 0) {
+            fprintf(stderr, "Semantic analysis failed.\n");
+            stream->status = 13;
+            freeAST(unit);
+            return true;
+        }
+
+        ASTNode* signature = stream->units[index];
+        ASTNode** link = unitLink(stream, index);
+        *link = unit;
+        unit->next = signature->next;
+        stream->status = compileUnitCode(stream, index);
+        *link = signature;
+        unit->next = NULL;
+        stream->stats->units++;
+    }
+    freeAST(unit);
+    return true;
+}
+
+//Driver
+
+static int compileUnits(StreamCompiler* stream, FILE* input) {
+    // First parse: signatures and symbols of the whole file
+    unit_parsed = keepSignature;
+    int status = parseInput(input);
+    if (status != 0) return status;
+    stream->program = (ASTProgramNode*)root;
+    stream->signatures = symbol_table;
+
+    for (ASTNode* node = stream->program->classes; node; node = node->next) stream->class_count++;
+    stream->unit_count = stream->class_count;
+    for (ASTNode* node = stream->program->functions; node; node = node->next) stream->unit_count++;
+    stream->units = checkedCalloc(stream->unit_count, sizeof(ASTNode*), ALLOC_MODULES);
+    stream->lowered = checkedCalloc(stream->unit_count, sizeof(bool), ALLOC_MODULES);
+    int unit = 0;
+    for (ASTNode* node = stream->program->classes; node; node = node->next) stream->units[unit++] = node;
+    for (ASTNode* node = stream->program->functions; node; node = node->next) stream->units[unit++] = node;
+
+    // The vtables, the entry and the routines only need the signatures
+    setAllocPhase(ALLOC_PHASE_IR);
+    stream->frame = buildIR((ASTNode*)stream->program, &stream->signatures, stream->lowered);
+    if (!stream->frame) {
+        fprintf(stderr, "Error during code generation.\n");
+        return 15;
+    }
+    status = writePiece(stream, generateEntryVYPcode(stream->frame), true);
+    if (status != 0) return status;
+
+    // Second parse: every unit is compiled as soon as it is complete
+    setAllocPhase(ALLOC_PHASE_PARSE);
+    rewind(input);
+    unit_parsed = compileUnit;
+    status = parseInput(input);
+    freeAST(root);
+    root = NULL;
+    if (status == 0) status = stream->status;
+    if (status == 0) status = writePiece(stream, generateRoutinesVYPcode(stream->frame), false);
+    return status;
+}
+
+int compileStreaming(FILE* input, FILE* output, int peepholeWindow, StreamStats* stats) {
+    memset(stats, 0, sizeof(StreamStats));
+    stats->peephole.window = peepholeWindow;
+    StreamCompiler stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.out = output;
+    stream.peepholeWindow = peepholeWindow;
+    stream.stats = stats;
+    active = &stream;
+
+    int status = compileUnits(&stream, input);
+
+    unit_parsed = NULL;
+    active = NULL;
+    freeIRProgram(stream.frame);
+    freeAST((ASTNode*)stream.program);
+    compilerFree(stream.units);
+    compilerFree(stream.lowered);
+    return status;
+}
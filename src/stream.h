@@ -0,0 +1,30 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdio.h>
+#include "escape.h"
+#include "tailcalls.h"
+#include "loops.h"
+#include "codegen.h"
+#include "peephole.h"
+
+// Totals of a streaming compilation
+typedef struct {
+    int units;                     // Top-level classes and functions compiled one at a time
+    int functions;                 // Functions and methods written
+    EscapeStats escape;
+    TailCallStats tails;
+    LoopStats loops;
+    CodegenStats codegen;
+    PeepholeStats peephole;
+} StreamStats;
+
+// Compile the file one top-level class or function at a time into VYPcode text. A first parse
+// keeps only the signatures (members and parameters, without the bodies) and the symbols of the
+// whole file. A second parse hands every unit to the analysis, the IR passes, the code generator
+// and the peephole optimizer as soon as it is complete, writes its code and frees it, so memory
+// follows the largest unit instead of the file. Calls into other units are treated as unknown
+// code by the loop optimizer. Returns the exit status of vypcomp.
+int compileStreaming(FILE* input, FILE* output, int peepholeWindow, StreamStats* stats);
+
+#endif // STREAM_H
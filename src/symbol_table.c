@@ -1,5 +1,6 @@
 #include "ast.h"
 #include "symbol_table.h"
+#include "alloc.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -23,8 +24,8 @@ int add_symbol(SymbolTable* table, const char* name, const char* type, bool is_f
     }
 
     Symbol new_symbol;
-    new_symbol.name = strdup(name);
-    new_symbol.type = strdup(type);
+    new_symbol.name = compilerStrdup(name, ALLOC_SYMBOLS);
+    new_symbol.type = compilerStrdup(type, ALLOC_SYMBOLS);
     new_symbol.defined = false;  // Initially not defined
     new_symbol.is_function = is_function;
     new_symbol.is_class = is_class;
@@ -39,7 +40,7 @@ int add_symbol(SymbolTable* table, const char* name, const char* type, bool is_f
 
         new_symbol.class.attributes = attributes;
         new_symbol.class.attr_count = attr_count;
-	new_symbol.class.parentClass = parentClass ? strdup(parentClass) : NULL;
+	new_symbol.class.parentClass = parentClass ? compilerStrdup(parentClass, ALLOC_SYMBOLS) : NULL;
     }
 
     table->symbols[table->symbol_count++] = new_symbol;
@@ -103,14 +104,14 @@ void print_symbol_table(SymbolTable* table) {
 
 void free_symbol_table(SymbolTable* table) {
     for (int i = 0; i < table->symbol_count; i++) {
-        free(table->symbols[i].name);  // Release symbol name
+        compilerFree(table->symbols[i].name);  // Release symbol name
         // If you use dynamic memory for other fields, also free them here
     }
     table->symbol_count = 0;  // Reset the accountant
 }
 
 char** extractAttributesFromClassBody(ASTNode* class_body) {
-    char** attributes = malloc(MAX_ATTRIBUTES * sizeof(char*));
+    char** attributes = compilerMalloc(MAX_ATTRIBUTES * sizeof(char*), ALLOC_MEMBER_LISTS);
     int count = 0;
 
     ASTNode* current = class_body;
@@ -119,7 +120,7 @@ char** extractAttributesFromClassBody(ASTNode* class_body) {
             ASTDeclarationNode* decl = (ASTDeclarationNode*)current;
 
             // Create a chain with the format "Name: Type"
-            char* attributeEntry = malloc(strlen(decl->name) + strlen(decl->type) + 2); // ':' y '\0'
+            char* attributeEntry = compilerMalloc(strlen(decl->name) + strlen(decl->type) + 2, ALLOC_MEMBER_LISTS); // ':' y '\0'
             sprintf(attributeEntry, "%s:%s", decl->name, decl->type);
 
             attributes[count++] = attributeEntry; // Add to the attributes list
@@ -131,20 +132,36 @@ char** extractAttributesFromClassBody(ASTNode* class_body) {
 
 
 char** extractMethodsFromClassBody(ASTNode* class_body) {
-    char** methods = malloc(MAX_METHODS * sizeof(char*));
+    char** methods = compilerMalloc(MAX_METHODS * sizeof(char*), ALLOC_MEMBER_LISTS);
     int count = 0;
 
     ASTNode* current = class_body;
     while (current) {
         if (current->type == AST_FUNCTION) {
             ASTFunctionNode* func = (ASTFunctionNode*)current;
-            methods[count++] = strdup(func->name);
+            methods[count++] = compilerStrdup(func->name, ALLOC_MEMBER_LISTS);
         }
         current = current->next;
     }
     return methods;
 }
 
+char** extractParameterTypes(ASTNode* parameters) {
+    int count = 0;
+    for (ASTNode* current = parameters; current; current = current->next) {
+        count++;
+    }
+
+    char** types = compilerMalloc((count + 1) * sizeof(char*), ALLOC_MEMBER_LISTS);
+    int index = 0;
+    for (ASTNode* current = parameters; current; current = current->next) {
+        ASTDeclarationNode* param = (ASTDeclarationNode*)current;
+        types[index++] = compilerStrdup(param->type, ALLOC_MEMBER_LISTS);  // Only the type is needed to check calls
+    }
+    types[index] = NULL;
+    return types;
+}
+
 int countAttributes(ASTNode* class_body) {
     int count = 0;
     ASTNode* current = class_body;
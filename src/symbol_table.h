@@ -51,6 +51,7 @@ void print_symbol_table(SymbolTable* table);
 void free_symbol_table(SymbolTable* table);
 char** extractAttributesFromClassBody(ASTNode* class_body);
 char** extractMethodsFromClassBody(ASTNode* class_body);
+char** extractParameterTypes(ASTNode* parameters);
 int countAttributes(ASTNode* class_body);
 int countMethods(ASTNode* class_body);
 const char* getMemberType(const char* className, const char* memberName, SymbolTable* symbolTable);
@@ -0,0 +1,217 @@
+#include "tailcalls.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_TAIL_PATH 64           // Instructions followed from a call to the return of its result
+
+// What happens to the result of a call until the function returns it
+typedef struct {
+    IRInstr* call;
+    IRInstr* ret;                  // Return that gives the result back
+    IROpcode combine;              // IR_ADD or IR_MUL applied on the way, IR_MOVE if none
+    int other;                     // Operand of the combination that does not come from the call
+    bool self;                     // The call can only run the function itself
+} TailPath;
+
+static IRInstr* findLabel(IRFunction* function, long label) {
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        if (instr->op == IR_LABEL && instr->imm == label) return instr;
+    }
+    return NULL;
+}
+
+// Code after a jump or a return can only be reached through a label
+static void removeDeadCode(IRFunction* function, IRInstr* terminator) {
+    while (terminator->next && terminator->next->op != IR_LABEL) {
+        IRInstr* dead = terminator->next;
+        removeIRInstr(function, dead);
+        freeIRInstr(dead);
+    }
+}
+
+//Tail positions
+
+// Follow the result of a call through moves, labels and jumps to the return that gives it back.
+// One addition or multiplication by a value computed before the call is also accepted, an
+// accumulator can take it when the call is recursive.
+static bool findTailPath(IRFunction* function, IRInstr* call, TailPath* path) {
+    bool* tracked = checkedCalloc(function->value_count, sizeof(bool), ALLOC_ANALYSIS);
+    if (call->dst >= 0) tracked[call->dst] = true;
+    path->call = call;
+    path->ret = NULL;
+    path->combine = IR_MOVE;
+    path->other = -1;
+    path->self = false;
+
+    IRInstr* instr = call->next;
+    for (int steps = 0; instr && steps < MAX_TAIL_PATH; steps++) {
+        IRInstr* next = instr->next;
+        if (instr->op == IR_RETURN) {
+            if (instr->src1 < 0 || tracked[instr->src1]) path->ret = instr;
+            break;
+        } else if (instr->op == IR_JUMP) {
+            next = findLabel(function, instr->imm);
+        } else if (instr->op == IR_MOVE && tracked[instr->src1]) {
+            tracked[instr->dst] = true;
+        } else if ((instr->op == IR_ADD || instr->op == IR_MUL) && path->combine == IR_MOVE &&
+                   tracked[instr->src1] != tracked[instr->src2]) {
+            // Only results of the call were written since it, so the other operand still has its value
+            path->combine = instr->op;
+            path->other = tracked[instr->src1] ? instr->src2 : instr->src1;
+            memset(tracked, 0, function->value_count * sizeof(bool));
+            tracked[instr->dst] = true;
+        } else if (instr->op != IR_LABEL) {
+            break;
+        }
+        instr = next;
+    }
+    compilerFree(tracked);
+    return path->ret != NULL;
+}
+
+// A call that can only run the function itself, a method can be replaced by an override
+static bool isSelfCall(IRProgram* program, IRFunction* function, IRInstr* call) {
+    if (strcmp(call->name, function->name) != 0 || call->arg_count != function->param_count) return false;
+    if (call->op != IR_CALL_METHOD || !function->className) return true;
+    return !isIRMethodOverridden(program, function->className, strchr(function->name, '.') + 1);
+}
+
+//Rewrites
+
+// params = args; goto start. An argument is copied first when a previous assignment would
+// overwrite the parameter it reads.
+static void replaceSelfCall(IRFunction* function, TailPath* path, int* params, int start, int acc) {
+    IRInstr* call = path->call;
+    int count = call->arg_count;
+
+    if (path->combine != IR_MOVE) {
+        insertIRInstrBefore(function, call, createIRInstr(path->combine, acc, acc, path->other));
+    }
+
+    int* sources = checkedCalloc(count, sizeof(int), ALLOC_ANALYSIS);
+    for (int i = 0; i < count; i++) {
+        sources[i] = call->args[i];
+        for (int j = 0; j < i; j++) {
+            if (call->args[i] != params[j] || call->args[j] == params[j]) continue;
+            IRValue* param = &function->values[params[j]];
+            sources[i] = newIRValue(function, param->type, param->className, NULL);
+            insertIRInstrBefore(function, call, createIRInstr(IR_MOVE, sources[i], call->args[i], -1));
+            break;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (sources[i] != params[i]) {
+            insertIRInstrBefore(function, call, createIRInstr(IR_MOVE, params[i], sources[i], -1));
+        }
+    }
+    compilerFree(sources);
+
+    IRInstr* jump = createIRInstr(IR_JUMP, -1, -1, -1);
+    jump->imm = start;
+    insertIRInstrBefore(function, call, jump);
+    removeIRInstr(function, call);
+    freeIRInstr(call);
+    removeDeadCode(function, jump);
+}
+
+// Leave the return right after the call, where the back end turns both into a jump
+static void moveReturnToCall(IRFunction* function, TailPath* path) {
+    IRInstr* call = path->call;
+    if (call->next == path->ret && (path->ret->src1 < 0 || path->ret->src1 == call->dst)) return;
+
+    IRInstr* ret = createIRInstr(IR_RETURN, -1, path->ret->src1 >= 0 ? call->dst : -1, -1);
+    if (call->next) {
+        insertIRInstrBefore(function, call->next, ret);
+    } else {
+        appendIRInstr(function, ret);
+    }
+    removeDeadCode(function, ret);
+}
+
+// Every return multiplies (or adds) its result by what the removed calls still had to apply
+static void accumulateReturns(IRFunction* function, IROpcode combine, int acc) {
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        if (instr->op != IR_RETURN || instr->src1 < 0) continue;
+        int result = newIRValue(function, IR_TYPE_INT, NULL, NULL);
+        insertIRInstrBefore(function, instr, createIRInstr(combine, result, acc, instr->src1));
+        instr->src1 = result;
+    }
+}
+
+static void optimizeFunction(IRProgram* program, IRFunction* function, TailCallStats* stats) {
+    // Without dead code, what follows a call up to the next label is only reached through the call
+    int call_count = 0;
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        if (instr->op == IR_JUMP || instr->op == IR_RETURN) removeDeadCode(function, instr);
+        if (instr->op == IR_CALL || instr->op == IR_CALL_METHOD) call_count++;
+    }
+    TailPath* paths = checkedCalloc(call_count, sizeof(TailPath), ALLOC_ANALYSIS);
+    int path_count = 0;
+    int self_count = 0;
+    IROpcode accumulate = IR_MOVE;
+
+    // All the paths are found before any rewrite, the rewrites only remove code after a call
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        if (instr->op != IR_CALL && instr->op != IR_CALL_METHOD) continue;
+        TailPath path;
+        if (!findTailPath(function, instr, &path)) continue;
+        path.self = isSelfCall(program, function, instr);
+        if (path.self && path.combine != IR_MOVE) {
+            // A single accumulator, the recursions with the other operation stay as calls
+            if (accumulate == IR_MOVE) accumulate = path.combine;
+            if (path.combine != accumulate) continue;
+        } else if (!path.self && (path.combine != IR_MOVE || instr->arg_count != function->param_count)) {
+            continue;                                  // The callee could not reuse the frame
+        }
+        if (path.self) self_count++;
+        paths[path_count++] = path;
+    }
+
+    int start = -1;
+    int acc = -1;
+    if (self_count > 0) {
+        // The loop starts before the declarations, which set the locals to their default values again
+        IRInstr* first = function->first;
+        if (accumulate != IR_MOVE) {
+            acc = newIRValue(function, IR_TYPE_INT, NULL, NULL);
+            IRInstr* init = createIRInstr(IR_CONST_INT, acc, -1, -1);
+            init->imm = accumulate == IR_MUL ? 1 : 0;
+            insertIRInstrBefore(function, first, init);
+            accumulateReturns(function, accumulate, acc);
+            stats->accumulators++;
+        }
+        start = newIRLabel(function);
+        IRInstr* label = createIRInstr(IR_LABEL, -1, -1, -1);
+        label->imm = start;
+        insertIRInstrBefore(function, first, label);
+    }
+
+    int* params = checkedCalloc(function->param_count, sizeof(int), ALLOC_ANALYSIS);
+    for (int v = 0; v < function->value_count; v++) {
+        if (function->values[v].paramIndex >= 0) params[function->values[v].paramIndex] = v;
+    }
+
+    for (int p = 0; p < path_count; p++) {
+        if (paths[p].self) {
+            replaceSelfCall(function, &paths[p], params, start, acc);
+            stats->self_calls++;
+        } else if (acc < 0) {
+            // With an accumulator the returns do more than passing the result on
+            moveReturnToCall(function, &paths[p]);
+            stats->tail_calls++;
+        }
+    }
+    compilerFree(params);
+    compilerFree(paths);
+}
+
+void optimizeTailCalls(IRProgram* program, TailCallStats* stats) {
+    stats->tail_calls = 0;
+    stats->self_calls = 0;
+    stats->accumulators = 0;
+    for (IRFunction* function = program->functions; function; function = function->next) {
+        optimizeFunction(program, function, stats);
+    }
+}
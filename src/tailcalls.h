@@ -0,0 +1,16 @@
+#ifndef TAILCALLS_H
+#define TAILCALLS_H
+
+#include "ir.h"
+
+// Totals of the tail call optimizations over the whole program
+typedef struct {
+    int tail_calls;                // Calls left right before the return of their result (become jumps)
+    int self_calls;                // Self-recursive calls turned into jumps to the start of the function
+    int accumulators;              // Functions whose recursion got an accumulator
+} TailCallStats;
+
+// Turn tail recursion into loops and mark the rest of the tail calls for the back end
+void optimizeTailCalls(IRProgram* program, TailCallStats* stats);
+
+#endif // TAILCALLS_H
@@ -0,0 +1,14 @@
+#include <string.h>
+#include <stdio.h>
+#include "server.h"
+
+// Takes the arguments of vypcomp and runs them on vypcomp --server, so build scripts can call
+// it instead of vypcomp. The socket is the one of VYPCOMP_SERVER or the one of the server directory.
+int main(int argc, char** argv) {
+    char socketName[256];
+    if (!getServerSocket(socketName, sizeof(socketName))) return 19;
+    if (argc > 1 && strcmp(argv[1], "--stop") == 0) {
+        return requestCompilation(socketName, 0, NULL);
+    }
+    return requestCompilation(socketName, argc, argv);
+}
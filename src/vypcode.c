@@ -0,0 +1,381 @@
+#include "vypcode.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+//Operands
+
+VCOperand vcReg(int reg) {
+    VCOperand operand = {VC_REG, reg, 0, NULL};
+    return operand;
+}
+
+VCOperand vcStack(int reg, long offset) {
+    VCOperand operand = {VC_STACK, reg, offset, NULL};
+    return operand;
+}
+
+VCOperand vcAbsolute(long address) {
+    VCOperand operand = {VC_STACK, VC_REG_NONE, address, NULL};
+    return operand;
+}
+
+VCOperand vcImm(long value) {
+    VCOperand operand = {VC_IMM, 0, value, NULL};
+    return operand;
+}
+
+VCOperand vcStr(const char* text) {
+    VCOperand operand = {VC_STR, 0, 0, compilerStrdup(text, ALLOC_CODE)};
+    return operand;
+}
+
+VCOperand vcLabel(const char* name) {
+    VCOperand operand = {VC_LABEL_REF, 0, 0, compilerStrdup(name, ALLOC_CODE)};
+    return operand;
+}
+
+bool sameVCOperand(VCOperand a, VCOperand b) {
+    if (a.kind != b.kind) return false;
+    switch (a.kind) {
+        case VC_NONE: return true;
+        case VC_REG: return a.reg == b.reg;
+        case VC_STACK: return a.reg == b.reg && a.value == b.value;
+        case VC_IMM: return a.value == b.value;
+        case VC_STR:
+        case VC_LABEL_REF: return strcmp(a.text, b.text) == 0;
+    }
+    return false;
+}
+
+//Instruction stream
+
+VCProgram* createVCProgram() {
+    VCProgram* program = (VCProgram*)checkedMalloc(sizeof(VCProgram), ALLOC_CODE);
+    program->code = NULL;
+    program->count = 0;
+    program->capacity = 0;
+    return program;
+}
+
+void emitVC(VCProgram* program, VCOpcode op, int operand_count, VCOperand a, VCOperand b, VCOperand c) {
+    if (program->count == program->capacity) {
+        program->capacity = program->capacity ? program->capacity * 2 : 256;
+        program->code = checkedRealloc(program->code, program->capacity * sizeof(VCInstr), ALLOC_CODE);
+    }
+    VCInstr* instr = &program->code[program->count++];
+    instr->op = op;
+    instr->operand_count = operand_count;
+    instr->operands[0] = a;
+    instr->operands[1] = b;
+    instr->operands[2] = c;
+}
+
+static const VCOperand noOperand = {VC_NONE, 0, 0, NULL};
+
+void appendVCProgram(VCProgram* program, VCProgram* from) {
+    for (int i = 0; i < from->count; i++) {
+        VCInstr* instr = &from->code[i];
+        emitVC(program, instr->op, instr->operand_count, instr->operands[0], instr->operands[1], instr->operands[2]);
+    }
+    compilerFree(from->code);
+    compilerFree(from);
+}
+
+void emitVC0(VCProgram* program, VCOpcode op) {
+    emitVC(program, op, 0, noOperand, noOperand, noOperand);
+}
+
+void emitVC1(VCProgram* program, VCOpcode op, VCOperand a) {
+    emitVC(program, op, 1, a, noOperand, noOperand);
+}
+
+void emitVC2(VCProgram* program, VCOpcode op, VCOperand a, VCOperand b) {
+    emitVC(program, op, 2, a, b, noOperand);
+}
+
+void emitVC3(VCProgram* program, VCOpcode op, VCOperand a, VCOperand b, VCOperand c) {
+    emitVC(program, op, 3, a, b, c);
+}
+
+//Text output
+
+const char* getVCOpcodeName(VCOpcode op) {
+    switch (op) {
+        case VC_LABEL: return "LABEL";
+        case VC_CREATE: return "CREATE";
+        case VC_COPY: return "COPY";
+        case VC_GETSIZE: return "GETSIZE";
+        case VC_GETWORD: return "GETWORD";
+        case VC_RESIZE: return "RESIZE";
+        case VC_SETWORD: return "SETWORD";
+        case VC_DESTROY: return "DESTROY";
+        case VC_CALL: return "CALL";
+        case VC_RETURN: return "RETURN";
+        case VC_SET: return "SET";
+        case VC_JUMP: return "JUMP";
+        case VC_JUMPZ: return "JUMPZ";
+        case VC_JUMPNZ: return "JUMPNZ";
+        case VC_READS: return "READS";
+        case VC_WRITES: return "WRITES";
+        case VC_READI: return "READI";
+        case VC_WRITEI: return "WRITEI";
+        case VC_ADDI: return "ADDI";
+        case VC_SUBI: return "SUBI";
+        case VC_MULI: return "MULI";
+        case VC_DIVI: return "DIVI";
+        case VC_LTI: return "LTI";
+        case VC_GTI: return "GTI";
+        case VC_EQI: return "EQI";
+        case VC_LTS: return "LTS";
+        case VC_GTS: return "GTS";
+        case VC_EQS: return "EQS";
+        case VC_AND: return "AND";
+        case VC_OR: return "OR";
+        case VC_NOT: return "NOT";
+        case VC_INT2STRING: return "INT2STRING";
+        default: return "UNKNOWN";
+    }
+}
+
+VCOpcode findVCOpcode(const char* name) {
+    for (int op = 0; op < VC_OPCODE_COUNT; op++) {
+        if (strcmp(getVCOpcodeName((VCOpcode)op), name) == 0) return (VCOpcode)op;
+    }
+    return VC_OPCODE_COUNT;
+}
+
+static const int operandCounts[VC_OPCODE_COUNT] = {
+    [VC_LABEL] = 1, [VC_CREATE] = 2, [VC_COPY] = 2, [VC_GETSIZE] = 2, [VC_GETWORD] = 3,
+    [VC_RESIZE] = 2, [VC_SETWORD] = 3, [VC_DESTROY] = 1, [VC_CALL] = 2, [VC_RETURN] = 1,
+    [VC_SET] = 2, [VC_JUMP] = 1, [VC_JUMPZ] = 2, [VC_JUMPNZ] = 2, [VC_READS] = 1,
+    [VC_WRITES] = 1, [VC_READI] = 1, [VC_WRITEI] = 1, [VC_ADDI] = 3, [VC_SUBI] = 3,
+    [VC_MULI] = 3, [VC_DIVI] = 3, [VC_LTI] = 3, [VC_GTI] = 3, [VC_EQI] = 3, [VC_LTS] = 3,
+    [VC_GTS] = 3, [VC_EQS] = 3, [VC_AND] = 3, [VC_OR] = 3, [VC_NOT] = 2, [VC_INT2STRING] = 2,
+};
+
+int getVCOperandCount(VCOpcode op) {
+    return op < VC_OPCODE_COUNT ? operandCounts[op] : 0;
+}
+
+static void writeRegister(int reg, FILE* out) {
+    if (reg == VC_REG_SP) {
+        fprintf(out, "$SP");
+    } else {
+        fprintf(out, "$%d", reg);
+    }
+}
+
+void writeVCOperand(VCOperand operand, FILE* out) {
+    switch (operand.kind) {
+        case VC_NONE:
+            break;
+        case VC_REG:
+            writeRegister(operand.reg, out);
+            break;
+        case VC_STACK:
+            fprintf(out, "[");
+            if (operand.reg == VC_REG_NONE) {
+                fprintf(out, "%ld", operand.value);
+            } else {
+                writeRegister(operand.reg, out);
+                if (operand.value > 0) fprintf(out, "+%ld", operand.value);
+                if (operand.value < 0) fprintf(out, "%ld", operand.value);
+            }
+            fprintf(out, "]");
+            break;
+        case VC_IMM:
+            fprintf(out, "%ld", operand.value);
+            break;
+        case VC_STR:
+            fprintf(out, "\"%s\"", operand.text); // VYPlanguage escapes are valid VYPcode escapes
+            break;
+        case VC_LABEL_REF:
+            fprintf(out, "%s", operand.text);
+            break;
+    }
+}
+
+int writeVYPcode(VCProgram* program, FILE* out) {
+    fprintf(out, "#! /bin/vypint\n");
+    fprintf(out, "# VYPcode: 1.0\n");
+    fprintf(out, "# Generated by: xlopezp00\n");
+    return writeVYPcodeInstructions(program, out);
+}
+
+int writeVYPcodeInstructions(VCProgram* program, FILE* out) {
+    for (int i = 0; i < program->count; i++) {
+        VCInstr* instr = &program->code[i];
+        if (instr->op != VC_LABEL) fprintf(out, "    ");
+        fprintf(out, "%s", getVCOpcodeName(instr->op));
+        for (int o = 0; o < instr->operand_count; o++) {
+            fprintf(out, o == 0 ? " " : ", ");
+            writeVCOperand(instr->operands[o], out);
+        }
+        fprintf(out, "\n");
+    }
+    return ferror(out) ? -1 : 0;
+}
+
+//Text input
+
+// Whole line without the end of line; false at the end of the file
+static bool readLine(FILE* in, char** buffer, size_t* capacity) {
+    size_t length = 0;
+    int c;
+    while ((c = fgetc(in)) != EOF && c != '\n') {
+        if (length + 1 >= *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 256;
+            *buffer = checkedRealloc(*buffer, *capacity, ALLOC_CODE);
+        }
+        (*buffer)[length++] = (char)c;
+    }
+    if (c == EOF && length == 0) return false;
+    if (!*buffer) {
+        *capacity = 256;
+        *buffer = checkedMalloc(*capacity, ALLOC_CODE);
+    }
+    if (length > 0 && (*buffer)[length - 1] == '\r') length--;
+    (*buffer)[length] = '\0';
+    return true;
+}
+
+static bool parseRegister(const char* text, int* reg, char** end) {
+    if (text[0] != '$') return false;
+    if (strncmp(text + 1, "SP", 2) == 0) {
+        *reg = VC_REG_SP;
+        *end = (char*)text + 3;
+        return true;
+    }
+    if (text[1] < '0' || text[1] > '9') return false;
+    *reg = (int)strtol(text + 1, end, 10);
+    return true;
+}
+
+// $reg, [$reg], [$reg+k], [$reg-k], [k], an integer, a string literal or a label
+static bool parseOperand(char* text, VCOperand* operand) {
+    char* end;
+    int reg;
+    if (text[0] == '"') {
+        size_t length = strlen(text);
+        if (length < 2 || text[length - 1] != '"') return false;
+        text[length - 1] = '\0';
+        *operand = vcStr(text + 1);
+        return true;
+    }
+    if (text[0] == '$') {
+        if (!parseRegister(text, &reg, &end) || *end) return false;
+        *operand = vcReg(reg);
+        return true;
+    }
+    if (text[0] == '[') {
+        char* inner = text + 1;
+        size_t length = strlen(inner);
+        if (length == 0 || inner[length - 1] != ']') return false;
+        inner[length - 1] = '\0';
+        if (inner[0] != '$') {
+            long address = strtol(inner, &end, 0);
+            if (end == inner || *end) return false;
+            *operand = vcAbsolute(address);
+            return true;
+        }
+        if (!parseRegister(inner, &reg, &end)) return false;
+        long offset = 0;
+        if (*end == '+' || *end == '-') {
+            char* number = end;
+            offset = strtol(number, &end, 0);
+            if (end == number + 1) return false;
+        }
+        if (*end) return false;
+        *operand = vcStack(reg, offset);
+        return true;
+    }
+    if ((text[0] >= '0' && text[0] <= '9') || text[0] == '-' || text[0] == '+') {
+        long value = strtol(text, &end, 0);
+        if (end == text || *end) return false;
+        *operand = vcImm(value);
+        return true;
+    }
+    // Names start with a letter, where '.', ':', '@' and '_' are letters too
+    for (char* c = text; *c; c++) {
+        bool letter = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || strchr(".:@_", *c);
+        if (!letter && (c == text || *c < '0' || *c > '9')) return false;
+    }
+    *operand = vcLabel(text);
+    return true;
+}
+
+// Split the line in place: the opcode, then the operands separated by commas or blanks.
+// Comments start with '#' or ';' outside a string literal.
+static int splitLine(char* line, char** tokens, int max) {
+    int count = 0;
+    char* c = line;
+    while (*c) {
+        while (*c == ' ' || *c == '\t' || *c == ',') c++;
+        if (!*c || *c == '#' || *c == ';') break;
+        if (count == max) return max + 1;
+        tokens[count++] = c;
+        if (*c == '"') {
+            for (c++; *c && *c != '"'; c++) {
+                if (*c == '\\' && c[1]) c++;
+            }
+            if (*c) c++;
+        } else if (*c == '[') {
+            while (*c && *c != ']') c++;
+            if (*c) c++;
+        } else {
+            while (*c && *c != ' ' && *c != '\t' && *c != ',') c++;
+        }
+        if (*c && *c != ' ' && *c != '\t' && *c != ',') return max + 1;   // Glued tokens
+        if (*c) *c++ = '\0';
+    }
+    return count;
+}
+
+VCProgram* readVYPcode(FILE* in) {
+    VCProgram* program = createVCProgram();
+    char* line = NULL;
+    size_t capacity = 0;
+    int number = 0;
+    bool ok = true;
+    while (ok && readLine(in, &line, &capacity)) {
+        number++;
+        char* tokens[5];
+        int count = splitLine(line, tokens, 4);
+        if (count == 0) continue;
+        VCOpcode op = count <= 4 ? findVCOpcode(tokens[0]) : VC_OPCODE_COUNT;
+        if (op == VC_OPCODE_COUNT || count - 1 != getVCOperandCount(op)) {
+            fprintf(stderr, "Error: line %d: unknown instruction or wrong operands.\n", number);
+            ok = false;
+            break;
+        }
+        VCOperand operands[3] = {noOperand, noOperand, noOperand};
+        for (int o = 0; o < count - 1 && ok; o++) {
+            if (!parseOperand(tokens[o + 1], &operands[o])) {
+                fprintf(stderr, "Error: line %d: invalid operand '%s'.\n", number, tokens[o + 1]);
+                ok = false;
+                for (int done = 0; done < o; done++) compilerFree(operands[done].text);
+            }
+        }
+        if (!ok) break;
+        emitVC(program, op, count - 1, operands[0], operands[1], operands[2]);
+    }
+    compilerFree(line);
+    if (!ok) {
+        freeVCProgram(program);
+        return NULL;
+    }
+    return program;
+}
+
+void freeVCProgram(VCProgram* program) {
+    if (!program) return;
+    for (int i = 0; i < program->count; i++) {
+        for (int o = 0; o < program->code[i].operand_count; o++) {
+            compilerFree(program->code[i].operands[o].text);
+        }
+    }
+    compilerFree(program->code);
+    compilerFree(program);
+}
@@ -0,0 +1,109 @@
+#ifndef VYPCODE_H
+#define VYPCODE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define VC_REG_SP -1               // Register number used for $SP
+#define VC_REG_NONE -2             // Stack operand with an absolute address
+
+// VYPcode instructions
+typedef enum {
+    VC_LABEL,
+    VC_CREATE,
+    VC_COPY,
+    VC_GETSIZE,
+    VC_GETWORD,
+    VC_RESIZE,
+    VC_SETWORD,
+    VC_DESTROY,
+    VC_CALL,
+    VC_RETURN,
+    VC_SET,
+    VC_JUMP,
+    VC_JUMPZ,
+    VC_JUMPNZ,
+    VC_READS,
+    VC_WRITES,
+    VC_READI,
+    VC_WRITEI,
+    VC_ADDI,
+    VC_SUBI,
+    VC_MULI,
+    VC_DIVI,
+    VC_LTI,
+    VC_GTI,
+    VC_EQI,
+    VC_LTS,
+    VC_GTS,
+    VC_EQS,
+    VC_AND,
+    VC_OR,
+    VC_NOT,
+    VC_INT2STRING,
+    VC_OPCODE_COUNT
+} VCOpcode;
+
+// Operand addressing
+typedef enum {
+    VC_NONE,
+    VC_REG,                        // $reg
+    VC_STACK,                      // [$reg+value], or [value] without register
+    VC_IMM,                        // Integer literal
+    VC_STR,                        // String literal
+    VC_LABEL_REF,                  // Label name
+} VCOperandKind;
+
+typedef struct {
+    VCOperandKind kind;
+    int reg;                       // Register (VC_REG_SP for $SP)
+    long value;                    // Immediate value or stack offset
+    char* text;                    // String literal content or label name
+} VCOperand;
+
+typedef struct {
+    VCOpcode op;
+    int operand_count;
+    VCOperand operands[3];
+} VCInstr;
+
+// Instruction stream of the whole program
+typedef struct {
+    VCInstr* code;
+    int count;
+    int capacity;
+} VCProgram;
+
+// Operand constructors
+VCOperand vcReg(int reg);
+VCOperand vcStack(int reg, long offset);
+VCOperand vcAbsolute(long address);
+VCOperand vcImm(long value);
+VCOperand vcStr(const char* text);
+VCOperand vcLabel(const char* name);
+
+VCProgram* createVCProgram();
+void emitVC(VCProgram* program, VCOpcode op, int operand_count, VCOperand a, VCOperand b, VCOperand c);
+void emitVC0(VCProgram* program, VCOpcode op);
+void emitVC1(VCProgram* program, VCOpcode op, VCOperand a);
+void emitVC2(VCProgram* program, VCOpcode op, VCOperand a, VCOperand b);
+void emitVC3(VCProgram* program, VCOpcode op, VCOperand a, VCOperand b, VCOperand c);
+bool sameVCOperand(VCOperand a, VCOperand b);
+
+// Move the instructions of from to the end of program; from is freed
+void appendVCProgram(VCProgram* program, VCProgram* from);
+
+const char* getVCOpcodeName(VCOpcode op);
+VCOpcode findVCOpcode(const char* name);    // VC_OPCODE_COUNT when unknown
+int getVCOperandCount(VCOpcode op);
+void writeVCOperand(VCOperand operand, FILE* out);
+int writeVYPcode(VCProgram* program, FILE* out);
+int writeVYPcodeInstructions(VCProgram* program, FILE* out);    // Without the header, for a program written in pieces
+
+// Parse VYPcode text back into an instruction stream. Only the instructions in VCOpcode are
+// accepted; on a lexical or syntax error it prints it with its line and returns NULL.
+VCProgram* readVYPcode(FILE* in);
+void freeVCProgram(VCProgram* program);
+
+#endif // VYPCODE_H
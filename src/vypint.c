@@ -0,0 +1,134 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "vypcode.h"
+#include "interp.h"
+#include "alloc.h"
+#include "bytecode.h"
+
+static void printUsage(const char* name) {
+    fprintf(stderr, "Usage: %s [options] <program.vc or bytecode container>\n", name);
+    fprintf(stderr, "  --regs=N     general purpose registers (default %d)\n", VM_DEFAULT_REGISTERS);
+    fprintf(stderr, "  --stack=N    words of the stack (default %d)\n", VM_DEFAULT_STACK);
+    fprintf(stderr, "  --nursery=N  words of the young generation (default %d)\n", HEAP_DEFAULT_NURSERY);
+    fprintf(stderr, "  --heap=N     most words of chunks, nursery included (default no limit)\n");
+    fprintf(stderr, "  --profile=F  write the counters of the run into F for vypcomp --profile-use=F\n");
+    fprintf(stderr, "  --verbose    print every executed instruction into stderr\n");
+    fprintf(stderr, "  --no-fuse    run every instruction with its own dispatch, without superinstructions\n");
+    fprintf(stderr, "  --stats      print the executed instructions and the time into stderr\n");
+}
+
+static double elapsedMilliseconds(struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1000.0 + (end.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+    // Options go before the program, like in the reference interpreter
+    setAllocFailureStatus(VM_ERROR_INTERNAL);
+    VMOptions options;
+    initVMOptions(&options);
+    bool stats = false;
+    const char* profileName = NULL;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strncmp(argv[argi], "--regs=", 7) == 0) {
+            options.registers = atoi(argv[argi] + 7);
+        } else if (strncmp(argv[argi], "--stack=", 8) == 0) {
+            options.stack_size = atol(argv[argi] + 8);
+        } else if (strncmp(argv[argi], "--nursery=", 10) == 0) {
+            options.nursery_size = atol(argv[argi] + 10);
+        } else if (strncmp(argv[argi], "--heap=", 7) == 0) {
+            options.heap_limit = atol(argv[argi] + 7);
+        } else if (strncmp(argv[argi], "--profile=", 10) == 0) {
+            profileName = argv[argi] + 10;
+        } else if (strcmp(argv[argi], "--verbose") == 0) {
+            options.verbose = true;
+        } else if (strcmp(argv[argi], "--no-fuse") == 0) {
+            options.fuse = false;
+        } else if (strcmp(argv[argi], "--silent") == 0) {
+            options.verbose = false;                // No debugging instructions are supported
+        } else if (strcmp(argv[argi], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[argi], "--help") == 0) {
+            printUsage(argv[0]);
+            return VM_OK;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[argi]);
+            return VM_ERROR_ARGUMENTS;
+        }
+    }
+    if (argi + 1 != argc || options.registers < 1 || options.stack_size < 1 ||
+        options.nursery_size < 1 || options.heap_limit < 0) {
+        printUsage(argv[0]);
+        return VM_ERROR_ARGUMENTS;
+    }
+
+    FILE* inputFile = fopen(argv[argi], "r");
+    if (!inputFile) {
+        perror("Error opening file");
+        return VM_ERROR_ARGUMENTS;
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // A bytecode container from vypcomp --binary is mapped as it is, the text is parsed and decoded
+    int status;
+    VCProgram* program = NULL;
+    VMCode* code;
+    if (isBytecodeFile(inputFile)) {
+        fclose(inputFile);
+        code = mapBytecode(argv[argi], &options, &status);
+        if (!code) return status;
+    } else {
+        program = readVYPcode(inputFile);
+        fclose(inputFile);
+        if (!program) return VM_ERROR_SYNTAX;
+        code = decodeVYPcode(program, &options, &status);
+        if (!code) {
+            freeVCProgram(program);
+            return status;
+        }
+    }
+    double loadTime = elapsedMilliseconds(&start);
+
+    // Full buffering; the engine flushes stdout before it reads stdin
+    static char outputBuffer[1 << 16];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+    VMStats run;
+    if (profileName) options.profile = createProfile();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    status = runVYPcode(code, &options, &run);
+    double runTime = elapsedMilliseconds(&start);
+
+    // The profile of a run that failed still counts what ran before the error
+    if (profileName) {
+        FILE* profileFile = fopen(profileName, "w");
+        if (!profileFile || writeProfile(options.profile, profileFile) != 0) {
+            perror("Error writing the profile");
+            if (status == VM_OK) status = VM_ERROR_ARGUMENTS;
+        }
+        if (profileFile) fclose(profileFile);
+        freeProfile(options.profile);
+    }
+    if (stats && status == VM_OK) {
+        fprintf(stderr, "Loaded %d instructions in %.3f ms.\n", code->count, loadTime);
+        fprintf(stderr, "Executed %lld instructions (%lld calls, %lld chunks created) in %.3f ms.\n",
+                run.instructions, run.calls, run.chunks, runTime);
+        fprintf(stderr, "Dispatched %lld handlers, %lld of them superinstructions.\n",
+                run.instructions - run.superinstructions, run.superinstructions);
+        fprintf(stderr, "Inline caches: %lld hits, %lld misses, %d polymorphic and %d megamorphic sites.\n",
+                run.cache_hits, run.cache_misses, run.polymorphic_sites, run.megamorphic_sites);
+        fprintf(stderr, "Garbage collection: %lld minor, %lld major, %lld chunks promoted, %lld freed, "
+                "peak %lld words, pauses %.3f ms total and %.3f ms max.\n",
+                run.heap.minor_collections, run.heap.major_collections, run.heap.promoted, run.heap.freed,
+                (long long)run.heap.peak_words, run.heap.total_pause, run.heap.max_pause);
+    }
+
+    freeVMCode(code);
+    if (program) freeVCProgram(program);
+    return status;
+}
@@ -0,0 +1,634 @@
+#include "x86.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MAX_LABEL 256
+#define MAX_OPERAND 32
+#define OPERAND_BUFFERS 4              // Operands of one instruction that can be alive at once
+
+// Machine registers of the virtual registers. They are callee-saved in the C convention, so the
+// runtime keeps them; the allocator already moves the values that live across a VYP call to
+// the frame, so the VYP functions do not save them either.
+static const char* const machineRegisters[X86_REGISTER_COUNT] = {"%rbx", "%r12", "%r13", "%r14", "%r15"};
+
+// State of the generation of one function
+typedef struct {
+    IRProgram* program;
+    FILE* out;
+    IRFunction* function;          // Function being translated
+    RegisterAllocation* allocation;
+    ProgramLayout* layout;         // Attribute offsets and vtables of the classes
+    char** strings;                // Literals of the read-only data, .Lstr.N is strings[N]
+    int string_count;
+    int string_capacity;
+    char operands[OPERAND_BUFFERS][MAX_OPERAND];
+    int next_operand;
+    bool failed;
+} X86Generator;
+
+static void reportError(X86Generator* gen, const char* message, const char* detail) {
+    fprintf(stderr, "Error: %s '%s'.\n", message, detail ? detail : "?");
+    gen->failed = true;
+}
+
+// One instruction per line, indented like the output of gcc -S
+static void emit(X86Generator* gen, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    fputc('\t', gen->out);
+    vfprintf(gen->out, format, args);
+    fputc('\n', gen->out);
+    va_end(args);
+}
+
+// Stack bytes of a number of words, keeping %rsp aligned to 16 bytes for the calls
+static int alignedBytes(int words) {
+    return (words * 8 + 15) / 16 * 16;
+}
+
+//Labels
+
+static void functionLabel(char* buffer, const char* name) {
+    snprintf(buffer, MAX_LABEL, "f.%s", name);
+}
+
+static void localLabel(char* buffer, IRFunction* function, long label) {
+    snprintf(buffer, MAX_LABEL, ".L%s.%ld", function->name, label);
+}
+
+static void newRoutineLabel(char* buffer, const char* className) {
+    snprintf(buffer, MAX_LABEL, "n.%s", className);
+}
+
+// Number of the read-only string with the text of a literal, escapes included
+static int internString(X86Generator* gen, const char* text) {
+    for (int s = 0; s < gen->string_count; s++) {
+        if (strcmp(gen->strings[s], text) == 0) return s;
+    }
+    if (gen->string_count == gen->string_capacity) {
+        gen->string_capacity = gen->string_capacity ? gen->string_capacity * 2 : 64;
+        gen->strings = checkedRealloc(gen->strings, gen->string_capacity * sizeof(char*), ALLOC_CODE);
+    }
+    gen->strings[gen->string_count] = checkedCalloc(strlen(text) + 1, 1, ALLOC_CODE);
+    strcpy(gen->strings[gen->string_count], text);
+    return gen->string_count++;
+}
+
+//Locations
+
+// Operand that reads or writes a virtual register
+static const char* valueOperand(X86Generator* gen, int value) {
+    char* buffer = gen->operands[gen->next_operand++ % OPERAND_BUFFERS];
+    ValueLocation location = gen->allocation->locations[value];
+    switch (location.kind) {
+        case LOCATION_REGISTER:
+            snprintf(buffer, MAX_OPERAND, "%s", machineRegisters[location.index]);
+            break;
+        case LOCATION_STACK:
+            snprintf(buffer, MAX_OPERAND, "%d(%%rbp)", -8 * location.index);
+            break;
+        case LOCATION_PARAM:
+            // Arguments are just above the return address: 16(%rbp) is the first one
+            snprintf(buffer, MAX_OPERAND, "%d(%%rbp)", 16 + 8 * location.index);
+            break;
+        default:
+            snprintf(buffer, MAX_OPERAND, "$0");
+            break;
+    }
+    return buffer;
+}
+
+static bool inRegister(X86Generator* gen, int value) {
+    return gen->allocation->locations[value].kind == LOCATION_REGISTER;
+}
+
+static void loadValue(X86Generator* gen, int value, const char* reg) {
+    const char* source = valueOperand(gen, value);
+    if (strcmp(source, reg) != 0) emit(gen, "movq %s, %s", source, reg);
+}
+
+// Register where an instruction can write a virtual register
+static const char* destRegister(X86Generator* gen, int value) {
+    return inRegister(gen, value) ? valueOperand(gen, value) : "%rax";
+}
+
+// Move %rax to the home of a virtual register kept in the frame
+static void storeDest(X86Generator* gen, int value) {
+    LocationKind kind = gen->allocation->locations[value].kind;
+    if (kind == LOCATION_STACK || kind == LOCATION_PARAM) {
+        emit(gen, "movq %%rax, %s", valueOperand(gen, value));
+    }
+}
+
+static void storeResult(X86Generator* gen, int value) {
+    if (value < 0 || gen->allocation->locations[value].kind == LOCATION_NONE) return;
+    if (inRegister(gen, value)) {
+        emit(gen, "movq %%rax, %s", valueOperand(gen, value));
+    } else {
+        storeDest(gen, value);
+    }
+}
+
+static void emitConstant(X86Generator* gen, int dst, long value) {
+    if (gen->allocation->locations[dst].kind == LOCATION_NONE) return;
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+        emit(gen, "movq $%ld, %s", value, valueOperand(gen, dst));
+    } else {
+        const char* reg = destRegister(gen, dst);
+        emit(gen, "movabsq $%ld, %s", value, reg);
+        storeDest(gen, dst);
+    }
+}
+
+static void emitMove(X86Generator* gen, int dst, int src) {
+    if (gen->allocation->locations[dst].kind == LOCATION_NONE) return;
+    if (inRegister(gen, dst) || inRegister(gen, src)) {
+        loadValue(gen, src, valueOperand(gen, dst));
+    } else {
+        loadValue(gen, src, "%rax");
+        storeDest(gen, dst);
+    }
+}
+
+// add, sub and imul take the second operand from a register or memory
+static void emitBinary(X86Generator* gen, const char* op, IRInstr* instr) {
+    const char* dst = destRegister(gen, instr->dst);
+    if (strcmp(dst, "%rax") != 0 && strcmp(valueOperand(gen, instr->src2), dst) == 0 && instr->src1 != instr->src2) {
+        dst = "%rax";                              // Loading src1 would overwrite src2
+    }
+    loadValue(gen, instr->src1, dst);
+    emit(gen, "%s %s, %s", op, valueOperand(gen, instr->src2), dst);
+    if (strcmp(dst, "%rax") == 0) storeResult(gen, instr->dst);
+}
+
+static void emitNullCheck(X86Generator* gen, const char* reg) {
+    emit(gen, "testq %s, %s", reg, reg);
+    emit(gen, "jnz 1f");
+    emit(gen, "call vyp_null_error");
+    fprintf(gen->out, "1:\n");
+}
+
+// Truncating division like DIVI; the runtime stops the program on a zero divisor and idiv
+// would trap on the only overflow, so a divisor of -1 just negates
+static void emitDivision(X86Generator* gen, IRInstr* instr) {
+    loadValue(gen, instr->src2, "%rcx");
+    emit(gen, "testq %%rcx, %%rcx");
+    emit(gen, "jnz 1f");
+    loadValue(gen, instr->src1, "%rdi");
+    emit(gen, "call vyp_division_error");
+    fprintf(gen->out, "1:\n");
+    loadValue(gen, instr->src1, "%rax");
+    emit(gen, "cmpq $-1, %%rcx");
+    emit(gen, "jne 2f");
+    emit(gen, "negq %%rax");
+    emit(gen, "jmp 3f");
+    fprintf(gen->out, "2:\n");
+    emit(gen, "cqto");
+    emit(gen, "idivq %%rcx");
+    fprintf(gen->out, "3:\n");
+    storeResult(gen, instr->dst);
+}
+
+//Comparisons
+
+// Condition code of a comparison and of its negation
+static const char* conditionCode(IROpcode op, bool negated) {
+    switch (op) {
+        case IR_LT: return negated ? "ge" : "l";
+        case IR_GT: return negated ? "le" : "g";
+        case IR_LE: return negated ? "g" : "le";
+        case IR_GE: return negated ? "l" : "ge";
+        case IR_EQ: return negated ? "ne" : "e";
+        default: return negated ? "e" : "ne";
+    }
+}
+
+// Strings are compared by the runtime, whose result is compared against 0 with the same
+// condition. When the next instruction branches on the result the flags are still there, so
+// the branch needs no test; returns whether it was emitted.
+static bool emitComparison(X86Generator* gen, IRInstr* instr) {
+    if (gen->function->values[instr->src1].type == IR_TYPE_STRING) {
+        loadValue(gen, instr->src1, "%rdi");
+        loadValue(gen, instr->src2, "%rsi");
+        emit(gen, "call vyp_compare_strings");
+        emit(gen, "cmpq $0, %%rax");
+    } else {
+        loadValue(gen, instr->src1, "%rax");
+        emit(gen, "cmpq %s, %%rax", valueOperand(gen, instr->src2));
+    }
+    emit(gen, "set%s %%al", conditionCode(instr->op, false));
+    emit(gen, "movzbl %%al, %%eax");       // mov and movzbl keep the flags
+    storeResult(gen, instr->dst);
+
+    IRInstr* next = instr->next;
+    if (!next || (next->op != IR_JUMPZ && next->op != IR_JUMPNZ) || next->src1 != instr->dst) return false;
+    char label[MAX_LABEL];
+    localLabel(label, gen->function, next->imm);
+    emit(gen, "j%s %s", conditionCode(instr->op, next->op == IR_JUMPZ), label);
+    return true;
+}
+
+//Calls
+
+// Calling convention: the caller reserves the words of the arguments at (%rsp) and the callee
+// finds them at 16(%rbp); the result comes back in %rax. %rsp stays aligned to 16 bytes.
+static int emitArguments(X86Generator* gen, int* args, int count) {
+    int bytes = alignedBytes(count);
+    if (bytes > 0) emit(gen, "subq $%d, %%rsp", bytes);
+    for (int i = 0; i < count; i++) {
+        if (inRegister(gen, args[i])) {
+            emit(gen, "movq %s, %d(%%rsp)", valueOperand(gen, args[i]), 8 * i);
+        } else {
+            loadValue(gen, args[i], "%rax");
+            emit(gen, "movq %%rax, %d(%%rsp)", 8 * i);
+        }
+    }
+    return bytes;
+}
+
+static void releaseArguments(X86Generator* gen, int bytes) {
+    if (bytes > 0) emit(gen, "addq $%d, %%rsp", bytes);
+}
+
+// Label of the code that a call runs, decided like the VYPcode generator does it. Fails for a
+// method with overrides in the subclasses of the static class of the receiver.
+static bool findStaticTarget(X86Generator* gen, IRInstr* instr, char* label, int* slot) {
+    *slot = -1;
+    if (instr->op == IR_CALL_METHOD) {
+        const char* staticClass = gen->function->values[instr->args[0]].className;
+        const char* method = strchr(instr->name, '.');
+        *slot = method ? getMethodSlot(gen->layout, staticClass, method + 1) : -1;
+        if (*slot >= 0 && isMethodOverridden(gen->layout, staticClass, *slot)) return false;
+    }
+    functionLabel(label, instr->name);
+    return true;
+}
+
+static void emitCall(X86Generator* gen, IRInstr* instr) {
+    char label[MAX_LABEL];
+    int slot;
+    int bytes = emitArguments(gen, instr->args, instr->arg_count);
+    if (findStaticTarget(gen, instr, label, &slot)) {
+        emit(gen, "call %s", label);
+    } else {
+        // vtable = receiver[0]; target = vtable[VTABLE_FIRST_METHOD + slot]
+        emit(gen, "movq (%%rsp), %%rax");
+        emitNullCheck(gen, "%rax");
+        emit(gen, "movq (%%rax), %%rax");
+        emit(gen, "call *%d(%%rax)", 8 * (VTABLE_FIRST_METHOD + slot));
+    }
+    releaseArguments(gen, bytes);
+    storeResult(gen, instr->dst);
+}
+
+// A call whose result is returned right away, with as many arguments as the function has
+// parameters: they replace the parameters and the callee returns straight to our caller
+static bool isTailCall(X86Generator* gen, IRInstr* instr, char* label) {
+    if (instr->op != IR_CALL && instr->op != IR_CALL_METHOD) return false;
+    IRInstr* next = instr->next;
+    int slot;
+    return next && next->op == IR_RETURN && (next->src1 < 0 || next->src1 == instr->dst) &&
+           instr->arg_count == gen->function->param_count && findStaticTarget(gen, instr, label, &slot);
+}
+
+static void emitTailCall(X86Generator* gen, const char* label, IRInstr* instr) {
+    // The new arguments are all read before the first parameter is overwritten
+    emitArguments(gen, instr->args, instr->arg_count);
+    for (int i = 0; i < instr->arg_count; i++) {
+        emit(gen, "movq %d(%%rsp), %%rax", 8 * i);
+        emit(gen, "movq %%rax, %d(%%rbp)", 16 + 8 * i);
+    }
+    emit(gen, "leave");
+    emit(gen, "jmp %s", label);
+}
+
+// vyp_concat(count, pieces) takes the pieces from an array in the stack
+static void emitConcat(X86Generator* gen, IRInstr* instr) {
+    int bytes = emitArguments(gen, instr->args, instr->arg_count);
+    emit(gen, "movq $%d, %%rdi", instr->arg_count);
+    emit(gen, "movq %%rsp, %%rsi");
+    emit(gen, "call vyp_concat");
+    releaseArguments(gen, bytes);
+    storeResult(gen, instr->dst);
+}
+
+//Instructions
+
+// Returns whether the next instruction was translated with this one
+static bool generateInstr(X86Generator* gen, IRInstr* instr) {
+    IRValue* values = gen->function->values;
+    char label[MAX_LABEL];
+
+    switch (instr->op) {
+        case IR_CONST_INT:
+            emitConstant(gen, instr->dst, instr->imm);
+            break;
+        case IR_CONST_STR:
+            if (gen->allocation->locations[instr->dst].kind == LOCATION_NONE) break;
+            emit(gen, "leaq .Lstr.%d(%%rip), %s", internString(gen, instr->name), destRegister(gen, instr->dst));
+            storeDest(gen, instr->dst);
+            break;
+        case IR_MOVE:
+            emitMove(gen, instr->dst, instr->src1);
+            break;
+        case IR_ADD: emitBinary(gen, "addq", instr); break;
+        case IR_SUB: emitBinary(gen, "subq", instr); break;
+        case IR_MUL: emitBinary(gen, "imulq", instr); break;
+        case IR_DIV: emitDivision(gen, instr); break;
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE:
+        case IR_EQ:
+        case IR_NE:
+            return emitComparison(gen, instr);
+        case IR_NOT:
+            emit(gen, "cmpq $0, %s", valueOperand(gen, instr->src1));
+            emit(gen, "sete %%al");
+            emit(gen, "movzbl %%al, %%eax");
+            storeResult(gen, instr->dst);
+            break;
+        case IR_NEG:
+            loadValue(gen, instr->src1, "%rax");
+            emit(gen, "negq %%rax");
+            storeResult(gen, instr->dst);
+            break;
+        case IR_CONCAT:
+            emitConcat(gen, instr);
+            break;
+        case IR_INT2STR:
+            loadValue(gen, instr->src1, "%rdi");
+            emit(gen, "call vyp_int2string");
+            storeResult(gen, instr->dst);
+            break;
+        case IR_STRLEN:
+            loadValue(gen, instr->src1, "%rax");
+            emit(gen, "movq (%%rax), %%rax");
+            storeResult(gen, instr->dst);
+            break;
+        case IR_SUBSTR:
+            loadValue(gen, instr->args[0], "%rdi");
+            loadValue(gen, instr->args[1], "%rsi");
+            loadValue(gen, instr->args[2], "%rdx");
+            emit(gen, "call vyp_substr");
+            storeResult(gen, instr->dst);
+            break;
+        case IR_READ_INT:
+        case IR_READ_STR:
+            emit(gen, "call %s", instr->op == IR_READ_INT ? "vyp_read_int" : "vyp_read_string");
+            storeResult(gen, instr->dst);
+            break;
+        case IR_PRINT: {
+            IRType type = values[instr->src1].type;
+            if (type != IR_TYPE_INT && type != IR_TYPE_STRING) {
+                reportError(gen, "print of a value that is not primitive in", gen->function->name);
+                break;
+            }
+            loadValue(gen, instr->src1, "%rdi");
+            emit(gen, "call %s", type == IR_TYPE_INT ? "vyp_print_int" : "vyp_print_string");
+            break;
+        }
+        case IR_NEW:
+            newRoutineLabel(label, instr->name);
+            emit(gen, "call %s", label);
+            storeResult(gen, instr->dst);
+            break;
+        case IR_GETFIELD: {
+            int index = getFieldOffset(gen->layout, values[instr->src1].className, instr->name);
+            if (index < 0) {
+                reportError(gen, "unknown attribute", instr->name);
+                break;
+            }
+            loadValue(gen, instr->src1, "%rax");
+            emitNullCheck(gen, "%rax");
+            emit(gen, "movq %d(%%rax), %%rax", 8 * index);
+            storeResult(gen, instr->dst);
+            break;
+        }
+        case IR_SETFIELD: {
+            int index = getFieldOffset(gen->layout, values[instr->src1].className, instr->name);
+            if (index < 0) {
+                reportError(gen, "unknown attribute", instr->name);
+                break;
+            }
+            loadValue(gen, instr->src1, "%rax");
+            emitNullCheck(gen, "%rax");
+            loadValue(gen, instr->src2, "%rcx");
+            emit(gen, "movq %%rcx, %d(%%rax)", 8 * index);
+            break;
+        }
+        case IR_CALL:
+        case IR_CALL_METHOD:
+            emitCall(gen, instr);
+            break;
+        case IR_LABEL:
+            localLabel(label, gen->function, instr->imm);
+            fprintf(gen->out, "%s:\n", label);
+            break;
+        case IR_JUMP:
+            localLabel(label, gen->function, instr->imm);
+            emit(gen, "jmp %s", label);
+            break;
+        case IR_JUMPZ:
+        case IR_JUMPNZ:
+            localLabel(label, gen->function, instr->imm);
+            emit(gen, "cmpq $0, %s", valueOperand(gen, instr->src1));
+            emit(gen, "%s %s", instr->op == IR_JUMPZ ? "je" : "jne", label);
+            break;
+        case IR_RETURN:
+            if (instr->src1 >= 0) loadValue(gen, instr->src1, "%rax");
+            emit(gen, "leave");
+            emit(gen, "ret");
+            break;
+        default:
+            reportError(gen, "unsupported intermediate instruction", getIROpcodeName(instr->op));
+            break;
+    }
+    return false;
+}
+
+static void generateFunction(X86Generator* gen, IRFunction* function, X86Stats* stats) {
+    char label[MAX_LABEL];
+    gen->function = function;
+    gen->allocation = allocateRegisters(function, X86_REGISTER_COUNT, NULL);
+
+    functionLabel(label, function->name);
+    fprintf(gen->out, "\n%s:\n", label);
+    emit(gen, "pushq %%rbp");
+    emit(gen, "movq %%rsp, %%rbp");
+    if (gen->allocation->frame_size > 0) emit(gen, "subq $%d, %%rsp", alignedBytes(gen->allocation->frame_size));
+
+    // Parameters that got a register are loaded once
+    for (int v = 0; v < function->value_count; v++) {
+        if (function->values[v].paramIndex >= 0 && inRegister(gen, v)) {
+            emit(gen, "movq %d(%%rbp), %s", 16 + 8 * function->values[v].paramIndex, valueOperand(gen, v));
+        }
+    }
+
+    for (IRInstr* instr = function->first; instr; instr = instr->next) {
+        if (isTailCall(gen, instr, label)) {
+            emitTailCall(gen, label, instr);
+            instr = instr->next;                   // The return is done by the callee
+        } else if (generateInstr(gen, instr)) {
+            instr = instr->next;
+        }
+    }
+
+    if (stats) {
+        stats->function_count++;
+        stats->register_values += gen->allocation->register_count;
+        stats->spilled_values += gen->allocation->spilled_count;
+    }
+    freeRegisterAllocation(gen->allocation);
+    gen->allocation = NULL;
+}
+
+//Runtime routines
+
+// Create the object, initialize its attributes and run the constructor chain
+static void generateNewRoutine(X86Generator* gen, ASTClassNode* classNode) {
+    ClassLayout* objectLayout = findClassLayout(gen->layout, classNode->name);
+    if (!objectLayout) {
+        reportError(gen, "no object layout (inheritance cycle?) for the class", classNode->name);
+        return;
+    }
+
+    char label[MAX_LABEL];
+    newRoutineLabel(label, classNode->name);
+    fprintf(gen->out, "\n%s:\n", label);
+    emit(gen, "pushq %%rbp");
+    emit(gen, "movq %%rsp, %%rbp");
+    emit(gen, "subq $16, %%rsp");
+    emit(gen, "movq $%d, %%rdi", objectLayout->size);
+    emit(gen, "call vyp_new_object");              // Zeroed, the integers and objects are ready
+    emit(gen, "leaq vt.%s(%%rip), %%rcx", classNode->name);
+    emit(gen, "movq %%rcx, (%%rax)");
+    for (int f = 0; f < objectLayout->field_count; f++) {
+        FieldLayout* field = &objectLayout->fields[f];
+        if (strcmp(field->type, "string") != 0) continue;
+        emit(gen, "leaq .Lstr.%d(%%rip), %%rcx", internString(gen, ""));
+        emit(gen, "movq %%rcx, %d(%%rax)", 8 * field->offset);
+    }
+    emit(gen, "movq %%rax, -8(%%rbp)");
+
+    // Constructors from the root of the hierarchy down to the class itself
+    ASTClassNode* chain[MAX_SYMBOLS];
+    int depth = 0;
+    for (ASTClassNode* current = classNode; current && depth < MAX_SYMBOLS;
+         current = findIRClass(gen->program, current->parent)) {
+        chain[depth++] = current;
+    }
+    while (depth > 0) {
+        ASTClassNode* current = chain[--depth];
+        for (ASTNode* member = current->members; member; member = member->next) {
+            if (member->type != AST_FUNCTION || strcmp(((ASTFunctionNode*)member)->name, current->name) != 0) {
+                continue;
+            }
+            emit(gen, "subq $16, %%rsp");
+            emit(gen, "movq -8(%%rbp), %%rax");
+            emit(gen, "movq %%rax, (%%rsp)");
+            emit(gen, "call f.%s.%s", current->name, current->name);
+            emit(gen, "addq $16, %%rsp");
+        }
+    }
+
+    emit(gen, "movq -8(%%rbp), %%rax");
+    emit(gen, "leave");
+    emit(gen, "ret");
+}
+
+// vyp_main is called by the C main of the runtime, so it keeps the registers C expects back
+static void generateEntry(X86Generator* gen) {
+    fprintf(gen->out, "\t.text\n\t.globl vyp_main\n\t.type vyp_main, @function\nvyp_main:\n");
+    emit(gen, "pushq %%rbp");
+    emit(gen, "movq %%rsp, %%rbp");
+    for (int r = 0; r < X86_REGISTER_COUNT; r++) emit(gen, "pushq %s", machineRegisters[r]);
+    emit(gen, "subq $%d, %%rsp", alignedBytes(X86_REGISTER_COUNT) - 8 * X86_REGISTER_COUNT);
+    emit(gen, "call f.main");
+    emit(gen, "addq $%d, %%rsp", alignedBytes(X86_REGISTER_COUNT) - 8 * X86_REGISTER_COUNT);
+    for (int r = X86_REGISTER_COUNT - 1; r >= 0; r--) emit(gen, "popq %s", machineRegisters[r]);
+    emit(gen, "popq %%rbp");
+    emit(gen, "ret");
+}
+
+// Word 0 of every object points to the vtable of its class
+static void generateVtables(X86Generator* gen) {
+    fprintf(gen->out, "\n\t.data\n\t.balign 8\n");
+    for (int c = 0; c < gen->layout->class_count; c++) {
+        ClassLayout* current = &gen->layout->classes[c];
+        fprintf(gen->out, "vt.%s:\n", current->name);
+        emit(gen, ".quad .Lstr.%d", internString(gen, current->name));
+        for (int m = 0; m < current->method_count; m++) {
+            emit(gen, ".quad f.%s.%s", current->methods[m].owner, current->methods[m].name);
+        }
+    }
+}
+
+// The literals are decoded now, the runtime gets its code points ready to use
+static void generateStrings(X86Generator* gen) {
+    fprintf(gen->out, "\n\t.section .rodata\n\t.balign 8\n");
+    for (int s = 0; s < gen->string_count; s++) {
+        const char* text = gen->strings[s];
+        size_t length = strlen(text);
+        int64_t* codes = checkedCalloc(length, sizeof(int64_t), ALLOC_CODE);
+        int count = 0;
+        for (size_t i = 0; i < length; ) {
+            unsigned char c = (unsigned char)text[i];
+            if (c == '\\' && text[i + 1] == 'x') {
+                codes[count++] = strtoll((char[7]){text[i + 2], text[i + 3], text[i + 4], text[i + 5],
+                                                   text[i + 6], text[i + 7], '\0'}, NULL, 16);
+                i += 8;
+            } else if (c == '\\' && text[i + 1] != '\0') {
+                codes[count++] = text[i + 1] == 'n' ? '\n' : text[i + 1] == 't' ? '\t' : text[i + 1];
+                i += 2;
+            } else {
+                // UTF-8 of the source, an invalid byte is taken as its own code point
+                int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+                int64_t value = c & (0x3F >> extra);
+                bool valid = extra > 0 && i + extra < length;
+                for (int k = 1; valid && k <= extra; k++) {
+                    valid = ((unsigned char)text[i + k] & 0xC0) == 0x80;
+                    value = (value << 6) | ((unsigned char)text[i + k] & 0x3F);
+                }
+                codes[count++] = valid ? value : c;
+                i += valid ? extra + 1 : 1;
+            }
+        }
+        fprintf(gen->out, ".Lstr.%d:\n\t.quad %d", s, count);
+        for (int c = 0; c < count; c++) {
+            fprintf(gen->out, c % 8 == 0 ? "\n\t.quad %lld" : ", %lld", (long long)codes[c]);
+        }
+        fputc('\n', gen->out);
+        compilerFree(codes);
+    }
+}
+
+int generateX86(IRProgram* program, FILE* out, X86Stats* stats) {
+    X86Generator gen;
+    memset(&gen, 0, sizeof(gen));
+    gen.program = program;
+    gen.out = out;
+    gen.layout = buildProgramLayout(program);
+    if (stats) memset(stats, 0, sizeof(X86Stats));
+
+    generateEntry(&gen);
+    for (IRFunction* function = program->functions; function; function = function->next) {
+        generateFunction(&gen, function, stats);
+    }
+    for (ASTNode* node = program->ast->classes; node; node = node->next) {
+        generateNewRoutine(&gen, (ASTClassNode*)node);
+    }
+    generateVtables(&gen);
+    generateStrings(&gen);
+    fprintf(out, "\n\t.section .note.GNU-stack,\"\",@progbits\n");
+
+    if (stats) stats->string_count = gen.string_count;
+    for (int s = 0; s < gen.string_count; s++) compilerFree(gen.strings[s]);
+    compilerFree(gen.strings);
+    freeProgramLayout(gen.layout);
+    return gen.failed || ferror(out) ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#ifndef X86_H
+#define X86_H
+
+#include "ir.h"
+#include "regalloc.h"
+#include "layout.h"
+#include <stdio.h>
+
+#define X86_REGISTER_COUNT 5       // %rbx, %r12 - %r15 hold virtual registers
+
+// Totals of the native code generation
+typedef struct {
+    int function_count;
+    int register_values;           // Virtual registers kept in machine registers
+    int spilled_values;            // Virtual registers kept in the frame
+    int string_count;              // Literals in the read-only data
+} X86Stats;
+
+// Translate the intermediate code into x86-64 assembly (GNU as, AT&T syntax) for Linux. The
+// program starts at vyp_main and needs the runtime of runtime.c:
+//     vypcomp --x86 program.vyp program.s && cc program.s vyprt.o -o program
+// Returns 0 on success.
+int generateX86(IRProgram* program, FILE* out, X86Stats* stats);
+
+#endif // X86_H